@@ -35,6 +35,8 @@
 const short defaultSfxVolume = 100;
 const short defaultMusicVolume = 60;
 
+class Label;
+
 class Setup_Audio : public SetupTabContainer, public gcn::ActionListener
 {
     public:
@@ -50,8 +52,8 @@ class Setup_Audio : public SetupTabContainer, public gcn::ActionListener
         int mMusicVolume, mSfxVolume;
         bool mSoundEnabled;
 
-        gcn::Label *mSfxLabel;
-        gcn::Label *mMusicLabel;
+        Label *mSfxLabel;
+        Label *mMusicLabel;
 
         gcn::CheckBox *mSoundCheckBox;
         gcn::Slider *mSfxSlider, *mMusicSlider;
@@ -32,6 +32,7 @@
 
 #include "../../widgets/setuptabcontainer.h"
 
+class Label;
 class RichTextBox;
 class TextField;
 class TextPreview;
@@ -62,25 +63,25 @@ class Setup_Colors : public SetupTabContainer, public gcn::ActionListener,
         gcn::ScrollArea *mPreviewBox;
         int mSelected;
 
-        gcn::Label *mGradTypeLabel;
+        Label *mGradTypeLabel;
         gcn::Slider *mGradTypeSlider;
-        gcn::Label *mGradTypeText;
+        Label *mGradTypeText;
 
-        gcn::Label *mGradDelayLabel;
+        Label *mGradDelayLabel;
         gcn::Slider *mGradDelaySlider;
         TextField *mGradDelayText;
 
-        gcn::Label *mRedLabel;
+        Label *mRedLabel;
         gcn::Slider *mRedSlider;
         TextField *mRedText;
         int mRedValue;
 
-        gcn::Label *mGreenLabel;
+        Label *mGreenLabel;
         gcn::Slider *mGreenSlider;
         TextField *mGreenText;
         int mGreenValue;
 
-        gcn::Label *mBlueLabel;
+        Label *mBlueLabel;
         gcn::Slider *mBlueSlider;
         TextField *mBlueText;
         int mBlueValue;
@@ -29,6 +29,7 @@
 
 #include "../../widgets/setuptabcontainer.h"
 
+class Label;
 class ModeListModel;
 
 class Setup_Display : public SetupTabContainer, public gcn::ActionListener
@@ -55,10 +56,10 @@ class Setup_Display : public SetupTabContainer, public gcn::ActionListener
 
         ModeListModel *mModeListModel;
 
-        gcn::Label *mAlphaLabel;
-        gcn::Label *mMouseAlphaLabel;
-        gcn::Label *mFpsLabel;
-        gcn::Label *mFontLabel;
+        Label *mAlphaLabel;
+        Label *mMouseAlphaLabel;
+        Label *mFpsLabel;
+        Label *mFontLabel;
 
         gcn::ScrollArea *mScrollArea;
 
@@ -74,7 +75,7 @@ class Setup_Display : public SetupTabContainer, public gcn::ActionListener
 
         int mFontSize;
         gcn::Slider *mFontSizeSlider;
-        gcn::Label *mFontSizeLabel;
+        Label *mFontSizeLabel;
 };
 
 #endif
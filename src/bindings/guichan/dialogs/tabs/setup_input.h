@@ -32,6 +32,8 @@
 
 #include "../../widgets/setuptabcontainer.h"
 
+class Label;
+
 class Setup_Input : public SetupTabContainer, public gcn::ActionListener,
                     public gcn::SelectionListener
 {
@@ -77,7 +79,7 @@ class Setup_Input : public SetupTabContainer, public gcn::ActionListener,
     private:
         class KeyListModel *mKeyListModel;
 
-        gcn::Label *mCalibrateLabel;
+        Label *mCalibrateLabel;
         gcn::CheckBox *mJoystickCheckbox;
 
         gcn::ListBox *mKeyList;
@@ -199,6 +199,12 @@ class Graphics : public gcn::Graphics
          */
         virtual SDL_Surface* getScreenshot() = 0;
 
+        /**
+         * Returns the number of draw calls made during the last frame, or 0
+         * when the renderer doesn't keep track of them.
+         */
+        virtual int getDrawCalls() const { return 0; }
+
         /**
          * Whether the graphics are available for drawing or not.
          */
@@ -46,6 +46,7 @@
 #include "../../core/configuration.h"
 #include "../../core/log.h"
 #include "../../core/resourcemanager.h"
+#include "../../core/scheduler.h"
 
 #include "../../core/image/image.h"
 #include "../../core/image/imageset.h"
@@ -315,15 +316,11 @@ void Gui::logic()
         graphics->updateScreen();
 
         // Fade out mouse cursor after extended inactivity
-        if (get_elapsed_time(mMouseInactivityTimer) < 15000)
+        if (Scheduler::getElapsedTime(mMouseInactivityTimer) < 15000)
         {
             const double alpha = std::min(mMouseCursorAlpha + 0.05, 1.0);
             mMouseCursorAlpha = std::min(mMaxMouseCursorAlpha, alpha);
         }
-        else if (mMouseInactivityTimer > MAX_TIME)
-        {
-            mMouseInactivityTimer -= MAX_TIME;
-        }
         else
         {
             mMouseCursorAlpha = std::max(0.0, mMouseCursorAlpha - 0.005);
@@ -412,10 +409,32 @@ void Gui::setUseCustomCursor(bool customCursor)
     }
 }
 
+void Gui::handleMouseInput()
+{
+    if (guiInput->isMouseQueueEmpty())
+        return;
+
+    // Both the window the mouse leaves and the one it enters may change
+    Window::contentChanged(getWidgetAt(mLastMouseX, mLastMouseY));
+    gcn::Gui::handleMouseInput();
+    Window::contentChanged(getWidgetAt(mLastMouseX, mLastMouseY));
+}
+
+void Gui::handleKeyInput()
+{
+    if (guiInput->isKeyQueueEmpty())
+        return;
+
+    // Input may move the focus to another window
+    Window::contentChanged(mFocusHandler->getFocused());
+    gcn::Gui::handleKeyInput();
+    Window::contentChanged(mFocusHandler->getFocused());
+}
+
 void Gui::handleMouseMoved(const gcn::MouseInput &mouseInput)
 {
     gcn::Gui::handleMouseMoved(mouseInput);
-    mMouseInactivityTimer = tick_time;
+    mMouseInactivityTimer = Scheduler::getTick();
 }
 
 void Gui::handleMouseWheelMovedDown(const gcn::MouseInput& mouseInput)
@@ -171,6 +171,16 @@ class Gui : public gcn::Gui
         void restoreFocus();
 
     protected:
+        /**
+         * Overridden to redraw the windows the mouse moves over or clicks.
+         */
+        void handleMouseInput();
+
+        /**
+         * Overridden to redraw the window that has the keyboard focus.
+         */
+        void handleKeyInput();
+
         void handleMouseMoved(const gcn::MouseInput &mouseInput);
         
         void handleMouseWheelMovedDown(const gcn::MouseInput& mouseInput);
@@ -196,7 +206,7 @@ class Gui : public gcn::Gui
         int mMouseY;                          /**< Current mouse Y position in
                                                    pixels. */
         Uint8 mButtonState;                   /**< Current mouse button state */        
-        int mMouseInactivityTimer;
+        Uint64 mMouseInactivityTimer;
         int mCursorType;
 
         /** Used to determine when to draw the next frame. */
@@ -405,9 +405,11 @@ bool InputManager::handleKeyboardInput(const SDL_Event &event)
                     if (!target)
                         target = beingManager->findNearestLivingBeing(x, y, 20);
 
-                    if (target)
+                    Map *map = viewport->getMap();
+
+                    // No popup while the map is still loading
+                    if (target && map)
                     {
-                        Map *map = viewport->getMap();
                         viewport->showPopup(target->mX * map->getTileWidth() -
                                             viewport->getCameraX() +
                                            (map->getTileWidth() / 2),
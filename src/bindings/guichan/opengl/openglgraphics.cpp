@@ -44,26 +44,38 @@
 #define GL_MAX_RECTANGLE_TEXTURE_SIZE_ARB 0x84F8
 #endif
 
-const unsigned int vertexBufSize = 500;
+/** The number of quads a batch can hold */
+const unsigned int batchSize = 1024;
 
 GLuint OpenGLGraphics::mLastImage = NULL;
+OpenGLGraphics *OpenGLGraphics::mInstance = NULL;
 
 OpenGLGraphics::OpenGLGraphics():
     mAlpha(false),
     mTexture(false),
     mColorAlpha(false),
-    mSync(false)
+    mSync(false),
+    mQuads(0),
+    mBatchTexture(0),
+    mScissor(-1, -1, -1, -1),
+    mDrawCalls(0),
+    mLastDrawCalls(0)
 {
-    mFloatTexArray = new GLfloat[vertexBufSize * 4];
-    mIntTexArray = new GLint[vertexBufSize * 4];
-    mIntVertArray = new GLint[vertexBufSize * 4];
+    mVertArray = new GLint[batchSize * 8];
+    mTexArray = new GLfloat[batchSize * 8];
+    mColorArray = new GLubyte[batchSize * 16];
+
+    mInstance = this;
 }
 
 OpenGLGraphics::~OpenGLGraphics()
 {
-    delete[] mFloatTexArray;
-    delete[] mIntTexArray;
-    delete[] mIntVertArray;
+    delete[] mVertArray;
+    delete[] mTexArray;
+    delete[] mColorArray;
+
+    if (mInstance == this)
+        mInstance = NULL;
 }
 
 void OpenGLGraphics::setSync(bool sync)
@@ -125,43 +137,6 @@ bool OpenGLGraphics::setVideoMode(int w, int h, int bpp, bool fs, bool hwaccel)
     return true;
 }
 
-static inline void drawQuad(Image *image, int srcX, int srcY, int dstX,
-                            int dstY, int width, int height)
-{
-    if (image->getTextureType() == GL_TEXTURE_2D)
-    {
-        // Find OpenGL normalized texture coordinates.
-        const float texX1 = static_cast<float>(srcX) /
-                            static_cast<float>(image->getTextureWidth());
-        const float texY1 = static_cast<float>(srcY) /
-                            static_cast<float>(image->getTextureHeight());
-        const float texX2 = static_cast<float>(srcX + width) /
-                            static_cast<float>(image->getTextureWidth());
-        const float texY2 = static_cast<float>(srcY + height) /
-                            static_cast<float>(image->getTextureHeight());
-
-        GLfloat tex[] = { texX1, texY1, texX2, texY1, 
-                          texX2, texY2, texX1, texY2 };
-        GLint vert[] = { dstX, dstY, dstX + width, dstY,
-                         dstX + width, dstY + height, dstX, dstY + height };
-
-        glVertexPointer(2, GL_FLOAT, 0, &vert);
-        glTexCoordPointer(2, GL_INT, 0, &tex);
-        glDrawArrays(GL_QUADS, 0, 4);
-    }
-    else
-    {
-        GLint tex[] = { srcX, srcY, srcX + width, srcY,
-                        srcX + width, srcY + height, srcX, srcY + height };
-        GLint vert[] = { dstX, dstY, dstX + width, dstY,
-                         dstX + width, dstY + height, dstX, dstY + height };
-
-        glVertexPointer(2, GL_INT, 0, &vert);
-        glTexCoordPointer(2, GL_INT, 0, &tex);
-        glDrawArrays(GL_QUADS, 0, 4);
-    }
-}
-
 bool OpenGLGraphics::drawImage(Image *image, int srcX, int srcY, int dstX,
                                int dstY, int width, int height, bool useColor)
 {
@@ -171,18 +146,18 @@ bool OpenGLGraphics::drawImage(Image *image, int srcX, int srcY, int dstX,
     srcX += image->mBounds.x;
     srcY += image->mBounds.y;
 
-    if (!useColor)
-        glColor4f(1.0f, 1.0f, 1.0f, image->mAlpha);
-
-    bindTexture(Image::mTextureType, image->mGLImage);
-
-    setTexturingAndBlending(true);
-
-    drawQuad(image, srcX, srcY, dstX, dstY, width, height);
+    dstX += mClipStack.top().xOffset;
+    dstY += mClipStack.top().yOffset;
 
-    if (!useColor)
-        glColor4ub(static_cast<GLubyte>(mColor.r), static_cast<GLubyte>(mColor.g),
-                   static_cast<GLubyte>(mColor.b), static_cast<GLubyte>(mColor.a));
+    if (useColor)
+    {
+        addQuad(image, srcX, srcY, dstX, dstY, width, height, mColor);
+    }
+    else
+    {
+        const gcn::Color color(255, 255, 255, (int) (image->mAlpha * 255));
+        addQuad(image, srcX, srcY, dstX, dstY, width, height, color);
+    }
 
     return true;
 }
@@ -201,17 +176,10 @@ void OpenGLGraphics::drawImagePattern(Image *image, int x, int y, int w, int h)
     const int srcX = image->mBounds.x;
     const int srcY = image->mBounds.y;
 
-    const float tw = static_cast<float>(image->getTextureWidth());
-    const float th = static_cast<float>(image->getTextureHeight());
+    x += mClipStack.top().xOffset;
+    y += mClipStack.top().yOffset;
 
-    unsigned int vp = 0;
-    const unsigned int vLimit = vertexBufSize * 4;
-
-    glColor4f(1.0f, 1.0f, 1.0f, image->mAlpha);
-
-    bindTexture(Image::mTextureType, image->mGLImage);
-
-    setTexturingAndBlending(true);
+    const gcn::Color color(255, 255, 255, (int) (image->mAlpha * 255));
 
     // Draw a set of textured rectangles
     for (int py = 0; py < h; py += ih)
@@ -220,60 +188,115 @@ void OpenGLGraphics::drawImagePattern(Image *image, int x, int y, int w, int h)
         const int dstY = y + py;
         for (int px = 0; px < w; px += iw)
         {
-            int width = (px + iw >= w) ? w - px : iw;
-            int dstX = x + px;
-
-            for (int i = 0; i < 4; i++)
-            {
-                const int offsetX = ((((i + 1) % 4) < 2) ? 0 : width);
-                const int offsetY = ((i < 2) ? 0 : height);
-                const int index = vp + (2 * i);
-
-                if (image->getTextureType() == GL_TEXTURE_2D)
-                {
-                    const float tx = static_cast<float>(srcX + offsetX) / tw;
-                    const float ty = static_cast<float>(srcY + offsetY) / th;
-
-                    mFloatTexArray[index] = tx;
-                    mFloatTexArray[index + 1] = ty;
-                }
-                else
-                {
-                    mIntTexArray[index] = srcX + offsetX;
-                    mIntTexArray[index + 1] = srcY + offsetY;
-                }
-
-                mIntVertArray[index] = dstX + offsetX;
-                mIntVertArray[index + 1] = dstY + offsetY;
-            }
-
-            vp += 8;
-            if (vp >= vLimit)
-            {
-                if (image->getTextureType() == GL_TEXTURE_2D)
-                    drawQuadArrayfi(vp);
-                else
-                    drawQuadArrayii(vp);
-
-                vp = 0;
-            }
+            const int width = (px + iw >= w) ? w - px : iw;
+            const int dstX = x + px;
+
+            addQuad(image, srcX, srcY, dstX, dstY, width, height, color);
         }
     }
+}
+
+void OpenGLGraphics::addQuad(Image *image, int srcX, int srcY, int dstX,
+                             int dstY, int width, int height,
+                             const gcn::Color &color)
+{
+    if (image->mGLImage != mBatchTexture || mQuads == batchSize)
+    {
+        flush();
+        mBatchTexture = image->mGLImage;
+    }
+
+    float texX1 = srcX;
+    float texY1 = srcY;
+    float texX2 = srcX + width;
+    float texY2 = srcY + height;
+
+    if (Image::mTextureType == GL_TEXTURE_2D)
+    {
+        // Find OpenGL normalized texture coordinates.
+        const float tw = static_cast<float>(image->getTextureWidth());
+        const float th = static_cast<float>(image->getTextureHeight());
+
+        texX1 /= tw;
+        texY1 /= th;
+        texX2 /= tw;
+        texY2 /= th;
+    }
+
+    GLint *vert = mVertArray + mQuads * 8;
+    GLfloat *tex = mTexArray + mQuads * 8;
+    GLubyte *col = mColorArray + mQuads * 16;
+
+    vert[0] = dstX;         vert[1] = dstY;
+    vert[2] = dstX + width; vert[3] = dstY;
+    vert[4] = dstX + width; vert[5] = dstY + height;
+    vert[6] = dstX;         vert[7] = dstY + height;
+
+    tex[0] = texX1; tex[1] = texY1;
+    tex[2] = texX2; tex[3] = texY1;
+    tex[4] = texX2; tex[5] = texY2;
+    tex[6] = texX1; tex[7] = texY2;
 
-    if (vp > 0)
+    for (int i = 0; i < 16; i += 4)
     {
-        if (image->getTextureType() == GL_TEXTURE_2D)
-            drawQuadArrayfi(vp);
-        else
-            drawQuadArrayii(vp);
+        col[i] = color.r;
+        col[i + 1] = color.g;
+        col[i + 2] = color.b;
+        col[i + 3] = color.a;
     }
 
-     glColor4ub(static_cast<GLubyte>(mColor.r),	static_cast<GLubyte>(mColor.g),
-                static_cast<GLubyte>(mColor.b), static_cast<GLubyte>(mColor.a));
+    mQuads++;
+}
+
+void OpenGLGraphics::flush()
+{
+    if (mQuads == 0)
+        return;
+
+    bindTexture(Image::mTextureType, mBatchTexture);
+
+    setTexturingAndBlending(true);
+
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    glVertexPointer(2, GL_INT, 0, mVertArray);
+    glTexCoordPointer(2, GL_FLOAT, 0, mTexArray);
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, mColorArray);
+
+    glDrawArrays(GL_QUADS, 0, mQuads * 4);
+    mDrawCalls++;
+
+    glDisableClientState(GL_COLOR_ARRAY);
+
+    // The current color is undefined after drawing with a color array
+    glColor4ub(static_cast<GLubyte>(mColor.r), static_cast<GLubyte>(mColor.g),
+               static_cast<GLubyte>(mColor.b), static_cast<GLubyte>(mColor.a));
+
+    mQuads = 0;
+}
+
+void OpenGLGraphics::updateScissor()
+{
+    const gcn::ClipRectangle &area = mClipStack.top();
+
+    if (area.x == mScissor.x && area.y == mScissor.y &&
+        area.width == mScissor.width && area.height == mScissor.height)
+        return;
+
+    flush();
+
+    mScissor = gcn::Rectangle(area.x, area.y, area.width, area.height);
+    glScissor(area.x, mTarget->h - area.y - area.height, area.width,
+              area.height);
 }
 
 void OpenGLGraphics::updateScreen()
 {
+    flush();
+
+    mLastDrawCalls = mDrawCalls;
+    mDrawCalls = 0;
+
     glFlush();
     glFinish();
     SDL_GL_SwapBuffers();
@@ -293,22 +316,27 @@ void OpenGLGraphics::_beginDraw()
     glLoadIdentity();
 
     glEnable(GL_SCISSOR_TEST);
-    glEnableClientState(GL_VERTEX_ARRAY);
 
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 
+    // The video mode may have changed, so always set the clip area again
+    mScissor = gcn::Rectangle(-1, -1, -1, -1);
+
     pushClipArea(gcn::Rectangle(0, 0, mTarget->w, mTarget->h));
 }
 
 void OpenGLGraphics::_endDraw()
 {
+    flush();
 }
 
 SDL_Surface* OpenGLGraphics::getScreenshot()
 {
+    flush();
+
     int h = mTarget->h;
     int w = mTarget->w;
 
@@ -347,25 +375,11 @@ SDL_Surface* OpenGLGraphics::getScreenshot()
 
 bool OpenGLGraphics::pushClipArea(gcn::Rectangle area)
 {
-    int transX = 0;
-    int transY = 0;
-
-    if (!mClipStack.empty())
-    {
-        transX = -mClipStack.top().xOffset;
-        transY = -mClipStack.top().yOffset;
-    }
-
+    // Offsets are added to the coordinates when drawing, rather than put in
+    // the modelview matrix, so that they don't interrupt the batch
     bool result = gcn::Graphics::pushClipArea(area);
 
-    transX += mClipStack.top().xOffset;
-    transY += mClipStack.top().yOffset;
-
-    glPushMatrix();
-    glTranslatef(transX, transY, 0);
-    glScissor(mClipStack.top().x,
-              mTarget->h - mClipStack.top().y - mClipStack.top().height,
-              mClipStack.top().width, mClipStack.top().height);
+    updateScissor();
 
     return result;
 }
@@ -377,10 +391,7 @@ void OpenGLGraphics::popClipArea()
     if (mClipStack.empty())
         return;
 
-    glPopMatrix();
-    glScissor(mClipStack.top().x, mTarget->h - mClipStack.top().y - 
-              mClipStack.top().height, mClipStack.top().width,
-              mClipStack.top().height);
+    updateScissor();
 }
 
 void OpenGLGraphics::setColor(const gcn::Color& color)
@@ -393,17 +404,28 @@ void OpenGLGraphics::setColor(const gcn::Color& color)
 
 void OpenGLGraphics::drawPoint(int x, int y)
 {
+    flush();
     setTexturingAndBlending(false);
 
+    x += mClipStack.top().xOffset;
+    y += mClipStack.top().yOffset;
+
     glBegin(GL_POINTS);
     glVertex2i(x, y);
     glEnd();
+    mDrawCalls++;
 }
 
 void OpenGLGraphics::drawLine(int x1, int y1, int x2, int y2)
 {
+    flush();
     setTexturingAndBlending(false);
 
+    x1 += mClipStack.top().xOffset;
+    y1 += mClipStack.top().yOffset;
+    x2 += mClipStack.top().xOffset;
+    y2 += mClipStack.top().yOffset;
+
     glBegin(GL_LINES);
     glVertex2f(x1 + 0.5f, y1 + 0.5f);
     glVertex2f(x2 + 0.5f, y2 + 0.5f);
@@ -412,6 +434,7 @@ void OpenGLGraphics::drawLine(int x1, int y1, int x2, int y2)
     glBegin(GL_POINTS);
     glVertex2f(x2 + 0.5f, y2 + 0.5f);
     glEnd();
+    mDrawCalls += 2;
 }
 
 void OpenGLGraphics::drawRectangle(const gcn::Rectangle& rect)
@@ -469,21 +492,25 @@ void OpenGLGraphics::setTexturingAndBlending(bool enable)
 void OpenGLGraphics::drawRectangle(const gcn::Rectangle& rect, bool filled)
 {
     const float offset = filled ? 0 : 0.5f;
+    const int x = rect.x + mClipStack.top().xOffset;
+    const int y = rect.y + mClipStack.top().yOffset;
 
+    flush();
     setTexturingAndBlending(false);
 
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 
     GLfloat vert[] =
     {
-        rect.x + offset, rect.y + offset,
-        rect.x + rect.width - offset, rect.y + offset,
-        rect.x + rect.width - offset, rect.y + rect.height - offset,
-        rect.x + offset, rect.y + rect.height - offset
+        x + offset, y + offset,
+        x + rect.width - offset, y + offset,
+        x + rect.width - offset, y + rect.height - offset,
+        x + offset, y + rect.height - offset
     };
 
     glVertexPointer(2, GL_FLOAT, 0, &vert);
     glDrawArrays(filled ? GL_QUADS : GL_LINE_LOOP, 0, 4);
+    mDrawCalls++;
 
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 }
@@ -497,21 +524,21 @@ void OpenGLGraphics::bindTexture(GLenum target, GLuint texture)
     }
 }
 
-inline void OpenGLGraphics::drawQuadArrayfi(int size)
+void OpenGLGraphics::deleteTexture(GLuint texture)
 {
-    glVertexPointer(2, GL_INT, 0, mIntVertArray);
-    glTexCoordPointer(2, GL_FLOAT, 0, mFloatTexArray);
-
-    glDrawArrays(GL_QUADS, 0, size / 2);
-}
+    // Quads batched from the texture have to be drawn while it still exists
+    if (mInstance && mInstance->mQuads > 0 &&
+        mInstance->mBatchTexture == texture)
+    {
+        mInstance->flush();
+    }
 
-inline void OpenGLGraphics::drawQuadArrayii(int size)
-{
-    glVertexPointer(2, GL_INT, 0, mIntVertArray);
-    glTexCoordPointer(2, GL_INT, 0, mIntTexArray);
+    // The name is often handed out again right away, and has to be bound
+    // again then
+    if (mLastImage == texture)
+        mLastImage = 0;
 
-    glDrawArrays(GL_QUADS, 0, size / 2);
+    glDeleteTextures(1, &texture);
 }
 
-
 #endif // USE_OPENGL
@@ -25,6 +25,15 @@
 
 #include "../graphics.h"
 
+/**
+ * Graphics implementation using OpenGL.
+ *
+ * Images are not drawn right away, but collected into a batch of quads which
+ * is sent to OpenGL in one go once an image from another texture is drawn,
+ * the clip area changes, something other than an image is drawn or the
+ * frame ends. Together with small images sharing atlas textures, this keeps
+ * the number of draw calls per frame low.
+ */
 class OpenGLGraphics : public Graphics
 {
     public:
@@ -79,24 +88,58 @@ class OpenGLGraphics : public Graphics
          */
         SDL_Surface *getScreenshot();
 
+        int getDrawCalls() const { return mLastDrawCalls; }
+
         static void bindTexture(GLenum target, GLuint texture);
 
+        /**
+         * Deletes a texture, drawing the batch first when it still holds
+         * images from that texture. Textures should only be deleted through
+         * here, so that the bound texture is known.
+         */
+        static void deleteTexture(GLuint texture);
+
     protected:
         void setTexturingAndBlending(bool enable);
 
-        void drawQuadArrayfi(int size);
+        /**
+         * Adds an image to the batch, in screen coordinates. Draws the batch
+         * first when the image uses another texture or the batch is full.
+         */
+        void addQuad(Image *image, int srcX, int srcY, int dstX, int dstY,
+                     int width, int height, const gcn::Color &color);
 
-        void drawQuadArrayii(int size);
+        /**
+         * Draws the images collected so far.
+         */
+        void flush();
+
+        /**
+         * Makes OpenGL clip to the current clip area, drawing the batch
+         * first if that changes anything.
+         */
+        void updateScissor();
 
     private:
         bool mAlpha, mTexture;
         bool mColorAlpha;
         bool mSync;
 
-        GLfloat *mFloatTexArray;
-        GLint *mIntTexArray;
-        GLint *mIntVertArray;
+        GLint *mVertArray;
+        GLfloat *mTexArray;
+        GLubyte *mColorArray;
+        unsigned int mQuads;        /**< Number of quads in the batch */
+        GLuint mBatchTexture;       /**< Texture used by the batch */
+
+        gcn::Rectangle mScissor;    /**< The last area clipped to */
+
+        int mDrawCalls;             /**< Made so far this frame */
+        int mLastDrawCalls;         /**< Made during the last frame */
+
         static GLuint mLastImage;
+
+        /** The graphics drawing the batch, if OpenGL is used */
+        static OpenGLGraphics *mInstance;
 };
 
 #endif
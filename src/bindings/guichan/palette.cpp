@@ -25,7 +25,10 @@
 #include "gui.h"
 #include "palette.h"
 
+#include "widgets/window.h"
+
 #include "../../core/configuration.h"
+#include "../../core/scheduler.h"
 
 #include "../../core/utils/gettext.h"
 #include "../../core/utils/stringutils.h"
@@ -72,7 +75,7 @@ std::string Palette::getConfigName(const std::string &typeName)
 DEFENUMNAMES(ColorType, COLOR_TYPE);
 
 Palette::Palette() :
-    mRainbowTime(tick_time),
+    mRainbowTime(Scheduler::getTick()),
     mColVector(ColVector(TYPE_COUNT)),
     mGradVector()
 {
@@ -172,6 +175,8 @@ void Palette::setColor(ColorType type, int r, int g, int b)
     mColVector[type].color.r = r;
     mColVector[type].color.g = g;
     mColVector[type].color.b = b;
+
+    Window::invalidateAll();
 }
 
 void Palette::setGradient(ColorType type, GradientType grad)
@@ -272,13 +277,13 @@ void Palette::addColor(Palette::ColorType type, int rgb,
 
 void Palette::advanceGradient ()
 {
-    if (get_elapsed_time(mRainbowTime) > 5)
+    if (Scheduler::getElapsedTime(mRainbowTime) > 5)
     {
         int pos, colIndex, colVal, delay, numOfColors;
         // For slower systems, advance can be greater than one (advance > 1
         // skips advance-1 steps). Should make gradient look the same
         // independent of the framerate.
-        int advance = get_elapsed_time(mRainbowTime) / 5;
+        int advance = Scheduler::getElapsedTime(mRainbowTime) / 5;
         double startColVal, destColVal;
 
         for (size_t i = 0; i < mGradVector.size(); i++)
@@ -348,7 +353,12 @@ void Palette::advanceGradient ()
         }
 
         if (advance)
-            mRainbowTime = tick_time;
+        {
+            mRainbowTime = Scheduler::getTick();
+
+            if (!mGradVector.empty())
+                Window::invalidateAll();
+        }
     }
 }
 
@@ -27,6 +27,8 @@
 #include <string>
 #include <vector>
 
+#include <SDL_types.h>
+
 #include <guichan/listmodel.hpp>
 #include <guichan/color.hpp>
 
@@ -278,7 +280,7 @@ class Palette : public gcn::ListModel
         static const gcn::Color RAINBOW_COLORS[];
         static const int RAINBOW_COLOR_COUNT;
         /** Time tick, that gradient-type colors were updated the last time. */
-        int mRainbowTime;
+        Uint64 mRainbowTime;
 
         /**
          * Define a color replacement.
@@ -20,6 +20,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <cassert>
 #include <SDL_gfxPrimitives.h>
 
@@ -31,6 +32,280 @@
 
 #include "../../../core/image/image.h"
 
+/**
+ * Reads a pixel of the given size.
+ */
+static inline Uint32 getPixel(const Uint8 *p, const int bpp)
+{
+    switch (bpp)
+    {
+        case 1: return *p;
+        case 2: return *(const Uint16*) p;
+        case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+            return p[0] << 16 | p[1] << 8 | p[2];
+#else
+            return p[0] | p[1] << 8 | p[2] << 16;
+#endif
+        default: return *(const Uint32*) p;
+    }
+}
+
+/**
+ * Writes a pixel of the given size.
+ */
+static inline void putPixel(Uint8 *p, const int bpp, const Uint32 pixel)
+{
+    switch (bpp)
+    {
+        case 1: *p = pixel; break;
+        case 2: *(Uint16*) p = pixel; break;
+        case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+            p[0] = (pixel >> 16) & 0xff;
+            p[1] = (pixel >> 8) & 0xff;
+            p[2] = pixel & 0xff;
+#else
+            p[0] = pixel & 0xff;
+            p[1] = (pixel >> 8) & 0xff;
+            p[2] = (pixel >> 16) & 0xff;
+#endif
+            break;
+        default: *(Uint32*) p = pixel; break;
+    }
+}
+
+/**
+ * Blends a row of 32 bit pixels with an alpha channel onto a row of 32 bit
+ * pixels with the same color layout, scaling the alpha by the given amount
+ * (0 - 256). Two color channels are blended at once in each half of a 32 bit
+ * word.
+ */
+static void blendRow(const Uint32 *src, Uint32 *dst, int width,
+                     const Uint32 amask, const int ashift, const int alpha)
+{
+    for (; width > 0; width--, src++, dst++)
+    {
+        const Uint32 s = *src;
+        int a = (((s & amask) >> ashift) * alpha) >> 8;
+
+        if (a == 0)
+            continue;
+
+        a += a >> 7;    // Map 255 onto 256
+        const Uint32 d = *dst;
+
+        const Uint32 rb = ((s & 0x00ff00ff) * a +
+                           (d & 0x00ff00ff) * (256 - a)) >> 8;
+        const Uint32 ag = ((s >> 8 & 0x00ff00ff) * a +
+                           (d >> 8 & 0x00ff00ff) * (256 - a));
+
+        *dst = (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+    }
+}
+
+/**
+ * Blends one color channel of two pixels with the same color layout.
+ */
+static inline Uint32 blendChannel(const Uint32 s, const Uint32 d,
+                                  const Uint32 mask, const int shift,
+                                  const int sa, const int below,
+                                  const int total)
+{
+    const Uint32 value = (((s & mask) >> shift) * sa +
+                          ((d & mask) >> shift) * below) / total;
+    return value << shift;
+}
+
+/**
+ * Composites a row of 32 bit pixels onto a row of 32 bit pixels with an
+ * alpha channel and the same color layout, like a cached window, scaling the
+ * alpha by the given amount (0 - 256). The source may have an alpha channel
+ * or a color key. Opaque pixels are copied directly.
+ */
+static void blendRowOver(const Uint32 *src, Uint32 *dst, int width,
+                         const SDL_PixelFormat *sf, const SDL_PixelFormat *df,
+                         const bool colorKey, const int alpha)
+{
+    const Uint32 colorMask = df->Rmask | df->Gmask | df->Bmask;
+
+    for (; width > 0; width--, src++, dst++)
+    {
+        const Uint32 s = *src;
+
+        if (colorKey && s == sf->colorkey)
+            continue;
+
+        const int a = sf->Amask ? (s & sf->Amask) >> sf->Ashift : 255;
+        const int sa = (a * alpha) >> 8;
+
+        if (sa == 0)
+            continue;
+
+        if (sa == 255)
+        {
+            *dst = (s & colorMask) | df->Amask;
+            continue;
+        }
+
+        // What shows through of the pixel below
+        const Uint32 d = *dst;
+        const int below = ((d & df->Amask) >> df->Ashift) * (255 - sa) / 255;
+        const int total = sa + below;
+
+        *dst = ((Uint32) total << df->Ashift) |
+               blendChannel(s, d, df->Rmask, df->Rshift, sa, below, total) |
+               blendChannel(s, d, df->Gmask, df->Gshift, sa, below, total) |
+               blendChannel(s, d, df->Bmask, df->Bshift, sa, below, total);
+    }
+}
+
+/**
+ * Blits a surface with an alpha channel, making it more transparent by the
+ * given amount. SDL itself ignores the surface alpha for such surfaces.
+ * When the target has an alpha channel too, the alpha values are combined,
+ * which SDL doesn't do either. Clips against the source surface and the clip
+ * rectangle of the target, like SDL_BlitSurface does.
+ */
+static void blitWithAlpha(SDL_Surface *src, const SDL_Rect &srcRect,
+                          SDL_Surface *dst, const SDL_Rect &dstRect,
+                          const Uint8 alpha)
+{
+    int srcX = srcRect.x;
+    int srcY = srcRect.y;
+    int dstX = dstRect.x;
+    int dstY = dstRect.y;
+    int width = srcRect.w;
+    int height = srcRect.h;
+
+    // Clip against the source surface
+    if (srcX < 0) { width += srcX; dstX -= srcX; srcX = 0; }
+    if (srcY < 0) { height += srcY; dstY -= srcY; srcY = 0; }
+    width = std::min(width, src->w - srcX);
+    height = std::min(height, src->h - srcY);
+
+    // Clip against the target
+    const SDL_Rect &clip = dst->clip_rect;
+    if (dstX < clip.x)
+    {
+        width -= clip.x - dstX;
+        srcX += clip.x - dstX;
+        dstX = clip.x;
+    }
+    if (dstY < clip.y)
+    {
+        height -= clip.y - dstY;
+        srcY += clip.y - dstY;
+        dstY = clip.y;
+    }
+    width = std::min(width, clip.x + clip.w - dstX);
+    height = std::min(height, clip.y + clip.h - dstY);
+
+    if (width <= 0 || height <= 0)
+        return;
+
+    if (SDL_MUSTLOCK(src))
+        SDL_LockSurface(src);
+    if (SDL_MUSTLOCK(dst))
+        SDL_LockSurface(dst);
+
+    const SDL_PixelFormat *sf = src->format;
+    const SDL_PixelFormat *df = dst->format;
+    const int sbpp = sf->BytesPerPixel;
+    const int dbpp = df->BytesPerPixel;
+
+    const Uint8 *srcRow = (const Uint8*) src->pixels + srcY * src->pitch +
+                          srcX * sbpp;
+    Uint8 *dstRow = (Uint8*) dst->pixels + dstY * dst->pitch + dstX * dbpp;
+
+    if (sbpp == 4 && dbpp == 4 && sf->Rmask == df->Rmask &&
+        sf->Gmask == df->Gmask && sf->Bmask == df->Bmask && sf->Amask &&
+        !df->Amask)
+    {
+        // The usual case, an image converted for the display
+        for (int y = 0; y < height; y++)
+        {
+            blendRow((const Uint32*) srcRow, (Uint32*) dstRow, width,
+                     sf->Amask, sf->Ashift, alpha + 1);
+            srcRow += src->pitch;
+            dstRow += dst->pitch;
+        }
+    }
+    else if (sbpp == 4 && dbpp == 4 && sf->Rmask == df->Rmask &&
+             sf->Gmask == df->Gmask && sf->Bmask == df->Bmask && df->Amask)
+    {
+        // Drawing into an image with an alpha channel, like a cached window
+        const bool colorKey = src->flags & SDL_SRCCOLORKEY;
+
+        for (int y = 0; y < height; y++)
+        {
+            blendRowOver((const Uint32*) srcRow, (Uint32*) dstRow, width,
+                         sf, df, colorKey, alpha + 1);
+            srcRow += src->pitch;
+            dstRow += dst->pitch;
+        }
+    }
+    else
+    {
+        const bool colorKey = src->flags & SDL_SRCCOLORKEY;
+
+        for (int y = 0; y < height; y++)
+        {
+            const Uint8 *sp = srcRow;
+            Uint8 *dp = dstRow;
+
+            for (int x = 0; x < width; x++, sp += sbpp, dp += dbpp)
+            {
+                const Uint32 pixel = getPixel(sp, sbpp);
+                if (colorKey && pixel == sf->colorkey)
+                    continue;
+
+                Uint8 r, g, b, a;
+                SDL_GetRGBA(pixel, src->format, &r, &g, &b, &a);
+
+                const int sa = a * (alpha + 1) >> 8;
+                if (sa == 0)
+                    continue;
+
+                if (df->Amask)
+                {
+                    Uint8 dr, dg, db, da;
+                    SDL_GetRGBA(getPixel(dp, dbpp), dst->format,
+                                &dr, &dg, &db, &da);
+
+                    // What shows through of the pixel below
+                    const int below = da * (255 - sa) / 255;
+                    const int total = sa + below;
+
+                    putPixel(dp, dbpp,
+                             SDL_MapRGBA(dst->format,
+                                         (r * sa + dr * below) / total,
+                                         (g * sa + dg * below) / total,
+                                         (b * sa + db * below) / total,
+                                         total));
+                    continue;
+                }
+
+                Uint8 dr, dg, db;
+                SDL_GetRGB(getPixel(dp, dbpp), dst->format, &dr, &dg, &db);
+
+                putPixel(dp, dbpp, SDL_MapRGB(dst->format,
+                                              dr + ((r - dr) * sa) / 255,
+                                              dg + ((g - dg) * sa) / 255,
+                                              db + ((b - db) * sa) / 255));
+            }
+
+            srcRow += src->pitch;
+            dstRow += dst->pitch;
+        }
+    }
+
+    if (SDL_MUSTLOCK(dst))
+        SDL_UnlockSurface(dst);
+    if (SDL_MUSTLOCK(src))
+        SDL_UnlockSurface(src);
+}
+
 SDLGraphics::SDLGraphics()
 {
     mTarget = NULL;
@@ -241,7 +516,7 @@ bool SDLGraphics::drawImage(Image *image, int srcX, int srcY, int dstX, int dstY
     srcRect.w = width;
     srcRect.h = height;
 
-    return !(SDL_BlitSurface(image->mImage, &srcRect, mTarget, &dstRect) < 0);
+    return blit(image, srcRect, dstRect);
 }
 
 void SDLGraphics::drawImagePattern(Image *image, int x, int y, int w, int h)
@@ -273,11 +548,44 @@ void SDLGraphics::drawImagePattern(Image *image, int x, int y, int w, int h)
             srcRect.x = srcX; srcRect.y = srcY;
             srcRect.w = dw;   srcRect.h = dh;
 
-            SDL_BlitSurface(image->mImage, &srcRect, mTarget, &dstRect);
+            blit(image, srcRect, dstRect);
         }
     }
 }
 
+bool SDLGraphics::blit(Image *image, SDL_Rect &srcRect, SDL_Rect &dstRect)
+{
+    SDL_Surface *surface = image->mImage;
+    const bool targetAlpha = mTarget->format->Amask;
+
+    if (image->mAlpha >= 1.0f && !targetAlpha)
+        return !(SDL_BlitSurface(surface, &srcRect, mTarget, &dstRect) < 0);
+
+    const Uint8 alpha = (Uint8) (std::min(std::max(image->mAlpha, 0.0f),
+                                          1.0f) * 255);
+    if (alpha == 0)
+        return true;
+
+    // Drawing into an image with an alpha channel, like a cached window
+    if (surface->format->Amask || targetAlpha)
+    {
+        blitWithAlpha(surface, srcRect, mTarget, dstRect, alpha);
+        return true;
+    }
+
+    // Without an alpha channel, SDL can apply the alpha itself. Since the
+    // surface may be shared with other images, it is set only for this blit.
+    const Uint32 flags = surface->flags & (SDL_SRCALPHA | SDL_RLEACCEL);
+    const Uint8 oldAlpha = surface->format->alpha;
+
+    SDL_SetAlpha(surface, SDL_SRCALPHA, alpha);
+    const bool result = !(SDL_BlitSurface(surface, &srcRect, mTarget,
+                                          &dstRect) < 0);
+    SDL_SetAlpha(surface, flags, oldAlpha);
+
+    return result;
+}
+
 void SDLGraphics::updateScreen()
 {
     SDL_Flip(mTarget);
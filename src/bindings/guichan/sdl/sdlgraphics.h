@@ -28,6 +28,7 @@
 class Image;
 class ImageRect;
 
+struct SDL_Rect;
 struct SDL_Surface;
 
 /**
@@ -108,6 +109,12 @@ class SDLGraphics : public Graphics
 
         virtual void _endDraw();
 
+    private:
+        /**
+         * Blits part of an image onto the target, at the alpha value of the
+         * image.
+         */
+        bool blit(Image *image, SDL_Rect &srcRect, SDL_Rect &dstRect);
 };
 
 #endif
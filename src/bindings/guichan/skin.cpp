@@ -24,6 +24,8 @@
 
 #include "skin.h"
 
+#include "widgets/window.h"
+
 #include "../../core/configuration.h"
 #include "../../core/configlistener.h"
 #include "../../core/log.h"
@@ -46,6 +48,8 @@ class SkinConfigListener : public ConfigListener
     {
         if (skinLoader)
             skinLoader->updateAlpha();
+
+        Window::invalidateAll();
     }
 };
 
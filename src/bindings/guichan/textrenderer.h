@@ -24,6 +24,7 @@
 
 #include "graphics.h"
 #include "palette.h"
+#include "truetypefont.h"
 
 /**
  * Class for text rendering. Used by the TextParticle, the Text and FlashText
@@ -44,6 +45,18 @@ class TextRenderer
     {
         graphics->setFont(font);
 
+        // TrueType fonts draw the outline and shadow in one go
+        TrueTypeFont *ttf = dynamic_cast<TrueTypeFont*>(font);
+        if (ttf && (outline || shadow))
+        {
+            graphics->setColor(color);
+            ttf->drawStyledString(graphics, text, x, y,
+                                  guiPalette->getColor(Palette::OUTLINE),
+                                  guiPalette->getColor(Palette::SHADOW),
+                                  outline, shadow, align);
+            return;
+        }
+
         // Text shadow
         if (shadow)
         {
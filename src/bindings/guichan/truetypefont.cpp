@@ -21,6 +21,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include <guichan/color.hpp>
 #include <guichan/exception.hpp>
 
@@ -31,13 +33,81 @@
 
 #include "../../core/utils/dtor.h"
 
-#define CACHE_SIZE 256
+/**
+ * Bytes of string images each font may cache.
+ */
+#define CACHE_BUDGET (2 * 1024 * 1024)
+
+/**
+ * Draws a 32 bit surface onto another of the same format, blending it with
+ * what is already there.
+ */
+static void composite(SDL_Surface *source, SDL_Surface *target,
+                      const int x, const int y, const int opacity)
+{
+    SDL_LockSurface(source);
+    SDL_LockSurface(target);
+
+    for (int offsetY = 0; offsetY < source->h; offsetY++)
+    {
+        const Uint32 *src = (const Uint32*) ((const Uint8*) source->pixels +
+                                             offsetY * source->pitch);
+        Uint32 *dst = (Uint32*) ((Uint8*) target->pixels +
+                                 (y + offsetY) * target->pitch) + x;
+
+        for (int offsetX = 0; offsetX < source->w; offsetX++, src++, dst++)
+        {
+            Uint8 r, g, b, a;
+            SDL_GetRGBA(*src, source->format, &r, &g, &b, &a);
+            a = a * opacity / 255;
+
+            if (a == 0)
+                continue;
+
+            Uint8 dr, dg, db, da;
+            SDL_GetRGBA(*dst, target->format, &dr, &dg, &db, &da);
+
+            const int below = da * (255 - a) / 255;
+            const int alpha = a + below;
+
+            *dst = SDL_MapRGBA(target->format,
+                               (r * a + dr * below) / alpha,
+                               (g * a + dg * below) / alpha,
+                               (b * a + db * below) / alpha,
+                               alpha);
+        }
+    }
+
+    SDL_UnlockSurface(target);
+    SDL_UnlockSurface(source);
+}
+
+static SDL_Surface *renderText(TTF_Font *font, const std::string &text,
+                               const gcn::Color &color)
+{
+    SDL_Color sdlCol;
+    sdlCol.b = color.b;
+    sdlCol.r = color.r;
+    sdlCol.g = color.g;
+
+    return TTF_RenderUTF8_Blended(font, text.c_str(), sdlCol);
+}
 
 class TextChunk
 {
     public:
-        TextChunk(const std::string &text, const gcn::Color &color) :
-            img(NULL), text(text), color(color)
+        enum
+        {
+            OUTLINE = 1,
+            SHADOW = 2
+        };
+
+        TextChunk(const std::string &text, const gcn::Color &color,
+                  const gcn::Color &outlineColor = gcn::Color(),
+                  const gcn::Color &shadowColor = gcn::Color(),
+                  const int style = 0) :
+            img(NULL), text(text), color(color), outlineColor(outlineColor),
+            shadowColor(shadowColor), style(style)
         {
         }
 
@@ -46,25 +116,47 @@ class TextChunk
             destroy(img);
         }
 
-        bool operator==(const std::string &str) const
+        /**
+         * Returns the number of bytes taken by the rendered image.
+         */
+        unsigned int getSize() const
         {
-            return (str == text);
+            return img ? img->getWidth() * img->getHeight() * 4 : 0;
         }
 
-        bool operator==(const TextChunk &chunk) const
+        /**
+         * Returns the distance from the top left of the image to where the
+         * text itself starts.
+         */
+        int getPadding() const
         {
-            return (chunk.text == text && chunk.color == color);
+            return (style & OUTLINE) ? 1 : 0;
         }
 
-        void generate(TTF_Font *font)
+        /**
+         * Returns the distance from where the text itself ends to the bottom
+         * right of the image.
+         */
+        int getTrailingPadding() const
         {
-            SDL_Color sdlCol;
-            sdlCol.b = color.b;
-            sdlCol.r = color.r;
-            sdlCol.g = color.g;
+            const int shadowOffset = (style & OUTLINE) ? 2 : 1;
+            return (style & SHADOW) ? std::max(getPadding(), shadowOffset) :
+                                      getPadding();
+        }
 
-            SDL_Surface *surface = TTF_RenderUTF8_Blended(font, text.c_str(),
-                                                          sdlCol);
+        /**
+         * Returns the width of the text in the image, without the outline
+         * and shadow around it.
+         */
+        int getTextWidth() const
+        {
+            return img ? img->getWidth() - getPadding() -
+                         getTrailingPadding() : 0;
+        }
+
+        void generate(TTF_Font *font)
+        {
+            SDL_Surface *surface = renderText(font, text, color);
 
             if (!surface)
             {
@@ -72,7 +164,15 @@ class TextChunk
                 return;
             }
 
-            img = Image::load(surface);
+            if (style)
+            {
+                SDL_Surface *styled = generateStyled(font, surface);
+                SDL_FreeSurface(surface);
+                surface = styled;
+            }
+
+            // Text comes and goes too often to be worth an atlas spot
+            img = Image::load(surface, false);
 
             SDL_FreeSurface(surface);
         }
@@ -80,13 +180,112 @@ class TextChunk
         Image *img;
         std::string text;
         gcn::Color color;
-};
+        gcn::Color outlineColor;
+        gcn::Color shadowColor;
+        int style;
+
+    private:
+        /**
+         * Combines the shadow, the outline and the text into one surface,
+         * the way they used to be drawn one after another.
+         */
+        SDL_Surface *generateStyled(TTF_Font *font, SDL_Surface *surface)
+        {
+            const int padding = getPadding();
+            const int shadowOffset = (style & OUTLINE) ? 2 : 1;
+            const int extra = getTrailingPadding();
+
+            const SDL_PixelFormat *format = surface->format;
+            SDL_Surface *target = SDL_CreateRGBSurface(SDL_SWSURFACE,
+                    surface->w + padding + extra,
+                    surface->h + padding + extra, 32,
+                    format->Rmask, format->Gmask, format->Bmask,
+                    format->Amask);
 
-typedef std::list<TextChunk>::iterator CacheIterator;
+            if (!target)
+                return NULL;
+
+            SDL_FillRect(target, NULL, 0);
+
+            if (style & SHADOW)
+            {
+                SDL_Surface *shadow = renderText(font, text, shadowColor);
+                if (shadow)
+                {
+                    composite(shadow, target, padding + shadowOffset,
+                              padding + shadowOffset, 128);
+                    SDL_FreeSurface(shadow);
+                }
+            }
+
+            if (style & OUTLINE)
+            {
+                SDL_Surface *outline = renderText(font, text, outlineColor);
+                if (outline)
+                {
+                    composite(outline, target, 2, 1, 255);
+                    composite(outline, target, 0, 1, 255);
+                    composite(outline, target, 1, 2, 255);
+                    composite(outline, target, 1, 0, 255);
+                    SDL_FreeSurface(outline);
+                }
+            }
+
+            composite(surface, target, padding, padding, 255);
+
+            return target;
+        }
+};
 
 static int fontCounter;
 
-TrueTypeFont::TrueTypeFont(const std::string &filename, int size, int style)
+TrueTypeFont::CacheStatistics TrueTypeFont::mCacheStatistics = { 0, 0, 0, 0 };
+
+/**
+ * Decodes the UTF-8 character at the given position and moves past it.
+ * Returns 0 for invalid sequences and characters SDL_ttf can't handle.
+ */
+static Uint16 nextCharacter(const std::string &text,
+                            std::string::size_type &pos)
+{
+    const unsigned char c = text[pos++];
+
+    int length;
+    Uint32 ch;
+
+    if (c < 0x80)
+        return c;
+    else if ((c & 0xe0) == 0xc0)
+    {
+        length = 1;
+        ch = c & 0x1f;
+    }
+    else if ((c & 0xf0) == 0xe0)
+    {
+        length = 2;
+        ch = c & 0x0f;
+    }
+    else if ((c & 0xf8) == 0xf0)
+    {
+        length = 3;
+        ch = c & 0x07;
+    }
+    else
+        return 0;
+
+    for (; length > 0; length--)
+    {
+        if (pos >= text.length() || (text[pos] & 0xc0) != 0x80)
+            return 0;
+
+        ch = (ch << 6) | (text[pos++] & 0x3f);
+    }
+
+    return ch > 0xffff ? 0 : ch;
+}
+
+TrueTypeFont::TrueTypeFont(const std::string &filename, int size, int style):
+    mChunksSize(0)
 {
     if (fontCounter == 0 && TTF_Init() == -1)
     {
@@ -104,10 +303,19 @@ TrueTypeFont::TrueTypeFont(const std::string &filename, int size, int style)
     }
 
     TTF_SetFontStyle (mFont, style);
+    mAscent = TTF_FontAscent(mFont);
 }
 
 TrueTypeFont::~TrueTypeFont()
 {
+    for (std::map<Uint16, Glyph>::iterator i = mGlyphs.begin();
+         i != mGlyphs.end(); ++i)
+    {
+        delete i->second.image;
+    }
+
+    mCacheStatistics.size -= mChunksSize;
+
     TTF_CloseFont(mFont);
     --fontCounter;
 
@@ -133,6 +341,12 @@ void TrueTypeFont::drawString(gcn::Graphics *graphics,
     if (!g)
         throw "Not a valid graphics object!";
 
+    if (Image::usesOpenGL())
+    {
+        drawGlyphs(g, text, x, y);
+        return;
+    }
+
     gcn::Color col = g->getColor();
     const float alpha = col.a / 255.0f;
 
@@ -141,49 +355,229 @@ void TrueTypeFont::drawString(gcn::Graphics *graphics,
      */
     col.a = 255;
 
-    TextChunk chunk(text, col);
+    TextChunk &chunk = getChunk(TextChunk(text, col));
+
+    if (chunk.img)
+    {
+        chunk.img->setAlpha(alpha);
+        g->drawImage(chunk.img, x, y);
+    }
+}
+
+void TrueTypeFont::drawStyledString(gcn::Graphics *graphics,
+                                    const std::string &text, int x, int y,
+                                    const gcn::Color &outlineColor,
+                                    const gcn::Color &shadowColor,
+                                    const bool outline, const bool shadow,
+                                    const gcn::Graphics::Alignment alignment)
+{
+    if (text.empty())
+        return;
+
+    Graphics *g = dynamic_cast<Graphics *>(graphics);
 
-    bool found = false;
+    if (!g)
+        throw "Not a valid graphics object!";
+
+    gcn::Color col = g->getColor();
+    const float alpha = col.a / 255.0f;
+    col.a = 255;
 
-    for (CacheIterator i = cache.begin(); i != cache.end(); i++)
+    const int style = (outline ? TextChunk::OUTLINE : 0) |
+                      (shadow ? TextChunk::SHADOW : 0);
+
+    TextChunk &chunk = getChunk(TextChunk(text, col, outlineColor,
+                                          shadowColor, style));
+
+    if (chunk.img)
     {
-        if (chunk == (*i))
-        {
-            // Raise priority: move it to front
-            cache.splice(cache.begin(), cache, i);
-            found = true;
-            break;
-        }
+        const int padding = chunk.getPadding();
+
+        // The glyphs drawn one by one under OpenGL may add up to a different
+        // width than the rendered string, so align by the image
+        if (alignment == gcn::Graphics::CENTER)
+            x -= chunk.getTextWidth() / 2;
+        else if (alignment == gcn::Graphics::RIGHT)
+            x -= chunk.getTextWidth();
+
+        chunk.img->setAlpha(alpha);
+        g->drawImage(chunk.img, x - padding, y - padding);
     }
+}
+
+/**
+ * Packs the opaque part of a color.
+ */
+static Uint32 packColor(const gcn::Color &color)
+{
+    return (color.r << 16) | (color.g << 8) | color.b;
+}
+
+bool TrueTypeFont::ChunkKey::operator<(const ChunkKey &other) const
+{
+    if (text != other.text)
+        return text < other.text;
+    if (style != other.style)
+        return style < other.style;
+    if (color != other.color)
+        return color < other.color;
+    if (outlineColor != other.outlineColor)
+        return outlineColor < other.outlineColor;
+    return shadowColor < other.shadowColor;
+}
+
+TrueTypeFont::ChunkKey TrueTypeFont::getKey(const TextChunk &chunk)
+{
+    ChunkKey key;
+    key.text = chunk.text;
+    key.style = chunk.style;
+    key.color = packColor(chunk.color);
+    key.outlineColor = (chunk.style & TextChunk::OUTLINE) ?
+                       packColor(chunk.outlineColor) : 0;
+    key.shadowColor = (chunk.style & TextChunk::SHADOW) ?
+                      packColor(chunk.shadowColor) : 0;
+    return key;
+}
 
-    // Surface not found
-    if (!found)
+TextChunk &TrueTypeFont::getChunk(const TextChunk &chunk)
+{
+    const ChunkKey key = getKey(chunk);
+    ChunkIndex::iterator i = mChunkIndex.find(key);
+
+    if (i != mChunkIndex.end())
+    {
+        // Raise priority: move it to front
+        mChunks.splice(mChunks.begin(), mChunks, i->second);
+        ++mCacheStatistics.hits;
+        return mChunks.front();
+    }
+
+    ++mCacheStatistics.misses;
+
+    mChunks.push_front(chunk);
+    mChunks.front().generate(mFont);
+    mChunkIndex[key] = mChunks.begin();
+
+    const unsigned int size = mChunks.front().getSize();
+    mChunksSize += size;
+    mCacheStatistics.size += size;
+
+    trimCache();
+
+    return mChunks.front();
+}
+
+void TrueTypeFont::trimCache()
+{
+    // Always keep the string that was just rendered
+    while (mChunksSize > CACHE_BUDGET && mChunks.size() > 1)
+    {
+        const TextChunk &chunk = mChunks.back();
+        const unsigned int size = chunk.getSize();
+
+        mChunkIndex.erase(getKey(chunk));
+        mChunksSize -= size;
+        mCacheStatistics.size -= size;
+        ++mCacheStatistics.evictions;
+
+        mChunks.pop_back();
+    }
+}
+
+void TrueTypeFont::drawGlyphs(Graphics *graphics, const std::string &text,
+                              int x, const int y) const
+{
+    std::string::size_type pos = 0;
+
+    while (pos < text.length())
     {
-        if (cache.size() >= CACHE_SIZE)
-            cache.pop_back();
+        const Uint16 ch = nextCharacter(text, pos);
+        if (!ch)
+            continue;
 
-        cache.push_front(chunk);
-        cache.front().generate(mFont);
+        const Glyph &glyph = getGlyph(ch);
+
+        // Drawn in the current color of the graphics
+        if (glyph.image)
+        {
+            graphics->drawImage(glyph.image, 0, 0, x + glyph.x, y + glyph.y,
+                                glyph.image->getWidth(),
+                                glyph.image->getHeight(), true);
+        }
+
+        x += glyph.advance;
     }
+}
 
-    if (cache.front().img)
+const TrueTypeFont::Glyph &TrueTypeFont::getGlyph(const Uint16 character) const
+{
+    std::map<Uint16, Glyph>::iterator i = mGlyphs.find(character);
+    if (i != mGlyphs.end())
+        return i->second;
+
+    Glyph &glyph = mGlyphs[character];
+    glyph.image = NULL;
+    glyph.x = 0;
+    glyph.y = 0;
+    glyph.advance = 0;
+
+    int minX, maxX, minY, maxY, advance;
+    if (TTF_GlyphMetrics(mFont, character, &minX, &maxX, &minY, &maxY,
+                         &advance) == -1)
+        return glyph;
+
+    glyph.x = minX;
+    glyph.y = mAscent - maxY;
+    glyph.advance = advance;
+
+    SDL_Color white;
+    white.r = 255;
+    white.g = 255;
+    white.b = 255;
+
+    SDL_Surface *surface = TTF_RenderGlyph_Blended(mFont, character, white);
+    if (surface)
     {
-        cache.front().img->setAlpha(alpha);
-        g->drawImage(cache.front().img, x, y);
+        if (surface->w > 0 && surface->h > 0)
+            glyph.image = Image::load(surface);
+
+        SDL_FreeSurface(surface);
     }
+
+    return glyph;
 }
 
 int TrueTypeFont::getWidth(const std::string& text) const
 {
-    for (CacheIterator i = cache.begin(); i != cache.end(); i++)
+    if (Image::usesOpenGL())
     {
-        if ((*i) == text)
+        // Add up the advances, as the glyphs are drawn
+        int width = 0;
+        std::string::size_type pos = 0;
+
+        while (pos < text.length())
         {
-            // Raise priority: move it to front
-            // Assumption is that TTF::draw will be called next
-            cache.splice(cache.begin(), cache, i);
-            return (i->img ? i->img->getWidth() : 0);
+            const Uint16 ch = nextCharacter(text, pos);
+            if (ch)
+                width += getGlyph(ch).advance;
         }
+
+        return width;
+    }
+
+    // Any color of the string has the same width, as long as it has no
+    // outline or shadow. These sort first.
+    ChunkKey key;
+    key.text = text;
+    key.style = 0;
+    key.color = key.outlineColor = key.shadowColor = 0;
+
+    ChunkIndex::const_iterator i = mChunkIndex.lower_bound(key);
+    if (i != mChunkIndex.end() && i->first.text == text &&
+        i->first.style == 0)
+    {
+        const Image *img = i->second->img;
+        return img ? img->getWidth() : 0;
     }
 
     int w, h;
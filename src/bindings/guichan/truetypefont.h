@@ -25,23 +25,43 @@
 #define TRUETYPEFONT_H
 
 #include <list>
+#include <map>
 #include <string>
 #include <SDL_ttf.h>
 
 #include <guichan/font.hpp>
+#include <guichan/graphics.hpp>
 
 #include "../../core/resource.h"
 
+class Graphics;
+class Image;
 class TextChunk;
 
 /**
  * A wrapper around SDL_ttf for allowing the use of TrueType fonts.
  *
+ * With OpenGL, each character is rendered once and strings are drawn glyph
+ * by glyph, which the renderer batches into few draw calls. With SDL, whole
+ * strings are rendered and cached, since one blit per string is cheaper
+ * there.
+ *
  * <b>NOTE:</b> This class initializes SDL_ttf as necessary.
  */
 class TrueTypeFont : public gcn::Font, public Resource
 {
     public:
+        /**
+         * Usage of the string caches, summed over all fonts.
+         */
+        struct CacheStatistics
+        {
+            unsigned int hits;
+            unsigned int misses;
+            unsigned int evictions;
+            unsigned int size;      /**< Bytes of cached images */
+        };
+
         /**
          * Destructor.
          */
@@ -60,6 +80,26 @@ class TrueTypeFont : public gcn::Font, public Resource
         void drawString(gcn::Graphics* graphics, const std::string& text,
                         int x, int y);
 
+        /**
+         * Draws a string with an outline and/or a shadow around it. These
+         * are rendered together with the text into a single cached image,
+         * so it takes only one draw. The text is aligned by its width in
+         * that image.
+         */
+        void drawStyledString(gcn::Graphics *graphics,
+                              const std::string &text, int x, int y,
+                              const gcn::Color &outlineColor,
+                              const gcn::Color &shadowColor,
+                              const bool outline, const bool shadow,
+                              const gcn::Graphics::Alignment alignment =
+                                  gcn::Graphics::LEFT);
+
+        /**
+         * Returns the usage of the string caches of all fonts.
+         */
+        static const CacheStatistics &getCacheStatistics()
+        { return mCacheStatistics; }
+
     private:
         /**
          * Constructor.
@@ -69,10 +109,68 @@ class TrueTypeFont : public gcn::Font, public Resource
          */
         TrueTypeFont(const std::string &filename, int size, int style = 0);
 
+        /**
+         * A rendered character, in white so that it can be drawn in any
+         * color.
+         */
+        struct Glyph
+        {
+            Image *image;
+            int x, y;           /**< Offset from the pen position */
+            int advance;        /**< Distance to the next character */
+        };
+
+        /**
+         * Returns the glyph of a character, rendering it when needed.
+         */
+        const Glyph &getGlyph(const Uint16 character) const;
+
+        /**
+         * Draws a string glyph by glyph.
+         */
+        void drawGlyphs(Graphics *graphics, const std::string &text, int x,
+                        const int y) const;
+
+        /**
+         * Identifies a rendered string in the cache.
+         */
+        struct ChunkKey
+        {
+            std::string text;
+            int style;
+            Uint32 color, outlineColor, shadowColor;
+
+            bool operator<(const ChunkKey &other) const;
+        };
+
+        static ChunkKey getKey(const TextChunk &chunk);
+
+        /**
+         * Returns the cached version of the given string, rendering it when
+         * needed.
+         */
+        TextChunk &getChunk(const TextChunk &chunk);
+
+        /**
+         * Drops the least recently used strings until the cache is within
+         * its budget.
+         */
+        void trimCache();
+
+        typedef std::list<TextChunk> Chunks;
+        typedef std::map<ChunkKey, Chunks::iterator> ChunkIndex;
+
         TTF_Font *mFont;
+        int mAscent;
+
+        mutable std::map<Uint16, Glyph> mGlyphs;
+
+        // String surfaces cache, most recently used first
+        Chunks mChunks;
+        ChunkIndex mChunkIndex;
+        unsigned int mChunksSize;
 
-        // Word surfaces cache
-        mutable std::list<TextChunk> cache;
+        static CacheStatistics mCacheStatistics;
 };
 
 #endif
@@ -21,6 +21,7 @@
  */
 
 #include "beingbox.h"
+#include "window.h"
 
 #include "../graphics.h"
 
@@ -114,6 +115,18 @@ BeingBox::~BeingBox()
     }
 }
 
+void BeingBox::setBeing(const Being *being)
+{
+    mBeing = being;
+    Window::contentChanged(this);
+}
+
+void BeingBox::logic()
+{
+    if (mBeing)
+        Window::contentChanged(this);
+}
+
 void BeingBox::draw(gcn::Graphics *graphics)
 {
     if (mBeing)
@@ -55,7 +55,13 @@ class BeingBox : public gcn::Widget
          * being to <code>NULL</code> causes the box not to draw any
          * being.
          */
-        void setBeing(const Being *being) { mBeing = being; }
+        void setBeing(const Being *being);
+
+        /**
+         * Redraws the window while a being is shown, since its sprites may
+         * animate or change at any time.
+         */
+        void logic();
 
         /**
          * Draws the scroll area.
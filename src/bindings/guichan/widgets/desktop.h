@@ -28,9 +28,10 @@
 
 #include "../guichanfwd.h"
 
-class Window;
 class Image;
+class Label;
 class ProgressBar;
+class Window;
 
 /**
  * A desktop for the game instance. Used when outside of the game.
@@ -111,9 +112,9 @@ class Desktop : public Container
                             float yPos = 0.625f);
 
         ProgressBar *progressBar;
-        gcn::Label *progressLabel;
+        Label *progressLabel;
         gcn::Button *setup;
-        gcn::Label *versionLabel;
+        Label *versionLabel;
         Window *currentDialog;
 
         std::string wallpaperName;
@@ -21,6 +21,7 @@
  */
 
 #include "icon.h"
+#include "window.h"
 
 #include "../graphics.h"
 
@@ -69,6 +70,8 @@ void Icon::setImage(Image *image)
         if (!mFixed)
             setSize(mImage->getWidth(), mImage->getHeight());
     }
+
+    Window::contentChanged(this);
 }
 
 void Icon::draw(gcn::Graphics *g)
@@ -21,6 +21,7 @@
  */
 
 #include "label.h"
+#include "window.h"
 
 #include "../palette.h"
 
@@ -30,3 +31,12 @@ void Label::draw(gcn::Graphics* graphics)
     gcn::Label::draw(static_cast<gcn::Graphics*>(graphics));
 }
 
+void Label::setCaption(const std::string& caption)
+{
+    if (caption == getCaption())
+        return;
+
+    gcn::Label::setCaption(caption);
+    Window::contentChanged(this);
+}
+
@@ -50,6 +50,11 @@ class Label : public gcn::Label
          */
         void draw(gcn::Graphics* graphics);
 
+        /**
+         * Sets the caption, redrawing the window when it changed.
+         */
+        void setCaption(const std::string& caption);
+
         void fontChanged() { adjustSize(); }
 };
 
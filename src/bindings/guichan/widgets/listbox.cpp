@@ -24,6 +24,7 @@
 #include <guichan/font.hpp>
 
 #include "listbox.h"
+#include "window.h"
 
 #include "../palette.h"
 #include "../protectedfocuslistener.h"
@@ -37,7 +38,8 @@ float ListBox::mAlpha = 1.0;
 
 ListBox::ListBox(gcn::ListModel *listModel, const std::string &actionEventId,
                  gcn::ActionListener *listener):
-    gcn::ListBox(listModel)
+    gcn::ListBox(listModel),
+    mDrawnSelected(-1)
 {
     if (!actionEventId.empty())
         setActionEventId(actionEventId);
@@ -68,6 +70,36 @@ ListBox::~ListBox()
     destroy(mProtFocusListener);
 }
 
+void ListBox::logic()
+{
+    gcn::ListBox::logic();
+
+    // Models change their rows without telling, so compare them with the
+    // ones last drawn
+    const int count = mListModel ? mListModel->getNumberOfElements() : 0;
+    bool changed = mSelected != mDrawnSelected ||
+                   count != (int) mElements.size();
+
+    mElements.resize(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        const std::string element = mListModel->getElementAt(i);
+
+        if (element != mElements[i])
+        {
+            mElements[i] = element;
+            changed = true;
+        }
+    }
+
+    if (changed)
+    {
+        mDrawnSelected = mSelected;
+        Window::contentChanged(this);
+    }
+}
+
 void ListBox::draw(gcn::Graphics *graphics)
 {
     if (!mListModel)
@@ -23,6 +23,9 @@
 #ifndef LISTBOX_H
 #define LISTBOX_H
 
+#include <string>
+#include <vector>
+
 #include <guichan/widgets/listbox.hpp>
 
 class ProtectedFocusListener;
@@ -45,6 +48,11 @@ class ListBox : public gcn::ListBox
 
         virtual ~ListBox();
 
+        /**
+         * Redraws the window when the elements or the selection changed.
+         */
+        void logic();
+
         /**
          * Draws the list box.
          */
@@ -74,6 +82,9 @@ class ListBox : public gcn::ListBox
         static float mAlpha;
 
         ProtectedFocusListener *mProtFocusListener;
+
+        std::vector<std::string> mElements;  /**< Elements last drawn */
+        int mDrawnSelected;                  /**< Selection last drawn */
 };
 
 #endif
@@ -30,9 +30,12 @@
 #include "../palette.h"
 #include "../textrenderer.h"
 
+#include "window.h"
+
 #include "../../../core/configlistener.h"
 #include "../../../core/configuration.h"
 #include "../../../core/resourcemanager.h"
+#include "../../../core/scheduler.h"
 
 #include "../../../core/image/image.h"
 
@@ -112,8 +115,6 @@ ProgressBar::ProgressBar(float progress, int width, int height,
         config.addListener("guialpha", mConfigListener);
     }
 
-    mLastUpdate = tick_time;
-
     mInstances++;
 }
 
@@ -157,20 +158,18 @@ void ProgressBar::fontChanged()
 void ProgressBar::logic()
 {
     if (!isVisible() || !getParent()->isVisible())
-    {
-        mLastUpdate = tick_time;
         return;
-    }
 
     // Make the gradients and smooth progress appear consistent regardless of
     // the framerate.
-    const int updateTicks = get_elapsed_time(mLastUpdate) / 10;
+    const int updateTicks = Scheduler::getFrameTicks();
 
-    if (updateTicks)
-        mLastUpdate = tick_time;
-    else
+    if (!updateTicks)
         return;
 
+    const gcn::Color oldColor = mColor;
+    const float oldProgress = mProgress;
+
     const size_t index = (size_t) (mProgress * mColors.size());
 
     if (mCurrentColor != index && index < mColors.size())
@@ -220,6 +219,18 @@ void ProgressBar::logic()
     {
         mProgress = mProgressToGo;
     }
+
+    if (mColor != oldColor || mProgress != oldProgress)
+        Window::contentChanged(this);
+}
+
+void ProgressBar::setText(const std::string &text)
+{
+    if (text == mText)
+        return;
+
+    mText = text;
+    Window::contentChanged(this);
 }
 
 void ProgressBar::draw(gcn::Graphics *graphics)
@@ -95,7 +95,7 @@ class ProgressBar : public gcn::Widget
         /**
          * Sets the text shown on the progress bar.
          */
-        void setText(const std::string &text) { mText = text; }
+        void setText(const std::string &text);
 
         /**
          * Returns the text shown on the progress bar.
@@ -139,7 +139,6 @@ class ProgressBar : public gcn::Widget
     private:
         float mProgress, mProgressToGo;
         bool mSmoothProgress;
-        int mLastUpdate;
 
         std::vector<gcn::Color> mColors;
         size_t mCurrentColor;
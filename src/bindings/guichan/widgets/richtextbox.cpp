@@ -21,11 +21,13 @@
  */
 
 #include <algorithm>
+#include <cassert>
 
 #include <guichan/graphics.hpp>
 #include <guichan/font.hpp>
 
 #include "richtextbox.h"
+#include "window.h"
 
 #include "../palette.h"
 
@@ -33,6 +35,10 @@
 
 RichTextBox::RichTextBox(unsigned int mode, bool opaque):
     gcn::Widget(),
+    mLayoutY(0),
+    mLayoutLink(0),
+    mLayoutWidth(0),
+    mTop(0),
     mLaidOutTextValid(false),
     mLinkHandler(NULL),
     mMode(mode),
@@ -78,8 +84,8 @@ void RichTextBox::addRow(const std::string &row)
     std::string newRow;
     gcn::Font *font = getFont();
 
-    // Invalidate the cached prewrapped lines
-    mLaidOutTextValid = false;
+    // The new row is laid out by the next logic update, below the others
+    Window::contentChanged(this);
 
     // Use links and user defined colors
     if (mUseLinksAndUserColors)
@@ -144,7 +150,6 @@ void RichTextBox::addRow(const std::string &row)
     }
 
     mTextRows.push_back(newRow);
-    mQueuedRows.push_back(newRow);
 
     // Auto size mode
     if (mMode == AUTO_SIZE)
@@ -177,92 +182,44 @@ void RichTextBox::logic()
     if (!isVisible())
         return;
 
-    if (!mQueuedRows.empty())
+    if (!mLaidOutTextValid)
+        calculateTextLayout();
+    else if (mRowLayouts.size() < mTextRows.size())
     {
-        gcn::Font *font = getFont();
-
-        // discard older rows when a row limit has been set
-        if (mMaxRows > 0 && !mTextRows.empty())
-        {
-            while (mTextRows.size() > mMaxRows)
-            {
-                mTextRows.pop_front();
-                for (unsigned int i = 0; i < mLinks.size(); i++)
-                {
-                    mLinks[i].y1 -= font->getHeight();
-                    mLinks[i].y2 -= font->getHeight();
-
-                    if (mLinks[i].y1 < 0)
-                        mLinks.erase(mLinks.begin() + i);
-                }
-            }
-        }
-
-        if (mMode == AUTO_WRAP)
-        {
-            unsigned int y = 0;
-            unsigned int nextChar;
-            const char *hyphen = "~";
-            const int hyphenWidth = font->getWidth(hyphen);
-            int x = 0;
-
-            for (TextRowIterator i = mTextRows.begin(); i != mTextRows.end(); i++)
-            {
-                std::string row = *i;
-                for (unsigned int j = 0; j < row.size(); j++)
-                {
-                    std::string character = row.substr(j, 1);
-                    x += font->getWidth(character);
-                    nextChar = j + 1;
+        // Only lay out the rows added since the last update
+        const unsigned int rowsBefore = mRowLayouts.size();
+        const unsigned int partsBefore = mLaidOutText.size();
 
-                    // Wraping between words (at blank spaces)
-                    if ((nextChar < row.size()) && (row.at(nextChar) == ' '))
-                    {
-                        int nextSpacePos = row.find(" ", (nextChar + 1));
+        TextRowIterator i = mTextRows.end();
+        for (size_t n = mRowLayouts.size(); n < mTextRows.size(); n++)
+            --i;
 
-                        if (nextSpacePos <= 0)
-                            nextSpacePos = row.size() - 1;
+        for (; i != mTextRows.end(); ++i)
+            layoutRow(*i);
 
-                        int nextWordWidth = font->getWidth(row.substr(nextChar,
-                                                          (nextSpacePos -
-                                                           nextChar)));
+        // Each new row got a layout of its own, and the parts of the rows
+        // laid out before were left alone
+        unsigned int newParts = 0;
+        for (size_t n = rowsBefore; n < mRowLayouts.size(); n++)
+            newParts += mRowLayouts[n].parts;
 
-                        if ((x + nextWordWidth + 10) > getWidth())
-                        {
-                            x = 15; // Ident in new line
-                            y += 1;
-                            j++;
-                        }
-                    }
-                    // Wrapping looong lines (brutal force)
-                    else if ((x + 2 * hyphenWidth) > getWidth())
-                    {
-                        x = 15; // Ident in new line
-                        y += 1;
-                    }
-                }
-            }
+        assert(mRowLayouts.size() == mTextRows.size());
+        assert(mLaidOutText.size() == partsBefore + newParts);
 
-            setHeight(font->getHeight() * (mTextRows.size() + y));
-        }
-        else
-        {
-            setHeight(font->getHeight() * mTextRows.size());
-        }
+        // Discard older rows when a row limit has been set
+        while (mMaxRows > 0 && mTextRows.size() > mMaxRows)
+            removeFirstRow();
 
-        mQueuedRows.clear();
+        setHeight(mLayoutY - mTop);
     }
-
-    if (!mLaidOutTextValid)
-        calculateTextLayout();
 }
 
 void RichTextBox::clearRows()
 {
     mTextRows.clear();
-    mQueuedRows.clear();
     mLaidOutTextValid = false;
     mLaidOutText.clear();
+    mRowLayouts.clear();
     mLinks.clear();
     setWidth(0);
     setHeight(0);
@@ -300,7 +257,7 @@ void RichTextBox::mousePressed(gcn::MouseEvent &event)
 {
     if (!mLinkHandler) return;
     LinkIterator i = find_if(mLinks.begin(), mLinks.end(),
-            MouseOverLink(event.getX(), event.getY()));
+            MouseOverLink(event.getX(), event.getY() + mTop));
 
     if (i != mLinks.end())
         mLinkHandler->handleLink(i->link);
@@ -309,17 +266,18 @@ void RichTextBox::mousePressed(gcn::MouseEvent &event)
 void RichTextBox::mouseMoved(gcn::MouseEvent &event)
 {
     LinkIterator i = find_if(mLinks.begin(), mLinks.end(),
-                             MouseOverLink(event.getX(), event.getY()));
+                             MouseOverLink(event.getX(), event.getY() + mTop));
 
     mSelectedLink = (i != mLinks.end()) ? (i - mLinks.begin()) : -1;
 }
 
 void RichTextBox::widgetResized(const gcn::Event &event)
 {
-    /* Need to lay the text out again, as line-wrapping may
-     * have changed.
+    /* Need to lay the text out again when the line-wrapping
+     * changes, which only depends on the width.
      */
-    mLaidOutTextValid = false;
+    if (mMode == AUTO_WRAP && getWidth() != mLayoutWidth)
+        mLaidOutTextValid = false;
 }
 
 void RichTextBox::draw(gcn::Graphics *graphics)
@@ -344,39 +302,48 @@ void RichTextBox::draw(gcn::Graphics *graphics)
         graphics->fillRectangle(gcn::Rectangle(0, 0, getWidth(), getHeight()));
     }
 
-    if (mSelectedLink >= 0)
+    if (mSelectedLink >= 0 && mSelectedLink < (int) mLinks.size())
     {
+        const HYPERLINK &link = mLinks[mSelectedLink];
+
         if ((mHighMode & BACKGROUND))
         {
             graphics->setColor(guiPalette->getColor(Palette::HIGHLIGHT));
-            graphics->fillRectangle(gcn::Rectangle(
-                        mLinks[mSelectedLink].x1, mLinks[mSelectedLink].y1,
-                        mLinks[mSelectedLink].x2 - mLinks[mSelectedLink].x1,
-                        mLinks[mSelectedLink].y2 - mLinks[mSelectedLink].y1));
+            graphics->fillRectangle(gcn::Rectangle(link.x1, link.y1 - mTop,
+                                                   link.x2 - link.x1,
+                                                   link.y2 - link.y1));
         }
 
         if ((mHighMode & UNDERLINE))
         {
             graphics->setColor(guiPalette->getColor(Palette::HYPERLINK));
-            graphics->drawLine(mLinks[mSelectedLink].x1, mLinks[mSelectedLink].y2,
-                               mLinks[mSelectedLink].x2, mLinks[mSelectedLink].y2);
+            graphics->drawLine(link.x1, link.y2 - mTop,
+                               link.x2, link.y2 - mTop);
         }
     }
 
     gcn::Font *font = getFont();
 
-    for (LaidOutTextIterator i = mLaidOutText.begin(); i != mLaidOutText.end();
-         i++)
+    // Only draw the parts within the visible area of the scroll area
+    const gcn::ClipRectangle &clip = graphics->getCurrentClipArea();
+    const int top = clip.y - clip.yOffset + mTop - font->getHeight();
+    const int bottom = clip.y - clip.yOffset + mTop + clip.height;
+
+    LaidOutTextIterator i = std::lower_bound(mLaidOutText.begin(),
+                                             mLaidOutText.end(), top,
+                                             PartAbove());
+
+    for (; i != mLaidOutText.end() && i->y < bottom; ++i)
     {
         switch (i->type)
         {
             case LaidOutPart::HORIZONTAL_RULE:
                 graphics->setColor(i->color);
-                graphics->drawLine(0, i->y, getWidth(), i->y);
+                graphics->drawLine(0, i->y - mTop, getWidth(), i->y - mTop);
                 break;
             default:
                 graphics->setColor(i->color);
-                font->drawString(graphics, i->text, i->x, i->y);
+                font->drawString(graphics, i->text, i->x, i->y - mTop);
         }
     }
 }
@@ -388,31 +355,71 @@ void RichTextBox::fontChanged()
 
 void RichTextBox::calculateTextLayout()
 {
-    int x = 0, y = 0;
-    int wrappedLines = 0;
-    int link = 0;
-    gcn::Font *font = getFont();
-
     mLaidOutText.clear();
+    mRowLayouts.clear();
+    mLayoutY = 0;
+    mLayoutLink = 0;
+    mTop = 0;
+    mLayoutWidth = getWidth();
 
     for (TextRowIterator i = mTextRows.begin(); i != mTextRows.end(); i++)
+        layoutRow(*i);
+
+    // Discard older rows when a row limit has been set
+    while (mMaxRows > 0 && mTextRows.size() > mMaxRows)
+        removeFirstRow();
+
+    setHeight(mLayoutY - mTop);
+    mLaidOutTextValid = true;
+}
+
+void RichTextBox::removeFirstRow()
+{
+    mTextRows.pop_front();
+
+    if (mRowLayouts.empty())
+        return;
+
+    const RowLayout &layout = mRowLayouts.front();
+
+    for (unsigned int i = 0; i < layout.parts; i++)
+        mLaidOutText.pop_front();
+
+    mLinks.erase(mLinks.begin(), mLinks.begin() + layout.links);
+    mLayoutLink -= layout.links;
+    mSelectedLink = -1;
+
+    // Instead of moving all the other rows up, their offset changes
+    mTop += layout.height;
+
+    mRowLayouts.pop_front();
+}
+
+void RichTextBox::layoutRow(const std::string &row)
+{
+    gcn::Font *font = getFont();
+    const gcn::Color textColor = guiPalette->getColor(Palette::TEXT);
+    gcn::Color selColor = textColor;
+    gcn::Color prevColor = selColor;
+    bool wrapped = false;
+    int x = 0;
+    int y = mLayoutY;
+    int &link = mLayoutLink;
+
+    RowLayout layout;
+    layout.parts = mLaidOutText.size();
+    layout.links = link;
+
+    // Check for separator lines
+    if (row.find("---", 0) == 0)
+    {
+        LaidOutPart temp(LaidOutPart::HORIZONTAL_RULE, row, 0,
+                         y + (font->getHeight() / 2), textColor);
+        mLaidOutText.push_back(temp);
+        y += font->getHeight();
+    }
+    else
     {
-        const gcn::Color textColor = guiPalette->getColor(Palette::TEXT);
-        gcn::Color selColor = textColor;
-        gcn::Color prevColor = selColor;
-        const std::string row = *(i);
-        bool wrapped = false;
-        x = 0;
-
-        // Check for separator lines
-        if (row.find("---", 0) == 0)
-        {
-            LaidOutPart temp(LaidOutPart::HORIZONTAL_RULE, row, 0,
-                             y + (font->getHeight() / 2), textColor);
-            mLaidOutText.push_back(temp);
-            y += font->getHeight();
-            continue;
-        }
 
         // TODO: Check if we must take texture size limits into account here
         // TODO: Check if some of the O(n) calls can be removed
@@ -570,7 +577,6 @@ void RichTextBox::calculateTextLayout()
                     end += 2; // Skip to after the space
 
                 wrapped = true;
-                wrappedLines++;
             }
             LaidOutPart temp(part, x, y, selColor);
             mLaidOutText.push_back(temp);
@@ -578,6 +584,11 @@ void RichTextBox::calculateTextLayout()
         }
         y += font->getHeight();
     }
-    setHeight(y);
-    mLaidOutTextValid = true;
+
+    layout.parts = mLaidOutText.size() - layout.parts;
+    layout.links = link - layout.links;
+    layout.height = y - mLayoutY;
+    mRowLayouts.push_back(layout);
+
+    mLayoutY = y;
 }
@@ -23,6 +23,7 @@
 #ifndef RICHTEXTBOX_H
 #define RICHTEXTBOX_H
 
+#include <deque>
 #include <list>
 #include <vector>
 
@@ -98,13 +99,14 @@ class RichTextBox : public gcn::Widget, public gcn::MouseListener,
         void mouseMoved(gcn::MouseEvent &event);
 
         /**
-         * After a resize, calculateTextLayout must be called
+         * After a change of width, calculateTextLayout must be called
          * before (or at the start of) the next draw.
          */
         void widgetResized(const gcn::Event &event);
 
         /**
-         * Draws the browser box.
+         * Draws the browser box. Only the rows within the clip area are
+         * drawn.
          */
         void draw(gcn::Graphics *graphics);
 
@@ -174,15 +176,12 @@ class RichTextBox : public gcn::Widget, public gcn::MouseListener,
          * mTextRows contains the raw text, before any layout or
          * link-recognition operations.
          *
-         * mQueuedRows contains the rows added since the last logic update.
-         * Rows are cached in advance, rather than operating on them immediately
-         * in order to try to avoid degenerating into a O(n!) algorithm when
-         * adding rows, and instead have a series of O(n^2) readjustments.
+         * Rows added since the last logic update are laid out on the next
+         * one, without touching the rows laid out before.
          */
         typedef std::list<std::string> TextRows;
         typedef TextRows::iterator TextRowIterator;
         TextRows mTextRows;
-        TextRows mQueuedRows;
 
         /**
          * A result of parsing mTextRows which has been
@@ -223,13 +222,56 @@ class RichTextBox : public gcn::Widget, public gcn::MouseListener,
                     color(c)
                     {}
         };
-        typedef std::list<LaidOutPart> LaidOutText;
+        typedef std::deque<LaidOutPart> LaidOutText;
         typedef LaidOutText::iterator LaidOutTextIterator;
         LaidOutText mLaidOutText;
 
+        /**
+         * Orders laid out parts by their position, for finding the ones
+         * that are visible.
+         */
+        struct PartAbove
+        {
+            bool operator()(const LaidOutPart &part, const int y) const
+            { return part.y < y; }
+        };
+
+        /**
+         * What a text row turned into when it was laid out, so that it can
+         * be removed again.
+         */
+        struct RowLayout
+        {
+            unsigned int parts;     /**< Number of LaidOutParts */
+            unsigned int links;     /**< Number of links */
+            int height;
+        };
+        std::deque<RowLayout> mRowLayouts;
+
+        /**
+         * Lays out a row below the rows laid out before.
+         */
+        void layoutRow(const std::string &row);
+
+        /**
+         * Removes the oldest row, together with its layout.
+         */
+        void removeFirstRow();
+
+        int mLayoutY;           /**< Where the next row is laid out */
+        int mLayoutLink;        /**< The first link of the next row */
+        int mLayoutWidth;       /**< The width the text was wrapped at */
+
+        /**
+         * The position of the first row. Rather than moving all rows up when
+         * old ones are removed, the laid out positions are offset by this.
+         */
+        int mTop;
+
         /**
          * Whether calculateTextLayout has been called since the
-         * last event that requires it.
+         * last event that requires it: a change of width or font, or
+         * clearing the rows. Added rows don't need it.
          */
         bool mLaidOutTextValid;
 
@@ -21,6 +21,7 @@
  */
 
 #include "scrollarea.h"
+#include "window.h"
 
 #include "../graphics.h"
 #include "../gui.h"
@@ -28,6 +29,7 @@
 #include "../../../core/configlistener.h"
 #include "../../../core/configuration.h"
 #include "../../../core/resourcemanager.h"
+#include "../../../core/scheduler.h"
 
 #include "../../../core/image/image.h"
 
@@ -37,6 +39,9 @@ int ScrollArea::instances = 0;
 float ScrollArea::mAlpha = 1.0;
 ScrollAreaConfigListener *ScrollArea::mConfigListener = NULL;
 
+/** Ticks between scrolls while a button is held down */
+static const int SCROLL_TICKS = 10;
+
 ImageRect ScrollArea::background;
 ImageRect ScrollArea::vMarker;
 Image *ScrollArea::buttons[4][2];
@@ -68,7 +73,9 @@ class ScrollAreaConfigListener : public ConfigListener
 ScrollArea::ScrollArea(bool gc, bool opaque):
     gcn::ScrollArea(),
     mOpaque(opaque),
-    mGC(gc)
+    mGC(gc),
+    mLastHScroll(0),
+    mLastVScroll(0)
 {
     init();
 }
@@ -76,7 +83,9 @@ ScrollArea::ScrollArea(bool gc, bool opaque):
 ScrollArea::ScrollArea(gcn::Widget *widget, bool gc, bool opaque):
     gcn::ScrollArea(widget),
     mOpaque(opaque),
-    mGC(gc)
+    mGC(gc),
+    mLastHScroll(0),
+    mLastVScroll(0)
 {
     init();
 }
@@ -181,7 +190,7 @@ void ScrollArea::init()
         config.addListener("guialpha", mConfigListener);
     }
 
-    mLastUpdate = tick_time;
+    mScrollTicks = 0;
 
     instances++;
 }
@@ -189,10 +198,7 @@ void ScrollArea::init()
 void ScrollArea::logic()
 {
     if (!isVisible())
-    {
-        mLastUpdate = tick_time;
         return;
-    }
 
     gcn::ScrollArea::logic();
     gcn::Widget *content = getContent();
@@ -213,12 +219,22 @@ void ScrollArea::logic()
         }
     }
 
-    int updateTicks = get_elapsed_time(mLastUpdate) / 100;
+    // Keep scrolling while a button is held down
+    mScrollTicks += Scheduler::getFrameTicks();
 
-    while (updateTicks > 0)
+    while (mScrollTicks >= SCROLL_TICKS)
     {
+        mScrollTicks -= SCROLL_TICKS;
         scroll();
-        updateTicks--;
+    }
+
+    // Scrolling changes what the window shows
+    if (getHorizontalScrollAmount() != mLastHScroll ||
+        getVerticalScrollAmount() != mLastVScroll)
+    {
+        mLastHScroll = getHorizontalScrollAmount();
+        mLastVScroll = getVerticalScrollAmount();
+        Window::contentChanged(this);
     }
 }
 
@@ -366,8 +382,7 @@ void ScrollArea::scroll()
     else if (mRightButtonPressed)
         setHorizontalScrollAmount(getHorizontalScrollAmount() +
                                   mRightButtonScrollAmount);
-
-    mLastUpdate = tick_time;}
+}
 
 void ScrollArea::mouseWheelMovedUp(gcn::MouseEvent& mouseEvent)
 {
@@ -441,5 +456,7 @@ void ScrollArea::mousePressed(gcn::MouseEvent &mouseEvent)
             mRightButtonPressed = true;
     }
 
+    // Scroll right away, then wait a full interval before repeating
     scroll();
+    mScrollTicks = 0;
 }
@@ -131,7 +131,8 @@ class ScrollArea : public gcn::ScrollArea
         bool mOpaque;
         bool mGC;
 
-        int mLastUpdate;
+        int mScrollTicks;                /**< Ticks since the last scroll */
+        int mLastHScroll, mLastVScroll;  /**< Scroll amounts last drawn */
 };
 
 #endif
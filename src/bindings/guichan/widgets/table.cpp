@@ -26,6 +26,7 @@
 #include <guichan/key.hpp>
 
 #include "table.h"
+#include "window.h"
 
 #include "../palette.h"
 #include "../protectedfocuslistener.h"
@@ -474,6 +475,7 @@ void Table::modelUpdated(bool completed)
     {
         recomputeDimensions();
         installActionListeners();
+        Window::contentChanged(this);
     }
     else
     { // before the update?
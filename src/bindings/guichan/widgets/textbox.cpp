@@ -26,6 +26,7 @@
 #include <guichan/font.hpp>
 
 #include "textbox.h"
+#include "window.h"
 
 #include "../palette.h"
 
@@ -53,6 +54,7 @@ TextBox::~TextBox()
 void TextBox::setTextWrapped(const std::string &text, int maxDimension)
 {
     mMaxDimension = maxDimension;
+    Window::contentChanged(this);
 
     // Make sure parent scroll area sets width of this widget
     if (getParent())
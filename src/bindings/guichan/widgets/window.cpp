@@ -36,6 +36,8 @@
 #include "../palette.h"
 #include "../skin.h"
 
+#include "../sdl/sdlgraphics.h"
+
 #include "../../../core/configuration.h"
 #include "../../../core/log.h"
 
@@ -45,6 +47,8 @@
 
 int Window::instances = 0;
 int Window::mouseResize = 0;
+bool Window::mCached = false;
+int Window::mCacheGeneration = 0;
 
 gcn::Widget *Window::mPreviousFocus = NULL;
 
@@ -66,7 +70,10 @@ Window::Window(const std::string& caption, bool modal, Window *parent,
     mMinWinWidth(100),
     mMinWinHeight(40),
     mMaxWinWidth(graphics->getWidth()),
-    mMaxWinHeight(graphics->getHeight())
+    mMaxWinHeight(graphics->getHeight()),
+    mCache(NULL),
+    mCacheValid(false),
+    mCacheGenerationDrawn(0)
 {
     logger->log("Window::Window(\"%s\")", caption.c_str());
 
@@ -76,6 +83,9 @@ Window::Window(const std::string& caption, bool modal, Window *parent,
     if (!skinLoader)
         skinLoader = new SkinLoader();
 
+    if (instances == 0)
+        mCached = config.getValue("cacheWindows", 0);
+
     instances++;
 
     setFrameSize(0);
@@ -108,6 +118,7 @@ Window::~Window()
 
     destroy(mLayout);
     destroy(mClose);
+    destroy(mCache);
 
     while (!mWidgets.empty())
     {
@@ -134,6 +145,98 @@ void Window::requestFocus()
 }
 
 void Window::draw(gcn::Graphics *graphics)
+{
+    // Drawing into an image needs the SDL renderer
+    if (!mCached || Image::usesOpenGL())
+    {
+        drawContents(graphics);
+        return;
+    }
+
+    if (!mCacheValid || !mCache || mCache->getWidth() != getWidth() ||
+        mCache->getHeight() != getHeight() ||
+        mCacheGenerationDrawn != mCacheGeneration)
+    {
+        updateCache();
+    }
+
+    if (mCache)
+        static_cast<Graphics*>(graphics)->drawImage(mCache, 0, 0);
+    else
+        drawContents(graphics);
+}
+
+void Window::contentChanged(gcn::Widget *widget)
+{
+    for (; widget; widget = widget->getParent())
+    {
+        Window *window = dynamic_cast<Window*>(widget);
+
+        if (window)
+            window->invalidate();
+    }
+}
+
+void Window::updateCache()
+{
+    destroy(mCache);
+
+    // Since the contents are drawn over a transparent background, they keep
+    // the transparency of the window skin. Using the color layout of the
+    // display lets images be composited without converting each pixel.
+    Uint32 rmask, gmask, bmask, amask;
+    const SDL_Surface *screen = SDL_GetVideoSurface();
+
+    if (screen && screen->format->BytesPerPixel == 4)
+    {
+        rmask = screen->format->Rmask;
+        gmask = screen->format->Gmask;
+        bmask = screen->format->Bmask;
+        amask = ~(rmask | gmask | bmask);
+    }
+    else
+    {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+        rmask = 0xff000000;
+        gmask = 0x00ff0000;
+        bmask = 0x0000ff00;
+        amask = 0x000000ff;
+#else
+        rmask = 0x000000ff;
+        gmask = 0x0000ff00;
+        bmask = 0x00ff0000;
+        amask = 0xff000000;
+#endif
+    }
+
+    SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, getWidth(),
+                                                getHeight(), 32, rmask,
+                                                gmask, bmask, amask);
+    if (!surface)
+    {
+        logger->log("Error: Could not create window cache: %s",
+                    SDL_GetError());
+        return;
+    }
+
+    SDL_FillRect(surface, NULL, 0);
+
+    {
+        // The clip area is popped again when the graphics go out of scope
+        SDLGraphics offscreen;
+        offscreen.setTarget(surface);
+        offscreen._beginDraw();
+        drawContents(&offscreen);
+    }
+
+    mCache = Image::load(surface);
+    SDL_FreeSurface(surface);
+
+    mCacheValid = true;
+    mCacheGenerationDrawn = mCacheGeneration;
+}
+
+void Window::drawContents(gcn::Graphics *graphics)
 {
     Graphics *g = static_cast<Graphics*>(graphics);
 
@@ -373,11 +476,13 @@ void Window::widgetResized(const gcn::Event &event)
                             getPadding());
 
     refreshLayout();
+    invalidate();
 }
 
 void Window::widgetShown(const gcn::Event& event)
 {
     mVisible = true;
+    invalidate();
 
     requestMoveToTop();
     if (config.getValue("autofocus", 1) == 1)
@@ -77,10 +77,30 @@ class Window : public gcn::Window, public gcn::WidgetListener,
         virtual void requestFocus();
 
         /**
-         * Draws the window.
+         * Draws the window. With the SDL renderer and the cacheWindows
+         * option set, the window is drawn from a cached image of its
+         * contents, which is only redrawn when they are marked as changed.
          */
         void draw(gcn::Graphics *graphics);
 
+        /**
+         * Marks the contents of the window as changed, so that they are
+         * redrawn the next time the window is drawn.
+         */
+        void invalidate() { mCacheValid = false; }
+
+        /**
+         * Marks the windows holding the given widget as changed. Widgets
+         * call this when their contents change outside of any input.
+         */
+        static void contentChanged(gcn::Widget *widget);
+
+        /**
+         * Marks the contents of all windows as changed, for changes that
+         * affect every window, like the GUI colors and transparency.
+         */
+        static void invalidateAll() { mCacheGeneration++; }
+
         /**
          * Sets the size of this window.
          */
@@ -399,6 +419,16 @@ class Window : public gcn::Window, public gcn::WidgetListener,
          */
         int getResizeHandles(gcn::MouseEvent &event);
 
+        /**
+         * Draws the skin and the widgets of the window.
+         */
+        void drawContents(gcn::Graphics *graphics);
+
+        /**
+         * Redraws the contents of the window into the cached image.
+         */
+        void updateCache();
+
         ResizeGrip *mGrip;            /**< Resize grip */
         ImageButton *mClose;          /**< Close button */
         Window *mParent;              /**< The parent window */
@@ -417,6 +447,10 @@ class Window : public gcn::Window, public gcn::WidgetListener,
         int mMaxWinHeight;            /**< Maximum window height */
         int mDefaultWidth;            /**< Default window width */
         int mDefaultHeight;           /**< Default window height */
+        Image *mCache;                /**< Cached contents of the window */
+        bool mCacheValid;             /**< Whether the cache is up to date */
+        int mCacheGenerationDrawn;    /**< Generation the cache was drawn
+                                           at */
 
         // Window "sector" system for placing windows. This provides a best
         // effort adaptation of a user's window locations on window resize.
@@ -435,6 +469,8 @@ class Window : public gcn::Window, public gcn::WidgetListener,
 
         static int mouseResize;       /**< Active resize handles */
         static int instances;         /**< Number of Window instances */
+        static bool mCached;          /**< Whether windows are cached */
+        static int mCacheGeneration;  /**< Raised to redraw all windows */
 
         /**
          * The width of the resize border. Is independent of the actual window
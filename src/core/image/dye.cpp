@@ -20,10 +20,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+#include <cstdio>
 #include <sstream>
 
-#include <guichan/color.hpp>
-
 #include "dye.h"
 
 #include "../log.h"
@@ -48,7 +48,7 @@ DyePalette::DyePalette(const std::string &description)
         const std::string str = description.substr(pos, pos + 6);
 
         sscanf(str.c_str(), "%06x", &val);
-        mColors.push_back(new gcn::Color(val));
+        mColors.push_back(val);
         pos += 6;
 
         if (pos == size)
@@ -60,25 +60,12 @@ DyePalette::DyePalette(const std::string &description)
     }
 }
 
-DyePalette::~DyePalette()
-{
-    delete_all(mColors);
-}
-
-void DyePalette::getColor(const int intensity, gcn::Color* color) const
+int DyePalette::getColor(const int intensity) const
 {
-    if (intensity == 0)
-    {
-        color->r = 0;
-        color->g = 0;
-        color->b = 0;
-        return;
-    }
-
     const int last = mColors.size();
 
-    if (last == 0)
-        return;
+    if (intensity == 0 || last == 0)
+        return 0;
 
     const int i = intensity * last / 255;
     const int t = intensity * last % 255;
@@ -86,38 +73,33 @@ void DyePalette::getColor(const int intensity, gcn::Color* color) const
     const int j = t != 0 ? i : i - 1;
 
     // Get the exact color if any, the next color otherwise.
-    const int r2 = mColors[j]->r,
-              g2 = mColors[j]->g,
-              b2 = mColors[j]->b;
+    const int color2 = mColors[j];
 
     if (t == 0)
-    {
-        // Exact color.
-        color->r = r2;
-        color->g = g2;
-        color->b = b2;
-        return;
-    }
+        return color2;
 
     // Get the previous color. First color is implicitly black.
-    int r1 = 0, g1 = 0, b1 = 0;
-    if (i > 0)
+    const int color1 = i > 0 ? mColors[i - 1] : 0;
+
+    // Perform a linear interpolation.
+    int color = 0;
+    for (int shift = 16; shift >= 0; shift -= 8)
     {
-        r1 = mColors[i - 1]->r;
-        g1 = mColors[i - 1]->g;
-        b1 = mColors[i - 1]->b;
+        const int c1 = (color1 >> shift) & 0xff;
+        const int c2 = (color2 >> shift) & 0xff;
+        color |= (((255 - t) * c1 + t * c2) / 255) << shift;
     }
 
-    // Perform a linear interpolation.
-    color->r = ((255 - t) * r1 + t * r2) / 255;
-    color->g = ((255 - t) * g1 + t * g2) / 255;
-    color->b = ((255 - t) * b1 + t * b2) / 255;
+    return color;
 }
 
 Dye::Dye(const std::string &description)
 {
     for (int i = 0; i < 7; ++i)
+    {
         mDyePalettes[i] = 0;
+        std::fill_n(mTables[i], 256, -1);
+    }
 
     if (description.empty())
         return;
@@ -154,6 +136,10 @@ Dye::Dye(const std::string &description)
         }
         mDyePalettes[i] = new DyePalette(description.substr(pos + 2,
                                                             next_pos - pos - 2));
+
+        for (int intensity = 0; intensity < 256; ++intensity)
+            mTables[i][intensity] = mDyePalettes[i]->getColor(intensity);
+
         ++next_pos;
     }
     while (next_pos < length);
@@ -165,23 +151,51 @@ Dye::~Dye()
         destroy(mDyePalettes[i]);
 }
 
-void Dye::update(gcn::Color *color) const
+void Dye::update(uint32_t *pixels, const int count) const
 {
-    const int cmax = std::max(color->r, std::max(color->g, color->b));
-    if (cmax == 0)
-        return;
+    // Sprite sheets have long runs of the same color, so remember the last
+    // pixel that was changed
+    uint32_t lastIn = 0, lastOut = 0;
 
-    const int cmin = std::min(color->r, std::min(color->g, color->b));
-    const int intensity = color->r + color->g + color->b;
+    for (uint32_t *end = pixels + count; pixels != end; ++pixels)
+    {
+        const uint32_t pixel = *pixels;
 
-    // not pure
-    if (cmin != cmax && (cmin != 0 || (intensity != cmax && intensity != 2 * cmax)))
-        return;
+        if (!(pixel & 0xff))
+            continue;
 
-    const int i = (color->r != 0) | ((color->g != 0) << 1) | ((color->b != 0) << 2);
+        if (pixel == lastIn)
+        {
+            *pixels = lastOut;
+            continue;
+        }
 
-    if (mDyePalettes[i - 1])
-        mDyePalettes[i - 1]->getColor(cmax, color);
+        const int r = pixel >> 24;
+        const int g = (pixel >> 16) & 0xff;
+        const int b = (pixel >> 8) & 0xff;
+
+        const int cmax = std::max(r, std::max(g, b));
+        if (cmax == 0)
+            continue;
+
+        const int cmin = std::min(r, std::min(g, b));
+        const int intensity = r + g + b;
+
+        // not pure
+        if (cmin != cmax && (cmin != 0 || (intensity != cmax &&
+                                           intensity != 2 * cmax)))
+            continue;
+
+        const int i = (r != 0) | ((g != 0) << 1) | ((b != 0) << 2);
+
+        const int dyed = mTables[i - 1][cmax];
+        if (dyed < 0)
+            continue;
+
+        lastIn = pixel;
+        lastOut = ((uint32_t) dyed << 8) | (pixel & 0xff);
+        *pixels = lastOut;
+    }
 }
 
 void Dye::instantiate(std::string &target, const std::string &palettes)
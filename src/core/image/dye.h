@@ -23,11 +23,10 @@
 #ifndef DYE_H
 #define DYE_H
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
-#include "../../bindings/guichan/guichanfwd.h"
-
 /**
  * Class for performing a linear interpolation between colors.
  */
@@ -42,15 +41,13 @@ class DyePalette
          */
         DyePalette(const std::string &pallete);
 
-        ~DyePalette();
-
         /**
-         * Gets a pixel color depending on its intensity.
+         * Gets a pixel color depending on its intensity, as 0xRRGGBB.
          */
-        void getColor(const int intensity, gcn::Color* color) const;
+        int getColor(const int intensity) const;
 
     private:
-        std::vector<gcn::Color*> mColors;
+        std::vector<int> mColors;   /**< As 0xRRGGBB */
 };
 
 /**
@@ -74,9 +71,17 @@ class Dye
         ~Dye();
 
         /**
-         * Modifies a pixel color.
+         * Modifies a row of pixels stored as 0xRRGGBBAA. Fully transparent
+         * pixels are left alone.
+         */
+        void update(uint32_t *pixels, const int count) const;
+
+        /**
+         * Returns the palette of the given channel, in the order below, or
+         * NULL if the dye doesn't change it.
          */
-        void update(gcn::Color *color) const;
+        const DyePalette *getPalette(const int channel) const
+        { return mDyePalettes[channel]; }
 
         /**
          * Fills the blank in a dye placeholder with some palette names.
@@ -92,6 +97,13 @@ class Dye
          * Red, Green, Yellow, Blue, Magenta, White (or rather gray).
          */
         DyePalette *mDyePalettes[7];
+
+        /**
+         * The colors of each palette by intensity, as 0xRRGGBB, or -1 for
+         * palettes which weren't given. Filled in once by the constructor,
+         * so that recoloring a pixel is a table lookup.
+         */
+        int mTables[7][256];
 };
 
 #endif
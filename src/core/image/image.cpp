@@ -20,19 +20,18 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <SDL_image.h>
 #include <SDL_rotozoom.h>
 
-#include <guichan/color.hpp>
-
 #include "dye.h"
 #include "image.h"
 
 #include "../log.h"
 
-#include "../utils/dtor.h"
-
 #ifdef USE_OPENGL
+#include "textureatlas.h"
+
 #include "../../bindings/guichan/opengl/openglgraphics.h"
 
 bool Image::mUseOpenGL = false;
@@ -40,10 +39,10 @@ int Image::mTextureType = 0;
 int Image::mTextureSize = 0;
 #endif
 
-Image::Image(SDL_Surface *image, Uint8* alphas):
-    mStoredAlpha(alphas),
+Image::Image(SDL_Surface *image):
 #ifdef USE_OPENGL
     mGLImage(0),
+    mInAtlas(false),
 #endif
     mImage(image),
     mAlpha(1.0f)
@@ -57,10 +56,10 @@ Image::Image(SDL_Surface *image, Uint8* alphas):
 #ifdef USE_OPENGL
 Image::Image(const GLuint &glimage, const int width, const int height,
              const int texWidth, const int texHeight):
-    mStoredAlpha(NULL),
     mGLImage(glimage),
     mTexWidth(texWidth),
     mTexHeight(texHeight),
+    mInAtlas(false),
     mImage(0),
     mAlpha(1.0)
 {
@@ -105,6 +104,27 @@ Resource *Image::load(void *buffer, unsigned bufferSize, const Dye &dye)
         return NULL;
     }
 
+    SDL_Surface *surf = convertToRGBA(tmpImage);
+    SDL_FreeSurface(tmpImage);
+
+    if (!surf)
+        return NULL;
+
+    Image *image = load(surf, dye);
+    SDL_FreeSurface(surf);
+    return image;
+}
+
+Image *Image::load(SDL_Surface *surface, const Dye &dye)
+{
+    dye.update(static_cast< uint32_t * >(surface->pixels),
+               surface->w * surface->h);
+
+    return load(surface);
+}
+
+SDL_Surface *Image::convertToRGBA(SDL_Surface *surface)
+{
     SDL_PixelFormat rgba;
     rgba.palette = NULL;
     rgba.BitsPerPixel = 32;
@@ -116,27 +136,7 @@ Resource *Image::load(void *buffer, unsigned bufferSize, const Dye &dye)
     rgba.colorkey = 0;
     rgba.alpha = 255;
 
-    SDL_Surface *surf = SDL_ConvertSurface(tmpImage, &rgba, SDL_SWSURFACE);
-    SDL_FreeSurface(tmpImage);
-
-    Uint32 *pixels = static_cast< Uint32 * >(surf->pixels);
-    for (Uint32 *p_end = pixels + surf->w * surf->h; pixels != p_end; ++pixels)
-    {
-        int alpha = *pixels & 255;
-        if (!alpha)
-            continue;
-        gcn::Color *v = new gcn::Color();
-        v->r = (*pixels >> 24) & 255;
-        v->g = (*pixels >> 16) & 255;
-        v->b = (*pixels >> 8 ) & 255;
-        dye.update(v);
-        *pixels = (v->r << 24) | (v->g << 16) | (v->b << 8) | alpha;
-        destroy(v);
-    }
-
-    Image *image = load(surf);
-    SDL_FreeSurface(surf);
-    return image;
+    return SDL_ConvertSurface(surface, &rgba, SDL_SWSURFACE);
 }
 
 Resource *Image::resize(Image *image, const int width, const int height)
@@ -144,7 +144,7 @@ Resource *Image::resize(Image *image, const int width, const int height)
     return image->resize(width, height);
 }
 
-Image *Image::load(SDL_Surface *tmpImage)
+Image *Image::load(SDL_Surface *tmpImage, const bool useAtlas)
 {
 #ifdef USE_OPENGL
     if (mUseOpenGL)
@@ -154,6 +154,15 @@ Image *Image::load(SDL_Surface *tmpImage)
 
         int width = tmpImage->w;
         int height = tmpImage->h;
+
+        // Small images share a texture, so that they can be drawn together
+        if (useAtlas && TextureAtlas::fits(width, height))
+        {
+            Image *image = loadToAtlas(tmpImage);
+            if (image)
+                return image;
+        }
+
         int realWidth = powerOfTwo(width);
         int realHeight = powerOfTwo(height);
 
@@ -246,7 +255,6 @@ Image *Image::load(SDL_Surface *tmpImage)
 
     bool hasAlpha = false;
 
-    Uint8* imageAlphas = new Uint8[tmpImage->w * tmpImage->h];
     if (tmpImage->format->BitsPerPixel == 32)
     {
         // Figure out whether the image uses its alpha layer
@@ -256,10 +264,11 @@ Image *Image::load(SDL_Surface *tmpImage)
             SDL_GetRGBA(((Uint32*) tmpImage->pixels)[i],
                           tmpImage->format, &r, &g, &b, &a);
 
-            imageAlphas[i] = a;
-
             if (a != 255)
+            {
                 hasAlpha = true;
+                break;
+            }
         }
     }
 
@@ -274,11 +283,10 @@ Image *Image::load(SDL_Surface *tmpImage)
     if (!image)
     {
         logger->log("Error: Image convert failed.");
-        delete [] imageAlphas;
         return NULL;
     }
 
-    return new Image(image, imageAlphas);
+    return new Image(image);
 }
 
 void Image::unload()
@@ -290,13 +298,15 @@ void Image::unload()
         // Free the image surface.
         SDL_FreeSurface(mImage);
         mImage = NULL;
-        delete [] mStoredAlpha;
     }
 
 #ifdef USE_OPENGL
     if (mGLImage)
     {
-        glDeleteTextures(1, &mGLImage);
+        if (mInAtlas)
+            TextureAtlas::remove(mGLImage, mBounds.x, mBounds.y);
+        else
+            OpenGLGraphics::deleteTexture(mGLImage);
         mGLImage = 0;
     }
 #endif
@@ -314,29 +324,12 @@ Image* Image::resize(const int width, const int height)
     
     if (mImage)
     {
-        SDL_Surface* scaledSurface = NULL;
-        Uint8* imageAlphas = NULL;
-
         const double scaleX = (double) width / (double) getWidth();
         const double scaleY = (double) height / (double) getHeight();
 
-        scaledSurface = zoomSurface(mImage, scaleX, scaleY, 1);
-
-        imageAlphas = new Uint8[scaledSurface->w * scaledSurface->h];
-        if (scaledSurface->format->BitsPerPixel == 32)
-        {
-            // Recalculate the alpha layers
-            for (int i = 0; i < scaledSurface->w * scaledSurface->h; ++i)
-            {
-                Uint8 r, g, b, a;
-                SDL_GetRGBA(((Uint32*) scaledSurface->pixels)[i],
-                              scaledSurface->format, &r, &g, &b, &a);
-
-                imageAlphas[i] = a;
-            }
-        }
+        SDL_Surface *scaledSurface = zoomSurface(mImage, scaleX, scaleY, 1);
 
-        return new Image(scaledSurface, imageAlphas);
+        return new Image(scaledSurface);
     }
 
     return this;
@@ -348,8 +341,8 @@ SubImage *Image::getSubImage(const int x, const int y, const int width,
     // Create a new clipped sub-image
 #ifdef USE_OPENGL
     if (mUseOpenGL)
-        return new SubImage(this, mGLImage, x, y, width, height,
-                            mTexWidth, mTexHeight);
+        return new SubImage(this, mGLImage, mBounds.x + x, mBounds.y + y,
+                            width, height, mTexWidth, mTexHeight);
 #endif
 
     return new SubImage(this, mImage, x, y, width, height);
@@ -357,36 +350,7 @@ SubImage *Image::getSubImage(const int x, const int y, const int width,
 
 void Image::setAlpha(float alpha)
 {
-    if (mAlpha == alpha)
-        return;
-
     mAlpha = alpha;
-
-#ifdef USE_OPENGL
-    if (mImage && !mUseOpenGL)
-#else
-    if (mImage)
-#endif
-    {
-        if (SDL_MUSTLOCK(mImage))
-            SDL_LockSurface(mImage);
-
-        // Set the alpha value this image is drawn at, pixel by pixel
-        for (int i = 0; i < mImage->w * mImage->h; i++)
-        {
-            Uint8 r, g, b, a;
-            SDL_GetRGBA(((Uint32*) mImage->pixels)[i], mImage->format, &r, 
-                                                       &g, &b, &a);
-
-            a = (Uint8) (mStoredAlpha[i] * mAlpha);
-
-            ((Uint32 *)(mImage->pixels))[i] = SDL_MapRGBA(mImage->format, r,
-                                                          g, b, a);
-        }
-
-        if (SDL_MUSTLOCK(mImage))
-            SDL_UnlockSurface(mImage);
-    }
 }
 
 Image* Image::merge(Image* image, const int x, const int y)
@@ -472,17 +436,150 @@ Image* Image::merge(Image* image, const int x, const int y)
     return newImage;
 }
 
+void Image::compositeTo(SDL_Surface *target, const int x, const int y) const
+{
+    if (!mImage)
+        return;
+
+    // Clip against the target
+    const int startX = std::max(0, -x);
+    const int startY = std::max(0, -y);
+    const int endX = std::min((int) mBounds.w, target->w - x);
+    const int endY = std::min((int) mBounds.h, target->h - y);
+
+    if (startX >= endX || startY >= endY)
+        return;
+
+    SDL_LockSurface(mImage);
+    SDL_LockSurface(target);
+
+    const SDL_PixelFormat *format = mImage->format;
+    const int bpp = format->BytesPerPixel;
+    const bool colorKey = mImage->flags & SDL_SRCCOLORKEY;
+
+    for (int offsetY = startY; offsetY < endY; offsetY++)
+    {
+        const Uint8 *src = (const Uint8*) mImage->pixels +
+                           (mBounds.y + offsetY) * mImage->pitch +
+                           (mBounds.x + startX) * bpp;
+        Uint32 *dst = (Uint32*) ((Uint8*) target->pixels +
+                                 (y + offsetY) * target->pitch) + x + startX;
+
+        for (int offsetX = startX; offsetX < endX; offsetX++, src += bpp, dst++)
+        {
+            Uint32 pixel;
+            switch (bpp)
+            {
+                case 1: pixel = *src; break;
+                case 2: pixel = *(const Uint16*) src; break;
+                case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+                    pixel = src[0] << 16 | src[1] << 8 | src[2];
+#else
+                    pixel = src[0] | src[1] << 8 | src[2] << 16;
+#endif
+                    break;
+                default: pixel = *(const Uint32*) src; break;
+            }
+
+            if (colorKey && pixel == format->colorkey)
+                continue;
+
+            Uint8 r, g, b, a;
+            SDL_GetRGBA(pixel, mImage->format, &r, &g, &b, &a);
+            a = (Uint8) (a * mAlpha);
+
+            if (a == 0)
+                continue;
+
+            if (a == 255)
+            {
+                *dst = SDL_MapRGBA(target->format, r, g, b, 255);
+                continue;
+            }
+
+            // Blend with the pixel below, taking its alpha into account
+            Uint8 dr, dg, db, da;
+            SDL_GetRGBA(*dst, target->format, &dr, &dg, &db, &da);
+
+            const int below = da * (255 - a) / 255;
+            const int alpha = a + below;
+
+            *dst = SDL_MapRGBA(target->format,
+                               (r * a + dr * below) / alpha,
+                               (g * a + dg * below) / alpha,
+                               (b * a + db * below) / alpha,
+                               alpha);
+        }
+    }
+
+    SDL_UnlockSurface(target);
+    SDL_UnlockSurface(mImage);
+}
+
 float Image::getAlpha() const
 {
     return mAlpha;
 }
 
+bool Image::usesOpenGL()
+{
+#ifdef USE_OPENGL
+    return mUseOpenGL;
+#else
+    return false;
+#endif
+}
+
 #ifdef USE_OPENGL
 void Image::setLoadAsOpenGL(const bool useOpenGL)
 {
     Image::mUseOpenGL = useOpenGL;
 }
 
+Image *Image::loadToAtlas(SDL_Surface *tmpImage)
+{
+    // Make sure the alpha channel is not used, but copied to destination
+    SDL_SetAlpha(tmpImage, 0, SDL_ALPHA_OPAQUE);
+
+    // Determine 32-bit masks based on byte order
+    Uint32 rmask, gmask, bmask, amask;
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    rmask = 0xff000000;
+    gmask = 0x00ff0000;
+    bmask = 0x0000ff00;
+    amask = 0x000000ff;
+#else
+    rmask = 0x000000ff;
+    gmask = 0x0000ff00;
+    bmask = 0x00ff0000;
+    amask = 0xff000000;
+#endif
+
+    SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, tmpImage->w,
+                                                tmpImage->h, 32, rmask, gmask,
+                                                bmask, amask);
+    if (!surface)
+        return NULL;
+
+    SDL_BlitSurface(tmpImage, NULL, surface, NULL);
+
+    GLuint texture;
+    int x, y, size;
+    const bool added = TextureAtlas::add(surface, texture, x, y, size);
+
+    SDL_FreeSurface(surface);
+
+    if (!added)
+        return NULL;
+
+    Image *image = new Image(texture, tmpImage->w, tmpImage->h, size, size);
+    image->mBounds.x = x;
+    image->mBounds.y = y;
+    image->mInAtlas = true;
+    return image;
+}
+
 int Image::powerOfTwo(const int input)
 {
     int value = 1;
@@ -546,46 +643,7 @@ SubImage::~SubImage()
 SubImage *SubImage::getSubImage(const int x, const int y, const int w,
                                 const int h)
 {
-    return mParent->getSubImage(mBounds.x + x, mBounds.y + y, w, h);
-}
-
-void SubImage::setAlpha(float alpha)
-{
-    if (mAlpha == alpha)
-        return;
-
-    mAlpha = alpha;
-
-#ifdef USE_OPENGL
-    if (mImage && !mUseOpenGL)
-#else
-    if (mImage)
-#endif
-    {
-        if (SDL_MUSTLOCK(mImage))
-            SDL_LockSurface(mImage);
-
-        // Set the alpha value this image is drawn at, pixel by pixel
-        for (int offsetY = 0; offsetY < getHeight() &&
-            (offsetY + mBounds.y) < mParent->getHeight(); offsetY++)
-        {
-            for (int offsetX = 0; offsetX < getWidth() &&
-                (offsetX + mBounds.x) < mParent->getWidth(); offsetX++)
-            {
-                int i = (offsetY + mBounds.y) * mParent->getWidth() + offsetX +
-                        mBounds.x;
-                Uint8 r, g, b, a;
-                SDL_GetRGBA(((Uint32*) mImage->pixels)[i], mImage->format, &r, 
-                                                           &g, &b, &a);
-
-                a = (Uint8) (mParent->mStoredAlpha[i] * mAlpha);
-
-                ((Uint32 *)(mImage->pixels))[i] = SDL_MapRGBA(mImage->format, r,
-                                                              g, b, a);
-            }
-        }
-        if (SDL_MUSTLOCK(mImage))
-            SDL_UnlockSurface(mImage);
-    }
+    // The parent adds its own position within the texture again
+    return mParent->getSubImage(mBounds.x - mParent->mBounds.x + x,
+                                mBounds.y - mParent->mBounds.y + y, w, h);
 }
-
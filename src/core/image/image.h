@@ -55,6 +55,7 @@ class Image : public Resource
     friend class SDLGraphics;
 #ifdef USE_OPENGL
     friend class OpenGLGraphics;
+    friend class TextureAtlas;
 #endif
 
     friend class SubImage;
@@ -105,8 +106,26 @@ class Image : public Resource
 
         /**
          * Loads an image from an SDL surface.
+         *
+         * @param useAtlas whether a small image may share a texture atlas
+         *                 page. Images that are replaced often, like rendered
+         *                 text, are better off with a texture of their own,
+         *                 since their space on a page is hardly ever reused.
+         */
+        static Image *load(SDL_Surface *, const bool useAtlas = true);
+
+        /**
+         * Recolors a surface returned by convertToRGBA and loads an image
+         * from it. The surface is changed, but not freed.
+         */
+        static Image *load(SDL_Surface *surface, const Dye &dye);
+
+        /**
+         * Returns a copy of the surface with its pixels stored as 0xRRGGBBAA,
+         * the layout Dye works on. The copy should be freed by the caller
+         * using SDL_FreeSurface.
          */
-        static Image *load(SDL_Surface *);
+        static SDL_Surface *convertToRGBA(SDL_Surface *surface);
 
         /**
          * Frees the resources created by SDL.
@@ -133,7 +152,8 @@ class Image : public Resource
                                       const int width, const int height);
 
         /**
-         * Sets the alpha value of this image.
+         * Sets the alpha value this image is drawn at. The pixels themselves
+         * are left alone, so this is cheap to change every frame.
          */
         virtual void setAlpha(float alpha);
 
@@ -163,6 +183,19 @@ class Image : public Resource
          */
         Image* merge(Image* image, const int x, const int y);
 
+        /**
+         * Draws this image onto a 32 bit surface with an alpha channel,
+         * blending it with what is already there. Unlike blitting, this also
+         * combines the alpha values, so the result can be drawn over other
+         * things later. SDL use only.
+         */
+        void compositeTo(SDL_Surface *target, const int x, const int y) const;
+
+        /**
+         * Returns whether images are loaded as OpenGL textures.
+         */
+        static bool usesOpenGL();
+
         /**
          * Resizes an image to a given width or height.
          *
@@ -171,12 +204,6 @@ class Image : public Resource
         Image* resize(const int width, const int height);
 
     protected:
-        /**
-         * Returns the current alpha value at a given pixel. Used to compute
-         * what the alpha value should be for a given pixel in SDL mode.
-         */
-        Uint8* mStoredAlpha;
-
         /**
          * Constructor.
          */
@@ -184,12 +211,18 @@ class Image : public Resource
         Image(const GLuint &glimage, const int width, const int height,
               const int texWidth, const int texHeight);
 
+        /**
+         * Puts an image on a texture atlas page. Returns NULL when that
+         * fails, in which case it should get a texture of its own.
+         */
+        static Image *loadToAtlas(SDL_Surface *tmpImage);
+
         /**
          * Returns the first power of two equal or bigger than the input.
          */
         static int powerOfTwo(const int input);
 #endif
-        Image(SDL_Surface *image, Uint8* alphas = NULL);
+        Image(SDL_Surface *image);
 
         SDL_Rect mBounds;
         bool mLoaded;
@@ -197,6 +230,7 @@ class Image : public Resource
 #ifdef USE_OPENGL
         GLuint mGLImage;
         int mTexWidth, mTexHeight;
+        bool mInAtlas;      /**< Whether mGLImage is shared with others */
 
         static bool mUseOpenGL;
         static int mTextureType;
@@ -237,11 +271,6 @@ class SubImage : public Image
         SubImage *getSubImage(const int x, const int y, const int width,
                               const int height);
 
-        /**
-         * Sets the alpha value of this image.
-         */
-        virtual void setAlpha(float alpha);
-
     private:
         Image *mParent;
 };
@@ -46,10 +46,10 @@ AnimationParticle::~AnimationParticle()
     mImage = NULL;
 }
 
-bool AnimationParticle::update()
+bool AnimationParticle::update(Random &random)
 {
     mAnimation->update(10); // particle engine is updated every 10ms
     mImage = mAnimation->getCurrentImage();
 
-    return Particle::update();
+    return Particle::update(random);
 }
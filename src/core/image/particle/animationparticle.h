@@ -40,7 +40,7 @@ class AnimationParticle : public ImageParticle
 
         ~AnimationParticle();
 
-        virtual bool update();
+        virtual bool update(Random &random);
 
     private:
         SimpleAnimation *mAnimation; /**< Used animation for this particle */
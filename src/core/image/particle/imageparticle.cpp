@@ -21,6 +21,7 @@
  */
 
 #include "imageparticle.h"
+#include "particleupdater.h"
 
 #include "../image.h"
 
@@ -30,12 +31,12 @@ ImageParticle::ImageParticle(Map *map, Image *image):
     Particle(map),
     mImage(image)
 {
-    if (mImage) mImage->incRef();
+    if (mImage) ParticleUpdater::incRef(mImage);
 }
 
 ImageParticle::~ImageParticle()
 {
-    if (mImage) mImage->decRef();
+    if (mImage) ParticleUpdater::decRef(mImage);
 }
 
 void ImageParticle::draw(Graphics *graphics, const int offsetX, const int offsetY) const
@@ -57,3 +58,16 @@ void ImageParticle::draw(Graphics *graphics, const int offsetX, const int offset
     mImage->setAlpha(getCurrentAlpha());
     graphics->drawImage(mImage, screenX, screenY);
 }
+
+bool ImageParticle::isInArea(const int left, const int top, const int right,
+                             const int bottom) const
+{
+    if (!isAlive() || !mImage)
+        return false;
+
+    const int x = (int) mPos.x - mImage->getWidth() / 2;
+    const int y = (int) mPos.y - (int) mPos.z - mImage->getHeight() / 2;
+
+    return x + mImage->getWidth() >= left && x <= right &&
+           y + mImage->getHeight() >= top && y <= bottom;
+}
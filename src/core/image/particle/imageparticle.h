@@ -53,6 +53,12 @@ class ImageParticle : public Particle
         virtual void draw(Graphics *graphics, const int offsetX,
                           const int offsetY) const;
 
+        /**
+         * Checks whether the image overlaps the given area.
+         */
+        virtual bool isInArea(const int left, const int top, const int right,
+                              const int bottom) const;
+
     protected:
         Image *mImage;   /**< The image used for this particle. */
 };
@@ -25,11 +25,11 @@
 
 #include <guichan/color.hpp>
 
-#include "animationparticle.h"
-#include "imageparticle.h"
 #include "particle.h"
+#include "particleeffect.h"
 #include "particleemitter.h"
-#include "rotationalparticle.h"
+#include "particlepool.h"
+#include "particleupdater.h"
 #include "textparticle.h"
 
 #include "../../configuration.h"
@@ -55,6 +55,7 @@ int Particle::fastPhysics = 0;
 int Particle::emitterSkip = 1;
 const float Particle::PARTICLE_SKY = 800.0f;
 bool Particle::enabled = true;
+Random Particle::mainRandom;
 
 Particle::Particle(Map *map):
     mAlpha(1.0f),
@@ -65,6 +66,8 @@ Particle::Particle(Map *map):
     mAlive(ALIVE),
     mAutoDelete(true),
     mMap(map),
+    mPool(NULL),
+    mUpdater(NULL),
     mDeathEffectConditions(0x00),
     mGravity(0.0f),
     mRandomness(0),
@@ -75,22 +78,23 @@ Particle::Particle(Map *map):
     mInvDieDistance(-1.0f),
     mMomentum(1.0f)
 {
-    Particle::particleCount++;
+    ParticleUpdater::countParticles(1);
 
     if (mMap)
-        setSpriteIterator(mMap->addSprite(this));
+        setSpriteIterator(ParticleUpdater::addSprite(mMap, this));
 }
 
 Particle::~Particle()
 {
     // Remove from map sprite list
     if (mMap)
-        mMap->removeSprite(mSpriteIterator);
+        ParticleUpdater::removeSprite(mMap, mSpriteIterator);
 
     // Delete child emitters and child particles
     clear();
+    destroy(mUpdater);
     // Update particle count
-    Particle::particleCount--;
+    ParticleUpdater::countParticles(-1);
 }
 
 void Particle::setupEngine()
@@ -99,11 +103,32 @@ void Particle::setupEngine()
     Particle::fastPhysics = config.getValue("particleFastPhysics", 0);
     Particle::emitterSkip = config.getValue("particleEmitterSkip", 1) + 1;
     Particle::enabled = config.getValue("particleeffects", true);
+
+    const int threads = config.getValue("particleThreads", 1);
+
+    if (threads > 1 && !mUpdater)
+        mUpdater = new ParticleUpdater(threads);
+
     disableAutoDelete();
     logger->log("Particle engine set up");
 }
 
-bool Particle::update()
+float Particle::getInvDistance(const Vector &dist)
+{
+    switch (Particle::fastPhysics)
+    {
+        case 1:
+            return fastInvSqrt(dist.x * dist.x + dist.y * dist.y +
+                               dist.z * dist.z);
+        case 2:
+            return 2.0f / fabs(dist.x) + fabs(dist.y) + fabs(dist.z);
+        default:
+            return 1.0f / sqrt(dist.x * dist.x + dist.y * dist.y +
+                               dist.z * dist.z);
+    }
+}
+
+bool Particle::update(Random &random)
 {
     if (!mMap)
         return false;
@@ -123,23 +148,7 @@ bool Particle::update()
         {
             Vector dist = mPos - mTarget->getPosition();
             dist.x *= SIN45;
-            float invHypotenuse;
-
-            switch (Particle::fastPhysics)
-            {
-                case 1:
-                    invHypotenuse = fastInvSqrt(dist.x * dist.x + dist.y * 
-                                                dist.y + dist.z * dist.z);
-                    break;
-                case 2:
-                    invHypotenuse = 2.0f / fabs(dist.x) + fabs(dist.y) +
-                                    fabs(dist.z);
-                    break;
-                default:
-                    invHypotenuse = 1.0f / sqrt(dist.x * dist.x + dist.y *
-                                    dist.y + dist.z * dist.z);
-                    break;
-            }
+            const float invHypotenuse = getInvDistance(dist);
 
             if (invHypotenuse)
             {
@@ -153,12 +162,12 @@ bool Particle::update()
 
         if (mRandomness > 0)
         {
-            mVelocity.x += (rand() % mRandomness - rand() % mRandomness) /
-                           1000.0f;
-            mVelocity.y += (rand() % mRandomness - rand() % mRandomness) /
-                           1000.0f;
-            mVelocity.z += (rand() % mRandomness - rand() % mRandomness) /
-                           1000.0f;
+            mVelocity.x += (random.next(mRandomness) -
+                            random.next(mRandomness)) / 1000.0f;
+            mVelocity.y += (random.next(mRandomness) -
+                            random.next(mRandomness)) / 1000.0f;
+            mVelocity.z += (random.next(mRandomness) -
+                            random.next(mRandomness)) / 1000.0f;
         }
 
         mVelocity.z -= mGravity;
@@ -193,18 +202,19 @@ bool Particle::update()
         }
 
         // Update child emitters
-        if ((mLifetimePast - 1) % Particle::emitterSkip == 0)
+        if ((mLifetimePast - 1) % Particle::emitterSkip == 0 &&
+            !mChildEmitters.empty())
         {
+            if (!mPool)
+                mPool = new ParticlePool(mMap, this);
+
             for (EmitterIterator e = mChildEmitters.begin();
                  e != mChildEmitters.end(); e++)
             {
-                Particles newParticles = (*e)->createParticles(mLifetimePast);
-                for (ParticleIterator p = newParticles.begin();
-                     p != newParticles.end(); p++)
-                {
-                    (*p)->moveBy(mPos);
-                    mChildParticles.push_back (*p);
-                }
+                Particles newParticles = (*e)->createParticles(mLifetimePast,
+                                                               mPos, *mPool,
+                                                               random);
+                mChildParticles.splice(mChildParticles.end(), newParticles);
             }
         }
     }
@@ -213,37 +223,47 @@ bool Particle::update()
     if (mAlive != ALIVE && mAlive != DEAD_LONG_AGO)
     {
         if ((mAlive & mDeathEffectConditions) > 0x00 && !mDeathEffect.empty())
-        {
-            Particle* deathEffect = particleEngine->addEffect(mDeathEffect, 0, 0);
-            deathEffect->moveBy(mPos);
-        }
+            ParticleUpdater::addDeathEffect(mDeathEffect, mPos);
             mAlive = DEAD_LONG_AGO;
     }
 
     Vector change = mPos - oldPos;
 
     // Update child particles
-
-    for (ParticleIterator p = mChildParticles.begin();
-         p != mChildParticles.end();)
+    if (mUpdater)
+        mUpdater->update(mChildParticles, change);
+    else
     {
-        //move particle with its parent if desired
-        if ((*p)->doesFollow())
-            (*p)->moveBy(change);
-
-        //update particle
-        if ((*p)->update())
-        {
-            p++;
-        }
-        else
+        for (ParticleIterator p = mChildParticles.begin();
+             p != mChildParticles.end();)
         {
-            delete (*p);
-            p = mChildParticles.erase(p);
+            //move particle with its parent if desired
+            if ((*p)->doesFollow())
+                (*p)->moveBy(change);
+
+            //update particle
+            if ((*p)->update(random))
+            {
+                p++;
+            }
+            else
+            {
+                delete (*p);
+                p = mChildParticles.erase(p);
+            }
         }
     }
 
-    return (mAlive == ALIVE || !mChildParticles.empty() || !mAutoDelete);
+    if (mPool)
+        mPool->update(change, random);
+
+    return (!isExtinct() || !mAutoDelete);
+}
+
+bool Particle::isExtinct() const
+{
+    return !isAlive() && mChildParticles.empty() &&
+           (!mPool || mPool->size() == 0);
 }
 
 void Particle::moveBy(const Vector &change)
@@ -255,6 +275,9 @@ void Particle::moveBy(const Vector &change)
         if ((*p)->doesFollow())
             (*p)->moveBy(change);
     }
+
+    if (mPool)
+        mPool->moveBy(change);
 }
 
 void Particle::moveTo(const float x, const float y)
@@ -281,94 +304,27 @@ Particle* Particle::addEffect(const std::string &particleEffectFile,
                               const int pixelX, const int pixelY,
                               const int rotation)
 {
-    Particle *newParticle = NULL;
-
-    const XML::Document doc(particleEffectFile);
-    const xmlNodePtr rootNode = doc.rootNode();
-
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "effect"))
-    {
-        logger->log("Error loading particle: %s", particleEffectFile.c_str());
-        return NULL;
-    }
-
     ResourceManager *resman = ResourceManager::getInstance();
+    ParticleEffect *effect = resman->getParticleEffect(particleEffectFile,
+                                                       mMap);
 
-    // Parse particles
-    for_each_xml_child_node(effectChildNode, rootNode)
-    {
-        // We're only interested in particles
-        if (!xmlStrEqual(effectChildNode->name, BAD_CAST "particle"))
-            continue;
-
-        // Determine the exact particle type
-        xmlNodePtr node;
-
-        // Animation
-        if ((node = XML::findFirstChildByName(effectChildNode, "animation")))
-            newParticle = new AnimationParticle(mMap, node);
+    if (!effect)
+        return NULL;
 
-        // Rotational
-        else if ((node = XML::findFirstChildByName(effectChildNode, "rotation")))
-            newParticle = new RotationalParticle(mMap, node);
+    const Vector position(mPos.x + (float) pixelX, mPos.y + (float) pixelY,
+                          mPos.z);
+    const std::list<Particle*> newParticles =
+        effect->createParticles(mMap, position, rotation);
 
-        // Image
-        else if ((node = XML::findFirstChildByName(effectChildNode, "image")))
-        {
-            Image *img= resman->getImage((const char*)
-                    node->xmlChildrenNode->content);
+    effect->decRef();
 
-            newParticle = new ImageParticle(mMap, img);
-        }
-        // Other
-        else
-            newParticle = new Particle(mMap);
-
-        // Read and set the basic properties of the particle
-        float offsetX = XML::getFloatProperty(effectChildNode, "position-x", 0);
-        float offsetY = XML::getFloatProperty(effectChildNode, "position-y", 0);
-        float offsetZ = XML::getFloatProperty(effectChildNode, "position-z", 0);
-        Vector position (mPos.x + (float) pixelX + offsetX,
-                         mPos.y + (float) pixelY + offsetY, mPos.z + offsetZ);
-        newParticle->moveTo(position);
-
-        int lifetime = XML::getProperty(effectChildNode, "lifetime", -1);
-        newParticle->setLifetime(lifetime);
-
-        // Look for additional emitters for this particle
-        for_each_xml_child_node(emitterNode, effectChildNode)
-        {
-            if (xmlStrEqual(emitterNode->name, BAD_CAST "emitter"))
-            {
-                ParticleEmitter *newEmitter;
-                newEmitter = new ParticleEmitter(emitterNode, newParticle, mMap,
-                                                 rotation);
-                newParticle->addEmitter(newEmitter);
-            }
-            else if (xmlStrEqual(emitterNode->name, BAD_CAST "deatheffect"))
-            {
-                std::string deathEffect = (const char*)emitterNode->xmlChildrenNode->content;
-                char deathEffectConditions = 0x00;
-
-                if (XML::getBoolProperty(emitterNode, "on-floor", true))
-                    deathEffectConditions += Particle::DEAD_FLOOR;
-                if (XML::getBoolProperty(emitterNode, "on-sky", true))
-                    deathEffectConditions += Particle::DEAD_SKY;
-                if (XML::getBoolProperty(emitterNode, "on-other", false))
-                    deathEffectConditions += Particle::DEAD_OTHER;
-                if (XML::getBoolProperty(emitterNode, "on-impact", true))
-                    deathEffectConditions += Particle::DEAD_IMPACT;
-                if (XML::getBoolProperty(emitterNode, "on-timeout", true))
-                    deathEffectConditions += Particle::DEAD_TIMEOUT;
-
-                newParticle->setDeathEffect(deathEffect, deathEffectConditions);
-            }
-        }
+    if (newParticles.empty())
+        return NULL;
 
-        mChildParticles.push_back(newParticle);
-    }
+    mChildParticles.insert(mChildParticles.end(), newParticles.begin(),
+                           newParticles.end());
 
-    return newParticle;
+    return newParticles.back();
 }
 
 Particle *Particle::addTextSplashEffect(const std::string &text, const int x,
@@ -377,9 +333,9 @@ Particle *Particle::addTextSplashEffect(const std::string &text, const int x,
 {
     Particle *newParticle = new TextParticle(mMap, text, color, font, outline);
     newParticle->moveTo(x, y);
-    newParticle->setVelocity(((rand() % 100) - 50) / 200.0f,    // X
-                             ((rand() % 100) - 50) / 200.0f,    // Y
-                             ((rand() % 100) / 200.0f) + 4.0f); // Z
+    newParticle->setVelocity((mainRandom.next(100) - 50) / 200.0f,    // X
+                             (mainRandom.next(100) - 50) / 200.0f,    // Y
+                             (mainRandom.next(100) / 200.0f) + 4.0f); // Z
     newParticle->setGravity(0.1f);
     newParticle->setBounce(0.5f);
     newParticle->setLifetime(200);
@@ -432,6 +388,9 @@ void Particle::setMap(Map *map)
 
 void Particle::clear()
 {
+    // The pool relies on the emitters to keep its images loaded
+    destroy(mPool);
+
     delete_all(mChildEmitters);
     mChildEmitters.clear();
 
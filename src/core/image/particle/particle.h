@@ -28,6 +28,7 @@
 
 #include "../../map/sprite/sprite.h"
 
+#include "../../utils/random.h"
 #include "../../utils/vector.h"
 
 #include "../../../bindings/guichan/guichanfwd.h"
@@ -35,6 +36,8 @@
 class Map;
 class Particle;
 class ParticleEmitter;
+class ParticlePool;
+class ParticleUpdater;
 
 typedef std::list<Particle *> Particles;
 typedef Particles::iterator ParticleIterator;
@@ -66,6 +69,9 @@ class Particle : public Sprite
                                               emitter updates in ticks */
         static bool enabled;             /**< Whether unnecessary particle
                                               effects are enabled or not */
+        static Random mainRandom;        /**< Random numbers for particles
+                                              created or updated on the main
+                                              thread */
 
         /**
          * Constructor.
@@ -90,11 +96,19 @@ class Particle : public Sprite
          */
         void setupEngine();
 
+        /**
+         * Returns the inverse of the length of the given distance, computed
+         * in the way set by fastPhysics.
+         */
+        static float getInvDistance(const Vector &dist);
+
         /**
          * Updates particle position, returns false when the particle should
          * be deleted.
+         *
+         * @param random the random numbers of the calling thread
          */
-        virtual bool update();
+        virtual bool update(Random &random);
 
         /**
          * Draws the particle image.
@@ -107,6 +121,12 @@ class Particle : public Sprite
          */
         virtual const int getPixelY() const { return (int) (mPos.y + mPos.z) - 64; }
 
+        /**
+         * Plain particles draw nothing, so they are never on screen.
+         */
+        virtual bool isInArea(const int left, const int top, const int right,
+                              const int bottom) const { return false; }
+
         /**
          * Sets the map the particle is on.
          */
@@ -260,7 +280,7 @@ class Particle : public Sprite
         /**
          * Determines whether the particle and its children are all dead
          */
-        bool isExtinct() const { return !isAlive() && mChildParticles.empty(); }
+        bool isExtinct() const;
 
         /**
          * Manually marks the particle for deletion.
@@ -303,6 +323,10 @@ class Particle : public Sprite
         Emitters mChildEmitters;    /**< List of child emitters. */
         Particles mChildParticles;  /**< List of particles controlled by this
                                          particle */
+        ParticlePool *mPool;        /**< Simple particles spawned by the child
+                                         emitters */
+        ParticleUpdater *mUpdater;  /**< Updates the child particles on several
+                                         threads, only used by the engine */
         std::string mDeathEffect;   /**< Particle effect file to be spawned when
                                          the particle dies */
         char mDeathEffectConditions;/**< Bitfield of death conditions which
@@ -0,0 +1,189 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "animationparticle.h"
+#include "imageparticle.h"
+#include "particle.h"
+#include "particleeffect.h"
+#include "rotationalparticle.h"
+
+#include "../image.h"
+#include "../simpleanimation.h"
+
+#include "../../log.h"
+#include "../../resourcemanager.h"
+
+#include "../../utils/dtor.h"
+#include "../../utils/xml.h"
+
+ParticleEffect *ParticleEffect::load(const std::string &fileName, Map *map)
+{
+    const XML::Document doc(fileName);
+    const xmlNodePtr rootNode = doc.rootNode();
+
+    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "effect"))
+    {
+        logger->log("Error loading particle: %s", fileName.c_str());
+        return NULL;
+    }
+
+    ResourceManager *resman = ResourceManager::getInstance();
+    ParticleEffect *effect = new ParticleEffect;
+
+    // Parse particles
+    for_each_xml_child_node(effectChildNode, rootNode)
+    {
+        // We're only interested in particles
+        if (!xmlStrEqual(effectChildNode->name, BAD_CAST "particle"))
+            continue;
+
+        effect->mParticles.push_back(ParticleTemplate());
+        ParticleTemplate &particle = effect->mParticles.back();
+        particle.image = NULL;
+
+        // Determine the exact particle type
+        xmlNodePtr node;
+
+        // Animation
+        if ((node = XML::findFirstChildByName(effectChildNode, "animation")))
+        {
+            particle.type = ParticleTemplate::ANIMATION;
+            SimpleAnimation::loadAnimation(node, particle.animation);
+        }
+        // Rotational
+        else if ((node = XML::findFirstChildByName(effectChildNode, "rotation")))
+        {
+            particle.type = ParticleTemplate::ROTATION;
+            SimpleAnimation::loadAnimation(node, particle.animation);
+        }
+        // Image
+        else if ((node = XML::findFirstChildByName(effectChildNode, "image")))
+        {
+            particle.type = ParticleTemplate::IMAGE;
+            particle.image = resman->getImage((const char*)
+                    node->xmlChildrenNode->content);
+        }
+        // Other
+        else
+            particle.type = ParticleTemplate::PLAIN;
+
+        // Read the basic properties of the particle
+        particle.offset.x = XML::getFloatProperty(effectChildNode,
+                                                  "position-x", 0);
+        particle.offset.y = XML::getFloatProperty(effectChildNode,
+                                                  "position-y", 0);
+        particle.offset.z = XML::getFloatProperty(effectChildNode,
+                                                  "position-z", 0);
+        particle.lifetime = XML::getProperty(effectChildNode, "lifetime", -1);
+        particle.deathEffectConditions = 0x00;
+
+        // Look for additional emitters for this particle
+        for_each_xml_child_node(emitterNode, effectChildNode)
+        {
+            if (xmlStrEqual(emitterNode->name, BAD_CAST "emitter"))
+            {
+                particle.emitters.push_back(ParticleEmitter(emitterNode, NULL,
+                                                            map));
+            }
+            else if (xmlStrEqual(emitterNode->name, BAD_CAST "deatheffect"))
+            {
+                particle.deathEffect = (const char*)emitterNode->xmlChildrenNode->content;
+                char &deathEffectConditions = particle.deathEffectConditions;
+
+                if (XML::getBoolProperty(emitterNode, "on-floor", true))
+                    deathEffectConditions += Particle::DEAD_FLOOR;
+                if (XML::getBoolProperty(emitterNode, "on-sky", true))
+                    deathEffectConditions += Particle::DEAD_SKY;
+                if (XML::getBoolProperty(emitterNode, "on-other", false))
+                    deathEffectConditions += Particle::DEAD_OTHER;
+                if (XML::getBoolProperty(emitterNode, "on-impact", true))
+                    deathEffectConditions += Particle::DEAD_IMPACT;
+                if (XML::getBoolProperty(emitterNode, "on-timeout", true))
+                    deathEffectConditions += Particle::DEAD_TIMEOUT;
+            }
+        }
+    }
+
+    return effect;
+}
+
+ParticleEffect::~ParticleEffect()
+{
+    for (std::list<ParticleTemplate>::iterator i = mParticles.begin();
+         i != mParticles.end(); ++i)
+    {
+        if (i->image)
+            i->image->decRef();
+    }
+}
+
+std::list<Particle*> ParticleEffect::createParticles(Map *map,
+                                                     const Vector &position,
+                                                     const int rotation) const
+{
+    std::list<Particle*> particles;
+
+    for (std::list<ParticleTemplate>::const_iterator i = mParticles.begin();
+         i != mParticles.end(); ++i)
+    {
+        Particle *newParticle;
+
+        switch (i->type)
+        {
+            case ParticleTemplate::ANIMATION:
+                newParticle = new AnimationParticle(map,
+                                                    new Animation(i->animation));
+                break;
+            case ParticleTemplate::ROTATION:
+                newParticle = new RotationalParticle(map,
+                                                     new Animation(i->animation));
+                break;
+            case ParticleTemplate::IMAGE:
+                newParticle = new ImageParticle(map, i->image);
+                break;
+            default:
+                newParticle = new Particle(map);
+                break;
+        }
+
+        newParticle->moveTo(position + i->offset);
+        newParticle->setLifetime(i->lifetime);
+
+        for (std::list<ParticleEmitter>::const_iterator e = i->emitters.begin();
+             e != i->emitters.end(); ++e)
+        {
+            ParticleEmitter *newEmitter = new ParticleEmitter(*e);
+            newEmitter->instantiate(newParticle, map, rotation);
+            newParticle->addEmitter(newEmitter);
+        }
+
+        if (!i->deathEffect.empty())
+        {
+            newParticle->setDeathEffect(i->deathEffect,
+                                        i->deathEffectConditions);
+        }
+
+        particles.push_back(newParticle);
+    }
+
+    return particles;
+}
@@ -0,0 +1,102 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PARTICLEEFFECT_H
+#define PARTICLEEFFECT_H
+
+#include <list>
+#include <string>
+
+#include "particleemitter.h"
+
+#include "../animation.h"
+
+#include "../../resource.h"
+
+#include "../../utils/vector.h"
+
+class Image;
+class Map;
+class Particle;
+
+/**
+ * A particle effect file, parsed once and kept by the ResourceManager. New
+ * particles are created from it without reading the file again.
+ */
+class ParticleEffect : public Resource
+{
+    public:
+        /**
+         * Parses a particle effect file. The map is needed because the
+         * offsets of animated particles depend on its tile size.
+         *
+         * @return <code>NULL</code> if an error occurred, a valid pointer
+         *         otherwise.
+         */
+        static ParticleEffect *load(const std::string &fileName, Map *map);
+
+        /**
+         * Creates the particles of the effect.
+         *
+         * @param map      The map the particles are put on.
+         * @param position The position the particles are placed relative to.
+         * @param rotation The rotation applied to the emitters, in degrees.
+         *
+         * @return The created particles.
+         */
+        std::list<Particle*> createParticles(Map *map, const Vector &position,
+                                             const int rotation) const;
+
+    protected:
+        /**
+         * Destructor.
+         */
+        ~ParticleEffect();
+
+    private:
+        /**
+         * A particle of the effect, described by its element in the file.
+         */
+        struct ParticleTemplate
+        {
+            enum Type
+            {
+                PLAIN,
+                IMAGE,
+                ANIMATION,
+                ROTATION
+            };
+
+            Type type;
+            Image *image;
+            Animation animation;
+            Vector offset;
+            int lifetime;
+            std::list<ParticleEmitter> emitters;
+            std::string deathEffect;
+            char deathEffectConditions;
+        };
+
+        std::list<ParticleTemplate> mParticles;
+};
+
+#endif
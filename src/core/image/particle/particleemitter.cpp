@@ -20,12 +20,16 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
 
 #include "animationparticle.h"
 #include "imageparticle.h"
 #include "particle.h"
 #include "particleemitter.h"
+#include "particlepool.h"
+#include "particleupdater.h"
 #include "rotationalparticle.h"
 
 #include "../image.h"
@@ -40,9 +44,10 @@
 #define DEG_RAD_FACTOR 0.017453293f
 
 ParticleEmitter::ParticleEmitter(const xmlNodePtr &emitterNode, Particle *target,
-                                 Map *map, const int rotation):
+                                 Map *map):
     mOutputPauseLeft(0),
-    mParticleImage(0)
+    mParticleImage(0),
+    mDeathEffectConditions(0x00)
 {
     mMap = map;
     mParticleTarget = target;
@@ -53,6 +58,7 @@ ParticleEmitter::ParticleEmitter(const xmlNodePtr &emitterNode, Particle *target
     mParticlePosZ.set(0.0f);
     mParticleAngleHorizontal.set(0.0f);
     mParticleAngleVertical.set(0.0f);
+    mHasAngleHorizontal = false;
     mParticlePower.set(0.0f);
     mParticleGravity.set(0.0f);
     mParticleRandomness.set(0);
@@ -104,9 +110,8 @@ ParticleEmitter::ParticleEmitter(const xmlNodePtr &emitterNode, Particle *target
             else if (name == "horizontal-angle")
             {
                 mParticleAngleHorizontal = readParticleEmitterProp(propertyNode, 0.0f);
-                mParticleAngleHorizontal.minVal += rotation;
+                mHasAngleHorizontal = true;
                 mParticleAngleHorizontal.minVal *= DEG_RAD_FACTOR;
-                mParticleAngleHorizontal.maxVal += rotation;
                 mParticleAngleHorizontal.maxVal *= DEG_RAD_FACTOR;
                 mParticleAngleHorizontal.changeAmplitude *= DEG_RAD_FACTOR;
             }
@@ -138,7 +143,8 @@ ParticleEmitter::ParticleEmitter(const xmlNodePtr &emitterNode, Particle *target
             else if (name == "output-pause")
             {
                 mOutputPause = readParticleEmitterProp(propertyNode, 0);
-                mOutputPauseLeft = mOutputPause.value(0);
+                mOutputPauseLeft =
+                    mOutputPause.value(0, Particle::mainRandom);
             }
             else if (name == "acceleration")
                 mParticleAcceleration = readParticleEmitterProp(propertyNode, 0.0f);
@@ -328,6 +334,7 @@ ParticleEmitter & ParticleEmitter::operator=(const ParticleEmitter &o)
     mParticlePosZ = o.mParticlePosZ;
     mParticleAngleHorizontal = o.mParticleAngleHorizontal;
     mParticleAngleVertical = o.mParticleAngleVertical;
+    mHasAngleHorizontal = o.mHasAngleHorizontal;
     mParticlePower = o.mParticlePower;
     mParticleGravity = o.mParticleGravity;
     mParticleRandomness = o.mParticleRandomness;
@@ -348,17 +355,43 @@ ParticleEmitter & ParticleEmitter::operator=(const ParticleEmitter &o)
     mParticleAnimation = o.mParticleAnimation;
     mParticleRotation = o.mParticleRotation;
     mParticleChildEmitters = o.mParticleChildEmitters;
+    mDeathEffect = o.mDeathEffect;
+    mDeathEffectConditions = o.mDeathEffectConditions;
 
     mOutputPauseLeft = 0;
 
-    if (mParticleImage) mParticleImage->incRef();
+    if (mParticleImage) ParticleUpdater::incRef(mParticleImage);
 
     return *this;
 }
 
 ParticleEmitter::~ParticleEmitter()
 {
-    if (mParticleImage) mParticleImage->decRef();
+    if (mParticleImage) ParticleUpdater::decRef(mParticleImage);
+}
+
+void ParticleEmitter::instantiate(Particle *target, Map *map,
+                                  const int rotation)
+{
+    mParticleTarget = target;
+    mMap = map;
+
+    // Like before effects were reused, only emitters that declare a
+    // direction are turned
+    if (mHasAngleHorizontal)
+    {
+        mParticleAngleHorizontal.minVal += rotation * DEG_RAD_FACTOR;
+        mParticleAngleHorizontal.maxVal += rotation * DEG_RAD_FACTOR;
+    }
+
+    mOutputPauseLeft = mOutputPause.value(0, Particle::mainRandom);
+
+    for (std::list<ParticleEmitter>::iterator i =
+         mParticleChildEmitters.begin(); i != mParticleChildEmitters.end();
+         ++i)
+    {
+        i->instantiate(target, map, 0);
+    }
 }
 
 template <typename T> ParticleEmitterProp<T>
@@ -387,7 +420,39 @@ ParticleEmitter::readParticleEmitterProp(xmlNodePtr propertyNode, T def)
     return retval;
 }
 
-std::list<Particle *> ParticleEmitter::createParticles(const int tick)
+bool ParticleEmitter::spreadsBeyondTile() const
+{
+    const float tileHeight = mMap ? (float) mMap->getTileHeight() : 32.0f;
+
+    float spread = mParticlePosY.maxVal - mParticlePosY.minVal;
+    if (mParticlePosY.changeFunc != FUNC_NONE)
+        spread += 2.0f * std::fabs(mParticlePosY.changeAmplitude);
+
+    // Particles attracted by a target move towards it, so only their own
+    // speed and the random changes to it are taken into account
+    float speed = std::max(std::fabs(mParticlePower.minVal),
+                           std::fabs(mParticlePower.maxVal));
+    if (mParticlePower.changeFunc != FUNC_NONE)
+        speed += std::fabs(mParticlePower.changeAmplitude);
+
+    const int randomness = mParticleRandomness.maxVal;
+    int lifetime = mParticleLifetime.maxVal;
+    if (mParticleLifetime.changeFunc != FUNC_NONE)
+        lifetime += std::abs(mParticleLifetime.changeAmplitude);
+
+    if (lifetime < 0)
+        return spread > tileHeight || speed > 0.0f || randomness > 0;
+
+    // The randomness changes the speed by up to randomness / 1000 per tick
+    const float drift = randomness * lifetime / 1000.0f;
+
+    return spread + (speed + drift) * lifetime * SIN45 > tileHeight;
+}
+
+std::list<Particle *> ParticleEmitter::createParticles(const int tick,
+                                                       const Vector &origin,
+                                                       ParticlePool &pool,
+                                                       Random &random)
 {
     std::list<Particle *> newParticles;
 
@@ -396,13 +461,51 @@ std::list<Particle *> ParticleEmitter::createParticles(const int tick)
         mOutputPauseLeft--;
         return newParticles;
     }
-    mOutputPauseLeft = mOutputPause.value(tick);
+    mOutputPauseLeft = mOutputPause.value(tick, random);
 
-    for (int i = mOutput.value(tick); i > 0; i--)
+    // Image particles which spawn nothing themselves are kept in the pool
+    const bool pooled = mParticleImage && mParticleChildEmitters.empty() &&
+                        mDeathEffect.empty() && !spreadsBeyondTile();
+
+    for (int i = mOutput.value(tick, random); i > 0; i--)
     {
         // Limit maximum particles
         if (Particle::particleCount > Particle::maxCount) break;
 
+        const Vector position = origin + Vector(mParticlePosX.value(tick, random),
+                                                mParticlePosY.value(tick, random),
+                                                mParticlePosZ.value(tick, random));
+
+        const float angleH = mParticleAngleHorizontal.value(tick, random);
+        const float angleV = mParticleAngleVertical.value(tick, random);
+        const float power = mParticlePower.value(tick, random);
+        const Vector velocity(cos(angleH) * cos(angleV) * power,
+                              sin(angleH) * cos(angleV) * power,
+                              sin(angleV) * power);
+
+        if (pooled)
+        {
+            PooledParticle particle;
+            particle.image = mParticleImage;
+            particle.position = position;
+            particle.velocity = velocity;
+            particle.randomness = mParticleRandomness.value(tick, random);
+            particle.gravity = mParticleGravity.value(tick, random);
+            particle.bounce = mParticleBounce.value(tick, random);
+            particle.follow = mParticleFollow;
+            particle.target = mParticleTarget;
+            particle.acceleration = mParticleAcceleration.value(tick, random);
+            particle.momentum = mParticleMomentum.value(tick, random);
+            particle.invDieDistance = 1.0f / mParticleDieDistance.value(tick, random);
+            particle.lifetime = mParticleLifetime.value(tick, random);
+            particle.fadeOut = mParticleFadeOut.value(tick, random);
+            particle.fadeIn = mParticleFadeIn.value(tick, random);
+            particle.alpha = mParticleAlpha.value(tick, random);
+
+            pool.add(particle);
+            continue;
+        }
+
         Particle *newParticle;
         if (mParticleImage)
             newParticle = new ImageParticle(mMap, mParticleImage);
@@ -419,32 +522,23 @@ std::list<Particle *> ParticleEmitter::createParticles(const int tick)
         else
             newParticle = new Particle(mMap);
 
-        Vector position(mParticlePosX.value(tick),
-                        mParticlePosY.value(tick),
-                        mParticlePosZ.value(tick));
         newParticle->moveTo(position);
+        newParticle->setVelocity(velocity.x, velocity.y, velocity.z);
 
-        float angleH = mParticleAngleHorizontal.value(tick);
-        float angleV = mParticleAngleVertical.value(tick);
-        float power = mParticlePower.value(tick);
-        newParticle->setVelocity(cos(angleH) * cos(angleV) * power,
-                                 sin(angleH) * cos(angleV) * power,
-                                 sin(angleV) * power);
-
-        newParticle->setRandomness(mParticleRandomness.value(tick));
-        newParticle->setGravity(mParticleGravity.value(tick));
-        newParticle->setBounce(mParticleBounce.value(tick));
+        newParticle->setRandomness(mParticleRandomness.value(tick, random));
+        newParticle->setGravity(mParticleGravity.value(tick, random));
+        newParticle->setBounce(mParticleBounce.value(tick, random));
         newParticle->setFollow(mParticleFollow);
 
         newParticle->setDestination(mParticleTarget,
-                                    mParticleAcceleration.value(tick),
-                                    mParticleMomentum.value(tick));
-        newParticle->setDieDistance(mParticleDieDistance.value(tick));
-
-        newParticle->setLifetime(mParticleLifetime.value(tick));
-        newParticle->setFadeOut(mParticleFadeOut.value(tick));
-        newParticle->setFadeIn(mParticleFadeIn.value(tick));
-        newParticle->setAlpha(mParticleAlpha.value(tick));
+                                    mParticleAcceleration.value(tick, random),
+                                    mParticleMomentum.value(tick, random));
+        newParticle->setDieDistance(mParticleDieDistance.value(tick, random));
+
+        newParticle->setLifetime(mParticleLifetime.value(tick, random));
+        newParticle->setFadeOut(mParticleFadeOut.value(tick, random));
+        newParticle->setFadeIn(mParticleFadeIn.value(tick, random));
+        newParticle->setAlpha(mParticleAlpha.value(tick, random));
 
         for (std::list<ParticleEmitter>::iterator i = mParticleChildEmitters.begin();
              i != mParticleChildEmitters.end(); i++)
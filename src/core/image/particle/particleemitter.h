@@ -34,6 +34,8 @@
 class Image;
 class Map;
 class Particle;
+class ParticlePool;
+class Vector;
 
 /**
  * Every Particle can have one or more particle emitters that create new
@@ -46,7 +48,7 @@ class ParticleEmitter
          * Constructor.
          */
         ParticleEmitter(const xmlNodePtr &emitterNode,  Particle *target,
-                        Map *map, const int rotation = 0);
+                        Map *map);
 
         /**
          * Copy Constructor (necessary for reference counting of particle images)
@@ -64,20 +66,44 @@ class ParticleEmitter
         ~ParticleEmitter();
 
         /**
-         * Spawns new particles
-         * @return: a list of created particles
+         * Spawns new particles around the given origin. Image particles
+         * without emitters or death effects of their own are put into the
+         * pool, unless they spread further than a tile. The others are
+         * created as separate objects.
+         *
+         * @param random the random numbers of the calling thread
+         * @return: a list of created particle objects
          */
-        std::list<Particle *> createParticles(const int tick);
+        std::list<Particle *> createParticles(const int tick,
+                                              const Vector &origin,
+                                              ParticlePool &pool,
+                                              Random &random);
 
         /**
          * Sets the target of the particles that are created
          */
         void setTarget(Particle *target) { mParticleTarget = target; };
 
+        /**
+         * Prepares a copy of a parsed emitter for use: sets the target and
+         * map of the particles it creates, turns it by the given rotation in
+         * degrees if it has a horizontal angle, and restarts its output
+         * pause.
+         */
+        void instantiate(Particle *target, Map *map, const int rotation);
+
     private:
         template <typename T>
         ParticleEmitterProp<T> readParticleEmitterProp(xmlNodePtr propertyNode, T def);
 
+        /**
+         * Returns whether the particles may end up further apart from north
+         * to south than the height of a tile. Such particles are sorted
+         * with the other sprites one by one, rather than all at the
+         * position of the pool.
+         */
+        bool spreadsBeyondTile() const;
+
         /**
          * initial position of particles:
          */
@@ -87,6 +113,7 @@ class ParticleEmitter
          * initial vector of particles:
          */
         ParticleEmitterProp<float> mParticleAngleHorizontal, mParticleAngleVertical;
+        bool mHasAngleHorizontal; /**< Whether the rotation applies */
 
         /**
          * Initial velocity of particles
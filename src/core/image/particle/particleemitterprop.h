@@ -22,6 +22,8 @@
 
 #include <cmath>
 
+#include "../../utils/random.h"
+
 enum ChangeFunc
 {
     FUNC_NONE,
@@ -57,10 +59,10 @@ template <typename T> struct ParticleEmitterProp
         changePhase = phase;
     }
 
-    T value(int tick)
+    T value(int tick, Random &random)
     {
         tick += changePhase;
-        T val = (T) (minVal + (maxVal - minVal) * (rand() / ((double) RAND_MAX + 1)));
+        T val = (T) (minVal + (maxVal - minVal) * random.nextUnit());
 
         switch (changeFunc)
         {
@@ -0,0 +1,400 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "particle.h"
+#include "particlepool.h"
+#include "particleupdater.h"
+
+#include "../image.h"
+
+#include "../../map/map.h"
+
+#include "../../../bindings/guichan/graphics.h"
+
+#define SIN45 0.707106781f
+
+ParticlePool::ParticlePool(Map *map, const Particle *owner):
+    mMap(map),
+    mOwner(owner),
+    mLeft(0.0f),
+    mTop(0.0f),
+    mRight(0.0f),
+    mBottom(0.0f),
+    mImageWidth(0),
+    mImageHeight(0)
+{
+    mSpriteIterator = ParticleUpdater::addSprite(mMap, this);
+}
+
+ParticlePool::~ParticlePool()
+{
+    clear();
+    ParticleUpdater::removeSprite(mMap, mSpriteIterator);
+}
+
+void ParticlePool::add(const PooledParticle &particle)
+{
+    const float x = particle.position.x;
+    const float y = particle.position.y - particle.position.z;
+
+    if (size() == 0)
+    {
+        mLeft = mRight = x;
+        mTop = mBottom = y;
+    }
+    else
+    {
+        mLeft = std::min(mLeft, x);
+        mRight = std::max(mRight, x);
+        mTop = std::min(mTop, y);
+        mBottom = std::max(mBottom, y);
+    }
+
+    mImageWidth = std::max(mImageWidth, particle.image->getWidth());
+    mImageHeight = std::max(mImageHeight, particle.image->getHeight());
+
+    mPosX.push_back(particle.position.x);
+    mPosY.push_back(particle.position.y);
+    mPosZ.push_back(particle.position.z);
+    mVelX.push_back(particle.velocity.x);
+    mVelY.push_back(particle.velocity.y);
+    mVelZ.push_back(particle.velocity.z);
+    mFollow.push_back(particle.follow ? 1.0f : 0.0f);
+    mGravity.push_back(particle.gravity);
+    mBounce.push_back(particle.bounce);
+    mMomentum.push_back(particle.momentum);
+    mAcceleration.push_back(particle.target ? particle.acceleration : 0.0f);
+    mInvDieDistance.push_back(particle.invDieDistance);
+    mAlpha.push_back(particle.alpha);
+    mRandomness.push_back(particle.randomness);
+    mLifetimeLeft.push_back(particle.lifetime);
+    mLifetimePast.push_back(0);
+    mFadeOut.push_back(particle.fadeOut);
+    mFadeIn.push_back(particle.fadeIn);
+    mDead.push_back(0);
+    mTarget.push_back(particle.target);
+    mImage.push_back(particle.image);
+
+    ParticleUpdater::countParticles(1);
+}
+
+void ParticlePool::clear()
+{
+    ParticleUpdater::countParticles(-(int) size());
+
+    while (!mPosX.empty())
+        remove(mPosX.size() - 1);
+}
+
+void ParticlePool::remove(const unsigned int index)
+{
+    const unsigned int last = mPosX.size() - 1;
+
+    if (index != last)
+    {
+        mPosX[index] = mPosX[last];
+        mPosY[index] = mPosY[last];
+        mPosZ[index] = mPosZ[last];
+        mVelX[index] = mVelX[last];
+        mVelY[index] = mVelY[last];
+        mVelZ[index] = mVelZ[last];
+        mFollow[index] = mFollow[last];
+        mGravity[index] = mGravity[last];
+        mBounce[index] = mBounce[last];
+        mMomentum[index] = mMomentum[last];
+        mAcceleration[index] = mAcceleration[last];
+        mInvDieDistance[index] = mInvDieDistance[last];
+        mAlpha[index] = mAlpha[last];
+        mRandomness[index] = mRandomness[last];
+        mLifetimeLeft[index] = mLifetimeLeft[last];
+        mLifetimePast[index] = mLifetimePast[last];
+        mFadeOut[index] = mFadeOut[last];
+        mFadeIn[index] = mFadeIn[last];
+        mDead[index] = mDead[last];
+        mTarget[index] = mTarget[last];
+        mImage[index] = mImage[last];
+    }
+
+    // pop_back keeps the capacity, so the storage is reused by new particles
+    mPosX.pop_back();
+    mPosY.pop_back();
+    mPosZ.pop_back();
+    mVelX.pop_back();
+    mVelY.pop_back();
+    mVelZ.pop_back();
+    mFollow.pop_back();
+    mGravity.pop_back();
+    mBounce.pop_back();
+    mMomentum.pop_back();
+    mAcceleration.pop_back();
+    mInvDieDistance.pop_back();
+    mAlpha.pop_back();
+    mRandomness.pop_back();
+    mLifetimeLeft.pop_back();
+    mLifetimePast.pop_back();
+    mFadeOut.pop_back();
+    mFadeIn.pop_back();
+    mDead.pop_back();
+    mTarget.pop_back();
+    mImage.pop_back();
+}
+
+void ParticlePool::moveBy(const Vector &change)
+{
+    const unsigned int count = size();
+
+    if (count == 0)
+        return;
+
+    float *posX = &mPosX[0];
+    float *posY = &mPosY[0];
+    float *posZ = &mPosZ[0];
+    const float *follow = &mFollow[0];
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        posX[i] += change.x * follow[i];
+        posY[i] += change.y * follow[i];
+        posZ[i] += change.z * follow[i];
+    }
+
+    // Cover both the old and the new positions of the following particles
+    const float dx = change.x;
+    const float dy = change.y - change.z;
+
+    if (dx < 0.0f) mLeft += dx; else mRight += dx;
+    if (dy < 0.0f) mTop += dy; else mBottom += dy;
+}
+
+void ParticlePool::update(const Vector &change, Random &random)
+{
+    moveBy(change);
+
+    const unsigned int count = size();
+
+    if (count == 0)
+        return;
+
+    float *posX = &mPosX[0];
+    float *posY = &mPosY[0];
+    float *posZ = &mPosZ[0];
+    float *velX = &mVelX[0];
+    float *velY = &mVelY[0];
+    float *velZ = &mVelZ[0];
+    const float *gravity = &mGravity[0];
+    const float *momentum = &mMomentum[0];
+    int *lifetimeLeft = &mLifetimeLeft[0];
+    int *lifetimePast = &mLifetimePast[0];
+    char *dead = &mDead[0];
+
+    // Particles whose lifetime ran out die before they move
+    for (unsigned int i = 0; i < count; i++)
+        dead[i] = lifetimeLeft[i] == 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        velX[i] *= momentum[i];
+        velY[i] *= momentum[i];
+        velZ[i] *= momentum[i];
+    }
+
+    // Acceleration towards the target
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (mAcceleration[i] == 0.0f)
+            continue;
+
+        Vector dist = Vector(posX[i], posY[i], posZ[i]) -
+                      mTarget[i]->getPosition();
+        dist.x *= SIN45;
+        const float invHypotenuse = Particle::getInvDistance(dist);
+
+        if (invHypotenuse)
+        {
+            if (mInvDieDistance[i] > 0.0f &&
+                invHypotenuse > mInvDieDistance[i])
+            {
+                dead[i] = 1;
+            }
+
+            const float accFactor = invHypotenuse * mAcceleration[i];
+            velX[i] -= dist.x * accFactor;
+            velY[i] -= dist.y * accFactor;
+            velZ[i] -= dist.z * accFactor;
+        }
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const int randomness = mRandomness[i];
+
+        if (randomness > 0)
+        {
+            velX[i] += (random.next(randomness) - random.next(randomness)) /
+                       1000.0f;
+            velY[i] += (random.next(randomness) - random.next(randomness)) /
+                       1000.0f;
+            velZ[i] += (random.next(randomness) - random.next(randomness)) /
+                       1000.0f;
+        }
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        velZ[i] -= gravity[i];
+
+        posX[i] += velX[i];
+        posY[i] += velY[i] * SIN45;
+        posZ[i] += velZ[i] * SIN45;
+
+        lifetimeLeft[i] -= lifetimeLeft[i] > 0;
+        lifetimePast[i]++;
+    }
+
+    // Bounce off the ground, or die when hitting it or the sky
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (posZ[i] < 0.0f)
+        {
+            if (mBounce[i] > 0.0f)
+            {
+                posZ[i] *= -mBounce[i];
+                velX[i] *= mBounce[i];
+                velY[i] *= mBounce[i];
+                velZ[i] *= -mBounce[i];
+            }
+            else
+            {
+                dead[i] = 1;
+            }
+        }
+        else if (posZ[i] > Particle::PARTICLE_SKY)
+        {
+            dead[i] = 1;
+        }
+    }
+
+    int removed = 0;
+
+    for (unsigned int i = 0; i < mDead.size();)
+    {
+        if (mDead[i])
+        {
+            remove(i);
+            removed++;
+        }
+        else
+            i++;
+    }
+
+    if (removed > 0)
+        ParticleUpdater::countParticles(-removed);
+
+    updateBounds();
+}
+
+void ParticlePool::updateBounds()
+{
+    const unsigned int count = size();
+
+    if (count == 0)
+        return;
+
+    const float *posX = &mPosX[0];
+    const float *posY = &mPosY[0];
+    const float *posZ = &mPosZ[0];
+    float left = posX[0], right = posX[0];
+    float top = posY[0] - posZ[0], bottom = top;
+
+    for (unsigned int i = 1; i < count; i++)
+    {
+        const float y = posY[i] - posZ[i];
+
+        left = std::min(left, posX[i]);
+        right = std::max(right, posX[i]);
+        top = std::min(top, y);
+        bottom = std::max(bottom, y);
+    }
+
+    mLeft = left;
+    mRight = right;
+    mTop = top;
+    mBottom = bottom;
+}
+
+void ParticlePool::draw(Graphics *graphics, const int offsetX,
+                        const int offsetY) const
+{
+    const unsigned int count = size();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Image *image = mImage[i];
+        const int width = image->getWidth();
+        const int height = image->getHeight();
+        const int screenX = (int) mPosX[i] + offsetX - width / 2;
+        const int screenY = (int) mPosY[i] - (int) mPosZ[i] + offsetY -
+                            height / 2;
+
+        // Check if on screen
+        if (screenX + width < 0 || screenX > graphics->getWidth() ||
+            screenY + height < 0 || screenY > graphics->getHeight())
+        {
+            continue;
+        }
+
+        float alpha = mAlpha[i];
+
+        if (mLifetimeLeft[i] > -1 && mLifetimeLeft[i] < mFadeOut[i])
+            alpha *= (float) mLifetimeLeft[i] / (float) mFadeOut[i];
+
+        if (mLifetimePast[i] < mFadeIn[i])
+            alpha *= (float) mLifetimePast[i] / (float) mFadeIn[i];
+
+        image->setAlpha(alpha);
+        graphics->drawImage(image, screenX, screenY);
+    }
+}
+
+const int ParticlePool::getPixelY() const
+{
+    return mOwner->getPixelY();
+}
+
+bool ParticlePool::isInArea(const int left, const int top, const int right,
+                            const int bottom) const
+{
+    if (size() == 0)
+        return false;
+
+    // Particle images are drawn centered on their position
+    const int halfWidth = mImageWidth / 2 + 1;
+    const int halfHeight = mImageHeight / 2 + 1;
+
+    return (int) mRight + halfWidth >= left &&
+           (int) mLeft - halfWidth <= right &&
+           (int) mBottom + halfHeight >= top &&
+           (int) mTop - halfHeight <= bottom;
+}
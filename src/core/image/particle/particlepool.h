@@ -0,0 +1,182 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PARTICLEPOOL_H
+#define PARTICLEPOOL_H
+
+#include <list>
+#include <vector>
+
+#include "../../map/sprite/sprite.h"
+
+#include "../../utils/random.h"
+#include "../../utils/vector.h"
+
+class Image;
+class Map;
+class Particle;
+
+/**
+ * The properties of a new particle in a particle pool.
+ */
+struct PooledParticle
+{
+    Image *image;           /**< Image of the particle, may not be NULL. It
+                                 is not reference counted, the emitters of
+                                 the owner keep it loaded. */
+    Vector position;        /**< Position in pixels relative to map */
+    Vector velocity;        /**< Speed in pixels per game-tick */
+    float gravity;          /**< Downward acceleration */
+    int randomness;         /**< Amount of random vector change */
+    float bounce;           /**< Velocity retained after hitting the ground */
+    bool follow;            /**< Is it moved when its owner moves? */
+    Particle *target;       /**< The particle that attracts it, may be NULL */
+    float acceleration;     /**< Acceleration towards the target */
+    float momentum;         /**< Speed retained after each game tick */
+    float invDieDistance;   /**< Inverse of the distance to the target at
+                                 which the particle dies */
+    int lifetime;           /**< Lifetime in game ticks, -1 for infinite */
+    int fadeOut;            /**< Lifetime left where fading out begins */
+    int fadeIn;             /**< Age where fading in is finished */
+    float alpha;            /**< Opacity of the particle */
+};
+
+/**
+ * Stores the simple image particles spawned by the emitters of a particle.
+ * The properties of the particles are kept in one array each, so that they
+ * are updated in tight loops without any allocation. Removed particles are
+ * replaced by the last one, which keeps the arrays free of gaps, and the
+ * storage is reused by the particles spawned later on.
+ *
+ * The pool is sorted with the other sprites of the map as a whole, at the
+ * position of the particle that owns it. Emitters only put particles into
+ * it which stay within about a tile of their origin from north to south,
+ * see ParticleEmitter::spreadsBeyondTile.
+ */
+class ParticlePool : public Sprite
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * @param map   the map the pool is drawn on, may not be NULL
+         * @param owner the particle whose emitters fill the pool
+         */
+        ParticlePool(Map *map, const Particle *owner);
+
+        /**
+         * Destructor.
+         */
+        ~ParticlePool();
+
+        /**
+         * Adds a particle to the pool.
+         */
+        void add(const PooledParticle &particle);
+
+        /**
+         * Removes all particles.
+         */
+        void clear();
+
+        /**
+         * Returns the number of particles in the pool.
+         */
+        unsigned int size() const { return mPosX.size(); }
+
+        /**
+         * Moves the particles which follow the owner of the pool.
+         */
+        void moveBy(const Vector &change);
+
+        /**
+         * Updates all particles and removes the ones which died.
+         *
+         * @param change the distance the owner moved since the last update
+         * @param random the random numbers of the calling thread
+         */
+        void update(const Vector &change, Random &random);
+
+        /**
+         * Draws all particles.
+         */
+        void draw(Graphics *graphics, const int offsetX,
+                  const int offsetY) const;
+
+        /**
+         * Returns the pixel Y coordinate of the owner.
+         */
+        const int getPixelY() const;
+
+        /**
+         * Checks whether the area covered by the particles overlaps the
+         * given area.
+         */
+        bool isInArea(const int left, const int top, const int right,
+                      const int bottom) const;
+
+    private:
+        /**
+         * Removes the particle at the given index, moving the last particle
+         * in its place.
+         */
+        void remove(const unsigned int index);
+
+        /**
+         * Recalculates the area covered by the particles.
+         */
+        void updateBounds();
+
+        Map *mMap;                      /**< Map the pool is on. */
+        const Particle *mOwner;         /**< Particle owning the pool. */
+        std::list<Sprite*>::iterator mSpriteIterator;
+                                        /**< Iterator of the pool on the
+                                             map */
+
+        /**
+         * Area covered by the positions of the particles on screen, and the
+         * largest image size of them.
+         */
+        float mLeft, mTop, mRight, mBottom;
+        int mImageWidth, mImageHeight;
+
+        std::vector<float> mPosX, mPosY, mPosZ;
+        std::vector<float> mVelX, mVelY, mVelZ;
+        std::vector<float> mFollow;     /**< 1 if the particle follows the
+                                             owner, 0 otherwise */
+        std::vector<float> mGravity;
+        std::vector<float> mBounce;
+        std::vector<float> mMomentum;
+        std::vector<float> mAcceleration;
+        std::vector<float> mInvDieDistance;
+        std::vector<float> mAlpha;
+        std::vector<int> mRandomness;
+        std::vector<int> mLifetimeLeft;
+        std::vector<int> mLifetimePast;
+        std::vector<int> mFadeOut;
+        std::vector<int> mFadeIn;
+        std::vector<char> mDead;        /**< 1 once the particle died */
+        std::vector<Particle*> mTarget;
+        std::vector<Image*> mImage;
+};
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <algorithm>
+
+#include "particleupdater.h"
+
+#include "../../resource.h"
+
+#include "../../map/map.h"
+
+ParticleUpdater *ParticleUpdater::mRunning = NULL;
+
+ParticleUpdater::ParticleUpdater(const int threads):
+    mTaskCount(0),
+    mNextTask(0),
+    mUpdateCount(0),
+    mQuit(false),
+    mDone(SDL_CreateSemaphore(0))
+{
+    const int count = threads > 1 ? threads : 1;
+    mWorkers.resize(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        Worker &worker = mWorkers[i];
+        worker.updater = this;
+        worker.thread = NULL;
+        worker.id = 0;
+        worker.start = NULL;
+        worker.task = NULL;
+    }
+
+    // The main thread takes its share of the tasks itself
+    for (int i = 1; i < count; i++)
+    {
+        Worker &worker = mWorkers[i];
+        worker.start = SDL_CreateSemaphore(0);
+        worker.thread = SDL_CreateThread(workerThread, &worker);
+        worker.id = SDL_GetThreadID(worker.thread);
+    }
+}
+
+ParticleUpdater::~ParticleUpdater()
+{
+    mQuit = true;
+
+    for (unsigned int i = 1; i < mWorkers.size(); i++)
+    {
+        SDL_SemPost(mWorkers[i].start);
+        SDL_WaitThread(mWorkers[i].thread, NULL);
+        SDL_DestroySemaphore(mWorkers[i].start);
+    }
+
+    SDL_DestroySemaphore(mDone);
+}
+
+int ParticleUpdater::workerThread(void *data)
+{
+    Worker *worker = static_cast<Worker*>(data);
+    ParticleUpdater *updater = worker->updater;
+
+    while (true)
+    {
+        SDL_SemWait(worker->start);
+
+        if (updater->mQuit)
+            break;
+
+        updater->runTasks(*worker);
+        SDL_SemPost(updater->mDone);
+    }
+
+    return 0;
+}
+
+void ParticleUpdater::update(Particles &particles, const Vector &change)
+{
+    mTaskCount = 0;
+    mUpdateCount++;
+
+    for (ParticleIterator p = particles.begin(); p != particles.end(); p++)
+    {
+        if (mTaskCount == mTasks.size())
+            mTasks.push_back(Task());
+
+        Task &task = mTasks[mTaskCount];
+        task.particle = *p;
+        task.alive = true;
+        task.particleCount = 0;
+        task.random.setSeed(mUpdateCount * 65537 + mTaskCount);
+        mTaskCount++;
+    }
+
+    if (mTaskCount == 0)
+        return;
+
+    mChange = change;
+    mNextTask = 0;
+    mWorkers[0].id = SDL_ThreadID();
+    mRunning = this;
+
+    // Only wake up as many workers as there are tasks for
+    const unsigned int helpers = std::min<unsigned int>(mWorkers.size(),
+                                                        mTaskCount) - 1;
+
+    for (unsigned int i = 1; i <= helpers; i++)
+        SDL_SemPost(mWorkers[i].start);
+
+    runTasks(mWorkers[0]);
+
+    for (unsigned int i = 1; i <= helpers; i++)
+        SDL_SemWait(mDone);
+
+    mRunning = NULL;
+
+    // Apply the collected changes in the order of the particles
+    unsigned int i = 0;
+
+    for (ParticleIterator p = particles.begin(); p != particles.end(); i++)
+    {
+        Task &task = mTasks[i];
+
+        for (std::map<Map*, std::list<Sprite*> >::iterator s =
+             task.addedSprites.begin(); s != task.addedSprites.end(); ++s)
+        {
+            s->first->addSprites(s->second);
+        }
+
+        for (RemovedSprites::iterator s = task.removedSprites.begin();
+             s != task.removedSprites.end(); ++s)
+        {
+            s->first->removeSprite(s->second);
+        }
+
+        task.addedSprites.clear();
+        task.removedSprites.clear();
+        Particle::particleCount += task.particleCount;
+
+        if (task.alive)
+            p++;
+        else
+            p = particles.erase(p);
+    }
+
+    // Death effects are added to the particle engine, so they are only
+    // spawned once its list of particles is no longer iterated
+    for (i = 0; i < mTaskCount; i++)
+    {
+        DeathEffects &deathEffects = mTasks[i].deathEffects;
+
+        for (DeathEffects::iterator d = deathEffects.begin();
+             d != deathEffects.end(); ++d)
+        {
+            addDeathEffect(d->first, d->second);
+        }
+
+        deathEffects.clear();
+    }
+}
+
+void ParticleUpdater::runTasks(Worker &worker)
+{
+    while (true)
+    {
+        mMutex.lock();
+        const unsigned int index = mNextTask++;
+        mMutex.unlock();
+
+        if (index >= mTaskCount)
+            break;
+
+        Task &task = mTasks[index];
+        worker.task = &task;
+
+        Particle *particle = task.particle;
+
+        // Move particle with its parent if desired
+        if (particle->doesFollow())
+            particle->moveBy(mChange);
+
+        if (!particle->update(task.random))
+        {
+            delete particle;
+            task.alive = false;
+        }
+    }
+
+    worker.task = NULL;
+}
+
+ParticleUpdater::Task *ParticleUpdater::getTask()
+{
+    if (!mRunning)
+        return NULL;
+
+    const Uint32 id = SDL_ThreadID();
+    std::vector<Worker> &workers = mRunning->mWorkers;
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+    {
+        if (workers[i].id == id)
+            return workers[i].task;
+    }
+
+    return NULL;
+}
+
+std::list<Sprite*>::iterator ParticleUpdater::addSprite(Map *map,
+                                                        Sprite *sprite)
+{
+    Task *task = getTask();
+
+    if (!task)
+        return map->addSprite(sprite);
+
+    std::list<Sprite*> &sprites = task->addedSprites[map];
+    return sprites.insert(sprites.end(), sprite);
+}
+
+void ParticleUpdater::removeSprite(Map *map,
+                                   const std::list<Sprite*>::iterator &sprite)
+{
+    Task *task = getTask();
+
+    if (task)
+        task->removedSprites.push_back(std::make_pair(map, sprite));
+    else
+        map->removeSprite(sprite);
+}
+
+void ParticleUpdater::countParticles(const int change)
+{
+    Task *task = getTask();
+
+    if (task)
+        task->particleCount += change;
+    else
+        Particle::particleCount += change;
+}
+
+void ParticleUpdater::incRef(Resource *resource)
+{
+    if (mRunning)
+    {
+        MutexLocker lock(&mRunning->mResourceMutex);
+        resource->incRef();
+    }
+    else
+        resource->incRef();
+}
+
+void ParticleUpdater::decRef(Resource *resource)
+{
+    if (mRunning)
+    {
+        MutexLocker lock(&mRunning->mResourceMutex);
+        resource->decRef();
+    }
+    else
+        resource->decRef();
+}
+
+void ParticleUpdater::addDeathEffect(const std::string &effectFile,
+                                     const Vector &position)
+{
+    Task *task = getTask();
+
+    if (task)
+    {
+        task->deathEffects.push_back(std::make_pair(effectFile, position));
+        return;
+    }
+
+    Particle *deathEffect = particleEngine->addEffect(effectFile, 0, 0);
+
+    if (deathEffect)
+        deathEffect->moveBy(position);
+}
@@ -0,0 +1,173 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PARTICLEUPDATER_H
+#define PARTICLEUPDATER_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <SDL_thread.h>
+
+#include "particle.h"
+
+#include "../../utils/mutex.h"
+#include "../../utils/random.h"
+#include "../../utils/vector.h"
+
+class Map;
+class Resource;
+class Sprite;
+
+/**
+ * Updates the particle effects of the particle engine on several threads.
+ * Each top level particle is updated together with its children as one
+ * task, and the tasks are handed out to the worker threads and the main
+ * thread.
+ *
+ * Particles change the sprites of the map, the particle count and the
+ * particle engine through the static functions of this class. While an
+ * update is running, these changes are collected for each task and applied
+ * by the main thread afterwards, in the order of the particles. Each task
+ * also draws from its own random numbers, seeded from the number of the
+ * update and of the task, so that the result does not depend on how the
+ * tasks were scheduled.
+ */
+class ParticleUpdater
+{
+    public:
+        /**
+         * Constructor, starts the worker threads.
+         *
+         * @param threads the number of threads to update on, including the
+         *                main thread
+         */
+        ParticleUpdater(const int threads);
+
+        /**
+         * Destructor, stops the worker threads.
+         */
+        ~ParticleUpdater();
+
+        /**
+         * Updates the given particles after moving the following ones by
+         * the given change, and deletes the particles which died.
+         */
+        void update(Particles &particles, const Vector &change);
+
+        /**
+         * Adds a sprite to the map.
+         */
+        static std::list<Sprite*>::iterator addSprite(Map *map,
+                                                      Sprite *sprite);
+
+        /**
+         * Removes a sprite from the map.
+         */
+        static void removeSprite(Map *map,
+                                 const std::list<Sprite*>::iterator &sprite);
+
+        /**
+         * Changes the number of existing particles.
+         */
+        static void countParticles(const int change);
+
+        /**
+         * Increases the reference count of a resource.
+         */
+        static void incRef(Resource *resource);
+
+        /**
+         * Decreases the reference count of a resource.
+         */
+        static void decRef(Resource *resource);
+
+        /**
+         * Spawns the given death effect from the particle engine.
+         */
+        static void addDeathEffect(const std::string &effectFile,
+                                   const Vector &position);
+
+    private:
+        ParticleUpdater(const ParticleUpdater&);  // prevent copying
+        ParticleUpdater& operator=(const ParticleUpdater&);
+
+        typedef std::list<std::pair<Map*, std::list<Sprite*>::iterator> >
+            RemovedSprites;
+        typedef std::list<std::pair<std::string, Vector> > DeathEffects;
+
+        /**
+         * A top level particle and the changes made while updating it.
+         */
+        struct Task
+        {
+            Particle *particle;
+            bool alive;
+            std::map<Map*, std::list<Sprite*> > addedSprites;
+            RemovedSprites removedSprites;
+            DeathEffects deathEffects;
+            int particleCount;
+            Random random;
+        };
+
+        struct Worker
+        {
+            ParticleUpdater *updater;
+            SDL_Thread *thread;
+            Uint32 id;
+            SDL_sem *start;       /**< Posted for each update */
+            Task *task;           /**< Task being run, or NULL */
+        };
+
+        static int workerThread(void *data);
+
+        /**
+         * Runs the tasks not yet taken by another thread.
+         */
+        void runTasks(Worker &worker);
+
+        /**
+         * Returns the task being run by the calling thread, or NULL when
+         * no update is running.
+         */
+        static Task *getTask();
+
+        std::vector<Task> mTasks;
+        unsigned int mTaskCount;
+        unsigned int mNextTask;             /**< Next task to be taken */
+        unsigned int mUpdateCount;          /**< Seeds the random numbers */
+        Vector mChange;
+        std::vector<Worker> mWorkers;       /**< The first one is the main
+                                                 thread */
+        bool mQuit;
+
+        SDL_sem *mDone;                     /**< Posted by each worker after
+                                                 an update */
+        Mutex mMutex;                       /**< Guards mNextTask */
+        Mutex mResourceMutex;               /**< Guards reference counts */
+
+        static ParticleUpdater *mRunning;   /**< Updater running an update */
+};
+
+#endif
@@ -47,7 +47,7 @@ RotationalParticle::~RotationalParticle()
     mImage = NULL;
 }
 
-bool RotationalParticle::update()
+bool RotationalParticle::update(Random &random)
 {
     // TODO: cache velocities to avoid spamming atan2()
 
@@ -76,5 +76,5 @@ bool RotationalParticle::update()
 
     mImage = mAnimation->getCurrentImage();
 
-    return Particle::update();
+    return Particle::update(random);
 }
@@ -39,7 +39,7 @@ class RotationalParticle : public ImageParticle
 
         ~RotationalParticle();
 
-        virtual bool update();
+        virtual bool update(Random &random);
 
     private:
         SimpleAnimation *mAnimation; /**< Used animation for this particle */
@@ -46,6 +46,12 @@ class TextParticle : public Particle
         // hack to improve text visibility
         virtual const int getPixelY() const { return (int) (mPos.y + mPos.z); }
 
+        /**
+         * The size of the text isn't known here, so it is always drawn.
+         */
+        virtual bool isInArea(const int left, const int top, const int right,
+                              const int bottom) const { return true; }
+
     private:
         std::string mText;             /**< Text of the particle. */
         gcn::Font *mTextFont;          /**< Font used for drawing the text. */
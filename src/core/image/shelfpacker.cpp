@@ -0,0 +1,96 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <cstddef>
+
+#include "shelfpacker.h"
+
+ShelfPacker::ShelfPacker(const int size):
+    mSize(size),
+    mNextY(0),
+    mUsed(0)
+{
+}
+
+bool ShelfPacker::allocate(const int width, const int height, int &x, int &y)
+{
+    // Use the shelf which wastes the least height
+    Shelf *best = NULL;
+    for (std::vector<Shelf>::iterator i = mShelves.begin();
+         i != mShelves.end(); ++i)
+    {
+        if (i->height < height || i->x + width > mSize)
+            continue;
+
+        if (!best || i->height < best->height)
+            best = &(*i);
+    }
+
+    // Rather open a new shelf than put a small rectangle on a much higher one
+    if ((!best || best->height > height * 2) && mNextY + height <= mSize)
+    {
+        Shelf shelf;
+        shelf.y = mNextY;
+        shelf.height = height;
+        shelf.x = 0;
+        shelf.used = 0;
+        mShelves.push_back(shelf);
+        mNextY += height;
+        best = &mShelves.back();
+    }
+
+    if (!best)
+        return false;
+
+    x = best->x;
+    y = best->y;
+    best->x += width;
+    best->used++;
+    mUsed++;
+
+    return true;
+}
+
+void ShelfPacker::release(const int x, const int y)
+{
+    for (std::vector<Shelf>::iterator i = mShelves.begin();
+         i != mShelves.end(); ++i)
+    {
+        if (i->y != y || x >= i->x)
+            continue;
+
+        mUsed--;
+
+        if (--i->used == 0)
+            i->x = 0;
+
+        break;
+    }
+
+    // Give the height of empty shelves at the bottom back, so that it can
+    // be split up differently
+    while (!mShelves.empty() && mShelves.back().used == 0)
+    {
+        mNextY -= mShelves.back().height;
+        mShelves.pop_back();
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef SHELFPACKER_H
+#define SHELFPACKER_H
+
+#include <vector>
+
+/**
+ * Lays out rectangles on a square area, as done for the pages of the
+ * texture atlas.
+ *
+ * Rectangles are placed on shelves: rows as high as the first rectangle put
+ * on them, which are filled from left to right. Space isn't reused while
+ * any rectangle on a shelf is in use, but a shelf is emptied for reuse once
+ * all of its rectangles have been released.
+ */
+class ShelfPacker
+{
+    public:
+        ShelfPacker(const int size);
+
+        /**
+         * Finds room for a rectangle, opening a new shelf when needed.
+         *
+         * @return <code>true</code> if the rectangle was placed at x and y,
+         *         <code>false</code> when there is no room for it
+         */
+        bool allocate(const int width, const int height, int &x, int &y);
+
+        /**
+         * Releases the space of a rectangle placed at the given position.
+         */
+        void release(const int x, const int y);
+
+        /**
+         * Returns whether no rectangles are in use.
+         */
+        bool isEmpty() const { return mUsed == 0; }
+
+        /**
+         * Returns the number of shelves in use.
+         */
+        int getShelfCount() const { return mShelves.size(); }
+
+        int getSize() const { return mSize; }
+
+    private:
+        struct Shelf
+        {
+            int y, height;
+            int x;              /**< Where the next rectangle goes */
+            int used;           /**< Rectangles still in use */
+        };
+
+        int mSize;
+        int mNextY;             /**< Where the next shelf goes */
+        int mUsed;
+        std::vector<Shelf> mShelves;
+};
+
+#endif
@@ -45,7 +45,13 @@ SimpleAnimation::SimpleAnimation(xmlNodePtr animationNode):
     mAnimationPhase(0)
 {
     mAnimation = new Animation();
+    loadAnimation(animationNode, *mAnimation);
+    mCurrentFrame = mAnimation->getFrame(0);
+}
 
+void SimpleAnimation::loadAnimation(xmlNodePtr animationNode,
+                                    Animation &animation)
+{
     ImageSet *imageset = ResourceManager::getInstance()->getImageSet(
         XML::getProperty(animationNode, "imageset", ""),
         XML::getProperty(animationNode, "width", 0),
@@ -83,7 +89,7 @@ SimpleAnimation::SimpleAnimation(xmlNodePtr animationNode):
                 continue;
             }
 
-            mAnimation->addFrame(img, delay, offsetX, offsetY);
+            animation.addFrame(img, delay, offsetX, offsetY);
         }
         else if (xmlStrEqual(frameNode->name, BAD_CAST "sequence"))
         {
@@ -106,15 +112,13 @@ SimpleAnimation::SimpleAnimation(xmlNodePtr animationNode):
                     continue;
                 }
 
-                mAnimation->addFrame(img, delay, offsetX, offsetY);
+                animation.addFrame(img, delay, offsetX, offsetY);
                 start++;
             }
         }
         else if (xmlStrEqual(frameNode->name, BAD_CAST "end"))
-            mAnimation->addTerminator();
+            animation.addTerminator();
     }
-
-    mCurrentFrame = mAnimation->getFrame(0);
 }
 
 bool SimpleAnimation::draw(Graphics* graphics, const int posX, const int posY) const
@@ -47,6 +47,13 @@ class SimpleAnimation
          */
         SimpleAnimation(xmlNodePtr animationNode);
 
+        /**
+         * Appends the frames described by an animation element to the given
+         * animation.
+         */
+        static void loadAnimation(xmlNodePtr animationNode,
+                                  Animation &animation);
+
         ~SimpleAnimation();
 
         Frame *getFrame() { return mCurrentFrame; }
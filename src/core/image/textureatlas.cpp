@@ -0,0 +1,153 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "textureatlas.h"
+
+#ifdef USE_OPENGL
+
+#include <algorithm>
+
+#include "../log.h"
+
+#include "../../bindings/guichan/opengl/openglgraphics.h"
+
+/** The size of the atlas pages, as far as textures can be this large */
+static const int PAGE_SIZE = 1024;
+
+/** Images larger than this in either direction get a texture of their own */
+static const int MAX_IMAGE_SIZE = 256;
+
+std::vector<TextureAtlas::Page*> TextureAtlas::mPages;
+
+bool TextureAtlas::fits(const int width, const int height)
+{
+    return width <= MAX_IMAGE_SIZE && height <= MAX_IMAGE_SIZE &&
+           width < Image::mTextureSize && height < Image::mTextureSize;
+}
+
+bool TextureAtlas::add(SDL_Surface *surface, GLuint &texture, int &x, int &y,
+                       int &size)
+{
+    // Leave a pixel between images, so that they never bleed into each other
+    const int width = surface->w + 1;
+    const int height = surface->h + 1;
+
+    Page *page = NULL;
+    for (std::vector<Page*>::iterator i = mPages.begin(); i != mPages.end();
+         ++i)
+    {
+        if ((*i)->layout.allocate(width, height, x, y))
+        {
+            page = *i;
+            break;
+        }
+    }
+
+    if (!page)
+    {
+        page = createPage();
+        if (!page)
+            return false;
+
+        if (!page->layout.allocate(width, height, x, y))
+            return false;
+    }
+
+    OpenGLGraphics::bindTexture(Image::mTextureType, page->texture);
+
+    if (SDL_MUSTLOCK(surface))
+        SDL_LockSurface(surface);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->pitch / 4);
+    glTexSubImage2D(Image::mTextureType, 0, x, y, surface->w, surface->h,
+                    GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    if (SDL_MUSTLOCK(surface))
+        SDL_UnlockSurface(surface);
+
+    texture = page->texture;
+    size = page->layout.getSize();
+
+    return true;
+}
+
+void TextureAtlas::remove(const GLuint texture, const int x, const int y)
+{
+    for (std::vector<Page*>::iterator i = mPages.begin(); i != mPages.end();
+         ++i)
+    {
+        Page *page = *i;
+        if (page->texture != texture)
+            continue;
+
+        page->layout.release(x, y);
+
+        if (page->layout.isEmpty())
+        {
+            OpenGLGraphics::deleteTexture(page->texture);
+            delete page;
+            mPages.erase(i);
+        }
+        return;
+    }
+}
+
+TextureAtlas::Page *TextureAtlas::createPage()
+{
+    // Flush current error flag.
+    glGetError();
+
+    const int size = std::min(PAGE_SIZE, Image::mTextureSize);
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    OpenGLGraphics::bindTexture(Image::mTextureType, texture);
+
+    // Start out transparent, which also covers the gaps between images
+    std::vector<GLubyte> pixels(size * size * 4, 0);
+    glTexImage2D(Image::mTextureType, 0, 4, size, size, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, &pixels[0]);
+
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glTexParameteri(Image::mTextureType, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(Image::mTextureType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    if (glGetError())
+    {
+        logger->log("Error: Could not create a texture atlas page of %dx%d.",
+                    size, size);
+        OpenGLGraphics::deleteTexture(texture);
+        return NULL;
+    }
+
+    Page *page = new Page(texture, size);
+    mPages.push_back(page);
+
+    logger->log("Created texture atlas page %d (%dx%d).", (int) mPages.size(),
+                size, size);
+
+    return page;
+}
+
+#endif // USE_OPENGL
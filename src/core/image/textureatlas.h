@@ -0,0 +1,101 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../../config.h"
+#endif
+
+#ifdef USE_OPENGL
+
+#include <vector>
+
+#include "image.h"
+#include "shelfpacker.h"
+
+/**
+ * Packs small images into a few large textures, so that the OpenGL renderer
+ * can draw many of them without switching textures in between.
+ *
+ * Images are placed on each page by a ShelfPacker, which reuses a row of
+ * images once all of them are freed. A page is deleted once the last image
+ * on it is gone. Images that are replaced often, like rendered text, are
+ * better kept out of the atlas, see Image::load.
+ */
+class TextureAtlas
+{
+    public:
+        /**
+         * Returns whether an image of the given size should be put in an
+         * atlas page rather than get a texture of its own.
+         */
+        static bool fits(const int width, const int height);
+
+        /**
+         * Uploads an image with 32 bit RGBA pixels to an atlas page.
+         *
+         * @param surface the image, which should be exactly as large as
+         *                the area to be used
+         * @param texture set to the texture of the page
+         * @param x       set to the position of the image on the page
+         * @param y       set to the position of the image on the page
+         * @param size    set to the width and height of the page
+         * @return <code>true</code> if the image was placed,
+         *         <code>false</code> when no space could be made for it
+         */
+        static bool add(SDL_Surface *surface, GLuint &texture, int &x, int &y,
+                        int &size);
+
+        /**
+         * Tells the atlas the image at the given position of a page is no
+         * longer in use.
+         */
+        static void remove(const GLuint texture, const int x, const int y);
+
+        /**
+         * Returns the number of atlas pages in use.
+         */
+        static int getPageCount() { return mPages.size(); }
+
+    private:
+        struct Page
+        {
+            Page(const GLuint texture, const int size):
+                texture(texture), layout(size) {}
+
+            GLuint texture;
+            ShelfPacker layout;
+        };
+
+        /**
+         * Creates an empty page.
+         */
+        static Page *createPage();
+
+        static std::vector<Page*> mPages;
+};
+
+#endif // USE_OPENGL
+
+#endif
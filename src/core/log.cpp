@@ -27,6 +27,8 @@
 
 #include <sys/time.h>
 
+#include <SDL_thread.h>
+
 #ifdef WIN32
 #include <windows.h>
 #elif __APPLE__
@@ -43,7 +45,9 @@
 
 Logger::Logger():
     mLogToStandardOut(false),
-    mLogToChatWindow(false)
+    mLogToChatWindow(false),
+    mMainThread(SDL_ThreadID()),
+    mMutex(SDL_CreateMutex())
 {
 }
 
@@ -51,11 +55,15 @@ Logger::~Logger()
 {
     if (mLogFile.is_open())
         mLogFile.close();
+
+    SDL_DestroyMutex(mMutex);
 }
 
 void Logger::setLogFile(const std::string &logFilename)
 {
+    SDL_mutexP(mMutex);
     mLogFile.open(logFilename.c_str(), std::ios_base::trunc);
+    SDL_mutexV(mMutex);
 
     if (!mLogFile.is_open())
         std::cout << "Warning: error while opening " << logFilename <<
@@ -95,12 +103,17 @@ void Logger::log(const char *log_text, ...)
         << (int)((tv.tv_usec / 10000) % 100)
         << "] ";
 
+    SDL_mutexP(mMutex);
+
     mLogFile << timeStr.str() << buf << std::endl;
 
     if (mLogToStandardOut)
         std::cout << timeStr.str() << buf << std::endl;
 
-    if (chatWindow && mLogToChatWindow)
+    SDL_mutexV(mMutex);
+
+    // The chat window may only be used from the main thread
+    if (chatWindow && mLogToChatWindow && SDL_ThreadID() == mMainThread)
         chatWindow->chatLog(buf, BY_LOGGER);
 
     // Delete temporary buffer
@@ -25,8 +25,12 @@
 
 #include <fstream>
 
+struct SDL_mutex;
+
 /**
- * The Log Class : Useful to write debug or info messages
+ * The Log Class : Useful to write debug or info messages. Messages can be
+ * logged from any thread, but only those of the thread that created the
+ * logger are shown in the chat window.
  */
 class Logger
 {
@@ -76,6 +80,8 @@ class Logger
         std::ofstream mLogFile;
         bool mLogToStandardOut;
         bool mLogToChatWindow;
+        unsigned int mMainThread;   /**< Thread allowed to use the GUI */
+        SDL_mutex *mMutex;          /**< Guards the log outputs */
 };
 
 extern Logger *logger;
@@ -20,10 +20,11 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <queue>
+#include <algorithm>
 
 #include "ambientlayer.h"
 #include "map.h"
+#include "pathfinder.h"
 #include "tileset.h"
 
 #include "sprite/sprite.h"
@@ -48,28 +49,9 @@
 extern volatile int tick_time;
 
 /**
- * A location on a tile map. Used for pathfinding, open list.
+ * The size in pixels of the chunks static layers are prerendered in.
  */
-struct Location
-{
-    /**
-     * Constructor.
-     */
-    Location(int px, int py, MetaTile *ptile):
-        x(px), y(py), tile(ptile)
-    {}
-
-    /**
-     * Comparison operator.
-     */
-    bool operator< (const Location &loc) const
-    {
-        return tile->Fcost > loc.tile->Fcost;
-    }
-
-    int x, y;
-    MetaTile *tile;
-};
+static const int CHUNK_SIZE = 256;
 
 TileAnimation::TileAnimation(Animation *ani):
     mLastImage(NULL)
@@ -103,6 +85,12 @@ void TileAnimation::update(const int ticks)
     }
 }
 
+void TileAnimation::addAffectedTile(MapLayer *layer, const int index)
+{
+    mAffected.push_back(std::make_pair(layer, index));
+    layer->setAnimated(index);
+}
+
 MapLayer::MapLayer(const int x, const int y, const int width, const int height,
                    const int tileWidth, const int tileHeight,
                    const bool isFringeLayer, const bool isVisible):
@@ -110,18 +98,72 @@ MapLayer::MapLayer(const int x, const int y, const int width, const int height,
     mWidth(width), mHeight(height),
     mTileWidth(tileWidth), mTileHeight(tileHeight),
     mIsFringeLayer(isFringeLayer),
-    mIsVisible(isVisible)
+    mIsVisible(isVisible),
+    mMaxImageWidth(0), mMaxImageHeight(0),
+    mLooseTilesValid(true)
 {
     const int size = mWidth * mHeight;
     mTiles = new Image*[size];
     std::fill_n(mTiles, size, (Image*) 0);
+    mAnimated.resize(size, false);
+    mLoose.resize(size, false);
+
+    mChunkTilesX = std::max(1, CHUNK_SIZE / std::max(1, mTileWidth));
+    mChunkTilesY = std::max(1, CHUNK_SIZE / std::max(1, mTileHeight));
+    mChunksX = (mWidth + mChunkTilesX - 1) / mChunkTilesX;
+    mChunksY = (mHeight + mChunkTilesY - 1) / mChunkTilesY;
+    mChunks.resize(mChunksX * mChunksY, (Image*) 0);
+    mChunkBuilt.resize(mChunksX * mChunksY, false);
 }
 
 MapLayer::~MapLayer()
 {
+    clearChunks();
     delete[] mTiles;
 }
 
+void MapLayer::setTile(const int index, Image *img)
+{
+    Image *old = mTiles[index];
+    if (old == img)
+        return;
+
+    mTiles[index] = img;
+
+    // Animated tiles aren't part of the chunks, so there is nothing to
+    // rebuild when they change frame
+    if (mAnimated[index])
+        return;
+
+    // The static tile may now cover an animated one, or no longer do so
+    if (!mAnimatedTiles.empty())
+        mLooseTilesValid = false;
+
+    if (img && (img->getWidth() > mMaxImageWidth ||
+                img->getHeight() > mMaxImageHeight))
+    {
+        // Every chunk may now need tiles from further away
+        mMaxImageWidth = std::max(mMaxImageWidth, img->getWidth());
+        mMaxImageHeight = std::max(mMaxImageHeight, img->getHeight());
+        clearChunks();
+        return;
+    }
+
+    invalidateChunks(index, old);
+    invalidateChunks(index, img);
+}
+
+void MapLayer::setAnimated(const int index)
+{
+    if (mAnimated[index])
+        return;
+
+    invalidateChunks(index, mTiles[index]);
+    mAnimated[index] = true;
+    mAnimatedTiles.push_back(index);
+    mLooseTilesValid = false;
+}
+
 void MapLayer::setTile(const int x, const int y, Image *img)
 {
     setTile(x + y * mWidth, img);
@@ -134,7 +176,7 @@ Image* MapLayer::getTile(const int x, const int y) const
 
 void MapLayer::draw(Graphics *graphics, int startX, int startY,
                     int endX, int endY, int scrollX, int scrollY,
-                    const Sprites &sprites) const
+                    const VisibleSprites &sprites) const
 {
     startX -= mX;
     startY -= mY;
@@ -146,7 +188,14 @@ void MapLayer::draw(Graphics *graphics, int startX, int startY,
     if (endX > mWidth) endX = mWidth;
     if (endY > mHeight) endY = mHeight;
 
-    Sprites::const_iterator si = sprites.begin();
+    if (!mIsFringeLayer && !Image::usesOpenGL())
+    {
+        if (mIsVisible)
+            drawChunks(graphics, startX, startY, endX, endY, scrollX, scrollY);
+        return;
+    }
+
+    VisibleSprites::const_iterator si = sprites.begin();
 
     graphics->pushClipArea(gcn::Rectangle(0, 0, graphics->getWidth(),
                                           graphics->getHeight()));
@@ -161,9 +210,9 @@ void MapLayer::draw(Graphics *graphics, int startX, int startY,
         if (mIsFringeLayer)
         {
             while (si != sprites.end() &&
-                  (*si)->getPixelY() <= y * mTileHeight - mTileHeight)
+                   si->pixelY <= y * mTileHeight - mTileHeight)
             {
-                (*si)->draw(graphics, -scrollX, -scrollY);
+                (*si->sprite)->draw(graphics, -scrollX, -scrollY);
                 si++;
             }
         }
@@ -189,7 +238,7 @@ void MapLayer::draw(Graphics *graphics, int startX, int startY,
             if (-scrollX >= 0 && -scrollX <= graphics->getWidth() &&
                 -scrollY >= 0 && -scrollY <= graphics->getHeight())
             {
-                (*si)->draw(graphics, -scrollX, -scrollY);
+                (*si->sprite)->draw(graphics, -scrollX, -scrollY);
             }
             si++;
         }
@@ -198,23 +247,292 @@ void MapLayer::draw(Graphics *graphics, int startX, int startY,
     graphics->popClipArea();
 }
 
+void MapLayer::drawChunks(Graphics *graphics, int startX, int startY,
+                          int endX, int endY, int scrollX, int scrollY) const
+{
+    const int chunkWidth = mChunkTilesX * mTileWidth;
+    const int chunkHeight = mChunkTilesY * mTileHeight;
+
+    // Screen area in pixels relative to the origin of this layer
+    const int left = scrollX - mX * mTileWidth;
+    const int top = scrollY - mY * mTileHeight;
+    const int right = left + graphics->getWidth();
+    const int bottom = top + graphics->getHeight();
+
+    const int firstX = std::max(0, left / chunkWidth);
+    const int firstY = std::max(0, top / chunkHeight);
+    const int lastX = std::min(mChunksX - 1, (right - 1) / chunkWidth);
+    const int lastY = std::min(mChunksY - 1, (bottom - 1) / chunkHeight);
+
+    if (!mLooseTilesValid)
+        updateLooseTiles();
+
+    graphics->pushClipArea(gcn::Rectangle(0, 0, graphics->getWidth(),
+                                          graphics->getHeight()));
+
+    for (int cy = firstY; cy <= lastY; cy++)
+    {
+        for (int cx = firstX; cx <= lastX; cx++)
+        {
+            Image *chunk = getChunk(cx, cy);
+            if (chunk)
+                graphics->drawImage(chunk, cx * chunkWidth - left,
+                                           cy * chunkHeight - top);
+        }
+    }
+
+    for (std::vector<int>::const_iterator i = mLooseTiles.begin();
+         i != mLooseTiles.end(); ++i)
+    {
+        const int x = *i % mWidth;
+        const int y = *i / mWidth;
+        Image *img = mTiles[*i];
+
+        if (!img || x < startX || x >= endX || y < startY || y >= endY)
+            continue;
+
+        const int px = (x + mX) * mTileWidth - scrollX;
+        const int py = (y + mY) * mTileHeight - scrollY + mTileHeight -
+                       img->getHeight();
+        graphics->drawImage(img, px, py);
+    }
+
+    graphics->popClipArea();
+
+    // Let go of the chunks which have scrolled well out of view
+    std::vector<int>::iterator i = mBuiltChunks.begin();
+    while (i != mBuiltChunks.end())
+    {
+        const int cx = *i % mChunksX;
+        const int cy = *i / mChunksX;
+
+        if (cx < firstX - 1 || cx > lastX + 1 ||
+            cy < firstY - 1 || cy > lastY + 1)
+        {
+            destroy(mChunks[*i]);
+            mChunkBuilt[*i] = false;
+            i = mBuiltChunks.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+Image *MapLayer::getChunk(const int chunkX, const int chunkY) const
+{
+    const int index = chunkX + chunkY * mChunksX;
+
+    if (!mChunkBuilt[index])
+    {
+        mChunks[index] = buildChunk(chunkX, chunkY);
+        mChunkBuilt[index] = true;
+        mBuiltChunks.push_back(index);
+    }
+
+    return mChunks[index];
+}
+
+Image *MapLayer::buildChunk(const int chunkX, const int chunkY) const
+{
+    const int chunkWidth = mChunkTilesX * mTileWidth;
+    const int chunkHeight = mChunkTilesY * mTileHeight;
+    const int left = chunkX * chunkWidth;
+    const int top = chunkY * chunkHeight;
+
+    // Tiles to the left may be wider than a tile, and tiles below may be
+    // higher than one, so they can reach into this chunk as well
+    const int startX = std::max(0, chunkX * mChunkTilesX -
+                                   std::max(0, mMaxImageWidth - 1) /
+                                   mTileWidth);
+    const int startY = std::max(0, chunkY * mChunkTilesY);
+    const int endX = std::min(mWidth, (chunkX + 1) * mChunkTilesX);
+    const int endY = std::min(mHeight, (chunkY + 1) * mChunkTilesY +
+                                       std::max(0, mMaxImageHeight - 1) /
+                                       mTileHeight);
+
+    SDL_Surface *surface = NULL;
+
+    for (int y = startY; y < endY; y++)
+    {
+        for (int x = startX; x < endX; x++)
+        {
+            const int index = x + y * mWidth;
+            const Image *img = mTiles[index];
+
+            if (!img || mLoose[index])
+                continue;
+
+            const int px = x * mTileWidth - left;
+            const int py = (y + 1) * mTileHeight - img->getHeight() - top;
+
+            if (px >= chunkWidth || py >= chunkHeight ||
+                px + img->getWidth() <= 0 || py + img->getHeight() <= 0)
+                continue;
+
+            if (!surface)
+            {
+                // Determine 32-bit masks based on byte order
+                Uint32 rmask, gmask, bmask, amask;
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+                rmask = 0xff000000;
+                gmask = 0x00ff0000;
+                bmask = 0x0000ff00;
+                amask = 0x000000ff;
+#else
+                rmask = 0x000000ff;
+                gmask = 0x0000ff00;
+                bmask = 0x00ff0000;
+                amask = 0xff000000;
+#endif
+
+                surface = SDL_CreateRGBSurface(SDL_SWSURFACE, chunkWidth,
+                                               chunkHeight, 32, rmask, gmask,
+                                               bmask, amask);
+                if (!surface)
+                {
+                    logger->log("Error: Could not create map chunk: %s",
+                                SDL_GetError());
+                    return NULL;
+                }
+                SDL_FillRect(surface, NULL, 0);
+            }
+
+            img->compositeTo(surface, px, py);
+        }
+    }
+
+    if (!surface)
+        return NULL;
+
+    Image *chunk = Image::load(surface);
+    SDL_FreeSurface(surface);
+    return chunk;
+}
+
+void MapLayer::invalidateChunks(const int index, const Image *img)
+{
+    if (!img || mBuiltChunks.empty())
+        return;
+
+    const int chunkWidth = mChunkTilesX * mTileWidth;
+    const int chunkHeight = mChunkTilesY * mTileHeight;
+
+    const int left = (index % mWidth) * mTileWidth;
+    const int bottom = (index / mWidth + 1) * mTileHeight;
+    const int top = std::max(0, bottom - img->getHeight());
+
+    const int firstX = left / chunkWidth;
+    const int firstY = top / chunkHeight;
+    const int lastX = std::min(mChunksX - 1,
+                               (left + img->getWidth() - 1) / chunkWidth);
+    const int lastY = std::min(mChunksY - 1, (bottom - 1) / chunkHeight);
+
+    for (int cy = firstY; cy <= lastY; cy++)
+    {
+        for (int cx = firstX; cx <= lastX; cx++)
+        {
+            const int chunk = cx + cy * mChunksX;
+            if (!mChunkBuilt[chunk])
+                continue;
+
+            destroy(mChunks[chunk]);
+            mChunkBuilt[chunk] = false;
+            mBuiltChunks.erase(std::find(mBuiltChunks.begin(),
+                                         mBuiltChunks.end(), chunk));
+        }
+    }
+}
+
+void MapLayer::clearChunks() const
+{
+    for (std::vector<int>::const_iterator i = mBuiltChunks.begin();
+         i != mBuiltChunks.end(); ++i)
+    {
+        destroy(mChunks[*i]);
+        mChunkBuilt[*i] = false;
+    }
+    mBuiltChunks.clear();
+}
+
+void MapLayer::updateLooseTiles() const
+{
+    std::vector<bool> loose(mAnimated);
+    std::vector<int> looseTiles;
+
+    // Tiles reach up from the bottom of their cell and to the right, so only
+    // the tiles drawn later, to the right or in the rows below, can cover a
+    // tile. Those are marked loose in turn, before they are reached.
+    const int reachX = std::max(0, mMaxImageWidth - 1) / mTileWidth;
+    const int reachY = std::max(0, mMaxImageHeight - 1) / mTileHeight;
+
+    for (int index = 0; index < mWidth * mHeight; index++)
+    {
+        if (!loose[index])
+            continue;
+
+        looseTiles.push_back(index);
+
+        const Image *img = mTiles[index];
+        const int x = index % mWidth;
+        const int y = index / mWidth;
+        const int left = x * mTileWidth;
+        const int right = left + (img ? img->getWidth() : mTileWidth);
+        const int bottom = (y + 1) * mTileHeight;
+        const int top = bottom - (img ? img->getHeight() : mTileHeight);
+
+        const int lastX = std::min(mWidth - 1, (right - 1) / mTileWidth);
+        const int lastY = std::min(mHeight - 1, y + reachY);
+
+        for (int ty = y; ty <= lastY; ty++)
+        {
+            for (int tx = std::max(0, x - reachX); tx <= lastX; tx++)
+            {
+                const int other = tx + ty * mWidth;
+                const Image *otherImg = mTiles[other];
+
+                if (other <= index || loose[other] || !otherImg)
+                    continue;
+
+                const int otherLeft = tx * mTileWidth;
+                const int otherBottom = (ty + 1) * mTileHeight;
+
+                if (otherLeft < right &&
+                    otherLeft + otherImg->getWidth() > left &&
+                    otherBottom > top &&
+                    otherBottom - otherImg->getHeight() < bottom)
+                {
+                    loose[other] = true;
+                }
+            }
+        }
+    }
+
+    if (loose != mLoose)
+    {
+        mLoose.swap(loose);
+        clearChunks();
+    }
+
+    mLooseTiles.swap(looseTiles);
+    mLooseTilesValid = true;
+}
+
 Map::Map(const int width, const int height, const int tileWidth,
          const int tileHeight):
     mWidth(width), mHeight(height),
     mTileWidth(tileWidth), mTileHeight(tileHeight),
     mMaxTileHeight(height),
-    mOnClosedList(1), mOnOpenList(2),
     mLastScrollX(0.0f), mLastScrollY(0.0f)
 {
-    const int size = mWidth * mHeight;
-
-    mMetaTiles = new MetaTile[size];
+    mPathFinder = new PathFinder(mWidth, mHeight);
 }
 
 Map::~Map()
 {
     // delete metadata, layers, tilesets and overlays
-    delete[] mMetaTiles;
+    destroy(mPathFinder);
     delete_all(mLayers);
     delete_all(mTilesets);
     delete_all(mForegrounds);
@@ -284,9 +602,10 @@ void Map::addTileset(Tileset *tileset)
         mMaxTileHeight = tileset->getHeight();
 }
 
-bool spriteCompare(const Sprite *a, const Sprite *b)
+static bool visibleSpriteCompare(const VisibleSprite &a,
+                                 const VisibleSprite &b)
 {
-    return a->getPixelY() < b->getPixelY();
+    return a.pixelY < b.pixelY;
 }
 
 void Map::update(const int ticks)
@@ -310,9 +629,10 @@ void Map::draw(Graphics *graphics, int scrollX, int scrollY)
     int endX = (graphics->getWidth() + scrollX + mTileWidth - 1) / mTileWidth;
     int endY = endPixelY / mTileHeight;
 
-    // Make sure sprites are sorted ascending by Y-coordinate so that they
-    // overlap correctly
-    mSprites.sort(spriteCompare);
+    // Make sure the sprites on screen are sorted ascending by Y-coordinate so
+    // that they overlap correctly
+    updateVisibleSprites(scrollX, scrollY, scrollX + graphics->getWidth(),
+                         scrollY + graphics->getHeight());
 
     // update scrolling of all ambient layers
     updateAmbientLayers(scrollX, scrollY);
@@ -326,13 +646,73 @@ void Map::draw(Graphics *graphics, int scrollX, int scrollY)
     for (; layeri != mLayers.end(); ++layeri)
     {
         (*layeri)->draw(graphics, startX, startY, endX, endY, scrollX, scrollY,
-                        mSprites);
+                        mVisibleSprites);
     }
 
     drawAmbientLayers(graphics, FOREGROUND_LAYERS, scrollX, scrollY,
                      (int) config.getValue("OverlayDetail", 2));
 }
 
+void Map::updateVisibleSprites(const int left, const int top,
+                               const int right, const int bottom)
+{
+    mVisibleSprites.clear();
+
+    // Count the sprites that are out of order to choose the way of sorting
+    int unsorted = 0;
+
+    for (SpriteIterator i = mSprites.begin(); i != mSprites.end(); ++i)
+    {
+        if (!(*i)->isInArea(left, top, right, bottom))
+            continue;
+
+        VisibleSprite visible;
+        visible.pixelY = (*i)->getPixelY();
+        visible.sprite = i;
+
+        if (!mVisibleSprites.empty() &&
+            mVisibleSprites.back().pixelY > visible.pixelY)
+        {
+            unsorted++;
+        }
+
+        mVisibleSprites.push_back(visible);
+    }
+
+    // The sprites are kept in the order of the last frame, so usually only
+    // a few of them moved or were added. Insertion sort handles that in
+    // close to linear time, but not many sprites in random order.
+    if (unsorted > 16 + (int) mVisibleSprites.size() / 8)
+    {
+        std::stable_sort(mVisibleSprites.begin(), mVisibleSprites.end(),
+                         visibleSpriteCompare);
+    }
+    else
+    {
+        for (unsigned int i = 1; i < mVisibleSprites.size(); i++)
+        {
+            const VisibleSprite visible = mVisibleSprites[i];
+            unsigned int j = i;
+
+            while (j > 0 && mVisibleSprites[j - 1].pixelY > visible.pixelY)
+            {
+                mVisibleSprites[j] = mVisibleSprites[j - 1];
+                j--;
+            }
+
+            mVisibleSprites[j] = visible;
+        }
+    }
+
+    // Move the visible sprites to the end of the list in their sorted order,
+    // which keeps them in order for the next frame
+    for (VisibleSprites::iterator i = mVisibleSprites.begin();
+         i != mVisibleSprites.end(); ++i)
+    {
+        mSprites.splice(mSprites.end(), mSprites, i->sprite);
+    }
+}
+
 void Map::updateAmbientLayers(const float scrollX, const float scrollY)
 {
     static int lastTick = tick_time; // static = only initialized at first call
@@ -412,35 +792,22 @@ Tileset* Map::getTilesetWithGid(const int gid) const
 
 void Map::setWalk(const int x, const int y, const bool walkable)
 {
-    mMetaTiles[x + y * mWidth].walkable = walkable;
-}
- 
-bool Map::occupied(const int x, const int y) const
-{
-    const Beings &beings = beingManager->getAll();
-    for (Beings::const_iterator i = beings.begin(); i != beings.end(); i++)
-    {
-        // job 45 is a portal, they don't collide
-        if ((*i)->mX == x && (*i)->mY == y && (*i)->mJob != 45)
-            return true;
-    }
-
-    return false;
+    mPathFinder->setWalk(x, y, walkable);
 }
 
-bool Map::tileCollides(const int x, const int y) const
+void Map::initializePathFinding()
 {
-     return !(contains(x, y) && mMetaTiles[x + y * mWidth].walkable);
+    mPathFinder->buildHierarchy();
 }
-
-bool Map::contains(const int x, const int y) const
+ 
+bool Map::occupied(const int x, const int y) const
 {
-    return x >= 0 && y >= 0 && x < mWidth && y < mHeight;
+    return beingManager->isOccupied(x, y);
 }
 
-MetaTile* Map::getMetaTile(const int x, const int y)
+bool Map::tileCollides(const int x, const int y) const
 {
-    return &mMetaTiles[x + y * mWidth];
+     return !mPathFinder->isWalkable(x, y);
 }
 
 SpriteIterator Map::addSprite(Sprite *sprite)
@@ -449,6 +816,11 @@ SpriteIterator Map::addSprite(Sprite *sprite)
     return mSprites.begin();
 }
 
+void Map::addSprites(Sprites &sprites)
+{
+    mSprites.splice(mSprites.begin(), sprites);
+}
+
 void Map::removeSprite(SpriteIterator iterator)
 {
     mSprites.erase(iterator);
@@ -470,148 +842,7 @@ Path Map::findPath(const int startX, const int startY, const int destX,
     // Path to be built up (empty by default)
     Path path;
 
-    // Declare open list, a list with open tiles sorted on F cost
-    std::priority_queue<Location> openList;
-
-    // Reset starting tile's G cost to 0
-    MetaTile *startTile = getMetaTile(startX, startY);
-    startTile->Gcost = 0;
-
-    // Add the start point to the open list
-    openList.push(Location(startX, startY, startTile));
-
-    bool foundPath = false;
-
-    // Keep trying new open tiles until no more tiles to try or target found
-    while (!openList.empty() && !foundPath)
-    {
-        // Take the location with the lowest F cost from the open list.
-        Location curr = openList.top();
-        openList.pop();
-
-        // If the tile is already on the closed list, this means it has already
-        // been processed with a shorter path to the start point (lower G cost)
-        if (curr.tile->whichList == mOnClosedList)
-            continue;
-
-        // Put the current tile on the closed list
-        curr.tile->whichList = mOnClosedList;
-
-        // Check the adjacent tiles
-        for (int dy = -1; dy <= 1; dy++)
-        {
-            for (int dx = -1; dx <= 1; dx++)
-            {
-                // Calculate location of tile to check
-                const int x = curr.x + dx;
-                const int y = curr.y + dy;
-
-                // Skip if if we're checking the same tile we're leaving from,
-                // or if the new location falls outside of the map boundaries
-                if ((dx == 0 && dy == 0) || !contains(x, y))
-                {
-                    continue;
-                }
-
-                MetaTile *newTile = getMetaTile(x, y);
-
-                // Skip if the tile is on the closed list or collides unless
-                // its the destination tile
-                if (newTile->whichList == mOnClosedList ||
-                   (tileCollides(x, y) && !(x == destX && y == destY)))
-                {
-                    continue;
-                }
-
-                // When taking a diagonal step, verify that we can skip the
-                // corner. We allow skipping past beings but not past non-
-                // walkable tiles.
-                if (dx != 0 && dy != 0)
-                {
-                    MetaTile *t1 = getMetaTile(curr.x, curr.y + dy);
-                    MetaTile *t2 = getMetaTile(curr.x + dx, curr.y);
-
-                    if (!(t1->walkable && t2->walkable))
-                        continue;
-                }
-
-                // Calculate G cost for this route, 10 for moving straight and
-                // 14 for moving diagonal (sqrt(200) = 14.1421...)
-                int Gcost = curr.tile->Gcost + ((dx == 0 || dy == 0) ? 10 : 14);
-
-                // Skip if Gcost becomes too much
-                // Warning: probably not entirely accurate
-                if (Gcost > 200)
-                    continue;
-
-                if (newTile->whichList != mOnOpenList)
-                {
-                    // Found a new tile (not on open nor on closed list)
-                    // Update Hcost of the new tile using Manhatten distance
-                    newTile->Hcost = 10 * (abs(x - destX) + abs(y - destY));
-
-                    // Set the current tile as the parent of the new tile
-                    newTile->parentX = curr.x;
-                    newTile->parentY = curr.y;
-
-                    // Update Gcost and Fcost of new tile
-                    newTile->Gcost = Gcost;
-                    newTile->Fcost = Gcost + newTile->Hcost;
-
-                    if (x != destX || y != destY)
-                    {
-                        // Add this tile to the open list
-                        newTile->whichList = mOnOpenList;
-                        openList.push(Location(x, y, newTile));
-                    }
-                    else
-                    {
-                        // Target location was found
-                        foundPath = true;
-                    }
-                }
-                else if (Gcost < newTile->Gcost)
-                {
-                    // Found a shorter route.
-                    // Update Gcost and Fcost of the new tile
-                    newTile->Gcost = Gcost;
-                    newTile->Fcost = Gcost + newTile->Hcost;
-
-                    // Set the current tile as the parent of the new tile
-                    newTile->parentX = curr.x;
-                    newTile->parentY = curr.y;
-
-                    // Add this tile to the open list (it's already
-                    // there, but this instance has a lower F score)
-                    openList.push(Location(x, y, newTile));
-                }
-            }
-        }
-    }
-
-    // Two new values to indicate whether a tile is on the open or closed list,
-    // this way we don't have to clear all the values between each pathfinding.
-    mOnClosedList += 2;
-    mOnOpenList += 2;
-
-    // If a path has been found, iterate backwards using the parent locations
-    // to extract it.
-    if (foundPath)
-    {
-        int pathX = destX;
-        int pathY = destY;
-
-        while (pathX != startX || pathY != startY)
-        {
-            // Add the new path node to the start of the path list
-            path.push_front(Position(pathX, pathY));
-
-            // Find out the next parent
-            MetaTile *tile = getMetaTile(pathX, pathY);
-            pathX = tile->parentX;
-            pathY = tile->parentY;
-        }
-    }
+    mPathFinder->findPath(startX, startY, destX, destY, path);
 
     return path;
 }
@@ -37,6 +37,7 @@ class Graphics;
 class Image;
 class MapLayer;
 class Particle;
+class PathFinder;
 class SimpleAnimation;
 class Sprite;
 class Tileset;
@@ -44,30 +45,19 @@ class Tileset;
 typedef std::vector<Tileset*> Tilesets;
 typedef std::list<Sprite*> Sprites;
 typedef Sprites::iterator SpriteIterator;
-typedef std::vector<MapLayer*> Layers;
 
 /**
- * A meta tile stores additional information about a location on a tile map.
- * This is information that doesn't need to be repeated for each tile in each
- * layer of the map.
+ * A sprite on screen, with the pixel Y coordinate it is drawn in order of.
  */
-struct MetaTile
+struct VisibleSprite
 {
-    /**
-     * Constructor.
-     */
-    MetaTile():whichList(0) {};
-
-    // Pathfinding members
-    int Fcost;               /**< Estimation of total path cost */
-    int Gcost;               /**< Cost from start to this location */
-    int Hcost;               /**< Estimated cost to goal */
-    int whichList;           /**< No list, open list or closed list */
-    int parentX;             /**< X coordinate of parent tile */
-    int parentY;             /**< Y coordinate of parent tile */
-    bool walkable;           /**< Can beings walk on this tile */
+    int pixelY;
+    SpriteIterator sprite;
 };
 
+typedef std::vector<VisibleSprite> VisibleSprites;
+typedef std::vector<MapLayer*> Layers;
+
 /**
  * Animation cycle of a tile image which changes the map accordingly.
  */
@@ -77,8 +67,7 @@ class TileAnimation
         TileAnimation(Animation *ani);
         ~TileAnimation();
         void update(const int ticks = 1);
-        void addAffectedTile(MapLayer *layer, const int index)
-        { mAffected.push_back(std::make_pair(layer, index)); }
+        void addAffectedTile(MapLayer *layer, const int index);
     private:
         std::list<std::pair<MapLayer*, int> > mAffected;
         SimpleAnimation *mAnimation;
@@ -88,6 +77,10 @@ class TileAnimation
 /**
  * A map layer. Stores a grid of tiles and their offset, and implements layer
  * rendering.
+ *
+ * In SDL mode, layers other than the fringe layer are drawn from chunks of
+ * tiles composited into a single image each, built when they come into view.
+ * Animated tiles are left out of the chunks and drawn separately on top.
  */
 class MapLayer
 {
@@ -114,7 +107,13 @@ class MapLayer
         /**
          * Set tile image with x + y * width already known.
          */
-        void setTile(const int index, Image *img) { mTiles[index] = img; }
+        void setTile(const int index, Image *img);
+
+        /**
+         * Marks the tile with x + y * width as changing regularly, so that it
+         * isn't included in the prerendered chunks.
+         */
+        void setAnimated(const int index);
 
         /**
          * Get tile image, with x and y in layer coordinates.
@@ -127,19 +126,74 @@ class MapLayer
          * coordinates and clipped to the layer's dimensions.
          *
          * The given sprites are only drawn when this layer is the fringe
-         * layer.
+         * layer. They need to be sorted by their pixel Y coordinate.
          */
         void draw(Graphics *graphics, int startX, int startY,
                   int endX, int endY, int scrollX, int scrollY,
-                  const Sprites &sprites) const;
+                  const VisibleSprites &sprites) const;
 
     private:
+        /**
+         * Draws the visible chunks and the loose tiles on top of them, with
+         * the tile range already in layer coordinates.
+         */
+        void drawChunks(Graphics *graphics, int startX, int startY,
+                        int endX, int endY, int scrollX, int scrollY) const;
+
+        /**
+         * Returns the image of the given chunk, building it when needed.
+         * Returns NULL for chunks without static tiles.
+         */
+        Image *getChunk(const int chunkX, const int chunkY) const;
+
+        /**
+         * Composites the static tiles that are drawn within a chunk.
+         */
+        Image *buildChunk(const int chunkX, const int chunkY) const;
+
+        /**
+         * Throws away the chunks the given tile image is drawn in.
+         */
+        void invalidateChunks(const int index, const Image *img);
+
+        /**
+         * Throws away all chunks.
+         */
+        void clearChunks() const;
+
+        /**
+         * Determines the loose tiles: the animated tiles, and the static
+         * tiles drawn after them which overlap them. Throws away the chunks
+         * when they change.
+         */
+        void updateLooseTiles() const;
+
         int mX, mY;
         int mWidth, mHeight;
         int mTileWidth, mTileHeight;
         bool mIsFringeLayer;    /**< Whether the sprites are drawn. */
         bool mIsVisible;
         Image **mTiles;
+
+        std::vector<bool> mAnimated;        /**< Per tile */
+        std::vector<int> mAnimatedTiles;    /**< Indexes of animated tiles */
+        int mMaxImageWidth, mMaxImageHeight;
+
+        int mChunkTilesX, mChunkTilesY;     /**< Size of a chunk in tiles */
+        int mChunksX, mChunksY;             /**< Number of chunks */
+        mutable std::vector<Image*> mChunks;
+        mutable std::vector<bool> mChunkBuilt;
+        mutable std::vector<int> mBuiltChunks;
+
+        /**
+         * Tiles left out of the chunks and drawn one by one on top of them,
+         * in the order of the tiles. Static tiles which are drawn after an
+         * animated tile and overlap it, like tall tiles in the rows below,
+         * are among them, so that they still cover it.
+         */
+        mutable std::vector<bool> mLoose;       /**< Per tile */
+        mutable std::vector<int> mLooseTiles;   /**< Indexes, in order */
+        mutable bool mLooseTilesValid;
 };
 
 /**
@@ -192,14 +246,16 @@ class Map : public Properties
         Tileset *getTilesetWithGid(const int gid) const;
 
         /**
-         * Get tile reference.
+         * Set walkability flag for a tile.
          */
-        MetaTile *getMetaTile(const int x, const int y);
+        void setWalk(const int x, const int y, const bool walkable);
 
         /**
-         * Set walkability flag for a tile.
+         * Precomputes the data used to find long paths on this map. Should
+         * be called once the collision layer has been loaded. Later changes
+         * to walkability are picked up incrementally.
          */
-        void setWalk(const int x, const int y, const bool walkable);
+        void initializePathFinding();
 
         /**
          * Tell if a tile collides, not including a check on beings.
@@ -230,16 +286,28 @@ class Map : public Properties
         const std::string getName() const;
 
         /**
-         * Find a path from one location to the next.
+         * Find a path from one location to the next. Paths across the whole
+         * map can be found once initializePathFinding() has been called.
          */
         Path findPath(const int startX, const int startY, const int destX,
                       const int destY);
 
+        /**
+         * Returns the path finder used by this map.
+         */
+        const PathFinder *getPathFinder() const { return mPathFinder; }
+
         /**
          * Adds a sprite to the map.
          */
         SpriteIterator addSprite(Sprite *sprite);
 
+        /**
+         * Moves the given sprites to the map. Iterators to them stay valid
+         * and can be used to remove them later on.
+         */
+        void addSprites(Sprites &sprites);
+
         /**
          * Removes a sprite from the map.
          */
@@ -292,20 +360,20 @@ class Map : public Properties
         bool occupied(const int x, const int y) const;
 
         /**
-         * Tells whether the given coordinates fall within the map boundaries.
+         * Collects the sprites inside the given area of the map in pixels,
+         * sorted by their pixel Y coordinate.
          */
-        bool contains(const int x, const int y) const;
+        void updateVisibleSprites(const int left, const int top,
+                                  const int right, const int bottom);
 
         int mWidth, mHeight;
         int mTileWidth, mTileHeight;
         int mMaxTileHeight;
-        MetaTile *mMetaTiles;
+        PathFinder *mPathFinder;
         Layers mLayers;
         Tilesets mTilesets;
-        Sprites mSprites;
-
-        // Pathfinding members
-        int mOnClosedList, mOnOpenList;
+        Sprites mSprites;           /**< In the order of the last frame */
+        VisibleSprites mVisibleSprites;
 
         // Overlay data
         std::list<AmbientLayer*> mBackgrounds;
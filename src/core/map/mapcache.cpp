@@ -0,0 +1,414 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "mapcache.h"
+
+#include "../log.h"
+#include "../resourcemanager.h"
+
+#include "../utils/mappedfile.h"
+
+namespace
+{
+    /** Identifies the file type and version of the format */
+    const char CACHE_MAGIC[] = { 'A', 'E', 'M', 'A', 'P', 0, 0, 2 };
+    const unsigned int MAGIC_LENGTH = sizeof(CACHE_MAGIC);
+
+    const std::string CACHE_DIR = "cache/maps";
+
+    /**
+     * Serializes map data. All numbers are stored as 32 bit little endian
+     * integers.
+     */
+    class CacheWriter
+    {
+        public:
+            void writeInt(int value)
+            {
+                mData.push_back(value & 0xff);
+                mData.push_back((value >> 8) & 0xff);
+                mData.push_back((value >> 16) & 0xff);
+                mData.push_back((value >> 24) & 0xff);
+            }
+
+            void writeString(const std::string &value)
+            {
+                writeInt(value.length());
+                mData.insert(mData.end(), value.begin(), value.end());
+            }
+
+            void writeBits(const std::vector<bool> &bits)
+            {
+                for (unsigned int i = 0; i < bits.size(); i += 8)
+                {
+                    unsigned char byte = 0;
+                    for (unsigned int j = i; j < bits.size() && j < i + 8; j++)
+                    {
+                        if (bits[j])
+                            byte |= 1 << (j - i);
+                    }
+                    mData.push_back(byte);
+                }
+            }
+
+            void writeRaw(const char *data, unsigned int length)
+            {
+                mData.insert(mData.end(), data, data + length);
+            }
+
+            const std::vector<unsigned char> &getData() const
+            { return mData; }
+
+        private:
+            std::vector<unsigned char> mData;
+    };
+
+    /**
+     * Deserializes map data written by the CacheWriter, checking that it
+     * doesn't read beyond the end of the data.
+     */
+    class CacheReader
+    {
+        public:
+            CacheReader(const unsigned char *data, unsigned int size):
+                mPos(data), mEnd(data + size), mFailed(false)
+            {}
+
+            int readInt()
+            {
+                if (!require(4))
+                    return 0;
+
+                const int value = mPos[0] | mPos[1] << 8 | mPos[2] << 16 |
+                                  mPos[3] << 24;
+                mPos += 4;
+                return value;
+            }
+
+            /**
+             * Reads the number of elements of a list, which is checked
+             * against the remaining data given the minimal size of each.
+             */
+            unsigned int readCount(unsigned int elementSize)
+            {
+                const unsigned int count = readInt();
+
+                if (elementSize && count > getRemaining() / elementSize)
+                {
+                    mFailed = true;
+                    return 0;
+                }
+
+                return count;
+            }
+
+            std::string readString()
+            {
+                const unsigned int length = readCount(1);
+                const char *start = (const char*) mPos;
+                mPos += length;
+                return std::string(start, length);
+            }
+
+            void readBits(unsigned int count, std::vector<bool> &bits)
+            {
+                const unsigned int length = count / 8 + (count % 8 ? 1 : 0);
+
+                if (!require(length))
+                    return;
+
+                bits.resize(count);
+                for (unsigned int i = 0; i < count; i++)
+                    bits[i] = mPos[i / 8] & (1 << (i % 8));
+
+                mPos += length;
+            }
+
+            bool readRaw(const char *data, unsigned int length)
+            {
+                if (!require(length) || memcmp(mPos, data, length))
+                    return false;
+
+                mPos += length;
+                return true;
+            }
+
+            bool isComplete() const { return !mFailed && mPos == mEnd; }
+
+            bool hasFailed() const { return mFailed; }
+
+        private:
+            unsigned int getRemaining() const { return mEnd - mPos; }
+
+            bool require(unsigned int length)
+            {
+                if (getRemaining() < length)
+                    mFailed = true;
+
+                return !mFailed;
+            }
+
+            const unsigned char *mPos;
+            const unsigned char *mEnd;
+            bool mFailed;
+    };
+}
+
+bool MapCache::read(const std::string &filename, unsigned long checksum,
+                    MapData &result)
+{
+    // Read into a separate description, so that a damaged cache doesn't
+    // leave the caller with partial data
+    MapData data;
+    MappedFile file;
+
+    if (!file.open(getCachePath(filename)))
+        return false;
+
+    CacheReader in(file.getData(), file.getSize());
+
+    if (!in.readRaw(CACHE_MAGIC, MAGIC_LENGTH) ||
+        (unsigned int) in.readInt() != (unsigned int) checksum)
+        return false;
+
+    data.width = in.readInt();
+    data.height = in.readInt();
+    data.tileWidth = in.readInt();
+    data.tileHeight = in.readInt();
+
+    data.properties.resize(in.readCount(8));
+    for (unsigned int i = 0; i < data.properties.size(); i++)
+    {
+        data.properties[i].first = in.readString();
+        data.properties[i].second = in.readString();
+    }
+
+    data.tilesets.resize(in.readCount(20));
+    for (unsigned int i = 0; i < data.tilesets.size(); i++)
+    {
+        MapData::TilesetData &tileset = data.tilesets[i];
+        tileset.firstGid = in.readInt();
+        tileset.image = in.readString();
+        tileset.tileWidth = in.readInt();
+        tileset.tileHeight = in.readInt();
+
+        tileset.animations.resize(in.readCount(8));
+        for (unsigned int j = 0; j < tileset.animations.size(); j++)
+        {
+            MapData::AnimationData &animation = tileset.animations[j];
+            animation.gid = in.readInt();
+
+            animation.frames.resize(in.readCount(8));
+            for (unsigned int k = 0; k < animation.frames.size(); k++)
+            {
+                animation.frames[k].first = in.readInt();
+                animation.frames[k].second = in.readInt();
+            }
+        }
+    }
+
+    data.layers.resize(in.readCount(28));
+    for (unsigned int i = 0; i < data.layers.size() && !in.hasFailed(); i++)
+    {
+        MapData::LayerData &layer = data.layers[i];
+        const int flags = in.readInt();
+        layer.fringe = flags & 1;
+        layer.visible = flags & 2;
+        layer.collision = flags & 4;
+        layer.x = in.readInt();
+        layer.y = in.readInt();
+        layer.width = in.readInt();
+        layer.height = in.readInt();
+        layer.tileWidth = in.readInt();
+        layer.tileHeight = in.readInt();
+
+        if (layer.width < 0 || layer.height < 0)
+            return false;
+
+        // Multiply as unsigned once the product is known to fit, readBits()
+        // then checks it against the remaining data
+        const unsigned int width = layer.width;
+        const unsigned int height = layer.height;
+
+        if (height && width > UINT_MAX / height)
+            return false;
+
+        const unsigned int size = width * height;
+
+        if (layer.collision)
+            in.readBits(size, layer.walkable);
+        else
+        {
+            layer.tiles.resize(in.readCount(4));
+            for (unsigned int j = 0; j < layer.tiles.size(); j++)
+                layer.tiles[j] = in.readInt();
+        }
+    }
+
+    data.particles.resize(in.readCount(12));
+    for (unsigned int i = 0; i < data.particles.size(); i++)
+    {
+        data.particles[i].file = in.readString();
+        data.particles[i].x = in.readInt();
+        data.particles[i].y = in.readInt();
+    }
+
+    data.warps.resize(in.readCount(4));
+    for (unsigned int i = 0; i < data.warps.size(); i++)
+        data.warps[i] = in.readString();
+
+    if (!in.isComplete())
+    {
+        logger->log("Warning: ignoring damaged map cache of %s",
+                    filename.c_str());
+        return false;
+    }
+
+    result.swap(data);
+    return true;
+}
+
+void MapCache::write(const std::string &filename, unsigned long checksum,
+                     const MapData &data)
+{
+    CacheWriter out;
+
+    out.writeRaw(CACHE_MAGIC, MAGIC_LENGTH);
+    out.writeInt(checksum);
+
+    out.writeInt(data.width);
+    out.writeInt(data.height);
+    out.writeInt(data.tileWidth);
+    out.writeInt(data.tileHeight);
+
+    out.writeInt(data.properties.size());
+    for (unsigned int i = 0; i < data.properties.size(); i++)
+    {
+        out.writeString(data.properties[i].first);
+        out.writeString(data.properties[i].second);
+    }
+
+    out.writeInt(data.tilesets.size());
+    for (unsigned int i = 0; i < data.tilesets.size(); i++)
+    {
+        const MapData::TilesetData &tileset = data.tilesets[i];
+        out.writeInt(tileset.firstGid);
+        out.writeString(tileset.image);
+        out.writeInt(tileset.tileWidth);
+        out.writeInt(tileset.tileHeight);
+
+        out.writeInt(tileset.animations.size());
+        for (unsigned int j = 0; j < tileset.animations.size(); j++)
+        {
+            const MapData::AnimationData &animation = tileset.animations[j];
+            out.writeInt(animation.gid);
+
+            out.writeInt(animation.frames.size());
+            for (unsigned int k = 0; k < animation.frames.size(); k++)
+            {
+                out.writeInt(animation.frames[k].first);
+                out.writeInt(animation.frames[k].second);
+            }
+        }
+    }
+
+    out.writeInt(data.layers.size());
+    for (unsigned int i = 0; i < data.layers.size(); i++)
+    {
+        const MapData::LayerData &layer = data.layers[i];
+        out.writeInt((layer.fringe ? 1 : 0) | (layer.visible ? 2 : 0) |
+                     (layer.collision ? 4 : 0));
+        out.writeInt(layer.x);
+        out.writeInt(layer.y);
+        out.writeInt(layer.width);
+        out.writeInt(layer.height);
+        out.writeInt(layer.tileWidth);
+        out.writeInt(layer.tileHeight);
+
+        if (layer.collision)
+            out.writeBits(layer.walkable);
+        else
+        {
+            out.writeInt(layer.tiles.size());
+            for (unsigned int j = 0; j < layer.tiles.size(); j++)
+                out.writeInt(layer.tiles[j]);
+        }
+    }
+
+    out.writeInt(data.particles.size());
+    for (unsigned int i = 0; i < data.particles.size(); i++)
+    {
+        out.writeString(data.particles[i].file);
+        out.writeInt(data.particles[i].x);
+        out.writeInt(data.particles[i].y);
+    }
+
+    out.writeInt(data.warps.size());
+    for (unsigned int i = 0; i < data.warps.size(); i++)
+        out.writeString(data.warps[i]);
+
+    ResourceManager::getInstance()->mkdir("/" + CACHE_DIR);
+
+    // Write to a temporary file first, so that there is never a partially
+    // written cache file
+    const std::string path = getCachePath(filename);
+    const std::string tempPath = path + ".tmp";
+    const std::vector<unsigned char> &buffer = out.getData();
+
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (!file)
+    {
+        logger->log("Warning: could not write map cache %s", path.c_str());
+        return;
+    }
+
+    bool written = fwrite(&buffer[0], 1, buffer.size(), file) ==
+                   buffer.size();
+    written = (fclose(file) == 0) && written;
+
+    // Renaming doesn't replace existing files on all platforms
+    remove(path.c_str());
+
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        logger->log("Warning: could not write map cache %s", path.c_str());
+        remove(tempPath.c_str());
+    }
+}
+
+std::string MapCache::getCachePath(const std::string &filename)
+{
+    // Flatten the path of the map file into a file name
+    std::string name = filename;
+    for (std::string::size_type i = 0; i < name.length(); i++)
+    {
+        if (name[i] == '/' || name[i] == '\\')
+            name[i] = '_';
+    }
+
+    return ResourceManager::getInstance()->getWriteDir() + "/" + CACHE_DIR +
+           "/" + name + ".bin";
+}
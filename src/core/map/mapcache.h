@@ -0,0 +1,132 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SDL_Surface;
+
+/**
+ * Everything needed to build a map, as read from a map file.
+ */
+struct MapData
+{
+    typedef std::vector<std::pair<std::string, std::string> > Properties;
+
+    struct AnimationData
+    {
+        int gid;
+        std::vector<std::pair<int, int> > frames;   /**< Tile and delay */
+    };
+
+    struct TilesetData
+    {
+        TilesetData():
+            firstGid(0), tileWidth(0), tileHeight(0), surface(NULL)
+        {}
+
+        int firstGid;
+        std::string image;
+        int tileWidth, tileHeight;
+        std::vector<AnimationData> animations;
+        SDL_Surface *surface;   /**< Image decoded ahead, not cached */
+    };
+
+    struct LayerData
+    {
+        int x, y;
+        int width, height;
+        int tileWidth, tileHeight;
+        bool fringe;
+        bool visible;
+        bool collision;
+        std::vector<int> tiles;         /**< Gids, unless collision layer */
+        std::vector<bool> walkable;     /**< For the collision layer */
+    };
+
+    struct ParticleData
+    {
+        std::string file;
+        int x, y;
+    };
+
+    int width, height;
+    int tileWidth, tileHeight;
+    Properties properties;
+    std::vector<TilesetData> tilesets;
+    std::vector<LayerData> layers;
+    std::vector<ParticleData> particles;
+    std::vector<std::string> warps;     /**< Names of maps warped to */
+
+    void swap(MapData &other)
+    {
+        std::swap(width, other.width);
+        std::swap(height, other.height);
+        std::swap(tileWidth, other.tileWidth);
+        std::swap(tileHeight, other.tileHeight);
+        properties.swap(other.properties);
+        tilesets.swap(other.tilesets);
+        layers.swap(other.layers);
+        particles.swap(other.particles);
+        warps.swap(other.warps);
+    }
+};
+
+/**
+ * Stores maps in a compact binary form in the write directory, so that
+ * loading them again doesn't involve decompressing and parsing the map
+ * files. Cached maps are only used as long as the checksum of the map file
+ * they were made from matches.
+ */
+class MapCache
+{
+    public:
+        /**
+         * Reads the cached version of the given map file, made from a map
+         * file with the given Adler-32 checksum.
+         *
+         * @return whether an up to date version was found. The given data
+         *         is left untouched when not.
+         */
+        static bool read(const std::string &filename, unsigned long checksum,
+                         MapData &data);
+
+        /**
+         * Stores the data read from the given map file, which has the given
+         * Adler-32 checksum.
+         */
+        static void write(const std::string &filename, unsigned long checksum,
+                          const MapData &data);
+
+    private:
+        /**
+         * Returns the real path of the cached version of a map file.
+         */
+        static std::string getCachePath(const std::string &filename);
+};
+
+#endif
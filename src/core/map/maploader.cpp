@@ -0,0 +1,275 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <algorithm>
+
+#include <SDL.h>
+
+#include "map.h"
+#include "mapcache.h"
+#include "maploader.h"
+#include "mapreader.h"
+
+#include "../configuration.h"
+#include "../log.h"
+#include "../resourcemanager.h"
+
+#include "../utils/dtor.h"
+
+/**
+ * The number of loaded maps kept around waiting to be used.
+ */
+const unsigned int MAX_LOADED_MAPS = 6;
+
+MapLoader::MapLoader():
+    mUseCache(true),
+    mQuit(false),
+    mThread(NULL),
+    mSignal(SDL_CreateSemaphore(0))
+{
+    mThread = SDL_CreateThread(loaderThread, this);
+
+    if (!mThread)
+        logger->log("Unable to create map loading thread");
+}
+
+MapLoader::~MapLoader()
+{
+    mMutex.lock();
+    mQuit = true;
+    mMutex.unlock();
+
+    if (mThread)
+    {
+        SDL_SemPost(mSignal);
+        SDL_WaitThread(mThread, NULL);
+    }
+
+    for (LoadedMaps::iterator i = mLoaded.begin(); i != mLoaded.end(); ++i)
+        freeMapData(i->second.data);
+
+    SDL_DestroySemaphore(mSignal);
+}
+
+std::string MapLoader::findMapFile(const std::string &mapName)
+{
+    std::string mapPath = "maps/" + mapName + ".tmx";
+
+    if (!ResourceManager::getInstance()->exists(mapPath))
+        mapPath += ".gz";
+
+    return mapPath;
+}
+
+void MapLoader::prefetch(const std::string &filename)
+{
+    MutexLocker lock(&mMutex);
+
+    if (isKnown(filename))
+        return;
+
+    mUseCache = config.getValue("mapCache", 1);
+    mQueue.push_back(filename);
+    SDL_SemPost(mSignal);
+}
+
+bool MapLoader::getMap(const std::string &filename, Map *&map)
+{
+    // Without a worker, load it right away
+    if (!mThread)
+    {
+        MapData data;
+        map = NULL;
+
+        if (MapReader::readMapData(filename, data,
+                                   config.getValue("mapCache", 1)))
+        {
+            map = MapReader::buildMap(data);
+            map->setProperty("_filename", filename);
+        }
+
+        return true;
+    }
+
+    mMutex.lock();
+    mWanted = filename;
+
+    LoadedMaps::iterator i = mLoaded.find(filename);
+
+    if (i == mLoaded.end())
+    {
+        // Make sure it is loaded next
+        if (mLoading != filename)
+        {
+            std::list<std::string>::iterator queued =
+                std::find(mQueue.begin(), mQueue.end(), filename);
+
+            if (queued != mQueue.end())
+                mQueue.erase(queued);
+            else
+                SDL_SemPost(mSignal);
+
+            mUseCache = config.getValue("mapCache", 1);
+            mQueue.push_front(filename);
+        }
+
+        mMutex.unlock();
+        return false;
+    }
+
+    const LoadedMap loaded = i->second;
+    MapData *data = loaded.data;
+    mLoaded.erase(i);
+    mLoadOrder.remove(filename);
+    mWanted.clear();
+    mMutex.unlock();
+
+    map = NULL;
+
+    if (data)
+    {
+        // The cache is written here, since it involves the resource manager
+        if (loaded.parsed)
+            MapCache::write(filename, loaded.checksum, *data);
+
+        map = MapReader::buildMap(*data);
+        map->setProperty("_filename", filename);
+
+        // Load the maps that may be warped to next
+        for (unsigned int j = 0; j < data->warps.size(); j++)
+        {
+            const std::string warpFile = findMapFile(data->warps[j]);
+
+            if (warpFile != filename)
+                prefetch(warpFile);
+        }
+    }
+
+    freeMapData(data);
+
+    return true;
+}
+
+int MapLoader::loaderThread(void *data)
+{
+    static_cast<MapLoader*>(data)->run();
+
+    return 0;
+}
+
+void MapLoader::run()
+{
+    ResourceManager *resman = ResourceManager::getInstance();
+
+    for (;;)
+    {
+        SDL_SemWait(mSignal);
+
+        mMutex.lock();
+
+        if (mQuit)
+        {
+            mMutex.unlock();
+            return;
+        }
+
+        if (mQueue.empty())
+        {
+            mMutex.unlock();
+            continue;
+        }
+
+        const std::string filename = mQueue.front();
+        const bool useCache = mUseCache;
+        mQueue.pop_front();
+        mLoading = filename;
+        mMutex.unlock();
+
+        LoadedMap loaded;
+        loaded.data = new MapData;
+        MapData *data = loaded.data;
+
+        if (MapReader::readMapData(filename, *data, useCache, loaded.parsed,
+                                   loaded.checksum))
+        {
+            // Decode the tile set images, leaving only their conversion to
+            // the main thread. Dyed images are left to the main thread.
+            for (unsigned int i = 0; i < data->tilesets.size(); i++)
+            {
+                MapData::TilesetData &tileset = data->tilesets[i];
+
+                if (tileset.image.find('|') == std::string::npos)
+                    tileset.surface = resman->loadSDLSurface(tileset.image);
+            }
+        }
+        else
+            destroy(loaded.data);
+
+        mMutex.lock();
+        mLoaded[filename] = loaded;
+        mLoadOrder.push_back(filename);
+        mLoading.clear();
+        evict();
+        mMutex.unlock();
+    }
+}
+
+bool MapLoader::isKnown(const std::string &filename) const
+{
+    return mLoading == filename ||
+           mLoaded.find(filename) != mLoaded.end() ||
+           std::find(mQueue.begin(), mQueue.end(), filename) != mQueue.end();
+}
+
+void MapLoader::evict()
+{
+    std::list<std::string>::iterator i = mLoadOrder.begin();
+
+    while (mLoaded.size() > MAX_LOADED_MAPS && i != mLoadOrder.end())
+    {
+        // Never throw away the map that is waited for
+        if (*i == mWanted)
+        {
+            ++i;
+            continue;
+        }
+
+        LoadedMaps::iterator loaded = mLoaded.find(*i);
+        freeMapData(loaded->second.data);
+        mLoaded.erase(loaded);
+        i = mLoadOrder.erase(i);
+    }
+}
+
+void MapLoader::freeMapData(MapData *data)
+{
+    if (!data)
+        return;
+
+    for (unsigned int i = 0; i < data->tilesets.size(); i++)
+    {
+        if (data->tilesets[i].surface)
+            SDL_FreeSurface(data->tilesets[i].surface);
+    }
+
+    delete data;
+}
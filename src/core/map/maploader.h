@@ -0,0 +1,127 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <SDL_thread.h>
+
+#include "../utils/mutex.h"
+
+class Map;
+struct MapData;
+
+/**
+ * Loads maps in the background. A worker thread reads and parses the map
+ * files and decodes the tile set images, leaving the creation of the map and
+ * its images, and updating the map cache, to the main thread.
+ *
+ * Besides the map that is waited for, the maps reachable through its warps
+ * are loaded ahead, so that most warps don't have to wait at all.
+ */
+class MapLoader
+{
+    public:
+        /**
+         * Constructor, starts the worker thread.
+         */
+        MapLoader();
+
+        /**
+         * Destructor, waits for the map being loaded to finish.
+         */
+        ~MapLoader();
+
+        /**
+         * Returns the map file belonging to a map name, like it is used by
+         * the server and in warps.
+         */
+        static std::string findMapFile(const std::string &mapName);
+
+        /**
+         * Loads the given map file ahead, after the ones already requested.
+         */
+        void prefetch(const std::string &filename);
+
+        /**
+         * Returns whether the given map file has been loaded. If so, the
+         * map is created and returned, or NULL when loading failed. If not,
+         * it is loaded before any maps that are only prefetched.
+         */
+        bool getMap(const std::string &filename, Map *&map);
+
+    private:
+        MapLoader(const MapLoader&);  // prevent copying
+        MapLoader& operator=(const MapLoader&);
+
+        static int loaderThread(void *data);
+
+        /**
+         * Loads the requested map files until told to quit. Runs on the
+         * worker thread.
+         */
+        void run();
+
+        /**
+         * Returns whether the map file is loaded, being loaded or waiting
+         * to be loaded. Requires the mutex to be locked.
+         */
+        bool isKnown(const std::string &filename) const;
+
+        /**
+         * Throws away the oldest loaded maps when too many are kept.
+         * Requires the mutex to be locked.
+         */
+        void evict();
+
+        /**
+         * Frees the decoded images and the data itself.
+         */
+        static void freeMapData(MapData *data);
+
+        struct LoadedMap
+        {
+            MapData *data;              /**< NULL when loading failed */
+            bool parsed;                /**< Whether to update the cache */
+            unsigned long checksum;     /**< Of the map file, for the cache */
+        };
+
+        typedef std::map<std::string, LoadedMap> LoadedMaps;
+
+        std::list<std::string> mQueue;      /**< Map files to load */
+        std::string mLoading;               /**< Being loaded right now */
+        LoadedMaps mLoaded;
+        std::list<std::string> mLoadOrder;  /**< Loaded maps, oldest first */
+        std::string mWanted;                /**< Map that is waited for */
+        bool mUseCache;
+        bool mQuit;
+
+        SDL_Thread *mThread;
+        SDL_sem *mSignal;                   /**< Posted for each request */
+        Mutex mMutex;
+};
+
+#endif
@@ -20,7 +20,9 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <iostream>
 #include <zlib.h>
 
@@ -28,6 +30,7 @@
 #include "mapreader.h"
 #include "tileset.h"
 
+#include "../configuration.h"
 #include "../log.h"
 #include "../resourcemanager.h"
 
@@ -44,97 +47,196 @@
 const unsigned int DEFAULT_TILE_WIDTH = 32;
 const unsigned int DEFAULT_TILE_HEIGHT = 32;
 
+namespace
+{
+    /**
+     * Finds the tile set a gid belongs to, given the first gids of the tile
+     * sets in increasing order. Since neighbouring tiles mostly come from
+     * the same tile set, the range of the last one found is checked first.
+     */
+    class GidLookup
+    {
+        public:
+            GidLookup(const std::vector<int> &firstGids):
+                mFirstGids(firstGids),
+                mIndex(-1), mStart(1), mEnd(0)
+            {}
+
+            /**
+             * Returns the index of the tile set, or -1 when there is none.
+             */
+            int find(const int gid)
+            {
+                if (gid < mStart || gid >= mEnd)
+                    update(gid);
+
+                return mIndex;
+            }
+
+        private:
+            void update(const int gid)
+            {
+                mIndex = -1;
+                mStart = INT_MIN;
+                mEnd = mFirstGids.empty() ? INT_MAX : mFirstGids[0];
+
+                for (unsigned int i = 0; i < mFirstGids.size() &&
+                     mFirstGids[i] <= gid; i++)
+                {
+                    mIndex = i;
+                    mStart = mFirstGids[i];
+                    mEnd = (i + 1 < mFirstGids.size()) ? mFirstGids[i + 1] :
+                                                         INT_MAX;
+                }
+            }
+
+            const std::vector<int> &mFirstGids;
+            int mIndex;
+            int mStart, mEnd;
+    };
+}
+
 Map *MapReader::readMap(const std::string &filename)
 {
+    MapData data;
+
+    if (!readMapData(filename, data, config.getValue("mapCache", 1)))
+        return NULL;
+
+    Map *map = buildMap(data);
+    map->setProperty("_filename", filename);
+
+    return map;
+}
+
+bool MapReader::readMapData(const std::string &filename, MapData &data,
+                            const bool useCache)
+{
+    bool parsed;
+    unsigned long checksum;
+
+    if (!readMapData(filename, data, useCache, parsed, checksum))
+        return false;
+
+    if (parsed)
+        MapCache::write(filename, checksum, data);
+
+    return true;
+}
+
+bool MapReader::readMapData(const std::string &filename, MapData &data,
+                            const bool useCache, bool &parsed,
+                            unsigned long &checksum)
+{
+    parsed = false;
+
     logger->log("Attempting to read map %s", filename.c_str());
     // Load the file through resource manager
     ResourceManager *resman = ResourceManager::getInstance();
     int fileSize;
     void *buffer = resman->loadFile(filename, fileSize);
-    Map *map = NULL;
 
     if (buffer == NULL)
     {
         logger->log("Map file not found (%s)", filename.c_str());
-        return NULL;
+        return false;
     }
 
-    unsigned char *inflated;
-    unsigned int inflatedSize;
+    // A cached version made from the same map file saves decompressing and
+    // parsing it
+    checksum = adler32(adler32(0L, Z_NULL, 0), (Bytef*) buffer, fileSize);
 
-    if (filename.find(".gz", filename.length() - 3) != std::string::npos)
+    if (useCache && MapCache::read(filename, checksum, data))
     {
-        // Inflate the gzipped map data
-        inflatedSize = inflateMemory((unsigned char*) buffer, fileSize,
-                                     inflated);
+        logger->log("Using cached map data");
         free(buffer);
-
-        if (inflated == NULL)
-        {
-            logger->log("Could not decompress map file (%s)",
-                    filename.c_str());
-            return NULL;
-        }
     }
     else
     {
-        inflated = (unsigned char*) buffer;
-        inflatedSize = fileSize;
-    }
+        unsigned char *inflated;
+        unsigned int inflatedSize;
 
-    XML::Document doc((char*) inflated, inflatedSize);
-    free(inflated);
+        if (filename.find(".gz", filename.length() - 3) != std::string::npos)
+        {
+            // Inflate the gzipped map data
+            inflatedSize = inflateMemory((unsigned char*) buffer, fileSize,
+                                         inflated);
+            free(buffer);
 
-    xmlNodePtr node = doc.rootNode();
+            if (inflated == NULL)
+            {
+                logger->log("Could not decompress map file (%s)",
+                        filename.c_str());
+                return false;
+            }
+        }
+        else
+        {
+            inflated = (unsigned char*) buffer;
+            inflatedSize = fileSize;
+        }
+
+        XML::Document doc((char*) inflated, inflatedSize);
+        free(inflated);
+
+        xmlNodePtr node = doc.rootNode();
+
+        // Parse the inflated map data
+        if (!node)
+        {
+            logger->log("Error while parsing map file (%s)!",
+                        filename.c_str());
+            return false;
+        }
 
-    // Parse the inflated map data
-    if (node)
-    {
         if (!xmlStrEqual(node->name, BAD_CAST "map"))
+        {
             logger->log("Error: Not a map file (%s)!", filename.c_str());
-        else
-            map = readMap(node, filename);
-    }
-    else
-        logger->log("Error while parsing map file (%s)!", filename.c_str());
+            return false;
+        }
 
-    if (map)
-        map->setProperty("_filename", filename);
+        readMap(node, filename, data);
+        parsed = useCache;
+    }
 
-    return map;
+    return true;
 }
 
 Map *MapReader::readMap(const xmlNodePtr &node, const std::string &path)
+{
+    MapData data;
+    readMap(node, path, data);
+
+    return buildMap(data);
+}
+
+void MapReader::readMap(const xmlNodePtr &node, const std::string &path,
+                        MapData &data)
 {
     // Take the filename off the path
     const std::string pathDir = path.substr(0, path.rfind("/") + 1);
 
-    const int w = XML::getProperty(node, "width", 0);
-    const int h = XML::getProperty(node, "height", 0);
-    const int tilew = XML::getProperty(node, "tilewidth", DEFAULT_TILE_WIDTH);
-    const int tileh = XML::getProperty(node, "tileheight", DEFAULT_TILE_HEIGHT);
-    Map *map = new Map(w, h, tilew, tileh);
+    data.width = XML::getProperty(node, "width", 0);
+    data.height = XML::getProperty(node, "height", 0);
+    data.tileWidth = XML::getProperty(node, "tilewidth", DEFAULT_TILE_WIDTH);
+    data.tileHeight = XML::getProperty(node, "tileheight",
+                                       DEFAULT_TILE_HEIGHT);
 
     for_each_xml_child_node(childNode, node)
     {
         if (xmlStrEqual(childNode->name, BAD_CAST "tileset"))
-        {
-            Tileset *tileset = readTileset(childNode, pathDir, map);
-
-            if (tileset)
-                map->addTileset(tileset);
-        }
+            readTileset(childNode, pathDir, data);
         else if (xmlStrEqual(childNode->name, BAD_CAST "layer"))
-            readLayer(childNode, map);
+            readLayer(childNode, data);
         else if (xmlStrEqual(childNode->name, BAD_CAST "properties"))
-            readProperties(childNode, map);
+            readProperties(childNode, data.properties);
         else if (xmlStrEqual(childNode->name, BAD_CAST "objectgroup"))
         {
             // The object group offset is applied to each object individually
             const int tileOffsetX = XML::getProperty(childNode, "x", 0);
             const int tileOffsetY = XML::getProperty(childNode, "y", 0);
-            const int offsetX = tileOffsetX * tilew;
-            const int offsetY = tileOffsetY * tileh;
+            const int offsetX = tileOffsetX * data.tileWidth;
+            const int offsetY = tileOffsetY * data.tileHeight;
 
             for_each_xml_child_node(objectNode, childNode)
             {
@@ -143,7 +245,32 @@ Map *MapReader::readMap(const xmlNodePtr &node, const std::string &path)
                     const std::string objType =
                         XML::getProperty(objectNode, "type", "");
 
-                    if (objType == "WARP" || objType == "NPC" ||
+                    if (objType == "WARP")
+                    {
+                        // Remember where warps lead to, for preloading
+                        for_each_xml_child_node(propertiesNode, objectNode)
+                        {
+                            if (!xmlStrEqual(propertiesNode->name,
+                                             BAD_CAST "properties"))
+                                continue;
+
+                            MapData::Properties properties;
+                            readProperties(propertiesNode, properties);
+
+                            for (unsigned int i = 0; i < properties.size(); i++)
+                            {
+                                if (properties[i].first == "dest_map" &&
+                                    std::find(data.warps.begin(),
+                                              data.warps.end(),
+                                              properties[i].second) ==
+                                    data.warps.end())
+                                    data.warps.push_back(properties[i].second);
+                            }
+                        }
+                        continue;
+                    }
+
+                    if (objType == "NPC" ||
                         objType == "SCRIPT" || objType == "SPAWN")
                     {
                         // Silently skip server-side objects.
@@ -167,9 +294,11 @@ Map *MapReader::readMap(const xmlNodePtr &node, const std::string &path)
                             continue;
                         }
 
-                        map->addParticleEffect(objName,
-                                               objX + offsetX,
-                                               objY + offsetY);
+                        MapData::ParticleData particle;
+                        particle.file = objName;
+                        particle.x = objX + offsetX;
+                        particle.y = objY + offsetY;
+                        data.particles.push_back(particle);
                     }
                     else
                         logger->log("   Warning: Unknown object type");
@@ -178,12 +307,146 @@ Map *MapReader::readMap(const xmlNodePtr &node, const std::string &path)
         }
     }
 
+    // Now that all tile sets are known, reduce the collision layers to
+    // whether each tile is walkable
+    std::vector<int> firstGids;
+    for (unsigned int i = 0; i < data.tilesets.size(); i++)
+        firstGids.push_back(data.tilesets[i].firstGid);
+
+    GidLookup lookup(firstGids);
+
+    for (unsigned int i = 0; i < data.layers.size(); i++)
+    {
+        MapData::LayerData &layer = data.layers[i];
+
+        if (!layer.collision)
+            continue;
+
+        layer.walkable.resize(layer.tiles.size());
+
+        for (unsigned int j = 0; j < layer.tiles.size(); j++)
+        {
+            const int gid = layer.tiles[j];
+            const int set = lookup.find(gid);
+            layer.walkable[j] = (set < 0 || gid == firstGids[set]);
+        }
+
+        layer.tiles.clear();
+    }
+}
+
+Map *MapReader::buildMap(const MapData &data)
+{
+    Map *map = new Map(data.width, data.height, data.tileWidth,
+                       data.tileHeight);
+
+    for (unsigned int i = 0; i < data.properties.size(); i++)
+    {
+        map->setProperty(data.properties[i].first,
+                         data.properties[i].second);
+    }
+
+    ResourceManager *resman = ResourceManager::getInstance();
+    std::vector<Tileset*> tilesets;
+    std::vector<int> firstGids;
+
+    for (unsigned int i = 0; i < data.tilesets.size(); i++)
+    {
+        const MapData::TilesetData &tilesetData = data.tilesets[i];
+        Image* tilebmp = tilesetData.surface ?
+            resman->getImage(tilesetData.image, tilesetData.surface) :
+            resman->getImage(tilesetData.image);
+
+        if (!tilebmp)
+        {
+            logger->log("Warning: Failed to load tileset (%s)",
+                        tilesetData.image.c_str());
+            continue;
+        }
+
+        Tileset *set = new Tileset(tilebmp, tilesetData.tileWidth,
+                                   tilesetData.tileHeight,
+                                   tilesetData.firstGid);
+        tilebmp->decRef();
+
+        map->addTileset(set);
+        tilesets.push_back(set);
+        firstGids.push_back(tilesetData.firstGid);
+
+        for (unsigned int j = 0; j < tilesetData.animations.size(); j++)
+        {
+            const MapData::AnimationData &animation =
+                tilesetData.animations[j];
+            Animation *ani = new Animation();
+
+            for (unsigned int k = 0; k < animation.frames.size(); k++)
+            {
+                ani->addFrame(set->get(animation.frames[k].first),
+                              animation.frames[k].second, 0, 0);
+            }
+
+            if (ani->getLength() > 0)
+            {
+                map->addAnimation(animation.gid, new TileAnimation(ani));
+                logger->log("Animation length: %d", ani->getLength());
+            }
+            else
+                destroy(ani);
+        }
+    }
+
+    GidLookup lookup(firstGids);
+
+    for (unsigned int i = 0; i < data.layers.size(); i++)
+    {
+        const MapData::LayerData &layerData = data.layers[i];
+        const int w = layerData.width;
+
+        if (layerData.collision)
+        {
+            for (unsigned int j = 0; j < layerData.walkable.size(); j++)
+                map->setWalk(j % w, j / w, layerData.walkable[j]);
+
+            // Now that the collision data is complete, prepare for long
+            // distance path finding.
+            map->initializePathFinding();
+            continue;
+        }
+
+        MapLayer *layer = new MapLayer(layerData.x, layerData.y, w,
+                                       layerData.height, layerData.tileWidth,
+                                       layerData.tileHeight, layerData.fringe,
+                                       layerData.visible);
+        map->addLayer(layer);
+
+        for (unsigned int j = 0; j < layerData.tiles.size(); j++)
+        {
+            const int gid = layerData.tiles[j];
+            const int set = lookup.find(gid);
+
+            Image *img = (set < 0) ? NULL :
+                                     tilesets[set]->get(gid - firstGids[set]);
+            layer->setTile(j % w, j / w, img);
+
+            TileAnimation* ani = map->getAnimationForGid(gid);
+            if (ani)
+                ani->addAffectedTile(layer, j);
+        }
+    }
+
+    for (unsigned int i = 0; i < data.particles.size(); i++)
+    {
+        const MapData::ParticleData &particle = data.particles[i];
+        map->addParticleEffect(particle.file, particle.x, particle.y);
+    }
+
     map->initializeAmbientLayers();
 
     return map;
 }
 
-void MapReader::readProperties(const xmlNodePtr &node, Properties *props)
+void MapReader::readProperties(const xmlNodePtr &node,
+                               MapData::Properties &props)
 {
     for_each_xml_child_node(childNode, node)
     {
@@ -195,51 +458,30 @@ void MapReader::readProperties(const xmlNodePtr &node, Properties *props)
         const std::string value = XML::getProperty(childNode, "value", "");
 
         if (!name.empty() && !value.empty())
-            props->setProperty(name, value);
+            props.push_back(std::make_pair(name, value));
     }
 }
 
-static void setTile(Map *map, MapLayer *layer, const int x,
-                    const int y, const int gid)
+void MapReader::readLayer(const xmlNodePtr &node, MapData &data)
 {
-    const Tileset* set = map->getTilesetWithGid(gid);
-    if (layer)
-    {
-        // Set regular tile on a layer
-        Image* img = set ? set->get(gid - set->getFirstGid()) : 0;
-        layer->setTile(x, y, img);
-    }
-    else
-    {
-        // Set collision tile
-        map->setWalk(x, y, (!set || (gid - set->getFirstGid() == 0)));
-    }
-}
+    MapData::LayerData layer;
 
-void MapReader::readLayer(const xmlNodePtr &node, Map *map)
-{
     // Layers are not necessarily the same size as the map
-    const int w = XML::getProperty(node, "width", map->getWidth());
-    const int h = XML::getProperty(node, "height", map->getHeight());
-    const int tw = XML::getProperty(node, "tilewidth", map->getTileWidth());
-    const int th = XML::getProperty(node, "tileheight", map->getTileHeight());
-    const int offsetX = XML::getProperty(node, "x", 0);
-    const int offsetY = XML::getProperty(node, "y", 0);
+    layer.width = XML::getProperty(node, "width", data.width);
+    layer.height = XML::getProperty(node, "height", data.height);
+    layer.tileWidth = XML::getProperty(node, "tilewidth", data.tileWidth);
+    layer.tileHeight = XML::getProperty(node, "tileheight", data.tileHeight);
+    layer.x = XML::getProperty(node, "x", 0);
+    layer.y = XML::getProperty(node, "y", 0);
     std::string name = XML::getProperty(node, "name", "");
     name = toLower(name);
 
-    const bool isFringeLayer = (name.substr(0,6) == "fringe");
-    const bool isCollisionLayer = (name.substr(0,9) == "collision");
-    const bool isVisible = XML::getProperty(node, "visible", 1);
+    layer.fringe = (name.substr(0,6) == "fringe");
+    layer.collision = (name.substr(0,9) == "collision");
+    layer.visible = XML::getProperty(node, "visible", 1);
 
-    MapLayer *layer = NULL;
-
-    if (!isCollisionLayer)
-    {
-        layer = new MapLayer(offsetX, offsetY, w, h, tw, th, isFringeLayer,
-                             isVisible);
-        map->addLayer(layer);
-    }
+    const int w = layer.width;
+    const int h = layer.height;
 
     logger->log("- Loading layer \"%s\"", name.c_str());
     int x = 0;
@@ -261,7 +503,7 @@ void MapReader::readLayer(const xmlNodePtr &node, Map *map)
             if (!compression.empty() && compression != "gzip")
             {
                 logger->log("Warning: only gzip layer compression supported!");
-                return;
+                break;
             }
 
             // Read base64 encoded map file
@@ -308,7 +550,7 @@ void MapReader::readLayer(const xmlNodePtr &node, Map *map)
                     if (!inflated)
                     {
                         logger->log("Error: Could not decompress layer!");
-                        return;
+                        break;
                     }
                 }
 
@@ -319,11 +561,7 @@ void MapReader::readLayer(const xmlNodePtr &node, Map *map)
                                     binData[i + 2] << 16 |
                                     binData[i + 3] << 24;
 
-                    setTile(map, layer, x, y, gid);
-
-                    TileAnimation* ani = map->getAnimationForGid(gid);
-                    if (ani)
-                        ani->addAffectedTile(layer, x + y * w);
+                    layer.tiles.push_back(gid);
 
                     x++;
                     if (x == w)
@@ -347,7 +585,7 @@ void MapReader::readLayer(const xmlNodePtr &node, Map *map)
                     continue;
 
                 const int gid = XML::getProperty(childNode2, "gid", -1);
-                setTile(map, layer, x, y, gid);
+                layer.tiles.push_back(gid);
 
                 x++;
                 if (x == w)
@@ -365,14 +603,19 @@ void MapReader::readLayer(const xmlNodePtr &node, Map *map)
         // There can be only one data element
         break;
     }
+
+    // Tiles without data stay empty
+    layer.tiles.resize(w * h, 0);
+
+    data.layers.push_back(layer);
 }
 
-Tileset *MapReader::readTileset(xmlNodePtr node, const std::string &path,
-                                Map *map)
+void MapReader::readTileset(xmlNodePtr node, const std::string &path,
+                            MapData &data)
 {
-    int firstGid = XML::getProperty(node, "firstgid", 0);
+    MapData::TilesetData tileset;
+    tileset.firstGid = XML::getProperty(node, "firstgid", 0);
     XML::Document* doc = NULL;
-    Tileset *set = NULL;
 
     if (xmlHasProp(node, BAD_CAST "source"))
     {
@@ -381,11 +624,12 @@ Tileset *MapReader::readTileset(xmlNodePtr node, const std::string &path,
                filename.erase(0, 3);  // Remove "../"
         doc = new XML::Document(filename);
         node = doc->rootNode();
-        firstGid += XML::getProperty(node, "firstgid", 0);
+        tileset.firstGid += XML::getProperty(node, "firstgid", 0);
     }
 
-    const int tw = XML::getProperty(node, "tilewidth", map->getTileWidth());
-    const int th = XML::getProperty(node, "tileheight", map->getTileHeight());
+    tileset.tileWidth = XML::getProperty(node, "tilewidth", data.tileWidth);
+    tileset.tileHeight = XML::getProperty(node, "tileheight",
+                                          data.tileHeight);
 
     for_each_xml_child_node(childNode, node)
     {
@@ -395,20 +639,8 @@ Tileset *MapReader::readTileset(xmlNodePtr node, const std::string &path,
 
             if (!source.empty())
             {
-                std::string sourceStr = source;
-                sourceStr.erase(0, 3);  // Remove "../"
-
-                ResourceManager *resman = ResourceManager::getInstance();
-                Image* tilebmp = resman->getImage(sourceStr);
-
-                if (tilebmp)
-                {
-                    set = new Tileset(tilebmp, tw, th, firstGid);
-                    tilebmp->decRef();
-                }
-                else
-                    logger->log("Warning: Failed to load tileset (%s)",
-                                source.c_str());
+                tileset.image = source;
+                tileset.image.erase(0, 3);  // Remove "../"
             }
         }
         else if (xmlStrEqual(childNode->name, BAD_CAST "tile"))
@@ -417,7 +649,8 @@ Tileset *MapReader::readTileset(xmlNodePtr node, const std::string &path,
             {
                 if (!xmlStrEqual(tileNode->name, BAD_CAST "properties")) continue;
 
-                int tileGID = firstGid + XML::getProperty(childNode, "id", 0);
+                int tileGID = tileset.firstGid +
+                              XML::getProperty(childNode, "id", 0);
 
                 // read tile properties to a map for simpler handling
                 std::map<std::string, int> tileProperties;
@@ -432,11 +665,10 @@ Tileset *MapReader::readTileset(xmlNodePtr node, const std::string &path,
                     logger->log("Tile Prop of %d \"%s\" = \"%d\"", tileGID, name.c_str(), value);
                 }
 
-                // create animation
-                if (!set)
-                    continue;
+                // collect the animation frames
+                MapData::AnimationData animation;
+                animation.gid = tileGID;
 
-                Animation *ani = new Animation();
                 for (int i = 0; ;i++)
                 {
                     std::map<std::string, int>::iterator iFrame, iDelay;
@@ -444,23 +676,21 @@ Tileset *MapReader::readTileset(xmlNodePtr node, const std::string &path,
                     iDelay = tileProperties.find("animation-delay" + toString(i));
 
                     if (iFrame != tileProperties.end() && iDelay != tileProperties.end())
-                        ani->addFrame(set->get(iFrame->second), iDelay->second, 0, 0);
+                        animation.frames.push_back(std::make_pair(iFrame->second,
+                                                                  iDelay->second));
                     else
                         break;
                 }
 
-                if (ani->getLength() > 0)
-                {
-                    map->addAnimation(tileGID, new TileAnimation(ani));
-                    logger->log("Animation length: %d", ani->getLength());
-                }
-                else
-                    destroy(ani);
+                if (!animation.frames.empty())
+                    tileset.animations.push_back(animation);
             }
         }
     }
 
     destroy(doc);
 
-    return set;
+    // Tile sets without an image are left out, like when it fails to load
+    if (!tileset.image.empty())
+        data.tilesets.push_back(tileset);
 }
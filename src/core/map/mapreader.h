@@ -25,12 +25,13 @@
 
 #include <libxml/tree.h>
 
+#include "mapcache.h"
+
 class Map;
-class Properties;
-class Tileset;
 
 /**
- * Reader for XML map files (*.tmx)
+ * Reader for XML map files (*.tmx). The data read from map files is cached
+ * by the MapCache.
  */
 class MapReader
 {
@@ -46,26 +47,57 @@ class MapReader
          */
         static Map *readMap(const xmlNodePtr &node, const std::string &path);
 
+        /**
+         * Reads the data of a map file, from the map cache when possible,
+         * and updates the cache when the map file had to be parsed.
+         */
+        static bool readMapData(const std::string &filename, MapData &data,
+                                const bool useCache);
+
+        /**
+         * Reads the data of a map file, from the map cache when possible.
+         * Doesn't write the cache, so it can be used by any thread. When
+         * the map file had to be parsed while the cache is used, parsed is
+         * set and checksum is set to the checksum of the map file, for the
+         * caller to update the cache with MapCache::write on the main
+         * thread.
+         */
+        static bool readMapData(const std::string &filename, MapData &data,
+                                const bool useCache, bool &parsed,
+                                unsigned long &checksum);
+
+        /**
+         * Creates a map from the data read from a map file. Tile set images
+         * already decoded into the data are used instead of loading them.
+         */
+        static Map *buildMap(const MapData &data);
+
     private:
+        /**
+         * Reads the data of an XML map from a parsed XML tree.
+         */
+        static void readMap(const xmlNodePtr &node, const std::string &path,
+                            MapData &data);
+
         /**
          * Reads the properties element.
          *
          * @param node  The <code>properties</code> element.
-         * @param props The Properties instance to which the properties will
-         *              be assigned.
+         * @param props The list to which the properties will be added.
          */
-        static void readProperties(const xmlNodePtr &node, Properties* props);
+        static void readProperties(const xmlNodePtr &node,
+                                   MapData::Properties &props);
 
         /**
-         * Reads a map layer and adds it to the given map.
+         * Reads a map layer and adds it to the given map data.
          */
-        static void readLayer(const xmlNodePtr &node, Map *map);
+        static void readLayer(const xmlNodePtr &node, MapData &data);
 
         /**
-         * Reads a tile set.
+         * Reads a tile set and adds it to the given map data.
          */
-        static Tileset *readTileset(xmlNodePtr node, const std::string &path,
-                                    Map *map);
+        static void readTileset(xmlNodePtr node, const std::string &path,
+                                MapData &data);
 
         /**
          * Gets an integer property from an xmlNodePtr.
@@ -0,0 +1,906 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+
+#include "pathfinder.h"
+
+/**
+ * Values of Node::heapIndex for tiles that are not on the open list.
+ */
+static const int NOT_VISITED = -1;
+static const int CLOSED = -2;
+
+/**
+ * Size in tiles of the clusters making up the abstract graph.
+ */
+static const int CLUSTER_SIZE = 16;
+
+/**
+ * Routes costing more than this are not searched for on the tile level
+ * directly, but through the cluster graph instead.
+ */
+static const int LOCAL_MAX_COST = 200;
+
+/**
+ * Openings between two clusters at least this wide get a transition at both
+ * ends, narrower ones a single transition in the middle.
+ */
+static const int WIDE_ENTRANCE = 6;
+
+PathFinder::PathFinder(const int width, const int height):
+    mWidth(width), mHeight(height),
+    mWalkable((width * height + 31) / 32, ~0u),
+    mNodes(width * height, Node()),
+    mSearch(0),
+    mClustersX(0), mClustersY(0),
+    mHierarchyDirty(false),
+    mAbstractSearch(0)
+{
+}
+
+void PathFinder::setWalk(const int x, const int y, const bool walkable)
+{
+    if (!contains(x, y))
+        return;
+
+    const int index = x + y * mWidth;
+
+    if (isWalkable(index) == walkable)
+        return;
+
+    if (walkable)
+        mWalkable[index >> 5] |= (1u << (index & 31));
+    else
+        mWalkable[index >> 5] &= ~(1u << (index & 31));
+
+    // Only the cluster containing the tile needs to be updated, which is
+    // postponed until the next long distance search.
+    if (!mClusters.empty())
+    {
+        mClusters[getCluster(x, y)].dirty = true;
+        mHierarchyDirty = true;
+    }
+}
+
+bool PathFinder::findPath(const int startX, const int startY, const int destX,
+                          const int destY, Path &path)
+{
+    path.clear();
+
+    if (!contains(startX, startY) || !contains(destX, destY))
+        return false;
+
+    const int distance = std::max(abs(destX - startX), abs(destY - startY));
+
+    // Nearby destinations are usually reached quickest by a direct search
+    if (distance * 10 <= LOCAL_MAX_COST &&
+        findPath(startX, startY, destX, destY, LOCAL_MAX_COST, path))
+    {
+        return true;
+    }
+
+    if (mClusters.empty())
+        return false;
+
+    return findAbstractPath(startX, startY, destX, destY, path);
+}
+
+bool PathFinder::findPath(const int startX, const int startY, const int destX,
+                          const int destY, const int maxCost, Path &path)
+{
+    path.clear();
+
+    if (!contains(startX, startY) || !contains(destX, destY))
+        return false;
+
+    const int startIndex = startX + startY * mWidth;
+    const int destIndex = destX + destY * mWidth;
+
+    if (startIndex == destIndex)
+        return false;
+
+    Area area;
+    area.x1 = 0;
+    area.y1 = 0;
+    area.x2 = mWidth;
+    area.y2 = mHeight;
+
+    if (!search(startIndex, destIndex, area, maxCost))
+        return false;
+
+    appendPath(startIndex, destIndex, path);
+    return true;
+}
+
+bool PathFinder::search(const int startIndex, const int destIndex,
+                        const Area &area, const int maxCost)
+{
+    // Use a new search counter, so we don't have to clear the state of all
+    // tiles between each search. Only when it wraps around do we have to.
+    if (++mSearch == 0)
+    {
+        for (std::vector<Node>::iterator i = mNodes.begin(), i_end =
+             mNodes.end(); i != i_end; ++i)
+        {
+            i->search = 0;
+        }
+        mSearch = 1;
+    }
+
+    mOpenList.clear();
+
+    const int destX = destIndex % mWidth;
+    const int destY = destIndex / mWidth;
+
+    // Reset starting tile's G cost to 0 and add it to the open list
+    getNode(startIndex).Gcost = 0;
+    heapPush(startIndex, 0);
+
+    bool foundPath = false;
+
+    // Keep trying new open tiles until no more tiles to try or target found
+    while (!mOpenList.empty() && !foundPath)
+    {
+        // Take the location with the lowest F cost from the open list, which
+        // also puts it on the closed list.
+        const int currIndex = heapPop();
+        const int currX = currIndex % mWidth;
+        const int currY = currIndex / mWidth;
+        const int currGcost = mNodes[currIndex].Gcost;
+
+        // Only tiles at the edge of the area have neighbours outside of it
+        const bool atEdge = currX == area.x1 || currY == area.y1 ||
+                            currX == area.x2 - 1 || currY == area.y2 - 1;
+
+        // Check the adjacent tiles
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                // Calculate location of tile to check
+                const int x = currX + dx;
+                const int y = currY + dy;
+
+                // Skip if if we're checking the same tile we're leaving from,
+                // or if the new location falls outside of the area
+                if ((dx == 0 && dy == 0) ||
+                    (atEdge && (x < area.x1 || y < area.y1 ||
+                                x >= area.x2 || y >= area.y2)))
+                {
+                    continue;
+                }
+
+                // Skip if the tile collides unless its the destination tile
+                const int index = x + y * mWidth;
+                if (index != destIndex && !isWalkable(index))
+                    continue;
+
+                // When taking a diagonal step, verify that we can skip the
+                // corner. We allow skipping past beings but not past non-
+                // walkable tiles.
+                if (dx != 0 && dy != 0 &&
+                    !(isWalkable(currIndex + dy * mWidth) &&
+                      isWalkable(currIndex + dx)))
+                {
+                    continue;
+                }
+
+                // Skip if the tile is on the closed list
+                Node &node = getNode(index);
+                if (node.heapIndex == CLOSED)
+                    continue;
+
+                // Calculate G cost for this route, 10 for moving straight and
+                // 14 for moving diagonal (sqrt(200) = 14.1421...)
+                const int Gcost = currGcost + ((dx == 0 || dy == 0) ? 10 : 14);
+
+                if (Gcost > maxCost)
+                    continue;
+
+                if (node.heapIndex == NOT_VISITED)
+                {
+                    // Found a new tile. Its H cost is the Manhattan distance
+                    // to the destination, or nothing when there is none.
+                    node.Gcost = Gcost;
+                    node.parent = currIndex;
+
+                    if (destIndex < 0)
+                    {
+                        heapPush(index, Gcost);
+                    }
+                    else if (index != destIndex)
+                    {
+                        heapPush(index, Gcost + 10 * (abs(x - destX) +
+                                                      abs(y - destY)));
+                    }
+                    else
+                    {
+                        // Target location was found
+                        node.heapIndex = CLOSED;
+                        foundPath = true;
+                    }
+                }
+                else if (Gcost < node.Gcost)
+                {
+                    // Found a shorter route to a tile on the open list
+                    mOpenList[node.heapIndex].Fcost -= node.Gcost - Gcost;
+                    node.Gcost = Gcost;
+                    node.parent = currIndex;
+                    siftUp(node.heapIndex);
+                }
+            }
+        }
+    }
+
+    return foundPath;
+}
+
+void PathFinder::appendPath(const int startIndex, const int destIndex,
+                            Path &path) const
+{
+    // Iterate backwards using the parent locations to extract the path, and
+    // then put the new part in walking order.
+    const Path::size_type begin = path.size();
+
+    for (int index = destIndex; index != startIndex;
+         index = mNodes[index].parent)
+    {
+        path.push_back(Position(index % mWidth, index / mWidth));
+    }
+
+    std::reverse(path.begin() + begin, path.end());
+}
+
+int PathFinder::getCost(const int x, const int y) const
+{
+    if (!contains(x, y))
+        return -1;
+
+    return getReachedCost(x + y * mWidth);
+}
+
+int PathFinder::getReachedCost(const int index) const
+{
+    const Node &node = mNodes[index];
+
+    if (node.search != mSearch || node.heapIndex == NOT_VISITED)
+        return -1;
+
+    return node.Gcost;
+}
+
+PathFinder::Node &PathFinder::getNode(const int index)
+{
+    Node &node = mNodes[index];
+
+    if (node.search != mSearch)
+    {
+        node.search = mSearch;
+        node.heapIndex = NOT_VISITED;
+    }
+
+    return node;
+}
+
+void PathFinder::heapPush(const int index, const int Fcost)
+{
+    OpenEntry entry;
+    entry.Fcost = Fcost;
+    entry.index = index;
+
+    mOpenList.push_back(entry);
+    siftUp(mOpenList.size() - 1);
+}
+
+int PathFinder::heapPop()
+{
+    const int top = mOpenList.front().index;
+    const OpenEntry last = mOpenList.back();
+    mOpenList.pop_back();
+
+    if (!mOpenList.empty())
+    {
+        mOpenList[0] = last;
+        siftDown(0);
+    }
+
+    mNodes[top].heapIndex = CLOSED;
+    return top;
+}
+
+void PathFinder::siftUp(int pos)
+{
+    const OpenEntry entry = mOpenList[pos];
+
+    while (pos > 0)
+    {
+        const int parentPos = (pos - 1) / 2;
+
+        if (mOpenList[parentPos].Fcost <= entry.Fcost)
+            break;
+
+        mOpenList[pos] = mOpenList[parentPos];
+        mNodes[mOpenList[pos].index].heapIndex = pos;
+        pos = parentPos;
+    }
+
+    mOpenList[pos] = entry;
+    mNodes[entry.index].heapIndex = pos;
+}
+
+void PathFinder::siftDown(int pos)
+{
+    const int size = mOpenList.size();
+    const OpenEntry entry = mOpenList[pos];
+
+    for (;;)
+    {
+        int child = 2 * pos + 1;
+
+        if (child >= size)
+            break;
+
+        if (child + 1 < size &&
+            mOpenList[child + 1].Fcost < mOpenList[child].Fcost)
+        {
+            child++;
+        }
+
+        if (entry.Fcost <= mOpenList[child].Fcost)
+            break;
+
+        mOpenList[pos] = mOpenList[child];
+        mNodes[mOpenList[pos].index].heapIndex = pos;
+        pos = child;
+    }
+
+    mOpenList[pos] = entry;
+    mNodes[entry.index].heapIndex = pos;
+}
+
+int PathFinder::getCluster(const int x, const int y) const
+{
+    return x / CLUSTER_SIZE + y / CLUSTER_SIZE * mClustersX;
+}
+
+void PathFinder::getClusterNodes(const int cluster,
+                                 std::vector<int> &nodes) const
+{
+    nodes.clear();
+
+    // A cluster's nodes lie on its own right and bottom borders and on the
+    // right border of its left neighbour and the bottom border of the one
+    // above it.
+    int borders[4];
+    int count = 0;
+
+    borders[count++] = 2 * cluster;
+    borders[count++] = 2 * cluster + 1;
+    if (cluster % mClustersX > 0)
+        borders[count++] = 2 * (cluster - 1);
+    if (cluster >= mClustersX)
+        borders[count++] = 2 * (cluster - mClustersX) + 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        const std::vector<int> &border = mBorders[borders[i]];
+
+        for (std::vector<int>::const_iterator j = border.begin(),
+             j_end = border.end(); j != j_end; ++j)
+        {
+            if (mAbstractNodes[*j].cluster == cluster)
+                nodes.push_back(*j);
+        }
+    }
+}
+
+void PathFinder::buildHierarchy()
+{
+    mClustersX = (mWidth + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    mClustersY = (mHeight + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+
+    const int clusterCount = mClustersX * mClustersY;
+
+    mClusters.resize(clusterCount);
+    mBorders.assign(2 * clusterCount, std::vector<int>());
+    mAbstractNodes.clear();
+    mFreeNodes.clear();
+
+    for (int c = 0; c < clusterCount; c++)
+    {
+        Cluster &cluster = mClusters[c];
+        cluster.area.x1 = (c % mClustersX) * CLUSTER_SIZE;
+        cluster.area.y1 = (c / mClustersX) * CLUSTER_SIZE;
+        cluster.area.x2 = std::min(cluster.area.x1 + CLUSTER_SIZE, mWidth);
+        cluster.area.y2 = std::min(cluster.area.y1 + CLUSTER_SIZE, mHeight);
+        cluster.dirty = false;
+    }
+
+    for (int b = 0; b < 2 * clusterCount; b++)
+        buildBorder(b);
+
+    for (int c = 0; c < clusterCount; c++)
+        buildEdges(c);
+
+    mHierarchyDirty = false;
+}
+
+void PathFinder::updateHierarchy()
+{
+    if (!mHierarchyDirty)
+        return;
+
+    const int clusterCount = mClusters.size();
+    std::vector<bool> rebuilt(mBorders.size(), false);
+    std::vector<bool> changed(clusterCount, false);
+
+    for (int c = 0; c < clusterCount; c++)
+    {
+        if (!mClusters[c].dirty)
+            continue;
+
+        int borders[4];
+        int count = 0;
+
+        borders[count++] = 2 * c;
+        borders[count++] = 2 * c + 1;
+        if (c % mClustersX > 0)
+            borders[count++] = 2 * (c - 1);
+        if (c >= mClustersX)
+            borders[count++] = 2 * (c - mClustersX) + 1;
+
+        // Transitions on these borders are replaced, so the edges of the
+        // clusters on both sides have to be rebuilt.
+        for (int i = 0; i < count; i++)
+        {
+            const int b = borders[i];
+            if (rebuilt[b])
+                continue;
+
+            buildBorder(b);
+            rebuilt[b] = true;
+
+            const int first = b / 2;
+            const int second = (b % 2 == 0) ? first + 1 : first + mClustersX;
+            changed[first] = true;
+            if (second < clusterCount)
+                changed[second] = true;
+        }
+
+        changed[c] = true;
+        mClusters[c].dirty = false;
+    }
+
+    for (int c = 0; c < clusterCount; c++)
+    {
+        if (changed[c])
+            buildEdges(c);
+    }
+
+    mHierarchyDirty = false;
+}
+
+void PathFinder::buildBorder(const int border)
+{
+    // Release the current transitions
+    std::vector<int> &nodes = mBorders[border];
+
+    for (std::vector<int>::iterator i = nodes.begin(), i_end = nodes.end();
+         i != i_end; ++i)
+    {
+        mAbstractNodes[*i].index = -1;
+        mAbstractNodes[*i].edges.clear();
+        mFreeNodes.push_back(*i);
+    }
+    nodes.clear();
+
+    const int cluster = border / 2;
+    const bool vertical = (border % 2 == 0);
+    const Area &area = mClusters[cluster].area;
+
+    // Clusters at the right and bottom of the map have no neighbour there
+    if ((vertical && area.x2 == mWidth) || (!vertical && area.y2 == mHeight))
+        return;
+
+    const int neighbour = vertical ? cluster + 1 : cluster + mClustersX;
+    const int length = vertical ? area.y2 - area.y1 : area.x2 - area.x1;
+    const int first = vertical ? (area.x2 - 1) + area.y1 * mWidth
+                               : area.x1 + (area.y2 - 1) * mWidth;
+    const int step = vertical ? mWidth : 1;
+    const int across = vertical ? 1 : mWidth;
+
+    // Find the runs of tiles that are walkable on both sides of the border
+    int runStart = -1;
+
+    for (int i = 0; i <= length; i++)
+    {
+        const int index = first + i * step;
+        const bool open = i < length && isWalkable(index) &&
+                          isWalkable(index + across);
+
+        if (open && runStart < 0)
+        {
+            runStart = i;
+        }
+        else if (!open && runStart >= 0)
+        {
+            const int runLength = i - runStart;
+
+            if (runLength >= WIDE_ENTRANCE)
+            {
+                const int a = first + runStart * step;
+                const int b = first + (i - 1) * step;
+                addTransition(border, a, cluster, a + across, neighbour);
+                addTransition(border, b, cluster, b + across, neighbour);
+            }
+            else
+            {
+                const int a = first + (runStart + runLength / 2) * step;
+                addTransition(border, a, cluster, a + across, neighbour);
+            }
+
+            runStart = -1;
+        }
+    }
+}
+
+void PathFinder::addTransition(const int border, const int indexA,
+                               const int clusterA, const int indexB,
+                               const int clusterB)
+{
+    int ids[2];
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (mFreeNodes.empty())
+        {
+            ids[i] = mAbstractNodes.size();
+            mAbstractNodes.push_back(AbstractNode());
+        }
+        else
+        {
+            ids[i] = mFreeNodes.back();
+            mFreeNodes.pop_back();
+        }
+    }
+
+    AbstractNode &a = mAbstractNodes[ids[0]];
+    a.index = indexA;
+    a.cluster = clusterA;
+    a.partner = ids[1];
+
+    AbstractNode &b = mAbstractNodes[ids[1]];
+    b.index = indexB;
+    b.cluster = clusterB;
+    b.partner = ids[0];
+
+    mBorders[border].push_back(ids[0]);
+    mBorders[border].push_back(ids[1]);
+}
+
+void PathFinder::buildEdges(const int cluster)
+{
+    std::vector<int> nodes;
+    getClusterNodes(cluster, nodes);
+
+    const Area &area = mClusters[cluster].area;
+
+    // Determine the cost from each node to every other node in the cluster
+    for (std::vector<int>::iterator i = nodes.begin(), i_end = nodes.end();
+         i != i_end; ++i)
+    {
+        std::vector<Edge> &edges = mAbstractNodes[*i].edges;
+        edges.clear();
+
+        search(mAbstractNodes[*i].index, -1, area, INT_MAX);
+
+        for (std::vector<int>::iterator j = nodes.begin(); j != i_end; ++j)
+        {
+            if (j == i)
+                continue;
+
+            const int cost = getReachedCost(mAbstractNodes[*j].index);
+            if (cost < 0)
+                continue;
+
+            Edge edge;
+            edge.node = *j;
+            edge.cost = cost;
+            edges.push_back(edge);
+        }
+    }
+}
+
+PathFinder::Area PathFinder::getDestArea(const int cluster, const int destX,
+                                         const int destY) const
+{
+    Area area = mClusters[cluster].area;
+    area.x1 = std::min(area.x1, destX);
+    area.y1 = std::min(area.y1, destY);
+    area.x2 = std::max(area.x2, destX + 1);
+    area.y2 = std::max(area.y2, destY + 1);
+    return area;
+}
+
+void PathFinder::openAbstract(const int node, const int tileIndex,
+                              const int parent, const int Gcost,
+                              const int destIndex)
+{
+    AbstractState &state = mAbstractStates[node];
+
+    if (state.search != mAbstractSearch)
+    {
+        state.search = mAbstractSearch;
+        state.closed = false;
+    }
+    else if (state.closed || state.Gcost <= Gcost)
+    {
+        return;
+    }
+
+    state.Gcost = Gcost;
+    state.parent = parent;
+
+    // The H cost is the octile distance, which never overestimates the cost
+    // of the remaining route.
+    const int dx = abs(tileIndex % mWidth - destIndex % mWidth);
+    const int dy = abs(tileIndex / mWidth - destIndex / mWidth);
+    const int Hcost = 10 * std::max(dx, dy) + 4 * std::min(dx, dy);
+
+    mAbstractOpen.push_back(AbstractEntry(Gcost + Hcost, node));
+    std::push_heap(mAbstractOpen.begin(), mAbstractOpen.end(),
+                   std::greater<AbstractEntry>());
+}
+
+bool PathFinder::findAbstractPath(const int startX, const int startY,
+                                  const int destX, const int destY,
+                                  Path &path)
+{
+    updateHierarchy();
+
+    const int startIndex = startX + startY * mWidth;
+    const int destIndex = destX + destY * mWidth;
+
+    if (startIndex == destIndex)
+        return false;
+
+    const int startCluster = getCluster(startX, startY);
+    const Area &startArea = mClusters[startCluster].area;
+
+    // Temporary nodes for the start and destination are added after the
+    // transitions.
+    const int nodeCount = mAbstractNodes.size();
+    const int startNode = nodeCount;
+    const int destNode = nodeCount + 1;
+
+    // A blocked destination may be entered from a neighbouring cluster, so
+    // it is connected to all clusters from which it can be stepped on. The
+    // area searched in those clusters is extended to include it.
+    std::vector<int> destClusters;
+
+    if (isWalkable(destIndex))
+    {
+        destClusters.push_back(getCluster(destX, destY));
+    }
+    else
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                if (!isWalkable(destX + dx, destY + dy))
+                    continue;
+
+                const int cluster = getCluster(destX + dx, destY + dy);
+                if (std::find(destClusters.begin(), destClusters.end(),
+                              cluster) == destClusters.end())
+                {
+                    destClusters.push_back(cluster);
+                }
+            }
+        }
+    }
+
+    // Connect the start and destination to the transitions of their
+    // clusters. Since steps cost the same both ways, the destination is
+    // searched from as well, which works even when it is blocked.
+    std::vector<int> nodes;
+    std::vector<Edge> startEdges;
+    std::vector<Edge> destEdges;
+    int directCost = -1;
+
+    search(startIndex, -1, startArea, INT_MAX);
+    getClusterNodes(startCluster, nodes);
+
+    for (std::vector<int>::iterator i = nodes.begin(), i_end = nodes.end();
+         i != i_end; ++i)
+    {
+        const int cost = getReachedCost(mAbstractNodes[*i].index);
+        if (cost < 0)
+            continue;
+
+        Edge edge;
+        edge.node = *i;
+        edge.cost = cost;
+        startEdges.push_back(edge);
+    }
+
+    for (std::vector<int>::iterator c = destClusters.begin(),
+         c_end = destClusters.end(); c != c_end; ++c)
+    {
+        search(destIndex, -1, getDestArea(*c, destX, destY), INT_MAX);
+
+        if (*c == startCluster)
+            directCost = getReachedCost(startIndex);
+
+        getClusterNodes(*c, nodes);
+
+        for (std::vector<int>::iterator i = nodes.begin(), i_end =
+             nodes.end(); i != i_end; ++i)
+        {
+            const int cost = getReachedCost(mAbstractNodes[*i].index);
+            if (cost < 0)
+                continue;
+
+            Edge edge;
+            edge.node = *i;
+            edge.cost = cost;
+            destEdges.push_back(edge);
+        }
+    }
+
+    if ((startEdges.empty() || destEdges.empty()) && directCost < 0)
+        return false;
+
+    // Search the abstract graph
+    if (++mAbstractSearch == 0)
+    {
+        for (std::vector<AbstractState>::iterator i = mAbstractStates.begin(),
+             i_end = mAbstractStates.end(); i != i_end; ++i)
+        {
+            i->search = 0;
+        }
+        mAbstractSearch = 1;
+    }
+
+    mAbstractStates.resize(nodeCount + 2, AbstractState());
+    mAbstractOpen.clear();
+
+    openAbstract(startNode, startIndex, -1, 0, destIndex);
+
+    bool foundPath = false;
+
+    while (!mAbstractOpen.empty())
+    {
+        const int curr = mAbstractOpen.front().second;
+        std::pop_heap(mAbstractOpen.begin(), mAbstractOpen.end(),
+                      std::greater<AbstractEntry>());
+        mAbstractOpen.pop_back();
+
+        AbstractState &state = mAbstractStates[curr];
+        if (state.closed)
+            continue;
+        state.closed = true;
+
+        if (curr == destNode)
+        {
+            foundPath = true;
+            break;
+        }
+
+        const int Gcost = state.Gcost;
+
+        if (curr == startNode)
+        {
+            for (std::vector<Edge>::iterator i = startEdges.begin(),
+                 i_end = startEdges.end(); i != i_end; ++i)
+            {
+                openAbstract(i->node, mAbstractNodes[i->node].index, curr,
+                             Gcost + i->cost, destIndex);
+            }
+
+            if (directCost >= 0)
+                openAbstract(destNode, destIndex, curr, directCost, destIndex);
+
+            continue;
+        }
+
+        const AbstractNode &node = mAbstractNodes[curr];
+
+        // Crossing over to the neighbouring cluster takes a single step
+        openAbstract(node.partner, mAbstractNodes[node.partner].index, curr,
+                     Gcost + 10, destIndex);
+
+        for (std::vector<Edge>::const_iterator i = node.edges.begin(),
+             i_end = node.edges.end(); i != i_end; ++i)
+        {
+            openAbstract(i->node, mAbstractNodes[i->node].index, curr,
+                         Gcost + i->cost, destIndex);
+        }
+
+        if (std::find(destClusters.begin(), destClusters.end(),
+                      node.cluster) != destClusters.end())
+        {
+            for (std::vector<Edge>::iterator i = destEdges.begin(),
+                 i_end = destEdges.end(); i != i_end; ++i)
+            {
+                if (i->node == curr)
+                {
+                    openAbstract(destNode, destIndex, curr, Gcost + i->cost,
+                                 destIndex);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!foundPath)
+        return false;
+
+    // Collect the abstract route in walking order
+    std::vector<int> route;
+    for (int node = destNode; node != -1;
+         node = mAbstractStates[node].parent)
+    {
+        route.push_back(node);
+    }
+    std::reverse(route.begin(), route.end());
+
+    // Refine the route by searching each of its parts on the tile level
+    for (std::vector<int>::size_type i = 1; i < route.size(); i++)
+    {
+        const int from = route[i - 1];
+        const int to = route[i];
+        const int fromIndex = (from == startNode) ? startIndex
+                                                  : mAbstractNodes[from].index;
+        const int toIndex = (to == destNode) ? destIndex
+                                             : mAbstractNodes[to].index;
+
+        if (fromIndex == toIndex)
+            continue;
+
+        if (from != startNode && mAbstractNodes[from].partner == to)
+        {
+            path.push_back(Position(toIndex % mWidth, toIndex / mWidth));
+            continue;
+        }
+
+        const int cluster = (from == startNode) ? startCluster
+                                                : mAbstractNodes[from].cluster;
+        const Area area = (to == destNode)
+                          ? getDestArea(cluster, destX, destY)
+                          : mClusters[cluster].area;
+
+        if (!search(fromIndex, toIndex, area, INT_MAX))
+        {
+            path.clear();
+            return false;
+        }
+
+        appendPath(fromIndex, toIndex, path);
+    }
+
+    return true;
+}
@@ -0,0 +1,286 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include <utility>
+#include <vector>
+
+#include "position.h"
+
+/**
+ * A* path finder for a tile grid with 8-connected movement.
+ *
+ * Walkability is kept in a packed bitset, separate from the search scratch
+ * space, so that collision lookups touch as little memory as possible. The
+ * scratch space and the open list (an indexed binary heap supporting
+ * decrease-key) are allocated once and reused by every search; stale scratch
+ * entries are recognized by a search counter instead of being cleared.
+ *
+ * For long distances the grid is divided into clusters (HPA*). Transitions
+ * between neighbouring clusters and the costs of moving between them within
+ * a cluster are precomputed by buildHierarchy(), so that a long route is
+ * found by searching this small abstract graph, after which only the chosen
+ * cluster crossings are searched on the tile level. Clusters touched by
+ * setWalk() are brought up to date before the next search.
+ *
+ * This class has no dependencies on the rest of the client, so that it can
+ * be used by offline tools like the path finding benchmark.
+ */
+class PathFinder
+{
+    public:
+        /**
+         * Constructor, taking the size of the grid in tiles. All tiles start
+         * out walkable.
+         */
+        PathFinder(const int width, const int height);
+
+        /**
+         * Set walkability flag for a tile.
+         */
+        void setWalk(const int x, const int y, const bool walkable);
+
+        /**
+         * Tells whether the given tile can be walked on. Tiles outside of the
+         * grid are never walkable.
+         */
+        bool isWalkable(const int x, const int y) const
+        {
+            return contains(x, y) && isWalkable(x + y * mWidth);
+        }
+
+        /**
+         * Tells whether the given coordinates fall within the grid.
+         */
+        bool contains(const int x, const int y) const
+        { return x >= 0 && y >= 0 && x < mWidth && y < mHeight; }
+
+        /**
+         * Precomputes the cluster graph used for long distance searches.
+         * Should be called once the walkability of all tiles is known.
+         */
+        void buildHierarchy();
+
+        /**
+         * Finds a path from one location to the next, at any distance. Short
+         * routes are searched directly, longer ones through the cluster graph
+         * when it has been built.
+         *
+         * @see findPath(int, int, int, int, int, Path&)
+         */
+        bool findPath(const int startX, const int startY, const int destX,
+                      const int destY, Path &path);
+
+        /**
+         * Finds a path from one location to the next. The resulting path
+         * does not include the start location, but does include the
+         * destination, which is allowed to be blocked. Routes costing more
+         * than maxCost (10 per straight step and 14 per diagonal step) are
+         * not considered.
+         *
+         * @return <code>true</code> if a path was found, <code>false</code>
+         *         otherwise, in which case the path is left empty.
+         */
+        bool findPath(const int startX, const int startY, const int destX,
+                      const int destY, const int maxCost, Path &path);
+
+        /**
+         * Returns the cost from the start location to the given tile as
+         * determined by the last tile level search, or -1 if the tile was not
+         * reached. This is meant for debugging purposes.
+         */
+        int getCost(const int x, const int y) const;
+
+        int getWidth() const { return mWidth; }
+        int getHeight() const { return mHeight; }
+
+    private:
+        /**
+         * Search state of a single tile.
+         */
+        struct Node
+        {
+            unsigned int search;     /**< Search this node belongs to */
+            int Gcost;               /**< Cost from start to this location */
+            int parent;              /**< Index of the parent tile */
+            int heapIndex;           /**< Position on the open list, or < 0 */
+        };
+
+        /**
+         * An entry on the open list. The F cost is kept here rather than in
+         * the node, so that reordering the heap doesn't have to look up the
+         * nodes.
+         */
+        struct OpenEntry
+        {
+            int Fcost;               /**< Estimation of total path cost */
+            int index;               /**< Index of the tile */
+        };
+
+        /**
+         * A rectangular part of the grid a search is limited to.
+         */
+        struct Area
+        {
+            int x1, y1;              /**< Top left tile, inclusive */
+            int x2, y2;              /**< Bottom right tile, exclusive */
+        };
+
+        /**
+         * A cluster of tiles in the abstract graph.
+         */
+        struct Cluster
+        {
+            Area area;
+            bool dirty;              /**< Walkability changed */
+        };
+
+        /**
+         * A connection within a cluster between two abstract nodes.
+         */
+        struct Edge
+        {
+            int node;
+            int cost;
+        };
+
+        /**
+         * A tile at the edge of a cluster through which a neighbouring
+         * cluster can be entered.
+         */
+        struct AbstractNode
+        {
+            int index;               /**< Tile index, or -1 when unused */
+            int cluster;             /**< Cluster this node belongs to */
+            int partner;             /**< Node on the other side */
+            std::vector<Edge> edges; /**< Reachable nodes in the cluster */
+        };
+
+        /**
+         * Search state of an abstract node.
+         */
+        struct AbstractState
+        {
+            unsigned int search;     /**< Search this state belongs to */
+            int Gcost;               /**< Cost from start to this node */
+            int parent;              /**< Previous node on the route */
+            bool closed;             /**< Whether the node was expanded */
+        };
+
+        typedef std::pair<int, int> AbstractEntry;  /**< F cost and node */
+
+        /**
+         * Tells whether the tile with the given index can be walked on.
+         */
+        bool isWalkable(const int index) const
+        { return (mWalkable[index >> 5] >> (index & 31)) & 1; }
+
+        /**
+         * Runs an A* search between two tiles within the given area, leaving
+         * the result in the scratch space. When destIndex is negative, every
+         * reachable tile in the area is visited instead (Dijkstra).
+         */
+        bool search(const int startIndex, const int destIndex,
+                    const Area &area, const int maxCost);
+
+        /**
+         * Appends the path found by the last search to the given path.
+         */
+        void appendPath(const int startIndex, const int destIndex,
+                        Path &path) const;
+
+        /**
+         * Returns the cost of a tile reached by the last search, or -1.
+         */
+        int getReachedCost(const int index) const;
+
+        /**
+         * Returns the search state of a tile, resetting it first when it is
+         * left over from an earlier search.
+         */
+        Node &getNode(const int index);
+
+        void heapPush(const int index, const int Fcost);
+        int heapPop();
+        void siftUp(int pos);
+        void siftDown(int pos);
+
+        int getCluster(const int x, const int y) const;
+        void getClusterNodes(const int cluster, std::vector<int> &nodes) const;
+
+        /**
+         * Rebuilds the transitions and edges affected by dirty clusters.
+         */
+        void updateHierarchy();
+
+        /**
+         * Replaces the transitions on a border between two clusters. Border
+         * 2 * c is the right border of cluster c, 2 * c + 1 its bottom border.
+         */
+        void buildBorder(const int border);
+        void addTransition(const int border, const int indexA,
+                           const int clusterA, const int indexB,
+                           const int clusterB);
+        void buildEdges(const int cluster);
+
+        /**
+         * Returns the area of a cluster, extended to include the destination
+         * when it lies just outside of it.
+         */
+        Area getDestArea(const int cluster, const int destX,
+                         const int destY) const;
+
+        /**
+         * Puts an abstract node on the open list when the given route to it
+         * is shorter than any found before.
+         */
+        void openAbstract(const int node, const int tileIndex,
+                          const int parent, const int Gcost,
+                          const int destIndex);
+
+        /**
+         * Searches the cluster graph and refines the result into a path.
+         */
+        bool findAbstractPath(const int startX, const int startY,
+                              const int destX, const int destY, Path &path);
+
+        int mWidth, mHeight;
+
+        std::vector<unsigned int> mWalkable;    /**< One bit per tile */
+        std::vector<Node> mNodes;
+        std::vector<OpenEntry> mOpenList;       /**< Binary heap of tiles */
+        unsigned int mSearch;                   /**< Current search counter */
+
+        // Cluster graph
+        int mClustersX, mClustersY;
+        bool mHierarchyDirty;
+        std::vector<Cluster> mClusters;
+        std::vector<std::vector<int> > mBorders;
+        std::vector<AbstractNode> mAbstractNodes;
+        std::vector<int> mFreeNodes;
+        std::vector<AbstractState> mAbstractStates;
+        std::vector<AbstractEntry> mAbstractOpen;   /**< Min-heap of nodes */
+        unsigned int mAbstractSearch;
+};
+
+#endif
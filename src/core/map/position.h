@@ -23,8 +23,8 @@
 #ifndef POSITION_H
 #define POSITION_H
 
-#include <list>
 #include <iostream>
+#include <vector>
 
 /**
  * A position along a being's path.
@@ -42,7 +42,10 @@ struct Position
     int y;
 };
 
-typedef std::list<Position> Path;
+/**
+ * A path, stored in walking order.
+ */
+typedef std::vector<Position> Path;
 typedef Path::iterator PathIterator;
 
 /**
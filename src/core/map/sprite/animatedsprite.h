@@ -96,6 +96,16 @@ class AnimatedSprite
          */
         void setDirection(const SpriteDirection &direction);
 
+        /**
+         * Returns the frame currently shown, or NULL if there is none.
+         */
+        const Frame *getCurrentFrame() const { return mFrame; }
+
+        /**
+         * Returns the sprite definition being animated.
+         */
+        SpriteDef *getSpriteDef() const { return mSprite; }
+
     private:
         bool updateCurrentAnimation(const unsigned int dt);
 
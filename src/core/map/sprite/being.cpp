@@ -27,6 +27,7 @@
 
 #include "animatedsprite.h"
 #include "being.h"
+#include "compositecache.h"
 #include "localplayer.h"
 
 #include "../../resourcemanager.h"
@@ -47,6 +48,7 @@
 
 #include "../../../core/configuration.h"
 #include "../../../core/log.h"
+#include "../../../core/scheduler.h"
 
 #include "../../../core/map/map.h"
 
@@ -54,6 +56,8 @@
 #include "../../../core/utils/gettext.h"
 #include "../../../core/utils/stringutils.h"
 
+#include "../../../eathena/beingmanager.h"
+
 #include "../../../eathena/db/colordb.h"
 #include "../../../eathena/db/emotedb.h"
 #include "../../../eathena/db/effectdb.h"
@@ -66,6 +70,7 @@
 #include "../../../eathena/net/protocol.h"
 
 int Being::mNumberOfHairstyles = 1;
+bool Being::mCompositeSprites = true;
 
 Being::Being(const int id, const int job, Map *map):
     mJob(job),
@@ -88,7 +93,8 @@ Being::Being(const int id, const int job, Map *map):
     mSpriteIDs(VECTOREND_SPRITE, 0),
     mSpriteColors(VECTOREND_SPRITE, ""),
     mChildParticleEffects(),
-    mUsedTargetCursor(NULL)
+    mUsedTargetCursor(NULL),
+    mGridCell(-1)
 {
     setMap(map);
 
@@ -98,8 +104,6 @@ Being::Being(const int id, const int job, Map *map):
 
     mSpeechBubble = NULL;
     mText = NULL;
-
-    mLastUpdate = tick_time;
 }
 
 Being::~Being()
@@ -123,6 +127,15 @@ void Being::setDestination(const Uint16 &destX, const Uint16 &destY)
         setPath(mMap->findPath(mX, mY, destX, destY));
 }
 
+void Being::setTile(const Uint16 x, const Uint16 y)
+{
+    mX = x;
+    mY = y;
+
+    if (mGridCell >= 0 && beingManager)
+        beingManager->updateGridCell(this);
+}
+
 void Being::clearPath()
 {
     mPath.clear();
@@ -130,12 +143,13 @@ void Being::clearPath()
 
 void Being::setPath(const Path &path)
 {
-    mPath = path;
+    // Kept last step first, so that each step can be popped off the back
+    mPath.assign(path.rbegin(), path.rend());
 
     if (mAction != WALK && mAction != DEAD)
     {
         nextStep();
-        mWalkTime = tick_time;
+        mWalkTime = Scheduler::getTick();
     }
 }
 
@@ -269,7 +283,7 @@ void Being::handleAttack(Being *victim, const int damage,
         setAction(Being::ATTACK);
 
     mFrame = 0;
-    mWalkTime = tick_time;
+    mWalkTime = Scheduler::getTick();
 }
 
 void Being::setMap(Map *map)
@@ -383,8 +397,8 @@ void Being::nextStep()
         return;
     }
 
-    Position pos = mPath.front();
-    mPath.pop_front();
+    Position pos = mPath.back();
+    mPath.pop_back();
 
     int dir = 0;
     if (pos.x > mX)
@@ -404,17 +418,14 @@ void Being::nextStep()
         return;
     }
 
-    mX = pos.x;
-    mY = pos.y;
+    setTile(pos.x, pos.y);
     setAction(WALK);
-    mWalkTime += mWalkSpeed / 10;
+    mWalkTime += mWalkSpeed / Scheduler::TICK_LENGTH;
 }
 
 void Being::logic()
 {
-    const int ticks = get_elapsed_time(mLastUpdate) / 10;
-
-    mLastUpdate = tick_time;
+    const int ticks = Scheduler::getFrameTicks();
 
     // Reduce the time that speech is still displayed
     if (mSpeechTime > 0 && viewport)
@@ -474,6 +485,17 @@ void Being::draw(Graphics *graphics, const int offsetX,
     if (mUsedTargetCursor != NULL)
         mUsedTargetCursor->draw(graphics, px + widthOffset, py + heightOffset);
 
+    if (mCompositeSprites)
+    {
+        int x, y;
+        Image *image = CompositeCache::get(mSprites, x, y);
+        if (image)
+        {
+            graphics->drawImage(image, px + x, py + y);
+            return;
+        }
+    }
+
     for (int i = 0; i < VECTOREND_SPRITE; i++)
     {
         if (mSprites[i])
@@ -586,8 +608,8 @@ const int Being::getXOffset() const
     if (mAction != WALK || !(mDirection & (LEFT | RIGHT)))
         return 0;
 
-    int offset = (get_elapsed_time(mWalkTime) * mMap->getTileWidth()) /
-                 mWalkSpeed;
+    int offset = (Scheduler::getElapsedTime(mWalkTime) *
+                  mMap->getTileWidth()) / mWalkSpeed;
 
     // We calculate the offset _from_ the _target_ location
     offset -= mMap->getTileWidth();
@@ -607,8 +629,8 @@ const int Being::getYOffset() const
     if (mAction != WALK || !(mDirection & (UP | DOWN)))
         return 0;
 
-    int offset = (get_elapsed_time(mWalkTime) * mMap->getTileHeight()) /
-                 mWalkSpeed;
+    int offset = (Scheduler::getElapsedTime(mWalkTime) *
+                  mMap->getTileHeight()) / mWalkSpeed;
 
     // We calculate the offset _from_ the _target_ location
     offset -= mMap->getTileHeight();
@@ -667,5 +689,7 @@ void Being::load()
         hairstyles++;
 
     mNumberOfHairstyles = hairstyles;
+
+    mCompositeSprites = config.getValue("compositeSprites", 1);
 }
 
@@ -27,6 +27,7 @@
 
 #include <SDL_types.h>
 
+#include <list>
 #include <string>
 #include <vector>
 #include <bitset>
@@ -148,7 +149,7 @@ class Being : public Sprite
         Uint16 mX, mY;        /**< Tile coordinates */
         Action mAction;       /**< Action the being is performing */
         int mFrame;
-        int mWalkTime;
+        Uint64 mWalkTime;
         int mEmotion;         /**< Currently showing emotion */
         int mEmotionTime;     /**< Time until emotion disappears */
         int mSpeechTime;
@@ -180,6 +181,12 @@ class Being : public Sprite
          */
         virtual void setDestination(const Uint16 &destX, const Uint16 &destY);
 
+        /**
+         * Places this being on the given tile. Positions should only be
+         * changed through here, so that the being manager's grid follows.
+         */
+        void setTile(const Uint16 x, const Uint16 y);
+
         /**
          * Puts a "speech balloon" above this being for the specified amount
          * of time.
@@ -326,7 +333,7 @@ class Being : public Sprite
         /**
          * Gets the current action.
          */
-        const int getWalkTime() { return mWalkTime; }
+        const Uint64 getWalkTime() { return mWalkTime; }
 
         /**
          * Returns the direction the being is facing.
@@ -428,7 +435,10 @@ class Being : public Sprite
 
         static int mNumberOfHairstyles; /** Number of hair styles in use */
 
-        Path mPath;
+        /** Whether the sprites are drawn through the CompositeCache */
+        static bool mCompositeSprites;
+
+        Path mPath;                     /**< Remaining steps, next one last */
         std::string mSpeech;
         std::string mOldSpeech;
         Text *mText;
@@ -438,8 +448,6 @@ class Being : public Sprite
 
         const gcn::Color* mNameColor;
 
-        int mLastUpdate;
-
         std::vector<AnimatedSprite*> mSprites;
         std::vector<int> mSpriteIDs;
         std::vector<std::string> mSpriteColors;
@@ -448,8 +456,13 @@ class Being : public Sprite
         // Target cursor being used
         SimpleAnimation* mUsedTargetCursor;
     private:
+        friend class BeingManager;
+
         // Speech Bubble components
         SpeechBubble *mSpeechBubble;
+
+        /** Cell of the being manager's grid this being is filed in */
+        int mGridCell;
 };
 
 #endif
@@ -0,0 +1,184 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <algorithm>
+
+#include "animatedsprite.h"
+#include "compositecache.h"
+#include "spritedef.h"
+
+#include "../../log.h"
+
+#include "../../image/animation.h"
+#include "../../image/image.h"
+
+/** The memory the composited images may take up, in bytes */
+static const unsigned int CACHE_BUDGET = 8 * 1024 * 1024;
+
+CompositeCache::Entries CompositeCache::mEntries;
+std::map<CompositeCache::Key, CompositeCache::Entries::iterator>
+        CompositeCache::mIndex;
+unsigned int CompositeCache::mSize = 0;
+
+Image *CompositeCache::get(const std::vector<AnimatedSprite*> &sprites,
+                           int &x, int &y)
+{
+    if (Image::usesOpenGL())
+        return NULL;
+
+    Key key;
+    std::vector<SpriteDef*> spriteDefs;
+
+    for (std::vector<AnimatedSprite*>::const_iterator i = sprites.begin();
+         i != sprites.end(); ++i)
+    {
+        if (!*i)
+            continue;
+
+        const Frame *frame = (*i)->getCurrentFrame();
+        if (!frame || !frame->image)
+            continue;
+
+        Layer layer;
+        layer.image = frame->image;
+        layer.x = frame->offsetX;
+        layer.y = frame->offsetY;
+        key.push_back(layer);
+        spriteDefs.push_back((*i)->getSpriteDef());
+    }
+
+    // A single layer is drawn as fast without the cache
+    if (key.size() < 2)
+        return NULL;
+
+    std::map<Key, Entries::iterator>::iterator found = mIndex.find(key);
+    if (found != mIndex.end())
+    {
+        // Move the entry to the front
+        mEntries.splice(mEntries.begin(), mEntries, found->second);
+    }
+    else
+    {
+        create(key, spriteDefs);
+
+        while (mSize > CACHE_BUDGET && mEntries.size() > 1)
+            remove(--mEntries.end());
+    }
+
+    const Entry &entry = mEntries.front();
+    x = entry.x;
+    y = entry.y;
+    return entry.image;
+}
+
+void CompositeCache::clear()
+{
+    while (!mEntries.empty())
+        remove(mEntries.begin());
+}
+
+void CompositeCache::create(const Key &key,
+                            const std::vector<SpriteDef*> &sprites)
+{
+    Entry entry;
+    entry.key = key;
+    entry.image = NULL;
+    entry.size = 0;
+
+    // Find the area covered by all layers
+    int left = key[0].x;
+    int top = key[0].y;
+    int right = left;
+    int bottom = top;
+
+    for (Key::const_iterator i = key.begin(); i != key.end(); ++i)
+    {
+        left = std::min(left, i->x);
+        top = std::min(top, i->y);
+        right = std::max(right, i->x + i->image->getWidth());
+        bottom = std::max(bottom, i->y + i->image->getHeight());
+    }
+
+    entry.x = left;
+    entry.y = top;
+
+    // Determine 32-bit masks based on byte order
+    Uint32 rmask, gmask, bmask, amask;
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    rmask = 0xff000000;
+    gmask = 0x00ff0000;
+    bmask = 0x0000ff00;
+    amask = 0x000000ff;
+#else
+    rmask = 0x000000ff;
+    gmask = 0x0000ff00;
+    bmask = 0x00ff0000;
+    amask = 0xff000000;
+#endif
+
+    SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, right - left,
+                                                bottom - top, 32, rmask,
+                                                gmask, bmask, amask);
+    if (surface)
+    {
+        SDL_FillRect(surface, NULL, 0);
+
+        for (Key::const_iterator i = key.begin(); i != key.end(); ++i)
+            i->image->compositeTo(surface, i->x - left, i->y - top);
+
+        entry.image = Image::load(surface);
+        entry.size = surface->pitch * surface->h;
+        SDL_FreeSurface(surface);
+    }
+    else
+    {
+        logger->log("Error: Could not create composited sprite: %s",
+                    SDL_GetError());
+    }
+
+    // Failures are remembered as well, so they aren't retried every frame
+    entry.sprites = sprites;
+    for (std::vector<SpriteDef*>::iterator i = entry.sprites.begin();
+         i != entry.sprites.end(); ++i)
+    {
+        (*i)->incRef();
+    }
+
+    mEntries.push_front(entry);
+    mIndex[key] = mEntries.begin();
+    mSize += entry.size;
+}
+
+void CompositeCache::remove(Entries::iterator entry)
+{
+    delete entry->image;
+
+    for (std::vector<SpriteDef*>::iterator i = entry->sprites.begin();
+         i != entry->sprites.end(); ++i)
+    {
+        (*i)->decRef();
+    }
+
+    mSize -= entry->size;
+    mIndex.erase(entry->key);
+    mEntries.erase(entry);
+}
@@ -0,0 +1,112 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef COMPOSITECACHE_H
+#define COMPOSITECACHE_H
+
+#include <list>
+#include <map>
+#include <vector>
+
+class AnimatedSprite;
+class Image;
+class SpriteDef;
+
+/**
+ * Keeps the current frames of layered sprites, like a player with their
+ * equipment, flattened into single images. Beings wearing the same things
+ * share these, and a being only needs one draw call per frame.
+ *
+ * The frames are identified by their images, so a cached image stops being
+ * used as soon as the equipment, colors, action, direction or frame of a
+ * being changes. The least recently used images are dropped when the cache
+ * grows too large. Only works for the SDL renderer, since it needs the pixels
+ * of the frames.
+ */
+class CompositeCache
+{
+    public:
+        /**
+         * Returns the current frames of the given sprites drawn on top of
+         * each other in order, creating the image if needed. Returns NULL
+         * when there is nothing to gain, or the frames can't be composited.
+         *
+         * @param sprites the sprites, which may contain NULL entries
+         * @param x       set to the offset the image should be drawn at
+         * @param y       set to the offset the image should be drawn at
+         */
+        static Image *get(const std::vector<AnimatedSprite*> &sprites,
+                          int &x, int &y);
+
+        /**
+         * Frees all cached images.
+         */
+        static void clear();
+
+    private:
+        struct Layer
+        {
+            const Image *image;
+            int x, y;
+
+            bool operator<(const Layer &other) const
+            {
+                if (image != other.image)
+                    return image < other.image;
+                if (x != other.x)
+                    return x < other.x;
+                return y < other.y;
+            }
+        };
+
+        typedef std::vector<Layer> Key;
+
+        struct Entry
+        {
+            Key key;
+            Image *image;
+            int x, y;
+            unsigned int size;                /**< In bytes */
+
+            /** Keeps the images of the layers from being freed */
+            std::vector<SpriteDef*> sprites;
+        };
+
+        typedef std::list<Entry> Entries;
+
+        /**
+         * Draws the layers into a new entry at the front of the list.
+         */
+        static void create(const Key &key,
+                           const std::vector<SpriteDef*> &sprites);
+
+        /**
+         * Frees an entry, and removes it from the list and the index.
+         */
+        static void remove(Entries::iterator entry);
+
+        static Entries mEntries;                /**< Most recently used first */
+        static std::map<Key, Entries::iterator> mIndex;
+        static unsigned int mSize;              /**< Bytes used by the images */
+};
+
+#endif
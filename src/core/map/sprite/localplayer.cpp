@@ -31,6 +31,7 @@
 
 #include "../../configuration.h"
 #include "../../resourcemanager.h"
+#include "../../scheduler.h"
 
 #include "../../image/animation.h"
 #include "../../image/imageset.h"
@@ -60,6 +61,16 @@
 
 LocalPlayer *player_node = NULL;
 
+/**
+ * The maximum number of steps sent to the server as a single destination.
+ * The server refuses to walk paths much longer than this, so long routes are
+ * walked towards in parts.
+ */
+static const Path::size_type MAX_WAYPOINT_STEPS = 24;
+
+/** Time stamp of an event that didn't happen. */
+static const Uint64 NO_TIME = (Uint64) -1;
+
 LocalPlayer::LocalPlayer(const Uint32 &id, const Uint16 &job, Map *map):
     Player(id, job, map),
     mCharId(0),
@@ -79,8 +90,9 @@ LocalPlayer::LocalPlayer(const Uint32 &id, const Uint16 &job, Map *map):
     mXp(0),
     mTarget(NULL), mPickUpTarget(NULL),
     mTrading(false), mGoingToTarget(false), mKeepAttacking(false),
-    mTargetTime(-1), mLastAction(-1), mWalkingDir(0),
+    mTargetTime(NO_TIME), mLastAction(NO_TIME), mWalkingDir(0),
     mDestX(0), mDestY(0),
+    mWaypointX(0), mWaypointY(0),
     mInventory(new Inventory(INVENTORY_SIZE)),
     mStorage(new Inventory(STORAGE_SIZE))
 {
@@ -120,7 +132,7 @@ void LocalPlayer::logic()
            break;
 
         case WALK:
-            mFrame = (get_elapsed_time(mWalkTime) * 6) / mWalkSpeed;
+            mFrame = (Scheduler::getElapsedTime(mWalkTime) * 6) / mWalkSpeed;
             if (mFrame >= 6)
                 nextStep();
             break;
@@ -134,7 +146,8 @@ void LocalPlayer::logic()
                 mEquippedWeapon->getAttackType() == ACTION_ATTACK_BOW)
                 frames = 5;
 
-            mFrame = (get_elapsed_time(mWalkTime) * frames) / mAttackSpeed;
+            mFrame = (Scheduler::getElapsedTime(mWalkTime) * frames) /
+                     mAttackSpeed;
 
             //attack particle effect
             if (mEquippedWeapon)
@@ -172,13 +185,13 @@ void LocalPlayer::logic()
     }
 
     // Actions are allowed once per second
-    if (get_elapsed_time(mLastAction) >= 1000)
-        mLastAction = -1;
+    if (Scheduler::getElapsedTime(mLastAction) >= 1000)
+        mLastAction = NO_TIME;
 
     // Remove target if its been on a being for more than a minute
-    if (get_elapsed_time(mTargetTime) >= 60000)
+    if (Scheduler::getElapsedTime(mTargetTime) >= 60000)
     {
-        mTargetTime = -1;
+        mTargetTime = NO_TIME;
         setTarget(NULL);
     }
 
@@ -207,7 +220,7 @@ void LocalPlayer::setAction(const Action &action)
 {
     if (action == DEAD)
     {
-        mTargetTime = -1;
+        mTargetTime = NO_TIME;
         setTarget(NULL);
     }
 
@@ -267,6 +280,13 @@ void LocalPlayer::nextStep()
         mPath.clear();
     }
 
+    // Tell the server about the next part of a long route
+    if (!mPath.empty() && mX == mWaypointX && mY == mWaypointY &&
+        (mWaypointX != mDestX || mWaypointY != mDestY))
+    {
+        sendWaypoint(mPath);
+    }
+
     Player::nextStep();
 }
 
@@ -378,11 +398,11 @@ void LocalPlayer::setTarget(Being *target)
         target = NULL;
 
     if (target || mAction == ATTACK)
-        mTargetTime = tick_time;
+        mTargetTime = Scheduler::getTick();
     else
     {
         mKeepAttacking = false;
-        mTargetTime = -1;
+        mTargetTime = NO_TIME;
     }
 
     if (mTarget)
@@ -399,18 +419,44 @@ void LocalPlayer::setTarget(Being *target)
 
 void LocalPlayer::setDestination(const Uint16 &x, const Uint16 &y)
 {
+    Path path;
+
+    if (mMap)
+        path = mMap->findPath(mX, mY, x, y);
+
     // Only send a new message to the server when destination changes
     if (x != mDestX || y != mDestY)
     {
         mDestX = x;
         mDestY = y;
 
-        MessageOut outMsg(0x0085);
-        outMsg.writeCoordinates(x, y, mDirection);
+        sendWaypoint(Path(path.rbegin(), path.rend()));
     }
 
     mPickUpTarget = NULL;
-    Being::setDestination(x, y);
+
+    if (mMap)
+        setPath(path);
+}
+
+void LocalPlayer::sendWaypoint(const Path &path)
+{
+    // When the destination is near or can't be reached, leave it up to the
+    // server. Otherwise walk up to a point along the way.
+    if (path.size() <= MAX_WAYPOINT_STEPS)
+    {
+        mWaypointX = mDestX;
+        mWaypointY = mDestY;
+    }
+    else
+    {
+        const Position &waypoint = path[path.size() - MAX_WAYPOINT_STEPS];
+        mWaypointX = waypoint.x;
+        mWaypointY = waypoint.y;
+    }
+
+    MessageOut outMsg(0x0085);
+    outMsg.writeCoordinates(mWaypointX, mWaypointY, mDirection);
 }
 
 void LocalPlayer::setWalkingDir(const int dir)
@@ -441,10 +487,10 @@ void LocalPlayer::raiseSkill(const Uint16 &skillId)
 
 void LocalPlayer::toggleSit()
 {
-    if (mLastAction != -1)
+    if (mLastAction != NO_TIME)
         return;
 
-    mLastAction = tick_time;
+    mLastAction = Scheduler::getTick();
 
     char type;
     switch (mAction)
@@ -466,10 +512,10 @@ void LocalPlayer::toggleSit()
 
 void LocalPlayer::emote(const Uint8 &emotion)
 {
-    if (mLastAction != -1)
+    if (mLastAction != NO_TIME)
         return;
 
-    mLastAction = tick_time;
+    mLastAction = Scheduler::getTick();
 
     MessageOut outMsg(0x00bf);
     outMsg.writeInt8(emotion);
@@ -528,8 +574,8 @@ void LocalPlayer::attack(Being *target, const bool keep)
             setDirection(LEFT);
     }
 
-    mWalkTime = tick_time;
-    mTargetTime = tick_time;
+    mWalkTime = Scheduler::getTick();
+    mTargetTime = Scheduler::getTick();
 
     if (target->getType() != Being::NPC)
         setAction(ATTACK);
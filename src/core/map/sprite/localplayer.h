@@ -264,15 +264,25 @@ class LocalPlayer : public Player
         bool mInStorage;      /**< Whether storage is currently accessible */
         bool mGoingToTarget;
         bool mKeepAttacking;  /** Whether or not to continue to attack */
-        int mTargetTime;      /** How long the being has been targeted **/
-        int mLastAction;      /**< Time stamp of the last action, -1 if none. */
+        Uint64 mTargetTime;   /** How long the being has been targeted **/
+        Uint64 mLastAction;   /**< Time stamp of the last action, NO_TIME if
+                                   none. */
         int mWalkingDir;      /**< The direction the player is walking in. */
         int mDestX;           /**< X coordinate of destination. */
         int mDestY;           /**< Y coordinate of destination. */
+        int mWaypointX;       /**< X coordinate sent to the server. */
+        int mWaypointY;       /**< Y coordinate sent to the server. */
 
         Inventory *mInventory;
         Inventory *mStorage;
 
+        /**
+         * Tells the server to walk towards the destination along the given
+         * path, which may be too long to be sent at once. Like mPath, the
+         * path is stored in reverse, with the next step last.
+         */
+        void sendWaypoint(const Path &path);
+
         // Load the target cursors into memory
         void initTargetCursor();
 
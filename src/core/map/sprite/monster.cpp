@@ -36,6 +36,8 @@
 #include "../../../core/image/image.h"
 #include "../../../core/image/simpleanimation.h"
 
+#include "../../../core/scheduler.h"
+
 #include "../../../core/map/map.h"
 
 #include "../../../core/utils/dtor.h"
@@ -103,7 +105,7 @@ void Monster::logic()
 {
     if (mAction != STAND)
     {
-        mFrame = (get_elapsed_time(mWalkTime) * 4) / mWalkSpeed;
+        mFrame = (Scheduler::getElapsedTime(mWalkTime) * 4) / mWalkSpeed;
 
         if (mFrame >= 4 && mAction != DEAD)
             nextStep();
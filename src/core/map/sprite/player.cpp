@@ -32,6 +32,8 @@
 #include "../../../bindings/guichan/palette.h"
 #include "../../../bindings/guichan/text.h"
 
+#include "../../../core/scheduler.h"
+
 #include "../../../core/map/map.h"
 
 #include "../../../core/utils/dtor.h"
@@ -127,7 +129,7 @@ void Player::logic()
            break;
 
         case WALK:
-            mFrame = (get_elapsed_time(mWalkTime) * 6) / mWalkSpeed;
+            mFrame = (Scheduler::getElapsedTime(mWalkTime) * 6) / mWalkSpeed;
 
             if (mFrame >= 6)
                 nextStep();
@@ -145,7 +147,8 @@ void Player::logic()
                 frames = 5;
             }
 
-            mFrame = (get_elapsed_time(mWalkTime) * frames) / mAttackSpeed;
+            mFrame = (Scheduler::getElapsedTime(mWalkTime) * frames) /
+                     mAttackSpeed;
 
             //attack particle effect
             if (mEquippedWeapon)
@@ -63,6 +63,14 @@ class Sprite
          * Returns the pixel Y coordinate of the sprite.
          */
         virtual const int getPixelY() const = 0;
+
+        /**
+         * Returns whether the sprite may draw anything inside the given area
+         * of the map, in pixels. Sprites outside of the screen are neither
+         * sorted nor drawn, so when unsure this should return true.
+         */
+        virtual bool isInArea(const int left, const int top, const int right,
+                              const int bottom) const { return true; }
 };
 
 #endif
@@ -35,6 +35,10 @@
 #include "image/image.h"
 #include "image/imageset.h"
 
+#include "image/particle/particleeffect.h"
+
+#include "map/map.h"
+
 #include "map/sprite/spritedef.h"
 
 #include "sound/music.h"
@@ -46,21 +50,39 @@
 
 ResourceManager *ResourceManager::instance = NULL;
 
+/**
+ * Seconds the decoded pixels of a dyed image are kept around for, in case more
+ * colors of it are needed.
+ */
+static const int DECODED_SURFACE_TIME = 10;
+
+/** The memory kept decoded surfaces may take up, in bytes */
+static const unsigned int DECODED_SURFACE_BUDGET = 16 * 1024 * 1024;
+
 ResourceManager::ResourceManager()
-  : mOldestOrphan(0)
+  : mOldestOrphan(0),
+    mDecodedSize(0)
 {
     logger->log("Initializing resource manager...");
 }
 
 ResourceManager::~ResourceManager()
 {
+    for (DecodedSurfaces::iterator i = mDecodedSurfaces.begin();
+         i != mDecodedSurfaces.end(); ++i)
+    {
+        SDL_FreeSurface(i->second.surface);
+    }
+
     mResources.insert(mOrphanedResources.begin(), mOrphanedResources.end());
 
-    // Release any remaining spritedefs first because they depend on image sets
+    // Release any remaining spritedefs and particle effects first because
+    // they depend on image sets and images
     ResourceIterator iter = mResources.begin();
     while (iter != mResources.end())
     {
-        if (dynamic_cast<SpriteDef*>(iter->second) != 0)
+        if (dynamic_cast<SpriteDef*>(iter->second) != 0 ||
+            dynamic_cast<ParticleEffect*>(iter->second) != 0)
         {
             cleanUp(iter->second);
             ResourceIterator toErase = iter;
@@ -145,11 +167,87 @@ void ResourceManager::cleanOrphans()
     mOldestOrphan = oldest;
 }
 
+SDL_Surface *ResourceManager::getDecodedSurface(const std::string &path)
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+
+    DecodedSurfaces::iterator i = mDecodedSurfaces.find(path);
+    if (i != mDecodedSurfaces.end())
+    {
+        i->second.lastUsed = tv.tv_sec;
+        return i->second.surface;
+    }
+
+    SDL_Surface *tmp = loadSDLSurface(path);
+    if (!tmp)
+    {
+        logger->log("Error, image load failed: %s", IMG_GetError());
+        return NULL;
+    }
+
+    SDL_Surface *surface = Image::convertToRGBA(tmp);
+    SDL_FreeSurface(tmp);
+
+    if (!surface)
+        return NULL;
+
+    DecodedSurface &decoded = mDecodedSurfaces[path];
+    decoded.surface = surface;
+    decoded.lastUsed = tv.tv_sec;
+    mDecodedSize += surface->pitch * surface->h;
+
+    return surface;
+}
+
+void ResourceManager::cleanDecodedSurfaces()
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    const time_t threshold = tv.tv_sec - DECODED_SURFACE_TIME;
+
+    DecodedSurfaces::iterator i = mDecodedSurfaces.begin();
+    while (i != mDecodedSurfaces.end())
+    {
+        if (i->second.lastUsed < threshold)
+        {
+            mDecodedSize -= i->second.surface->pitch * i->second.surface->h;
+            SDL_FreeSurface(i->second.surface);
+            mDecodedSurfaces.erase(i++);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    while (mDecodedSize > DECODED_SURFACE_BUDGET)
+    {
+        DecodedSurfaces::iterator oldest = mDecodedSurfaces.begin();
+        for (i = mDecodedSurfaces.begin(); i != mDecodedSurfaces.end(); ++i)
+        {
+            if (i->second.lastUsed < oldest->second.lastUsed)
+                oldest = i;
+        }
+
+        mDecodedSize -= oldest->second.surface->pitch *
+                        oldest->second.surface->h;
+        SDL_FreeSurface(oldest->second.surface);
+        mDecodedSurfaces.erase(oldest);
+    }
+}
+
 bool ResourceManager::setWriteDir(const std::string &path)
 {
     return (bool) PHYSFS_setWriteDir(path.c_str());
 }
 
+std::string ResourceManager::getWriteDir() const
+{
+    const char *path = PHYSFS_getWriteDir();
+    return path ? path : "";
+}
+
 bool ResourceManager::addToSearchPath(const std::string &path,
                                       const bool append)
 {
@@ -248,6 +346,7 @@ Resource *ResourceManager::get(const std::string &idPath, generator fun,
         resource->mIdPath = idPath;
         mResources[idPath] = resource;
         cleanOrphans();
+        cleanDecodedSurfaces();
     }
 
     // Returns NULL if the object could not be created.
@@ -316,24 +415,34 @@ struct DyedImageLoader
     static Resource *load(void *v)
     {
         DyedImageLoader *l = static_cast< DyedImageLoader * >(v);
-        std::string path = l->path;
+        const std::string &path = l->path;
         std::string::size_type p = path.find('|');
-        Dye *d = NULL;
-        if (p != std::string::npos)
+
+        if (p == std::string::npos)
         {
-            d = new Dye(path.substr(p + 1));
-            path = path.substr(0, p);
+            int fileSize;
+            void *buffer = l->manager->loadFile(path, fileSize);
+            if (!buffer)
+                return NULL;
+
+            Resource *res = Image::load(buffer, fileSize);
+            free(buffer);
+            return res;
         }
 
-        int fileSize;
-        void *buffer = l->manager->loadFile(path, fileSize);
-        if (!buffer)
+        // Other colors of the same image are likely to follow, so the file
+        // is decoded once and each color recolors a copy of it
+        SDL_Surface *base = l->manager->getDecodedSurface(path.substr(0, p));
+        if (!base)
             return NULL;
 
-        Resource *res = d ? Image::load(buffer, fileSize, *d)
-                          : Image::load(buffer, fileSize);
-        free(buffer);
-        destroy(d);
+        SDL_Surface *surface = Image::convertToRGBA(base);
+        if (!surface)
+            return NULL;
+
+        Dye d(path.substr(p + 1));
+        Resource *res = Image::load(surface, d);
+        SDL_FreeSurface(surface);
         return res;
     }
 };
@@ -344,6 +453,23 @@ Image *ResourceManager::getImage(const std::string &idPath)
     return static_cast<Image*>(get(idPath, DyedImageLoader::load, &l));
 }
 
+struct SurfaceImageLoader
+{
+    SDL_Surface *surface;
+    static Resource *load(void *v)
+    {
+        SurfaceImageLoader *l = static_cast< SurfaceImageLoader * >(v);
+        return Image::load(l->surface);
+    }
+};
+
+Image *ResourceManager::getImage(const std::string &idPath,
+                                 SDL_Surface *surface)
+{
+    SurfaceImageLoader l = { surface };
+    return static_cast<Image*>(get(idPath, SurfaceImageLoader::load, &l));
+}
+
 struct ResizedImageLoader
 {
     ResourceManager *manager;
@@ -419,6 +545,30 @@ SpriteDef *ResourceManager::getSprite(const std::string &path,
     return static_cast<SpriteDef*>(get(ss.str(), SpriteDefLoader::load, &l));
 }
 
+struct ParticleEffectLoader
+{
+    std::string path;
+    Map *map;
+    static Resource *load(void *v)
+    {
+        ParticleEffectLoader *l = static_cast< ParticleEffectLoader * >(v);
+        return ParticleEffect::load(l->path, l->map);
+    }
+};
+
+ParticleEffect *ResourceManager::getParticleEffect(const std::string &path,
+                                                   Map *map)
+{
+    ParticleEffectLoader l = { path, map };
+    std::stringstream ss;
+    ss << path << "[";
+    if (map)
+        ss << map->getTileWidth() << "x" << map->getTileHeight();
+    ss << "]";
+    return static_cast<ParticleEffect*>(get(ss.str(),
+                                            ParticleEffectLoader::load, &l));
+}
+
 void ResourceManager::release(Resource *res)
 {
     ResourceIterator resIter = mResources.find(res->mIdPath);
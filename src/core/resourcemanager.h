@@ -34,7 +34,9 @@
 
 class Image;
 class ImageSet;
+class Map;
 class Music;
+class ParticleEffect;
 class Resource;
 class SoundEffect;
 class SpriteDef;
@@ -72,6 +74,12 @@ class ResourceManager
          */
         bool setWriteDir(const std::string &path);
 
+        /**
+         * Returns the real path of the write directory, or an empty string
+         * when none has been set.
+         */
+        std::string getWriteDir() const;
+
         /**
          * Adds a directory or archive to the search path. If append is true
          * then the directory is added to the end of the search path, otherwise
@@ -150,6 +158,12 @@ class ResourceManager
          */
         Image *getImage(const std::string &idPath);
 
+        /**
+         * Returns the image with the given id, creating it from the given
+         * surface if it isn't loaded yet. The surface isn't freed.
+         */
+        Image *getImage(const std::string &idPath, SDL_Surface *surface);
+
         /**
          * Convenience wrapper around ResourceManager::get for loading
          * resized images.
@@ -188,6 +202,13 @@ class ResourceManager
          */
         SpriteDef *getSprite(const std::string &path, const int variant = 0);
 
+        /**
+         * Creates a particle effect based on a given path. Effects are parsed
+         * once for each tile size, since the offsets of their animations
+         * depend on the map they are placed on.
+         */
+        ParticleEffect *getParticleEffect(const std::string &path, Map *map);
+
         /**
          * Releases a resource, placing it in the set of orphaned resources.
          */
@@ -216,6 +237,13 @@ class ResourceManager
          */
         SDL_Surface *loadSDLSurface(const std::string& filename);
 
+        /**
+         * Returns the decoded pixels of an image file in the layout used for
+         * dyeing, decoding the file only if that wasn't done recently. The
+         * surface is owned by the resource manager.
+         */
+        SDL_Surface *getDecodedSurface(const std::string &path);
+
         /**
          * Returns an instance of the class, creating one if it does not
          * already exist.
@@ -235,12 +263,27 @@ class ResourceManager
 
         void cleanOrphans();
 
+        /**
+         * Frees the decoded surfaces that haven't been used for a while, and
+         * the least recently used ones while they take too much memory.
+         */
+        void cleanDecodedSurfaces();
+
         static ResourceManager *instance;
         typedef std::map<std::string, Resource*> Resources;
         typedef Resources::iterator ResourceIterator;
         Resources mResources;
         Resources mOrphanedResources;
         time_t mOldestOrphan;
+
+        struct DecodedSurface
+        {
+            SDL_Surface *surface;
+            time_t lastUsed;
+        };
+        typedef std::map<std::string, DecodedSurface> DecodedSurfaces;
+        DecodedSurfaces mDecodedSurfaces;
+        unsigned int mDecodedSize;      /**< Bytes used by the surfaces */
 };
 
 #endif
@@ -0,0 +1,57 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <SDL_timer.h>
+
+#include "scheduler.h"
+
+Uint64 Scheduler::mTick = 0;
+Uint32 Scheduler::mLastTime = 0;
+int Scheduler::mTime = 0;
+int Scheduler::mFrameTicks = 0;
+bool Scheduler::mStarted = false;
+
+void Scheduler::beginFrame()
+{
+    const Uint32 now = SDL_GetTicks();
+
+    if (!mStarted)
+    {
+        mLastTime = now;
+        mStarted = true;
+    }
+
+    // The unsigned difference stays correct when SDL_GetTicks wraps
+    Uint32 elapsed = now - mLastTime;
+    mLastTime = now;
+
+    // Drop the time which is beyond what may be caught up on
+    if (elapsed > (Uint32) (MAX_FRAME_TICKS * TICK_LENGTH))
+        elapsed = MAX_FRAME_TICKS * TICK_LENGTH;
+
+    // Less than a tick is left over from before, so this never exceeds
+    // MAX_FRAME_TICKS
+    mTime += elapsed;
+    mFrameTicks = mTime / TICK_LENGTH;
+    mTime -= mFrameTicks * TICK_LENGTH;
+    mTick += mFrameTicks;
+}
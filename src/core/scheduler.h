@@ -0,0 +1,84 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <SDL_types.h>
+
+/**
+ * Paces the game logic in ticks of a fixed length. At the start of each
+ * frame, the time passed since the previous frame is turned into ticks,
+ * which the game logic then runs through. The number of ticks run in one
+ * frame is limited, so that a slow frame doesn't cause even more work in
+ * the next one. The time beyond that limit is dropped.
+ */
+class Scheduler
+{
+    public:
+        /** Length of a tick in milliseconds. */
+        static const int TICK_LENGTH = 10;
+
+        /** Maximum number of ticks run in one frame. */
+        static const int MAX_FRAME_TICKS = 10;
+
+        /**
+         * Determines the ticks to run in the frame being started. Called
+         * once at the start of each frame.
+         */
+        static void beginFrame();
+
+        /**
+         * Returns the number of ticks to run in the current frame.
+         */
+        static int getFrameTicks() { return mFrameTicks; }
+
+        /**
+         * Returns the number of ticks run since the start, which only ever
+         * increases. Use this to time stamp events.
+         */
+        static Uint64 getTick() { return mTick; }
+
+        /**
+         * Returns the time in milliseconds that passed since the given tick
+         * was current.
+         */
+        static int getElapsedTime(const Uint64 tick)
+        { return tick < mTick ? (int) ((mTick - tick) * TICK_LENGTH) : 0; }
+
+        /**
+         * Returns how far the time has advanced towards the next tick,
+         * between 0 and 1. Used to interpolate between the state of the
+         * last two ticks when drawing.
+         */
+        static float getAlpha()
+        { return (float) mTime / (float) TICK_LENGTH; }
+
+    private:
+        static Uint64 mTick;        /**< Ticks run since the start */
+        static Uint32 mLastTime;    /**< SDL time of the previous frame */
+        static int mTime;           /**< Time not yet run, in ms */
+        static int mFrameTicks;     /**< Ticks to run in this frame */
+        static bool mStarted;
+};
+
+#endif
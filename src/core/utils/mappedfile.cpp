@@ -0,0 +1,135 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mappedfile.h"
+
+MappedFile::MappedFile():
+    mData(NULL),
+    mSize(0)
+#ifdef WIN32
+    , mFile(INVALID_HANDLE_VALUE),
+    mMapping(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef WIN32
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    const DWORD size = GetFileSize(mFile, NULL);
+    if (size == INVALID_FILE_SIZE || size == 0)
+    {
+        close();
+        return false;
+    }
+
+    mMapping = CreateFileMapping(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping)
+        mData = (const unsigned char*) MapViewOfFile(mMapping, FILE_MAP_READ,
+                                                     0, 0, 0);
+    if (!mData)
+    {
+        close();
+        return false;
+    }
+
+    mSize = size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMapping)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mData = NULL;
+    mSize = 0;
+    mFile = INVALID_HANDLE_VALUE;
+    mMapping = NULL;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after closing the file
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    mData = (const unsigned char*) data;
+    mSize = info.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData)
+        munmap((void*) mData, mSize);
+
+    mData = NULL;
+    mSize = 0;
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+
+/**
+ * Read-only access to the contents of a file, by mapping it into memory.
+ * This saves copying the data, and only the parts actually used are read
+ * from disk.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+     * Maps the file at the given path, unmapping the previous one.
+     */
+    bool open(const std::string &path);
+
+    void close();
+
+    const unsigned char *getData() const { return mData; }
+
+    unsigned int getSize() const { return mSize; }
+
+private:
+    MappedFile(const MappedFile&);  // prevent copying
+    MappedFile& operator=(const MappedFile&);
+
+    const unsigned char *mData;
+    unsigned int mSize;
+
+#ifdef WIN32
+    void *mFile;
+    void *mMapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+/**
+ * A small pseudo random number generator (xorshift). Unlike rand(), each
+ * instance has its own state, so threads can draw numbers without sharing
+ * a lock, and a given seed always gives the same sequence.
+ */
+class Random
+{
+    public:
+        static const unsigned int MAX = 0x7fffffff;
+
+        Random(const unsigned int seed = 1) { setSeed(seed); }
+
+        /**
+         * Restarts the sequence from the given seed. The seed is scrambled
+         * first, so that consecutive seeds give unrelated sequences.
+         */
+        void setSeed(unsigned int seed)
+        {
+            seed ^= seed >> 16;
+            seed *= 0x7feb352d;
+            seed ^= seed >> 15;
+            seed *= 0x846ca68b;
+            seed ^= seed >> 16;
+
+            // The state may never become zero
+            mState = seed ? seed : 0x9e3779b9;
+        }
+
+        /**
+         * Returns a number between 0 and MAX.
+         */
+        unsigned int next()
+        {
+            mState ^= mState << 13;
+            mState ^= mState >> 17;
+            mState ^= mState << 5;
+            return (mState >> 1) & MAX;
+        }
+
+        /**
+         * Returns a number between 0 and range - 1.
+         */
+        int next(const int range) { return (int) (next() % range); }
+
+        /**
+         * Returns a number between 0 and 1, excluding 1.
+         */
+        double nextUnit() { return next() / ((double) MAX + 1); }
+
+    private:
+        unsigned int mState;
+};
+
+#endif
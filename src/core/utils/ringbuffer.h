@@ -0,0 +1,229 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * Makes sure memory accesses before the barrier are not reordered with those
+ * after it, by either the compiler or the processor.
+ */
+inline void memoryBarrier()
+{
+#if defined(__GNUC__)
+    __sync_synchronize();
+#elif defined(_MSC_VER)
+    _ReadWriteBarrier();
+#endif
+}
+
+/**
+ * A byte queue for passing data from one thread to another without locking.
+ * Exactly one thread may write to it and exactly one other thread may read
+ * from it. Each side only modifies its own position, and the barriers make
+ * sure the data is in place before the other side can see the new position.
+ *
+ * The data is never moved. Instead, both sides get direct access to the
+ * contiguous blocks of the buffer that they may write to or read from.
+ */
+class RingBuffer
+{
+public:
+    /**
+     * Constructor. The size has to be a power of two.
+     */
+    RingBuffer(unsigned int size);
+    ~RingBuffer();
+
+    /**
+     * Empties the buffer. May only be called while no other thread is
+     * using it.
+     */
+    void clear();
+
+    unsigned int getSize() const { return mSize; }
+
+    /**
+     * Returns the number of bytes that can be read. Reading side only.
+     */
+    unsigned int getReadable() const;
+
+    /**
+     * Returns the number of bytes that can be written. Writing side only.
+     */
+    unsigned int getWritable() const;
+
+    /**
+     * Returns the byte at the given offset from the read position. Reading
+     * side only.
+     */
+    unsigned char peek(unsigned int offset) const;
+
+    /**
+     * Returns the data at the given offset from the read position, and the
+     * number of bytes that can be read from there before the end of the
+     * buffer wraps around. Reading side only.
+     */
+    const char *getReadBlock(unsigned int offset,
+                             unsigned int &length) const;
+
+    /**
+     * Copies bytes starting at the given offset from the read position,
+     * taking care of the wrap around. Reading side only.
+     */
+    void copy(unsigned int offset, unsigned int length, char *dest) const;
+
+    /**
+     * Marks the given number of bytes as read, allowing them to be
+     * overwritten. Reading side only.
+     */
+    void consume(unsigned int length);
+
+    /**
+     * Returns where to write to, and the number of bytes that can be
+     * written there before the end of the buffer wraps around. Writing side
+     * only.
+     */
+    char *getWriteBlock(unsigned int &length);
+
+    /**
+     * Makes the given number of bytes written to the write block available
+     * for reading. Writing side only.
+     */
+    void commit(unsigned int length);
+
+private:
+    RingBuffer(const RingBuffer&);  // prevent copying
+    RingBuffer& operator=(const RingBuffer&);
+
+    char *mData;
+    const unsigned int mSize;
+    const unsigned int mMask;
+
+    // Both positions keep increasing and wrap around naturally, so that
+    // their difference is always the amount of data in the buffer.
+    volatile unsigned int mReadPos;
+    volatile unsigned int mWritePos;
+};
+
+
+inline RingBuffer::RingBuffer(unsigned int size):
+    mData(new char[size]),
+    mSize(size),
+    mMask(size - 1),
+    mReadPos(0),
+    mWritePos(0)
+{
+}
+
+inline RingBuffer::~RingBuffer()
+{
+    delete[] mData;
+}
+
+inline void RingBuffer::clear()
+{
+    mReadPos = 0;
+    mWritePos = 0;
+    memoryBarrier();
+}
+
+inline unsigned int RingBuffer::getReadable() const
+{
+    const unsigned int readable = mWritePos - mReadPos;
+
+    // Don't look at the data before knowing it has been written
+    memoryBarrier();
+    return readable;
+}
+
+inline unsigned int RingBuffer::getWritable() const
+{
+    const unsigned int writable = mSize - (mWritePos - mReadPos);
+
+    // Don't overwrite the data before knowing it has been read
+    memoryBarrier();
+    return writable;
+}
+
+inline unsigned char RingBuffer::peek(unsigned int offset) const
+{
+    return (unsigned char) mData[(mReadPos + offset) & mMask];
+}
+
+inline const char *RingBuffer::getReadBlock(unsigned int offset,
+                                            unsigned int &length) const
+{
+    const unsigned int start = (mReadPos + offset) & mMask;
+    length = mSize - start;
+    return mData + start;
+}
+
+inline void RingBuffer::copy(unsigned int offset, unsigned int length,
+                             char *dest) const
+{
+    unsigned int contiguous;
+    const char *data = getReadBlock(offset, contiguous);
+
+    if (length <= contiguous)
+    {
+        memcpy(dest, data, length);
+    }
+    else
+    {
+        memcpy(dest, data, contiguous);
+        memcpy(dest + contiguous, mData, length - contiguous);
+    }
+}
+
+inline void RingBuffer::consume(unsigned int length)
+{
+    // Finish reading before handing the space back to the writer
+    memoryBarrier();
+    mReadPos = mReadPos + length;
+}
+
+inline char *RingBuffer::getWriteBlock(unsigned int &length)
+{
+    const unsigned int writable = getWritable();
+    const unsigned int start = mWritePos & mMask;
+
+    length = mSize - start;
+    if (length > writable)
+        length = writable;
+
+    return mData + start;
+}
+
+inline void RingBuffer::commit(unsigned int length)
+{
+    // Finish writing before handing the data to the reader
+    memoryBarrier();
+    mWritePos = mWritePos + length;
+}
+
+#endif // RINGBUFFER_H
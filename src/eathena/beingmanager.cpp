@@ -20,11 +20,15 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include "beingmanager.h"
 
 #include "net/messageout.h"
 #include "net/protocol.h"
 
+#include "../core/map/map.h"
+
 #include "../core/map/sprite/localplayer.h"
 #include "../core/map/sprite/monster.h"
 #include "../core/map/sprite/npc.h"
@@ -32,24 +36,16 @@
 
 #include "../core/utils/dtor.h"
 
-class FindBeingFunctor
-{
-    public:
-        bool operator() (Being *being)
-        {
-            Uint16 other_y = y + ((being->getType() == Being::NPC) ? 1 : 0);
-            return (being->mX == x &&
-                    (being->mY == y || being->mY == other_y) &&
-                    being->mAction != Being::DEAD &&
-                    (type == Being::UNKNOWN || being->getType() == type));
-        }
-
-        Uint16 x, y;
-        Being::Type type;
-} beingFinder;
+/**
+ * Size in tiles of the cells of the grid used to look up beings by location.
+ */
+static const int GRID_CELL_SIZE = 8;
 
-BeingManager::BeingManager()
+BeingManager::BeingManager():
+    mMap(NULL),
+    mGridWidth(0), mGridHeight(0)
 {
+    resetGrid();
 }
 
 BeingManager::~BeingManager()
@@ -69,6 +65,8 @@ void BeingManager::refreshParticleEffects() const
 void BeingManager::setMap(Map *map)
 {
     mMap = map;
+    resetGrid();
+
     if (player_node)
         player_node->setMap(map);
 }
@@ -77,6 +75,7 @@ void BeingManager::setPlayer(LocalPlayer *player)
 {
     player_node = player;
     mBeings.push_back(player);
+    addBeing(player);
 }
 
 Being *BeingManager::createBeing(int id, Uint16 job)
@@ -100,6 +99,7 @@ Being *BeingManager::createBeing(int id, Uint16 job)
     }
 
     mBeings.push_back(being);
+    addBeing(being);
 
     return being;
 }
@@ -107,54 +107,81 @@ Being *BeingManager::createBeing(int id, Uint16 job)
 void BeingManager::destroyBeing(Being *being)
 {
     mBeings.remove(being);
+    removeBeing(being);
     destroy(being);
 }
 
 Being *BeingManager::findBeing(int id) const
 {
-    for (Beings::const_iterator i = mBeings.begin(), i_end = mBeings.end();
-         i != i_end; ++i)
-    {
-        Being *being = (*i);
+    const BeingIds::const_iterator i = mBeingIds.find(id);
 
-        if (being->getId() == id)
-            return being;
-    }
-    return NULL;
+    return (i == mBeingIds.end()) ? NULL : i->second;
 }
 
 Being *BeingManager::findBeing(int x, int y, Being::Type type) const
 {
-    beingFinder.x = x;
-    beingFinder.y = y;
-    beingFinder.type = type;
+    // NPCs can also be found at the tile above them
+    const int gx = getGridX(x);
 
-    Beings::const_iterator i = find_if(mBeings.begin(), mBeings.end(),
-                                       beingFinder);
+    for (int gy = getGridY(y); gy <= getGridY(y + 1); gy++)
+    {
+        const GridCell &cell = mGrid[gx + gy * mGridWidth];
 
-    return (i == mBeings.end()) ? NULL : *i;
+        for (GridCell::const_iterator i = cell.begin(), i_end = cell.end();
+             i != i_end; ++i)
+        {
+            Being *being = (*i);
+            const int otherY = y + ((being->getType() == Being::NPC) ? 1 : 0);
+
+            if (being->mX == x &&
+                (being->mY == y || being->mY == otherY) &&
+                being->mAction != Being::DEAD &&
+                (type == Being::UNKNOWN || being->getType() == type))
+            {
+                return being;
+            }
+        }
+    }
+
+    return NULL;
 }
 
 Being *BeingManager::findBeingByPixel(int x, int y) const
 {
-    Beings::const_iterator itr = mBeings.begin();
-    Beings::const_iterator itr_end = mBeings.end();
+    // Beings are drawn around their tile, and may be walking from the
+    // previous one, so look in the neighbouring cells as well
+    int x1 = 0, y1 = 0, x2 = mGridWidth - 1, y2 = mGridHeight - 1;
 
-    for (; itr != itr_end; ++itr)
+    if (mMap)
     {
-        Being *being = (*itr);
-
-        int xtol = being->getWidth();
-        int uptol = being->getHeight() / 2;
+        getGridRange(x / mMap->getTileWidth(), y / mMap->getTileHeight(),
+                     GRID_CELL_SIZE, x1, y1, x2, y2);
+    }
 
-        if ((being->mAction != Being::DEAD) &&
-            (being != player_node) &&
-            (being->getPixelX() <= x) &&
-            (being->getPixelX() + xtol >= x) &&
-            (being->getPixelY() - uptol <= y) &&
-            (being->getPixelY() + uptol >= y))
+    for (int gy = y1; gy <= y2; gy++)
+    {
+        for (int gx = x1; gx <= x2; gx++)
         {
-            return being;
+            const GridCell &cell = mGrid[gx + gy * mGridWidth];
+
+            for (GridCell::const_iterator i = cell.begin(),
+                 i_end = cell.end(); i != i_end; ++i)
+            {
+                Being *being = (*i);
+
+                int xtol = being->getWidth();
+                int uptol = being->getHeight() / 2;
+
+                if ((being->mAction != Being::DEAD) &&
+                    (being != player_node) &&
+                    (being->getPixelX() <= x) &&
+                    (being->getPixelX() + xtol >= x) &&
+                    (being->getPixelY() - uptol <= y) &&
+                    (being->getPixelY() + uptol >= y))
+                {
+                    return being;
+                }
+            }
         }
     }
 
@@ -182,6 +209,10 @@ const Beings &BeingManager::getAll() const
 
 void BeingManager::logic()
 {
+    // Beings can't do anything while the map is being loaded
+    if (!mMap)
+        return;
+
     Beings::iterator i = mBeings.begin();
     while (i != mBeings.end())
     {
@@ -191,11 +222,14 @@ void BeingManager::logic()
 
         if (being->mAction == Being::DEAD && being->mFrame >= 20)
         {
+            removeBeing(being);
             destroy(being);
             i = mBeings.erase(i);
         }
         else
+        {
             ++i;
+        }
     }
 }
 
@@ -206,9 +240,12 @@ void BeingManager::clear()
 
     delete_all(mBeings);
     mBeings.clear();
+    mBeingIds.clear();
 
     if (player_node)
         mBeings.push_back(player_node);
+
+    resetGrid();
 }
 
 Being *BeingManager::findNearestLivingBeing(int x, int y, int maxdist,
@@ -217,22 +254,32 @@ Being *BeingManager::findNearestLivingBeing(int x, int y, int maxdist,
     Being *closestBeing = NULL;
     int dist = 0;
 
-    Beings::const_iterator itr = mBeings.begin();
-    Beings::const_iterator itr_end = mBeings.end();
+    // Only the cells within the maximum distance need to be checked
+    int x1, y1, x2, y2;
+    getGridRange(x, y, maxdist, x1, y1, x2, y2);
 
-    for (; itr != itr_end; ++itr)
+    for (int gy = y1; gy <= y2; gy++)
     {
-        Being *being = (*itr);
-        int d = abs(being->mX - x) + abs(being->mY - y);
-
-        if ((being->getType() == type || (type == Being::UNKNOWN &&
-             being->getType() != Being::WARP))
-                && (d < dist || closestBeing == NULL)   // it is closer
-                && being->mAction != Being::DEAD        // no dead beings
-                && being != player_node)                // it is not you
+        for (int gx = x1; gx <= x2; gx++)
         {
-            dist = d;
-            closestBeing = being;
+            const GridCell &cell = mGrid[gx + gy * mGridWidth];
+
+            for (GridCell::const_iterator i = cell.begin(),
+                 i_end = cell.end(); i != i_end; ++i)
+            {
+                Being *being = (*i);
+                int d = abs(being->mX - x) + abs(being->mY - y);
+
+                if ((being->getType() == type || (type == Being::UNKNOWN &&
+                     being->getType() != Being::WARP))
+                        && (d < dist || closestBeing == NULL) // it is closer
+                        && being->mAction != Being::DEAD      // no dead beings
+                        && being != player_node)              // it is not you
+                {
+                    dist = d;
+                    closestBeing = being;
+                }
+            }
         }
     }
 
@@ -247,25 +294,52 @@ Being *BeingManager::findNearestLivingBeing(Being *aroundBeing, int maxdist,
     int x = aroundBeing->mX;
     int y = aroundBeing->mY;
 
-    for (Beings::const_iterator i = mBeings.begin(), i_end = mBeings.end();
-         i != i_end; ++i)
-    {
-        Being *being = (*i);
-        int d = abs(being->mX - x) + abs(being->mY - y);
+    // Only the cells within the maximum distance need to be checked
+    int x1, y1, x2, y2;
+    getGridRange(x, y, maxdist, x1, y1, x2, y2);
 
-        if ((being->getType() == type || type == Being::UNKNOWN)
-                && (d < dist || closestBeing == NULL)   // it is closer
-                && being->mAction != Being::DEAD        // no dead beings
-                && being != aroundBeing)
+    for (int gy = y1; gy <= y2; gy++)
+    {
+        for (int gx = x1; gx <= x2; gx++)
         {
-            dist = d;
-            closestBeing = being;
+            const GridCell &cell = mGrid[gx + gy * mGridWidth];
+
+            for (GridCell::const_iterator i = cell.begin(),
+                 i_end = cell.end(); i != i_end; ++i)
+            {
+                Being *being = (*i);
+                int d = abs(being->mX - x) + abs(being->mY - y);
+
+                if ((being->getType() == type || type == Being::UNKNOWN)
+                        && (d < dist || closestBeing == NULL) // it is closer
+                        && being->mAction != Being::DEAD      // no dead beings
+                        && being != aroundBeing)
+                {
+                    dist = d;
+                    closestBeing = being;
+                }
+            }
         }
     }
 
     return (maxdist >= dist) ? closestBeing : NULL;
 }
 
+bool BeingManager::isOccupied(int x, int y) const
+{
+    const GridCell &cell = mGrid[getGridX(x) + getGridY(y) * mGridWidth];
+
+    for (GridCell::const_iterator i = cell.begin(), i_end = cell.end();
+         i != i_end; ++i)
+    {
+        // job 45 is a portal, they don't collide
+        if ((*i)->mX == x && (*i)->mY == y && (*i)->mJob != 45)
+            return true;
+    }
+
+    return false;
+}
+
 bool BeingManager::hasBeing(Being *being)
 {
     for (Beings::const_iterator i = mBeings.begin(), i_end = mBeings.end();
@@ -277,3 +351,97 @@ bool BeingManager::hasBeing(Being *being)
 
     return false;
 }
+
+void BeingManager::addBeing(Being *being)
+{
+    mBeingIds[being->getId()] = being;
+
+    being->mGridCell = getGridX(being->mX) + getGridY(being->mY) * mGridWidth;
+    mGrid[being->mGridCell].push_back(being);
+}
+
+void BeingManager::removeBeing(Being *being)
+{
+    const BeingIds::iterator i = mBeingIds.find(being->getId());
+    if (i != mBeingIds.end() && i->second == being)
+        mBeingIds.erase(i);
+
+    if (being->mGridCell < 0)
+        return;
+
+    GridCell &cell = mGrid[being->mGridCell];
+    GridCell::iterator j = std::find(cell.begin(), cell.end(), being);
+    if (j != cell.end())
+    {
+        *j = cell.back();
+        cell.pop_back();
+    }
+
+    being->mGridCell = -1;
+}
+
+void BeingManager::updateGridCell(Being *being)
+{
+    const int gridCell = getGridX(being->mX) +
+                         getGridY(being->mY) * mGridWidth;
+
+    if (gridCell == being->mGridCell)
+        return;
+
+    GridCell &cell = mGrid[being->mGridCell];
+    GridCell::iterator i = std::find(cell.begin(), cell.end(), being);
+    if (i != cell.end())
+    {
+        *i = cell.back();
+        cell.pop_back();
+    }
+
+    being->mGridCell = gridCell;
+    mGrid[gridCell].push_back(being);
+}
+
+void BeingManager::resetGrid()
+{
+    // Without a map all beings share a single cell
+    mGridWidth = 1;
+    mGridHeight = 1;
+
+    if (mMap)
+    {
+        mGridWidth = std::max((mMap->getWidth() + GRID_CELL_SIZE - 1) /
+                              GRID_CELL_SIZE, 1);
+        mGridHeight = std::max((mMap->getHeight() + GRID_CELL_SIZE - 1) /
+                               GRID_CELL_SIZE, 1);
+    }
+
+    mGrid.clear();
+    mGrid.resize(mGridWidth * mGridHeight);
+    mBeingIds.clear();
+
+    for (Beings::const_iterator i = mBeings.begin(), i_end = mBeings.end();
+         i != i_end; ++i)
+    {
+        addBeing(*i);
+    }
+}
+
+void BeingManager::getGridRange(int x, int y, int dist, int &x1, int &y1,
+                                int &x2, int &y2) const
+{
+    const int cells = dist / GRID_CELL_SIZE + 1;
+
+    x1 = std::max(getGridX(x) - cells, 0);
+    y1 = std::max(getGridY(y) - cells, 0);
+    x2 = std::min(getGridX(x) + cells, mGridWidth - 1);
+    y2 = std::min(getGridY(y) + cells, mGridHeight - 1);
+}
+
+int BeingManager::getGridX(int x) const
+{
+    return std::min(std::max(x / GRID_CELL_SIZE, 0), mGridWidth - 1);
+}
+
+int BeingManager::getGridY(int y) const
+{
+    return std::min(std::max(y / GRID_CELL_SIZE, 0), mGridHeight - 1);
+}
@@ -23,6 +23,9 @@
 #ifndef BEINGMANAGER_H
 #define BEINGMANAGER_H
 
+#include <map>
+#include <vector>
+
 #include "../core/map/sprite/being.h"
 
 class LocalPlayer;
@@ -101,6 +104,11 @@ class BeingManager
         Being *findNearestLivingBeing(Being *aroundBeing, int maxdist,
                                       Being::Type type = Being::UNKNOWN) const;
 
+        /**
+         * Returns whether the given tile is blocked by a being.
+         */
+        bool isOccupied(int x, int y) const;
+
         /**
          * Returns the whole list of beings.
          */
@@ -125,9 +133,58 @@ class BeingManager
          */
         void clear();
 
+        /**
+         * Files a being under the grid cell containing its current tile,
+         * when it has moved to another cell. Called by Being::setTile.
+         */
+        void updateGridCell(Being *being);
+
     protected:
         Beings mBeings;
         Map *mMap;
+
+    private:
+        typedef std::map<int, Being*> BeingIds;
+        typedef std::vector<Being*> GridCell;
+
+        /**
+         * Adds a being to the id lookup and to the grid.
+         */
+        void addBeing(Being *being);
+
+        /**
+         * Removes a being from the id lookup and from the grid.
+         */
+        void removeBeing(Being *being);
+
+        /**
+         * Resizes the grid to cover the current map and refiles all beings.
+         */
+        void resetGrid();
+
+        /**
+         * Returns the range of grid cells containing all tiles within the
+         * given distance of a tile.
+         */
+        void getGridRange(int x, int y, int dist, int &x1, int &y1, int &x2,
+                          int &y2) const;
+
+        /**
+         * Return the grid column or row containing the given tile
+         * coordinate, clamped to the grid.
+         */
+        int getGridX(int x) const;
+        int getGridY(int y) const;
+
+        BeingIds mBeingIds;         /**< Beings by id */
+
+        /**
+         * Uniform grid over the map, in which each cell lists the beings
+         * standing on its tiles. Queries by location only look at the cells
+         * around that location.
+         */
+        std::vector<GridCell> mGrid;
+        int mGridWidth, mGridHeight;
 };
 
 extern BeingManager *beingManager;
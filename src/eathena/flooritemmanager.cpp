@@ -34,11 +34,45 @@ FloorItemManager::~FloorItemManager()
 FloorItem* FloorItemManager::create(const int id, const int itemId,
                                     const int x, const int y, Map *map)
 {
+    if (!map)
+    {
+        const PendingItem pending = { id, itemId, x, y };
+        mPendingItems.push_back(pending);
+        return NULL;
+    }
+
     FloorItem *floorItem = new FloorItem(id, itemId, x, y, map);
     mFloorItems.push_back(floorItem);
     return floorItem;
 }
 
+void FloorItemManager::setMap(Map *map)
+{
+    if (!map)
+        return;
+
+    for (PendingItems::iterator i = mPendingItems.begin(),
+         i_end = mPendingItems.end(); i != i_end; ++i)
+    {
+        create(i->id, i->itemId, i->x, i->y, map);
+    }
+
+    mPendingItems.clear();
+}
+
+void FloorItemManager::removePending(const int id)
+{
+    for (PendingItems::iterator i = mPendingItems.begin();
+         i != mPendingItems.end(); ++i)
+    {
+        if (i->id == id)
+        {
+            mPendingItems.erase(i);
+            return;
+        }
+    }
+}
+
 void FloorItemManager::destroy(FloorItem *item)
 {
     mFloorItems.remove(item);
@@ -51,6 +85,7 @@ void FloorItemManager::clear()
 {
     delete_all(mFloorItems);
     mFloorItems.clear();
+    mPendingItems.clear();
 }
 
 FloorItem *FloorItemManager::findById(const int id)
@@ -33,9 +33,23 @@ class FloorItemManager
     public:
         ~FloorItemManager();
 
+        /**
+         * Creates a floor item on the given map. While no map is loaded the
+         * item is queued instead, and NULL is returned.
+         */
         FloorItem* create(const int id, const int itemId, const int x,
                           const int y, Map *map);
 
+        /**
+         * Creates the items queued while the map was loading.
+         */
+        void setMap(Map *map);
+
+        /**
+         * Forgets a queued item that was removed before the map was loaded.
+         */
+        void removePending(const int id);
+
         void destroy(FloorItem *item);
 
         void clear();
@@ -48,6 +62,13 @@ class FloorItemManager
         typedef FloorItems::iterator FloorItemIterator;
         FloorItems mFloorItems;
 
+        struct PendingItem
+        {
+            int id, itemId, x, y;
+        };
+        typedef std::list<PendingItem> PendingItems;
+        PendingItems mPendingItems;
+
 };
 
 // TODO Get rid of the global?
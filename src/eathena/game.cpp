@@ -88,9 +88,11 @@
 
 #include "../core/configuration.h"
 #include "../core/log.h"
+#include "../core/scheduler.h"
 
 #include "../core/image/particle/particle.h"
 
+#include "../core/map/sprite/compositecache.h"
 #include "../core/map/sprite/localplayer.h"
 
 #include "../core/utils/dtor.h"
@@ -268,8 +270,6 @@ Game::Game():
     msg.writeInt32(tick_time);
 
     viewport->changeMap(map_path);
-
-    mGameTime = tick_time;
 }
 
 Game::~Game()
@@ -279,6 +279,7 @@ Game::~Game()
     destroy(beingManager);
     destroy(floorItemManager);
     destroy(player_node);
+    CompositeCache::clear();
     destroy(particleEngine);
     destroy(viewport);
 
@@ -300,17 +301,10 @@ void Game::logic()
     beingManager->logic();
 
     // Update the particle engine
-    // TODO: Modify the particle engine to be able to update asynchronously
-    //       based on the ticks elapsed since the last update.
-    while (get_elapsed_time(mGameTime) > 0)
-    {
-        particleEngine->update();
-        mGameTime++;
-    }
+    for (int i = Scheduler::getFrameTicks(); i > 0; i--)
+        particleEngine->update(Particle::mainRandom);
 
     if (!network->isConnected())
         network->interrupt();
-
-    mGameTime = tick_time;
 }
 
@@ -37,8 +37,6 @@ class Game
         void logic();
 
     private:
-        int mGameTime;
-
         typedef const std::auto_ptr<MessageHandler> MessageHandlerPtr;
         MessageHandlerPtr mBeingHandler;
         MessageHandlerPtr mBuySellHandler;
@@ -29,9 +29,10 @@
 
 #include "../../bindings/guichan/widgets/window.h"
 
+class Label;
+class ListBox;
 class ShopListBox;
 class ShopListModel;
-class ListBox;
 
 /**
  * The buy dialog.
@@ -115,10 +116,10 @@ class BuyDialog : public Window, public gcn::SelectionListener
         gcn::Button *mAddMaxButton;
         ShopListBox *mShopItemList;
         gcn::ScrollArea *mScrollArea;
-        gcn::Label *mItemDescLabel;
-        gcn::Label *mItemEffectLabel;
-        gcn::Label *mMoneyLabel;
-        gcn::Label *mQuantityLabel;
+        Label *mItemDescLabel;
+        Label *mItemEffectLabel;
+        Label *mMoneyLabel;
+        Label *mQuantityLabel;
         gcn::Slider *mSlider;
 
         ShopListModel *mShopListModel;
@@ -28,6 +28,7 @@
 #include "../../core/map/sprite/being.h"
 
 class BeingBox;
+class Label;
 class Player;
 
 /**
@@ -70,13 +71,13 @@ class CharCreateDialog : public Window
         void attemptCharCreate();
 
         gcn::TextField *mNameField;
-        gcn::Label *mNameLabel;
+        Label *mNameLabel;
         gcn::Button *mNextHairColorButton;
         gcn::Button *mPrevHairColorButton;
-        gcn::Label *mHairColorLabel;
+        Label *mHairColorLabel;
         gcn::Button *mNextHairStyleButton;
         gcn::Button *mPrevHairStyleButton;
-        gcn::Label *mHairStyleLabel;
+        Label *mHairStyleLabel;
         gcn::Button *mCreateButton;
         gcn::Button *mCancelButton;
 
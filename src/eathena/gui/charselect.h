@@ -28,6 +28,7 @@
 #include "../../core/map/sprite/being.h"
 
 class BeingBox;
+class Label;
 class LocalPlayer;
 
 template<class T>
@@ -76,10 +77,10 @@ class CharSelectDialog : public Window
         gcn::Button *mPreviousButton;
         gcn::Button *mNextButton;
 
-        gcn::Label *mNameLabel;
-        gcn::Label *mLevelLabel;
-        gcn::Label *mJobLevelLabel;
-        gcn::Label *mMoneyLabel;
+        Label *mNameLabel;
+        Label *mLevelLabel;
+        Label *mJobLevelLabel;
+        Label *mMoneyLabel;
 
         BeingBox *mBeingBox;
 
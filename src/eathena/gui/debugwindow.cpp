@@ -23,8 +23,12 @@
 #include "debugwindow.h"
 #include "viewport.h"
 
+#include "../net/network.h"
+
+#include "../../bindings/guichan/graphics.h"
 #include "../../bindings/guichan/gui.h"
 #include "../../bindings/guichan/layout.h"
+#include "../../bindings/guichan/truetypefont.h"
 
 #include "../../bindings/guichan/widgets/label.h"
 
@@ -32,20 +36,23 @@
 
 #include "../../core/image/particle/particle.h"
 
+#include "../../core/scheduler.h"
+
 #include "../../core/map/map.h"
 
 #include "../../core/utils/gettext.h"
 #include "../../core/utils/stringutils.h"
 
 DebugWindow::DebugWindow():
-    Window(_("Debug"))
+    Window(_("Debug")),
+    mTextCacheTime(0)
 {
     setWindowName("Debug");
     saveVisibility(false);
 
     setResizable(true);
     setCloseButton(true);
-    setDefaultSize(400, 100, ImageRect::CENTER);
+    setDefaultSize(400, 185, ImageRect::CENTER);
 
     mFPSLabel = new Label(strprintf(_("%d FPS"), 0));
     mMusicFileLabel = new Label(strprintf(_("Music: %s"), ""));
@@ -53,6 +60,14 @@ DebugWindow::DebugWindow():
     mMiniMapLabel = new Label(strprintf(_("Minimap: %s"), ""));
     mTileMouseLabel = new Label(strprintf(_("Cursor: (%d, %d)"), 0, 0));
     mParticleCountLabel = new Label(strprintf(_("Particle count: %d"), 0));
+    mNetworkLabel = new Label(strprintf(_("Sent: %u packets, %u bytes, "
+                                          "%u stalls"), 0, 0, 0));
+    mTextCacheLabel = new Label(strprintf(_("Text cache: %u hits, %u misses, "
+                                            "%u evictions, %u KiB"),
+                                          0, 0, 0, 0));
+
+    for (int i = 0; i < PACKET_LABELS; i++)
+        mPacketLabels[i] = new Label("");
 
     fontChanged();
     loadWindowState();
@@ -74,6 +89,11 @@ void DebugWindow::fontChanged()
     place(3, 1, mParticleCountLabel);
     place(0, 2, mMapLabel, 4);
     place(0, 3, mMiniMapLabel, 4);
+    place(0, 4, mNetworkLabel, 4);
+    place(0, 5, mTextCacheLabel, 4);
+
+    for (int i = 0; i < PACKET_LABELS; i++)
+        place(0, 6 + i, mPacketLabels[i], 4);
 
     restoreFocus();
 }
@@ -96,15 +116,73 @@ void DebugWindow::logic()
     if (!isVisible())
         return;
 
-    mFPSLabel->setCaption(strprintf(_("%d FPS"), fps));
+    const int drawCalls = graphics->getDrawCalls();
+    if (drawCalls > 0)
+        mFPSLabel->setCaption(strprintf(_("%d FPS, %d draw calls"), fps,
+                                        drawCalls));
+    else
+        mFPSLabel->setCaption(strprintf(_("%d FPS"), fps));
     mMusicFileLabel->setCaption(strprintf(_("Music: %s"),
                                           sound.getCurrentTrack().c_str()));
 
+    // Drawing the label uses the text cache too, so only update it about
+    // once a second, like the frame rate
+    if (Scheduler::getElapsedTime(mTextCacheTime) >= 1000)
+    {
+        const TrueTypeFont::CacheStatistics &textCache =
+            TrueTypeFont::getCacheStatistics();
+        mTextCacheLabel->setCaption(strprintf(_("Text cache: %u hits, "
+                                                "%u misses, %u evictions, "
+                                                "%u KiB"),
+                                              textCache.hits,
+                                              textCache.misses,
+                                              textCache.evictions,
+                                              textCache.size / 1024));
+        mTextCacheTime = Scheduler::getTick();
+    }
+
+    if (network)
+    {
+        mNetworkLabel->setCaption(strprintf(_("Sent: %u packets, %u bytes, "
+                                              "%u stalls"),
+                                            network->getPacketsQueued(),
+                                            network->getBytesSent(),
+                                            network->getSendStalls()));
+
+        // Show where handling received messages takes the most time, when
+        // statistics are kept on it
+        std::vector<Uint16> busiest;
+        if (network->isStatisticsEnabled())
+            busiest = network->getBusiestPackets(PACKET_LABELS);
+
+        for (int i = 0; i < PACKET_LABELS; i++)
+        {
+            if (i >= (int) busiest.size())
+            {
+                mPacketLabels[i]->setCaption("");
+                continue;
+            }
+
+            const PacketStatistics &stats =
+                network->getStatistics(busiest[i]);
+
+            mPacketLabels[i]->setCaption(strprintf(_("Packet %04x: %u "
+                                                     "received, %.1f ms, "
+                                                     "%.1f ms max"),
+                                                   busiest[i], stats.count,
+                                                   stats.totalTime / 1000.0,
+                                                   stats.maxTime / 1000.0));
+        }
+    }
+
     if (!viewport)
         return;
 
     Map *currentMap = viewport->getMap();
 
+    if (!currentMap)
+        return;
+
     // Get the current mouse position
     const int mouseTileX = (gui->getMouseX() + viewport->getCameraX()) /
                             currentMap->getTileWidth();
@@ -114,13 +192,10 @@ void DebugWindow::logic()
     mTileMouseLabel->setCaption(strprintf(_("Cursor: (%d, %d)"), mouseTileX,
                                             mouseTileY));
 
-    if (currentMap)
-    {
-        mMiniMapLabel->setCaption(strprintf(_("Minimap: %s"),
-                                            currentMap->getProperty("minimap").c_str()));
-        mMapLabel->setCaption(strprintf(_("Map: %s"),
-                                        viewport->getMapPath().c_str()));
-    }
+    mMiniMapLabel->setCaption(strprintf(_("Minimap: %s"),
+                                        currentMap->getProperty("minimap").c_str()));
+    mMapLabel->setCaption(strprintf(_("Map: %s"),
+                                    viewport->getMapPath().c_str()));
 
     mParticleCountLabel->setCaption(strprintf(_("Particle count: %d"),
                                                  Particle::particleCount));
@@ -23,8 +23,12 @@
 #ifndef DEBUGWINDOW_H
 #define DEBUGWINDOW_H
 
+#include <SDL_types.h>
+
 #include "../../bindings/guichan/widgets/window.h"
 
+class Label;
+
 /**
  * The debug window.
  *
@@ -51,9 +55,16 @@ class DebugWindow : public Window
 
         void fontChanged();
     private:
-        gcn::Label *mMusicFileLabel, *mMapLabel, *mMiniMapLabel;
-        gcn::Label *mTileMouseLabel, *mFPSLabel;
-        gcn::Label *mParticleCountLabel;
+        Label *mMusicFileLabel, *mMapLabel, *mMiniMapLabel;
+        Label *mTileMouseLabel, *mFPSLabel;
+        Label *mParticleCountLabel;
+        Label *mNetworkLabel;
+        Label *mTextCacheLabel;
+        Uint64 mTextCacheTime;  /**< Tick of the last text cache update */
+
+        /** The number of busiest message types to show */
+        static const int PACKET_LABELS = 3;
+        Label *mPacketLabels[PACKET_LABELS];
 };
 
 extern DebugWindow *debugWindow;
@@ -31,6 +31,7 @@
 
 class Item;
 class ItemContainer;
+class Label;
 class ProgressBar;
 
 /**
@@ -119,8 +120,8 @@ class InventoryWindow : public Window, public gcn::SelectionListener
         gcn::Button *mUseButton, *mDropButton;
         gcn::ScrollArea *mInvenScroll;
 
-        gcn::Label *mWeightLabel;
-        gcn::Label *mSlotsLabel;
+        Label *mWeightLabel;
+        Label *mSlotsLabel;
 
         ProgressBar *mWeightBar;
         ProgressBar *mSlotsBar;
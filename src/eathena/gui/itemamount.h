@@ -29,6 +29,7 @@ class Icon;
 class IntTextField;
 class Item;
 class ItemPopup;
+class Label;
 
 #define AMOUNT_TRADE_ADD 1
 #define AMOUNT_ITEM_DROP 2
@@ -70,7 +71,7 @@ class ItemAmountWindow : public Window
 
         void fontChanged();
     private:
-        gcn::Label *mItemAmountLabel;   /**< Item amount caption. */
+        Label *mItemAmountLabel;   /**< Item amount caption. */
 
         gcn::Button *mOkButton;
         gcn::Button *mCancelButton;
@@ -32,6 +32,8 @@
 
 #include "../../bindings/guichan/widgets/window.h"
 
+class Label;
+
 /**
  * The login dialog.
  *
@@ -98,11 +100,11 @@ class LoginDialog : public Window, public gcn::KeyListener,
          */
         static unsigned short getUShort(const std::string &str);
 
-        gcn::Label *mUserLabel;
-        gcn::Label *mPassLabel;
-        gcn::Label *mServerLabel;
-        gcn::Label *mPortLabel;
-        gcn::Label *mDropdownLabel;
+        Label *mUserLabel;
+        Label *mPassLabel;
+        Label *mServerLabel;
+        Label *mPortLabel;
+        Label *mDropdownLabel;
         gcn::TextField *mUserField;
         gcn::TextField *mPassField;
         gcn::TextField *mServerField;
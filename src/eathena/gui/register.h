@@ -29,6 +29,7 @@
 
 #include "../../bindings/guichan/widgets/window.h"
 
+class Label;
 class OkDialog;
 class WrongDataNoticeListener;
 
@@ -106,11 +107,11 @@ class RegisterDialog : public Window, public gcn::KeyListener
          */
         static unsigned short getUShort(const std::string &str);
 
-        gcn::Label *mUserLabel;
-        gcn::Label *mPasswordLabel;
-        gcn::Label *mConfirmLabel;
-        gcn::Label *mServerLabel;
-        gcn::Label *mPortLabel;
+        Label *mUserLabel;
+        Label *mPasswordLabel;
+        Label *mConfirmLabel;
+        Label *mServerLabel;
+        Label *mPortLabel;
 
         gcn::TextField *mUserField;
         gcn::TextField *mPasswordField;
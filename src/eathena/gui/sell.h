@@ -28,6 +28,7 @@
 #include "../../bindings/guichan/widgets/window.h"
 
 class Item;
+class Label;
 class ShopListBox;
 class ShopListModel;
 
@@ -110,10 +111,10 @@ class SellDialog : public Window, public gcn::SelectionListener
         gcn::Button *mAddMaxButton;
         ShopListBox *mShopItemList;
         gcn::ScrollArea *mScrollArea;
-        gcn::Label *mMoneyLabel;
-        gcn::Label *mItemDescLabel;
-        gcn::Label *mItemEffectLabel;
-        gcn::Label *mQuantityLabel;
+        Label *mMoneyLabel;
+        Label *mItemDescLabel;
+        Label *mItemEffectLabel;
+        Label *mQuantityLabel;
         gcn::Slider *mSlider;
 
         ShopListModel *mShopListModel;
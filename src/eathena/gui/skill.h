@@ -33,9 +33,10 @@ struct SKILL {
     short id, lv, sp;
 };
 
-class Table;
+class Label;
 class ScrollArea;
 class SkillTableModel;
+class Table;
 
 /**
  * The skill dialog.
@@ -82,7 +83,7 @@ class SkillDialog : public Window, public gcn::SelectionListener
         Table *mTable;
         ScrollArea *mSkillScrollArea;
         SkillTableModel *mTableModel;
-        gcn::Label *mPointsLabel;
+        Label *mPointsLabel;
         gcn::Button *mIncButton;
         gcn::Button *mUseButton;
 
@@ -28,6 +28,8 @@
 #define ITEM_SHORTCUT  1
 #define EMOTE_SHORTCUT 2
 
+class Label;
+
 /**
  * Window used for selecting which slot to place a shortcut in on the shortcut
  * window.
@@ -59,7 +61,7 @@ class SlotSelectionWindow : public Window
 
         void fontChanged();
     private:
-        gcn::Label *mSlotLabel;  /**< Slot caption. */
+        Label *mSlotLabel;       /**< Slot caption. */
         gcn::Slider *mSlotSlide; /**< Slider containing the selected slot */
 
         gcn::Button *mOkButton;
@@ -25,6 +25,7 @@
 
 #include "../../bindings/guichan/widgets/window.h"
 
+class Label;
 class LocalPlayer;
 class ProgressBar;
 
@@ -75,9 +76,9 @@ class StatusWindow : public Window
         /**
          * Status Part
          */
-        gcn::Label *mLvlLabel, *mJobLvlLabel;
-        gcn::Label *mGpLabel;
-        gcn::Label *mHpLabel, *mMpLabel, *mXpLabel, *mJobLabel;
+        Label *mLvlLabel, *mJobLvlLabel;
+        Label *mGpLabel;
+        Label *mHpLabel, *mMpLabel, *mXpLabel, *mJobLabel;
 
         ProgressBar *mHpBar, *mMpBar;
         ProgressBar *mXpBar, *mJobBar;
@@ -85,27 +86,27 @@ class StatusWindow : public Window
         /**
          * Derived Statistics captions
          */
-        gcn::Label *mStatsAttackLabel, *mStatsDefenseLabel;
-        gcn::Label *mStatsMagicAttackLabel, *mStatsMagicDefenseLabel;
-        gcn::Label *mStatsAccuracyLabel, *mStatsEvadeLabel;
-        gcn::Label *mStatsReflexLabel;
+        Label *mStatsAttackLabel, *mStatsDefenseLabel;
+        Label *mStatsMagicAttackLabel, *mStatsMagicDefenseLabel;
+        Label *mStatsAccuracyLabel, *mStatsEvadeLabel;
+        Label *mStatsReflexLabel;
 
-        gcn::Label *mStatsAttackPoints, *mStatsDefensePoints;
-        gcn::Label *mStatsMagicAttackPoints, *mStatsMagicDefensePoints;
-        gcn::Label *mStatsAccuracyPoints, *mStatsEvadePoints;
-        gcn::Label *mStatsReflexPoints;
+        Label *mStatsAttackPoints, *mStatsDefensePoints;
+        Label *mStatsMagicAttackPoints, *mStatsMagicDefensePoints;
+        Label *mStatsAccuracyPoints, *mStatsEvadePoints;
+        Label *mStatsReflexPoints;
 
         /**
          * Stats captions.
          */
-        gcn::Label *mStatsTitleLabel;
-        gcn::Label *mStatsTotalLabel;
-        gcn::Label *mStatsCostLabel;
-
-        gcn::Label *mStatsLabel[6];
-        gcn::Label *mPointsLabel[6];
-        gcn::Label *mStatsDisplayLabel[6];
-        gcn::Label *mRemainingStatsPointsLabel;
+        Label *mStatsTitleLabel;
+        Label *mStatsTotalLabel;
+        Label *mStatsCostLabel;
+
+        Label *mStatsLabel[6];
+        Label *mPointsLabel[6];
+        Label *mStatsDisplayLabel[6];
+        Label *mRemainingStatsPointsLabel;
 
         /**
          * Stats buttons.
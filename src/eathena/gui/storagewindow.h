@@ -30,6 +30,7 @@
 
 class Item;
 class ItemContainer;
+class Label;
 class ProgressBar;
 class TextBox;
 
@@ -111,7 +112,7 @@ class StorageWindow : public Window, public gcn::SelectionListener
 
         gcn::ScrollArea *mInvenScroll;
 
-        gcn::Label *mSlotsLabel;
+        Label *mSlotsLabel;
 
         ProgressBar *mSlotsBar;
 
@@ -29,6 +29,8 @@
 
 #include "../../../bindings/guichan/widgets/setuptabcontainer.h"
 
+class Label;
+
 class Setup_Game : public SetupTabContainer, public gcn::ActionListener
 {
     public:
@@ -51,24 +53,24 @@ class Setup_Game : public SetupTabContainer, public gcn::ActionListener
         bool mPickupParticleEnabled;
         int mSpeechMode;
 
-        gcn::Label *speechLabel;
-        gcn::Label *overlayDetailLabel;
-        gcn::Label *particleDetailLabel;
+        Label *speechLabel;
+        Label *overlayDetailLabel;
+        Label *particleDetailLabel;
 
         gcn::CheckBox *mNameCheckBox;
 
         gcn::Slider *mSpeechSlider;
-        gcn::Label *mSpeechModeLabel;
+        Label *mSpeechModeLabel;
 
         int mOverlayDetail;
         gcn::Slider *mOverlayDetailSlider;
-        gcn::Label *mOverlayDetailLabel;
+        Label *mOverlayDetailLabel;
 
         int mParticleDetail;
         gcn::Slider *mParticleDetailSlider;
-        gcn::Label *mParticleDetailLabel;
+        Label *mParticleDetailLabel;
 
-        gcn::Label *mPickupNotifyLabel;
+        Label *mPickupNotifyLabel;
         gcn::CheckBox *mPickupChatCheckBox;
         gcn::CheckBox *mPickupParticleCheckBox;
 };
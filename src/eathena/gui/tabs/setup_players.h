@@ -31,9 +31,10 @@
 
 #include "../../../bindings/guichan/widgets/setuptabcontainer.h"
 
-class Table;
+class Label;
 class PlayerTableModel;
 class StaticTableModel;
+class Table;
 
 class Setup_Players : public SetupTabContainer, public gcn::ActionListener,
                       public PlayerRelationsListener
@@ -60,7 +61,7 @@ class Setup_Players : public SetupTabContainer, public gcn::ActionListener,
 
         gcn::ScrollArea *mPlayerScrollArea;
 
-        gcn::Label *mIgnoreActionLabel;
+        Label *mIgnoreActionLabel;
 
         gcn::CheckBox *mDefaultTrading;
         gcn::CheckBox *mDefaultWhisper;
@@ -33,6 +33,7 @@ class IntTextField;
 class Inventory;
 class Item;
 class ItemContainer;
+class Label;
 class ScrollArea;
 
 /**
@@ -136,7 +137,7 @@ class TradeWindow : public Window, public gcn::SelectionListener
         ItemContainer *mMyItemContainer;
         ItemContainer *mPartnerItemContainer;
 
-        gcn::Label *mPartnerMoneyLabel, *mOwnMoneyLabel;
+        Label *mPartnerMoneyLabel, *mOwnMoneyLabel;
         gcn::Button *mOkButton, *mCancelButton;
 
         ScrollArea *mMyScroll, *mPartnerScroll;
@@ -34,6 +34,7 @@
 #include "../../core/utils/mutex.h"
 
 class Button;
+class Label;
 class ProgressBar;
 class RichTextBox;
 class ScrollArea;
@@ -133,7 +134,7 @@ class UpdaterWindow : public Window, public UpdaterListener
         /** The mutex used to guard access to mNewLabelCaption etc. */
         Mutex mLabelMutex;
 
-        gcn::Label *mLabel;           /**< Progress bar caption. */
+        Label *mLabel;                /**< Progress bar caption. */
         Button *mStateButton;         /**< Button to start playing/cancel. */
         ProgressBar *mProgressBar;    /**< Update progress bar. */
         RichTextBox *mRichTextBox;    /**< Box to display news. */
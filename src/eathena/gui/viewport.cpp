@@ -44,11 +44,12 @@
 #include "../../core/configuration.h"
 #include "../../core/log.h"
 #include "../../core/resourcemanager.h"
+#include "../../core/scheduler.h"
 
 #include "../../core/image/particle/particle.h"
 
 #include "../../core/map/map.h"
-#include "../../core/map/mapreader.h"
+#include "../../core/map/maploader.h"
 
 #include "../../core/map/sprite/localplayer.h"
 #include "../../core/map/sprite/npc.h"
@@ -60,14 +61,21 @@
 Viewport::Viewport():
     mCurrentMap(NULL),
     mMapName(""),
-    mLastTick(tick_time),
+    mCameraX(0.0f),
+    mCameraY(0.0f),
+    mLastCameraX(0.0f),
+    mLastCameraY(0.0f),
     mPixelViewX(0.0f),
     mPixelViewY(0.0f),
     mTileViewX(0),
     mTileViewY(0),
     mShowDebugPath(false),
+    mDebugPathStartX(-1),
+    mDebugPathStartY(-1),
+    mDebugPathDestX(-1),
+    mDebugPathDestY(-1),
     mPlayerFollowMouse(false),
-    mWalkTime(-1)
+    mWalkTime((Uint64) -1)
 {
     setOpaque(false);
     addMouseListener(this);
@@ -114,6 +122,7 @@ Viewport::Viewport():
     mScrollHeightOffset = config.getValue("TileHeightScrollOffset", 0.0f);
 
     mPopupMenu = new PopupMenu(UNKNOWN, this);
+    mMapLoader = new MapLoader();
 
     setDimension(gcn::Rectangle(0, 0, graphics->getWidth(),
                                 graphics->getHeight()));
@@ -123,30 +132,90 @@ Viewport::~Viewport()
 {
     destroy(mCurrentMap);
     destroy(mPopupMenu);
+    destroy(mMapLoader);
 }
 
 void Viewport::setMap(Map *map)
 {
     mCurrentMap = map;
+
+    // The debug path belongs to the previous map
+    mDebugPath.clear();
+    mDebugPathCosts.clear();
+    mDebugPathStartX = mDebugPathStartY = -1;
+    mDebugPathDestX = mDebugPathDestY = -1;
+}
+
+void Viewport::updateDebugPath(const int startX, const int startY,
+                               const int destX, const int destY)
+{
+    if (startX == mDebugPathStartX && startY == mDebugPathStartY &&
+        destX == mDebugPathDestX && destY == mDebugPathDestY)
+        return;
+
+    mDebugPathStartX = startX;
+    mDebugPathStartY = startY;
+    mDebugPathDestX = destX;
+    mDebugPathDestY = destY;
+
+    mDebugPath = mCurrentMap->findPath(startX, startY, destX, destY);
+    mDebugPathCosts.clear();
+    mDebugPathCosts.reserve(mDebugPath.size());
+
+    // The path finder only remembers the costs of its last tile level
+    // search, which is just the final segment of a long route, so add up
+    // the steps here instead
+    int cost = 0;
+    int x = startX;
+    int y = startY;
+
+    for (PathIterator i = mDebugPath.begin(); i != mDebugPath.end(); i++)
+    {
+        cost += (i->x != x && i->y != y) ? 14 : 10;
+        mDebugPathCosts.push_back(cost);
+        x = i->x;
+        y = i->y;
+    }
 }
 
 std::string Viewport::getMapPath()
 {
-    return mCurrentMap->getProperty("_filename");
+    return mCurrentMap ? mCurrentMap->getProperty("_filename") : "";
 }
 
-void Viewport::draw(gcn::Graphics *graphics)
+/**
+ * Keeps a viewpoint coordinate from going past the start or end of the map.
+ */
+static float clampView(float view, const int viewMax)
 {
-    static int lastTick = tick_time;
+    if (view < 0)
+        view = 0;
+    if (view > viewMax)
+        view = viewMax;
 
+    return view;
+}
+
+void Viewport::draw(gcn::Graphics *graphics)
+{
     if (!mCurrentMap || !player_node)
     {
         graphics->setColor(gcn::Color(64, 64, 64));
         graphics->fillRectangle(gcn::Rectangle(0, 0, getWidth(), getHeight()));
+
+        if (!mLoadingMap.empty())
+        {
+            graphics->setColor(gcn::Color(255, 255, 255));
+            graphics->drawText(_("Loading map..."), getWidth() / 2,
+                               getHeight() / 2, gcn::Graphics::CENTER);
+        }
+
         return;
     }
 
-    mCurrentMap->update(get_elapsed_time(mLastTick));
+    const int ticks = Scheduler::getFrameTicks();
+
+    mCurrentMap->update(ticks * Scheduler::TICK_LENGTH);
 
     Graphics *g = static_cast<Graphics*>(graphics);
 
@@ -154,10 +223,6 @@ void Viewport::draw(gcn::Graphics *graphics)
     const int tileWidth = mCurrentMap->getTileWidth();
     const int tileHeight = mCurrentMap->getTileHeight();
 
-    // Avoid freaking out when tick_time overflows
-    if (tick_time < lastTick)
-        lastTick = tick_time;
-
     // Calculate viewpoint
     const int widthOffset = (int) (mScrollWidthOffset * (float) tileWidth);
     const int heightOffset = (int) (mScrollWidthOffset * (float) tileWidth);
@@ -179,56 +244,57 @@ void Viewport::draw(gcn::Graphics *graphics)
     const int yScrollRadius = (int) (mScrollRadius *(float) tileHeight);
 
     // Apply lazy scrolling
-    while (lastTick < tick_time)
+    for (int i = 0; i < ticks; i++)
     {
-        if (player_x > mPixelViewX + xScrollRadius)
+        mLastCameraX = mCameraX;
+        mLastCameraY = mCameraY;
+
+        if (player_x > mCameraX + xScrollRadius)
         {
-            mPixelViewX += (player_x - mPixelViewX - xScrollRadius) /
-                            xScrollLaziness;
+            mCameraX += (player_x - mCameraX - xScrollRadius) /
+                         xScrollLaziness;
         }
-        if (player_x < mPixelViewX - xScrollRadius)
+        if (player_x < mCameraX - xScrollRadius)
         {
-            mPixelViewX += (player_x - mPixelViewX + xScrollRadius) /
-                            xScrollLaziness;
+            mCameraX += (player_x - mCameraX + xScrollRadius) /
+                         xScrollLaziness;
         }
-        if (player_y > mPixelViewY + yScrollRadius)
+        if (player_y > mCameraY + yScrollRadius)
         {
-            mPixelViewY += (player_y - mPixelViewY - yScrollRadius) /
-                            yScrollLaziness;
+            mCameraY += (player_y - mCameraY - yScrollRadius) /
+                         yScrollLaziness;
         }
-        if (player_y < mPixelViewY - yScrollRadius)
+        if (player_y < mCameraY - yScrollRadius)
         {
-            mPixelViewY += (player_y - mPixelViewY + yScrollRadius) /
-                            yScrollLaziness;
+            mCameraY += (player_y - mCameraY + yScrollRadius) /
+                         yScrollLaziness;
         }
-        lastTick++;
     }
 
     // Auto center when player is off screen
-    if (player_x - mPixelViewX > g->getWidth() / 2 ||
-        mPixelViewX - player_x > g->getWidth() / 2 ||
-        mPixelViewY - player_y > g->getHeight() / 2 ||
-        player_y - mPixelViewY > g->getHeight() / 2)
+    if (player_x - mCameraX > g->getWidth() / 2 ||
+        mCameraX - player_x > g->getWidth() / 2 ||
+        mCameraY - player_y > g->getHeight() / 2 ||
+        player_y - mCameraY > g->getHeight() / 2)
     {
-        mPixelViewX = player_x;
-        mPixelViewY = player_y;
+        mCameraX = mLastCameraX = player_x;
+        mCameraY = mLastCameraY = player_y;
     };
 
     // Don't move camera so that the end of the map is on screen
     const int viewXmax = (mCurrentMap->getWidth() * tileWidth) - g->getWidth();
     const int viewYmax = (mCurrentMap->getHeight() * tileHeight) - g->getHeight();
 
-    if (mCurrentMap)
-    {
-        if (mPixelViewX < 0)
-            mPixelViewX = 0;
-        if (mPixelViewY < 0)
-            mPixelViewY = 0;
-        if (mPixelViewX > viewXmax)
-            mPixelViewX = viewXmax;
-        if (mPixelViewY > viewYmax)
-            mPixelViewY = viewYmax;
-    }
+    mCameraX = clampView(mCameraX, viewXmax);
+    mCameraY = clampView(mCameraY, viewYmax);
+
+    // Draw the view in between the last two ticks, so that it moves smoothly
+    // when there are more frames than ticks
+    const float alpha = Scheduler::getAlpha();
+    mPixelViewX = clampView(mLastCameraX + (mCameraX - mLastCameraX) * alpha,
+                            viewXmax);
+    mPixelViewY = clampView(mLastCameraY + (mCameraY - mLastCameraY) * alpha,
+                            viewYmax);
 
     mTileViewX = (int) (mPixelViewX + (tileWidth / 2)) / tileWidth;
     mTileViewY = (int) (mPixelViewY + (tileHeight / 2)) / tileHeight;
@@ -248,19 +314,20 @@ void Viewport::draw(gcn::Graphics *graphics)
             const int mouseTileX = mouseX / tileWidth + mTileViewX;
             const int mouseTileY = mouseY / tileHeight + mTileViewY;
 
-            Path debugPath = mCurrentMap->findPath(player_node->mX, player_node->mY,
-                                            mouseTileX, mouseTileY);
+            updateDebugPath(player_node->mX, player_node->mY,
+                            mouseTileX, mouseTileY);
 
             g->setColor(gcn::Color(255, 0, 0));
-            for (PathIterator i = debugPath.begin(); i != debugPath.end(); i++)
+            for (unsigned int n = 0; n < mDebugPath.size(); n++)
             {
+                const Position *i = &mDebugPath[n];
                 const int squareX = i->x * tileWidth - (int) mPixelViewX + 
                                     (tileWidth / 2) - 4;
                 const int squareY = i->y * tileHeight - (int) mPixelViewY +
                                     (tileHeight / 2) - 4;
 
                 g->fillRectangle(gcn::Rectangle(squareX, squareY, 8, 8));
-                g->drawText(toString(mCurrentMap->getMetaTile(i->x, i->y)->Gcost),
+                g->drawText(toString(mDebugPathCosts[n]),
                                    squareX + 4, squareY + (tileHeight / 2) - 4,
                                    gcn::Graphics::CENTER);
             }
@@ -287,7 +354,6 @@ void Viewport::draw(gcn::Graphics *graphics)
     }
 
     drawChildren(g);
-    mLastTick = tick_time;
 }
 
 void Viewport::logic()
@@ -296,13 +362,17 @@ void Viewport::logic()
 
     const int mouseX = gui->getMouseX();
     const int mouseY = gui->getMouseY();
-    const int tileWidth = mCurrentMap->getTileWidth();
-    const int tileHeight = mCurrentMap->getTileHeight();
     const Uint8 button = gui->getButtonState();
 
+    if (!mLoadingMap.empty())
+        finishMapChange();
+
     if (!mCurrentMap || !player_node)
         return;
 
+    const int tileWidth = mCurrentMap->getTileWidth();
+    const int tileHeight = mCurrentMap->getTileHeight();
+
     if (mPlayerFollowMouse && button & SDL_BUTTON(1) &&
         mWalkTime != player_node->mWalkTime)
     {
@@ -447,8 +517,14 @@ void Viewport::closePopupMenu()
 
 void Viewport::scrollBy(int x, int y)
 {
-    mPixelViewX += (float) (x * mCurrentMap->getTileWidth());
-    mPixelViewY += (float) (y * mCurrentMap->getTileHeight());
+    // The view is centered on the player once the map is loaded
+    if (!mCurrentMap)
+        return;
+
+    mCameraX += (float) (x * mCurrentMap->getTileWidth());
+    mCameraY += (float) (y * mCurrentMap->getTileHeight());
+    mLastCameraX = mCameraX;
+    mLastCameraY = mCameraY;
 }
 
 bool Viewport::changeMap(const std::string &path)
@@ -470,26 +546,46 @@ bool Viewport::changeMap(const std::string &path)
 
     mMapName = path.substr(0, path.rfind("."));
 
-    // Store full map path in global var
-    std::string mapPath = "maps/" + mMapName + ".tmx";
-    ResourceManager *resman = ResourceManager::getInstance();
-    if (!resman->exists(mapPath))
-        mapPath += ".gz";
+    // Nothing refers to the old map while the new one is loading
+    minimap->setMap(NULL);
+    beingManager->setMap(NULL);
+    particleEngine->setMap(NULL);
+
+    if (mCurrentMap)
+    {
+        mOldMusic = mCurrentMap->getMusicFile();
+        destroy(mCurrentMap);
+    }
+
+    // Load the new map in the background, unless it has been loaded ahead
+    mLoadingMap = MapLoader::findMapFile(mMapName);
+    finishMapChange();
 
-    // Attempt to load the new map
-    Map *newMap = MapReader::readMap(mapPath);
+    return true;
+}
+
+void Viewport::finishMapChange()
+{
+    Map *newMap;
+
+    if (!mMapLoader->getMap(mLoadingMap, newMap))
+        return;
 
     if (!newMap)
     {
-        logger->log("Error while loading %s", mapPath.c_str());
+        logger->log("Error while loading %s", mLoadingMap.c_str());
         new OkDialog(_("Could not load map"),
-                     strprintf(_("Error while loading %s"), mapPath.c_str()));
+                     strprintf(_("Error while loading %s"),
+                               mLoadingMap.c_str()));
     }
 
+    mLoadingMap.clear();
+
     // Notify the minimap and beingManager about the map change
     minimap->setMap(newMap);
     beingManager->setMap(newMap);
     particleEngine->setMap(newMap);
+    floorItemManager->setMap(newMap);
 
     keyboard.refreshActiveKeys();
 
@@ -498,17 +594,13 @@ bool Viewport::changeMap(const std::string &path)
         newMap->initializeParticleEffects(particleEngine);
 
     // Start playing new music file when necessary
-    std::string oldMusic = mCurrentMap ? mCurrentMap->getMusicFile() : "";
-    std::string newMusic = newMap ? newMap->getMusicFile() : "";
+    const std::string newMusic = newMap ? newMap->getMusicFile() : "";
 
-    if (newMusic != oldMusic)
+    if (newMusic != mOldMusic)
         sound.playMusic(newMusic);
 
-    if (mCurrentMap)
-        destroy(mCurrentMap);
+    mOldMusic = newMusic;
 
     setMap(newMap);
     MessageOut outMsg(CMSG_MAP_LOADED);
-
-    return true;
 }
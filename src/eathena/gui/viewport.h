@@ -23,6 +23,8 @@
 #ifndef VIEWPORT_H
 #define VIEWPORT_H
 
+#include <SDL_types.h>
+
 #include <guichan/mouselistener.hpp>
 
 #include "../../bindings/guichan/widgets/container.h"
@@ -35,6 +37,7 @@ class Graphics;
 class ImageSet;
 class Item;
 class Map;
+class MapLoader;
 class PopupMenu;
 
 /**
@@ -137,32 +140,60 @@ class Viewport : public Container, public gcn::MouseListener
         void scrollBy(int x, int y);
 
         /**
-         * Sets the currently active map.
+         * Sets the currently active map. The map is loaded in the background
+         * when it hasn't been loaded ahead, meanwhile there is no map.
          */
         bool changeMap(const std::string &mapName);
 
     private:
+        /**
+         * Switches to the map being loaded once it is ready.
+         */
+        void finishMapChange();
+
         /**
          * Sets the map displayed by the viewport.
          */
         void setMap(Map *map);
 
+        /**
+         * Searches the debug path again when either of its ends has moved,
+         * along with the cost of reaching each of its tiles.
+         */
+        void updateDebugPath(const int startX, const int startY,
+                             const int destX, const int destY);
+
         Map *mCurrentMap;            /**< The current map. */
         std::string mMapName;
+        MapLoader *mMapLoader;
+        std::string mLoadingMap;     /**< Map file being loaded. */
+        std::string mOldMusic;       /**< Music of the previous map. */
 
-        int mLastTick;
         float mScrollRadius;
         float mScrollLaziness;
         float mScrollWidthOffset;    /**< In # of tiles */
         float mScrollHeightOffset;   /**< In # of tiles */
-        float mPixelViewX;           /**< Current viewpoint in pixels. */
-        float mPixelViewY;           /**< Current viewpoint in pixels. */
+        float mCameraX;              /**< Viewpoint after the last tick. */
+        float mCameraY;              /**< Viewpoint after the last tick. */
+        float mLastCameraX;          /**< Viewpoint before the last tick. */
+        float mLastCameraY;          /**< Viewpoint before the last tick. */
+        float mPixelViewX;           /**< Current viewpoint in pixels, in
+                                          between the last two ticks. */
+        float mPixelViewY;           /**< Current viewpoint in pixels, in
+                                          between the last two ticks. */
         int mTileViewX;              /**< Current viewpoint in tiles. */
         int mTileViewY;              /**< Current viewpoint in tiles. */
         bool mShowDebugPath;         /**< Show a path from player to pointer. */
+        Path mDebugPath;             /**< Path shown for debugging. */
+        std::vector<int> mDebugPathCosts; /**< Cost to reach each tile of
+                                               the debug path. */
+        int mDebugPathStartX;
+        int mDebugPathStartY;
+        int mDebugPathDestX;
+        int mDebugPathDestY;
 
         bool mPlayerFollowMouse;
-        int mWalkTime;
+        Uint64 mWalkTime;
 
         PopupMenu *mPopupMenu;       /**< Popup menu. */
 };
@@ -35,6 +35,7 @@
 #include "../../bindings/guichan/gui.h"
 
 #include "../../core/log.h"
+#include "../../core/scheduler.h"
 
 #include "../../core/map/sprite/being.h"
 #include "../../core/map/sprite/localplayer.h"
@@ -108,7 +109,7 @@ void BeingHandler::handleMessage(MessageIn *msg)
             {
                 dstBeing->clearPath();
                 dstBeing->mFrame = 0;
-                dstBeing->mWalkTime = tick_time;
+                dstBeing->mWalkTime = Scheduler::getTick();
                 dstBeing->setAction(Being::STAND);
             }
 
@@ -153,14 +154,15 @@ void BeingHandler::handleMessage(MessageIn *msg)
                 Uint16 srcX, srcY, dstX, dstY;
                 msg->readCoordinatePair(srcX, srcY, dstX, dstY);
                 dstBeing->setAction(Being::STAND);
-                dstBeing->mX = srcX;
-                dstBeing->mY = srcY;
+                dstBeing->setTile(srcX, srcY);
                 dstBeing->setDestination(dstX, dstY);
             }
             else
             {
+                Uint16 x, y;
                 Uint8 dir;
-                msg->readCoordinates(dstBeing->mX, dstBeing->mY, dir);
+                msg->readCoordinates(x, y, dir);
+                dstBeing->setTile(x, y);
                 dstBeing->setDirection(dir);
             }
 
@@ -190,8 +192,7 @@ void BeingHandler::handleMessage(MessageIn *msg)
             if (dstBeing)
             {
                 dstBeing->setAction(Being::STAND);
-                dstBeing->mX = srcX;
-                dstBeing->mY = srcY;
+                dstBeing->setTile(srcX, srcY);
                 dstBeing->setDestination(dstX, dstY);
             }
 
@@ -439,14 +440,15 @@ void BeingHandler::handleMessage(MessageIn *msg)
             {
                 Uint16 srcX, srcY, dstX, dstY;
                 msg->readCoordinatePair(srcX, srcY, dstX, dstY);
-                dstBeing->mX = srcX;
-                dstBeing->mY = srcY;
+                dstBeing->setTile(srcX, srcY);
                 dstBeing->setDestination(dstX, dstY);
             }
             else
             {
+                Uint16 x, y;
                 Uint8 dir;
-                msg->readCoordinates(dstBeing->mX, dstBeing->mY, dir);
+                msg->readCoordinates(x, y, dir);
+                dstBeing->setTile(x, y);
                 dstBeing->setDirection(dir);
             }
 
@@ -469,7 +471,7 @@ void BeingHandler::handleMessage(MessageIn *msg)
             msg->readInt8();   // Lv
             msg->readInt8();   // unknown
 
-            dstBeing->mWalkTime = tick_time;
+            dstBeing->mWalkTime = Scheduler::getTick();
             dstBeing->mFrame = 0;
             break;
 
@@ -492,8 +494,9 @@ void BeingHandler::handleMessage(MessageIn *msg)
                 dstBeing = beingManager->findBeing(id);
                 if (dstBeing)
                 {
-                    dstBeing->mX = msg->readInt16();
-                    dstBeing->mY = msg->readInt16();
+                    const Uint16 x = msg->readInt16();
+                    const Uint16 y = msg->readInt16();
+                    dstBeing->setTile(x, y);
                     if (dstBeing->mAction == Being::WALK)
                     {
                         dstBeing->mFrame = 0;
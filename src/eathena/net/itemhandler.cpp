@@ -56,15 +56,19 @@ void ItemHandler::handleMessage(MessageIn *msg)
             y = msg->readInt16();
             msg->skip(4);     // amount,subX,subY / subX,subY,amount
 
+            // Queued by the manager while the map is still loading
             floorItemManager->create(id, itemId, x, y, viewport->getMap());
             break;
 
         case SMSG_ITEM_REMOVE:
             FloorItem *item;
-            item = floorItemManager->findById(msg->readInt32());
+            id = msg->readInt32();
+            item = floorItemManager->findById(id);
 
             if (item)
                 floorItemManager->destroy(item);
+            else
+                floorItemManager->removePending(id);
 
             break;
     }
@@ -55,6 +55,7 @@ void MapLoginHandler::handleMessage(MessageIn *msg)
 {
     int code;
     unsigned char direction;
+    Uint16 x, y;
     std::string error;
 
     switch (msg->getId())
@@ -80,7 +81,8 @@ void MapLoginHandler::handleMessage(MessageIn *msg)
 
         case SMSG_LOGIN_SUCCESS:
             msg->readInt32();   // server tick
-            msg->readCoordinates(player_node->mX, player_node->mY, direction);
+            msg->readCoordinates(x, y, direction);
+            player_node->setTile(x, y);
             msg->skip(2);      // unknown
             logger->log("Protocol: Player start position: (%d, %d), Direction: %d",
                          player_node->mX, player_node->mY, direction);
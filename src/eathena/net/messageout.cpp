@@ -20,7 +20,6 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <cstring>
 #include <SDL.h>
 #include <SDL_endian.h>
 #include <string>
@@ -28,44 +27,42 @@
 #include "messageout.h"
 #include "network.h"
 
-MessageOut::MessageOut(short id):
-    mData(0),
-    mDataSize(0),
-    mPos(0)
+MessageOut::MessageOut(short id)
 {
-    mData = network->mOutBuffer + network->mOutSize;
+    network->mPacketsQueued++;
     writeInt16(id);
 }
 
+void MessageOut::write(const void *data, unsigned int length)
+{
+    const char *bytes = static_cast<const char*>(data);
+    network->mOutBuffer.insert(network->mOutBuffer.end(), bytes,
+                               bytes + length);
+}
+
 void MessageOut::writeInt8(Sint8 value)
 {
-    mData[mPos] = value;
-    mPos += sizeof(Sint8);
-    network->mOutSize += sizeof(Sint8);
+    write(&value, sizeof(Sint8));
 }
 
 void MessageOut::writeInt16(Sint16 value)
 {
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
     Sint16 swap = SDL_Swap16(value);
-    memcpy(mData + mPos, &swap, sizeof(Sint16));
+    write(&swap, sizeof(Sint16));
 #else
-    memcpy(mData + mPos, &value, sizeof(Sint16));
+    write(&value, sizeof(Sint16));
 #endif
-    mPos += sizeof(Sint16);
-    network->mOutSize += sizeof(Sint16);
 }
 
 void MessageOut::writeInt32(Sint32 value)
 {
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
     Sint32 swap = SDL_Swap32(value);
-    memcpy(mData + mPos, &swap, sizeof(Sint32));
+    write(&swap, sizeof(Sint32));
 #else
-    memcpy(mData + mPos, &value, sizeof(Sint32));
+    write(&value, sizeof(Sint32));
 #endif
-    mPos += sizeof(Sint32);
-    network->mOutSize += sizeof(Sint32);
 }
 
 #define LOBYTE(w)  ((unsigned char)(w))
@@ -74,9 +71,7 @@ void MessageOut::writeInt32(Sint32 value)
 void MessageOut::writeCoordinates(unsigned short x, unsigned short y,
                                   unsigned char direction)
 {
-    char *data = mData + mPos;
-    network->mOutSize += 3;
-    mPos += 3;
+    char data[3];
 
     short temp;
     temp = x;
@@ -123,6 +118,8 @@ void MessageOut::writeCoordinates(unsigned short x, unsigned short y,
             direction = (unsigned char) -1;
     }
     data[2] |= direction;
+
+    write(data, 3);
 }
 
 void MessageOut::writeString(const std::string &string, int length)
@@ -141,16 +138,13 @@ void MessageOut::writeString(const std::string &string, int length)
     }
 
     // Write the actual string
-    memcpy(&mData[mPos], (void*)toWrite.c_str(), toWrite.length());
-    mPos += toWrite.length();
-    network->mOutSize += toWrite.length();
+    write(toWrite.c_str(), toWrite.length());
 
     // Pad remaining space with zeros
     if (length > (int)toWrite.length())
     {
-        memset(&mData[mPos], '\0', length - toWrite.length());
-        mPos += length - toWrite.length();
-        network->mOutSize += length - toWrite.length();
+        network->mOutBuffer.insert(network->mOutBuffer.end(),
+                                   length - toWrite.length(), '\0');
     }
 }
 
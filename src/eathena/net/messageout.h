@@ -27,7 +27,9 @@
 #include <SDL_types.h>
 
 /**
- * Used for building an outgoing message.
+ * Used for building an outgoing message. The message is appended to the
+ * network's outgoing buffer while it is being written, and is sent along
+ * with the others on the next Network::flush().
  */
 class MessageOut
 {
@@ -58,9 +60,10 @@ class MessageOut
         void writeString(const std::string &string, int length = -1);
 
     private:
-        char *mData;                         /**< Data building up. */
-        unsigned int mDataSize;              /**< Size of data. */
-        unsigned int mPos;                   /**< Position in the data. */
+        /**
+         * Appends data to the network's outgoing buffer.
+         */
+        void write(const void *data, unsigned int length);
 };
 
 #endif
@@ -21,14 +21,20 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <sstream>
 
+#include <sys/time.h>
+
 #include "messagehandler.h"
 #include "messagein.h"
 #include "network.h"
+#include "packetcapture.h"
 
+#include "../../core/configuration.h"
 #include "../../core/log.h"
 
+#include "../../core/utils/dtor.h"
 #include "../../core/utils/gettext.h"
 #include "../../core/utils/stringutils.h"
 
@@ -80,10 +86,66 @@ short packet_lengths[] = {
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
 };
 
-const unsigned int BUFFER_SIZE = 65536;
+/**
+ * Size of the receive buffer. Has to be a power of two, and large enough to
+ * hold the longest possible message (65535 bytes).
+ */
+const unsigned int RECEIVE_BUFFER_SIZE = 262144;
+
+const int PACKET_TABLE_SIZE = sizeof(packet_lengths) / sizeof(short);
+
+/**
+ * Amount of outgoing data that is sent right away instead of waiting for
+ * more data to coalesce with, about the size of a TCP segment.
+ */
+const unsigned int SEND_COALESCE_SIZE = 1400;
+
+/**
+ * Sends blocking for at least this many milliseconds are counted as stalls.
+ */
+const Uint32 SEND_STALL_TIME = 50;
+
+/**
+ * Parameters of the FNV-1a hash used for the digest of replayed messages.
+ */
+const Uint32 FNV_OFFSET = 2166136261u;
+const Uint32 FNV_PRIME = 16777619u;
 
 Network *network = NULL;
 
+static Uint64 getMicroseconds()
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return (Uint64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/**
+ * Orders message ids by the time spent handling them, most first.
+ */
+class BusierPacket
+{
+    public:
+        BusierPacket(const std::vector<PacketStatistics> &statistics):
+            mStatistics(statistics)
+        {}
+
+        bool operator()(Uint16 a, Uint16 b) const
+        {
+            return mStatistics[a].totalTime > mStatistics[b].totalTime;
+        }
+
+    private:
+        const std::vector<PacketStatistics> &mStatistics;
+};
+
+int sendThread(void *data)
+{
+    static_cast<Network*>(data)->send();
+
+    return 0;
+}
+
 int networkThread(void *data)
 {
     network = static_cast<Network*>(data);
@@ -91,22 +153,51 @@ int networkThread(void *data)
     if (!network->realConnect())
         return -1;
 
+    // Data is sent from a thread of its own, so that a slow socket neither
+    // holds up receiving nor the main thread
+    SDL_Thread *sender = SDL_CreateThread(sendThread, network);
+    if (!sender)
+    {
+        network->setError("Unable to create network sending thread");
+        return -1;
+    }
+
     network->receive();
 
+    SDL_SemPost(network->mSendSignal);
+    SDL_WaitThread(sender, NULL);
+
     return 0;
 }
 
 Network::Network():
     mSocket(0),
     mAddress(), mPort(0),
-    mInBuffer(new char[BUFFER_SIZE]),
-    mOutBuffer(new char[BUFFER_SIZE]),
-    mInSize(0), mOutSize(0),
+    mInBuffer(RECEIVE_BUFFER_SIZE),
+    mSendQueueTime(0),
+    mSendDelay(0),
+    mSendSignal(SDL_CreateSemaphore(0)),
+    mPacketsQueued(0), mBytesSent(0), mSendStalls(0),
     mToSkip(0),
+    mCapture(NULL),
+    mReplay(NULL),
+    mConnectTime(0),
+    mReplayOffset(0),
+    mReplayTime(0),
+    mReplayPaced(true),
+    mReplayTrace(false),
+    mReplayDigest(FNV_OFFSET),
+    mMessagesDispatched(0),
+    mSpaceMutex(SDL_CreateMutex()),
+    mSpaceAvailable(SDL_CreateCond()),
     mState(IDLE),
-    mWorkerThread(0)
+    mWorkerThread(0),
+    mMessageHandlers(PACKET_TABLE_SIZE, (MessageHandler*) NULL),
+    mStatisticsEnabled(false)
 {
     logger->log("Creating new Network instance");
+
+    setStatisticsEnabled(config.getValue("networkStatistics", 0));
 }
 
 Network::~Network()
@@ -114,13 +205,20 @@ Network::~Network()
     logger->log("Shutting down Network instance");
     clearHandlers();
 
+    if (mStatisticsEnabled)
+        logStatistics();
+
     if (mState != IDLE && mState != NET_ERROR)
         disconnect();
 
     network = NULL;
 
-    delete[] mInBuffer;
-    delete[] mOutBuffer;
+    SDL_DestroyCond(mSpaceAvailable);
+    SDL_DestroyMutex(mSpaceMutex);
+    SDL_DestroySemaphore(mSendSignal);
+
+    destroy(mCapture);
+    destroy(mReplay);
 }
 
 bool Network::connect(const std::string &address, short port)
@@ -142,10 +240,23 @@ bool Network::connect(const std::string &address, short port)
     mAddress = address;
     mPort = port;
 
+    // The worker of a connection that failed may still be finishing, and
+    // has to be done with the buffers before they can be reset
+    if (mWorkerThread)
+    {
+        SDL_WaitThread(mWorkerThread, NULL);
+        mWorkerThread = NULL;
+    }
+
     // Reset to sane values
-    mOutSize = 0;
-    mInSize = 0;
+    mOutBuffer.clear();
+    mSendBuffer.clear();
+    mSending.clear();
+    mSendDelay = (Uint32) config.getValue("networkSendDelay", 5);
+    mInBuffer.clear();
     mToSkip = 0;
+    mMessagesDispatched = 0;
+    mReplayDigest = FNV_OFFSET;
 
     mState = CONNECTING;
     mWorkerThread = SDL_CreateThread(networkThread, this);
@@ -161,12 +272,29 @@ bool Network::connect(const std::string &address, short port)
 void Network::disconnect()
 {
     logger->log("Network::Disconnecting from %s:%i", mAddress.c_str(), mPort);
+
+    // Hand over what was written last, like a logout request, so that the
+    // sending thread delivers it before closing
+    flush();
     mState = IDLE;
 
+    if (mReplay)
+    {
+        logger->log("Replay: dispatched %u messages, digest %08x",
+                    mMessagesDispatched, mReplayDigest);
+
+        if (mStatisticsEnabled)
+            logStatistics();
+    }
+
     if (mWorkerThread)
     {
         SDL_WaitThread(mWorkerThread, NULL);
         mWorkerThread = NULL;
+
+        // A failure of the final send has been logged, but doesn't make the
+        // disconnect any less complete
+        mState = IDLE;
     }
 
     if (mSocket)
@@ -179,18 +307,91 @@ void Network::disconnect()
 void Network::registerHandler(MessageHandler *handler)
 {
     for (const Uint16 *i = handler->handledMessages; *i; i++)
+    {
+        // Messages outside of the length table are never dispatched
+        if (*i >= PACKET_TABLE_SIZE)
+        {
+            logger->log("Network: can't handle unknown packet %x", *i);
+            continue;
+        }
+
         mMessageHandlers[*i] = handler;
+    }
 }
 
 void Network::unregisterHandler(MessageHandler *handler)
 {
     for (const Uint16 *i = handler->handledMessages; *i; i++)
-        mMessageHandlers.erase(*i);
+    {
+        if (*i < PACKET_TABLE_SIZE && mMessageHandlers[*i] == handler)
+            mMessageHandlers[*i] = NULL;
+    }
 }
 
 void Network::clearHandlers()
 {
-    mMessageHandlers.clear();
+    std::fill(mMessageHandlers.begin(), mMessageHandlers.end(),
+              (MessageHandler*) NULL);
+}
+
+void Network::setStatisticsEnabled(bool enabled)
+{
+    mStatisticsEnabled = enabled;
+
+    if (enabled && mStatistics.empty())
+        mStatistics.resize(PACKET_TABLE_SIZE);
+}
+
+const PacketStatistics &Network::getStatistics(Uint16 id) const
+{
+    static const PacketStatistics none;
+
+    if (id >= mStatistics.size())
+        return none;
+
+    return mStatistics[id];
+}
+
+std::vector<Uint16> Network::getBusiestPackets(unsigned int count) const
+{
+    std::vector<Uint16> ids;
+
+    for (unsigned int id = 0; id < mStatistics.size(); id++)
+    {
+        if (mStatistics[id].count)
+            ids.push_back(id);
+    }
+
+    count = std::min(count, (unsigned int) ids.size());
+    std::partial_sort(ids.begin(), ids.begin() + count, ids.end(),
+                      BusierPacket(mStatistics));
+    ids.resize(count);
+
+    return ids;
+}
+
+void Network::logStatistics() const
+{
+    const std::vector<Uint16> ids = getBusiestPackets(mStatistics.size());
+
+    logger->log("Network: statistics on %u types of messages",
+                (unsigned int) ids.size());
+
+    for (unsigned int i = 0; i < ids.size(); i++)
+    {
+        const PacketStatistics &stats = mStatistics[ids[i]];
+
+        logger->log("  %04x: %u messages, %u bytes, %.3f ms total, "
+                    "%.3f ms average, %.3f ms max", ids[i], stats.count,
+                    stats.bytes, stats.totalTime / 1000.0,
+                    stats.totalTime / 1000.0 / stats.count,
+                    stats.maxTime / 1000.0);
+    }
+}
+
+void Network::resetStatistics()
+{
+    std::fill(mStatistics.begin(), mStatistics.end(), PacketStatistics());
 }
 
 void Network::dispatchMessages()
@@ -199,8 +400,6 @@ void Network::dispatchMessages()
     {
         MessageIn msg = getNextMessage();
 
-        MessageHandlerIterator iter = mMessageHandlers.find(msg.getId());
-
         if (msg.getLength() == 0 || msg.getLength() == 1)
         {
             disconnect();
@@ -209,10 +408,34 @@ void Network::dispatchMessages()
             return;
         }
 
-        if (iter != mMessageHandlers.end())
-            iter->second->handleMessage(&msg);
+        // Messages of a length of 0 have been rejected above, which
+        // includes all with ids beyond the table
+        const Uint16 id = msg.getId();
+        MessageHandler *handler = mMessageHandlers[id];
+
+        if (!handler)
+            logger->log("Unhandled packet: %x", id);
+        else if (!mStatisticsEnabled)
+            handler->handleMessage(&msg);
         else
-            logger->log("Unhandled packet: %x", msg.getId());
+        {
+            const Uint64 start = getMicroseconds();
+            handler->handleMessage(&msg);
+            const unsigned int time = getMicroseconds() - start;
+
+            PacketStatistics &stats = mStatistics[id];
+            stats.count++;
+            stats.bytes += msg.getLength();
+            stats.totalTime += time;
+            stats.maxTime = std::max(stats.maxTime, time);
+        }
+
+        mMessagesDispatched++;
+
+        if (mReplay && mReplayTrace)
+            logger->log("Replay: message %u, id %04x, %u bytes, digest %08x",
+                        mMessagesDispatched, id, msg.getLength(),
+                        mReplayDigest);
 
         skip(msg.getLength());
     }
@@ -220,91 +443,159 @@ void Network::dispatchMessages()
 
 void Network::flush()
 {
-    if (!mOutSize || mState != CONNECTED)
+    if (mOutBuffer.empty())
         return;
 
+    // Only hand over the data, sending is left to the sending thread
     mMutex.lock();
-    int ret = SDLNet_TCP_Send(mSocket, mOutBuffer, mOutSize);
-
-    if (ret < (int) mOutSize)
-        setError(strprintf("Error in SDLNet_TCP_Send(): %s", SDLNet_GetError()));
-
-    mOutSize = 0;
+    if (mSendBuffer.empty())
+    {
+        mSendBuffer.swap(mOutBuffer);
+        mSendQueueTime = SDL_GetTicks();
+    }
+    else
+    {
+        mSendBuffer.insert(mSendBuffer.end(), mOutBuffer.begin(),
+                           mOutBuffer.end());
+    }
     mMutex.unlock();
+
+    mOutBuffer.clear();
+    SDL_SemPost(mSendSignal);
 }
 
 void Network::skip(int len)
 {
-    mMutex.lock();
     mToSkip += len;
 
-    if (!mInSize)
-    {
-        mMutex.unlock();
+    const unsigned int skipNow = std::min(mToSkip, mInBuffer.getReadable());
+    if (!skipNow)
         return;
-    }
 
-    if (mInSize >= mToSkip)
-    {
-        mInSize -= mToSkip;
-        memmove(mInBuffer, mInBuffer + mToSkip, mInSize);
-        mToSkip = 0;
-    }
-    else
-    {
-        mToSkip -= mInSize;
-        mInSize = 0;
-    }
-    mMutex.unlock();
+    mInBuffer.consume(skipNow);
+    mToSkip -= skipNow;
+
+    // Wake up the worker thread if it was waiting for room. Signaling under
+    // the lock means the worker either sees the room or is already waiting.
+    SDL_mutexP(mSpaceMutex);
+    SDL_CondSignal(mSpaceAvailable);
+    SDL_mutexV(mSpaceMutex);
+}
+
+int Network::getMessageLength() const
+{
+    const unsigned int size = mInBuffer.getReadable();
+
+    if (size < 2)
+        return -1;
+
+    const Uint16 msgId = readWord(0);
+
+    // Unknown messages get a length of 0, which is rejected when dispatching
+    int len = (msgId < PACKET_TABLE_SIZE) ? packet_lengths[msgId] : 0;
+
+    if (len == -1 && size >= 4)
+        len = readWord(2);
+
+    return len;
 }
 
 bool Network::messageReady()
 {
-    int len = -1;
+    // Catch up on data that was to be skipped before it arrived
+    if (mToSkip)
+        skip(0);
 
-    mMutex.lock();
-    if (mInSize >= 2)
-    {
-        len = packet_lengths[readWord(0)];
+    if (mToSkip)
+        return false;
+
+    const int len = getMessageLength();
+
+    return len >= 0 && mInBuffer.getReadable() >= (unsigned int) len;
+}
+
+MessageIn Network::getNextMessage()
+{
+    const int len = getMessageLength();
 
-        if (len == -1 && mInSize > 4)
-            len = readWord(2);
+#ifdef DEBUG
+    logger->log("Received packet 0x%x of length %d", readWord(0), len);
+#endif
 
+    // Messages are parsed straight from the receive buffer, unless they wrap
+    // around its end.
+    unsigned int contiguous;
+    const char *data = mInBuffer.getReadBlock(0, contiguous);
+
+    if (contiguous < (unsigned int) len)
+    {
+        mWrapBuffer.resize(len);
+        mInBuffer.copy(0, len, &mWrapBuffer[0]);
+        data = &mWrapBuffer[0];
     }
 
-    bool ret = (mInSize >= static_cast<unsigned int>(len));
-    mMutex.unlock();
+    // Two replays of the same data should handle the same messages, which
+    // the digest makes easy to compare
+    if (mReplay)
+    {
+        for (int i = 0; i < len; i++)
+            mReplayDigest = (mReplayDigest ^ (Uint8) data[i]) * FNV_PRIME;
+    }
 
-    return ret;
+    return MessageIn(data, len);
 }
 
-MessageIn Network::getNextMessage()
+bool Network::startCapture(const std::string &path)
 {
-    while (!messageReady())
+    destroy(mCapture);
+
+    mCapture = new CaptureWriter();
+    if (!mCapture->open(path))
     {
-        if (mState == NET_ERROR)
-            break;
+        destroy(mCapture);
+        return false;
     }
 
-    mMutex.lock();
-    int msgId = readWord(0);
-    int len = packet_lengths[msgId];
+    return true;
+}
 
-    if (len == -1)
-        len = readWord(2);
+bool Network::startReplay(const std::string &path, bool paced)
+{
+    destroy(mReplay);
 
-#ifdef DEBUG
-    logger->log("Received packet 0x%x of length %d", msgId, len);
-#endif
+    mReplayPaced = paced;
+    mReplayTrace = config.getValue("networkReplayTrace", 0);
 
-    MessageIn msg(mInBuffer, len);
-    mMutex.unlock();
+    mReplay = new CaptureReader();
+    if (!mReplay->open(path))
+    {
+        destroy(mReplay);
+        return false;
+    }
 
-    return msg;
+    return true;
 }
 
 bool Network::realConnect()
 {
+    if (mReplay)
+    {
+        // Pretend to connect, a connection without recorded data just
+        // stays silent
+        if (!mReplay->nextConnection())
+            logger->log("Replay: no more recorded connections");
+
+        mReplayData.clear();
+        mReplayOffset = 0;
+        mConnectTime = SDL_GetTicks();
+
+        logger->log("Network::Replaying session with %s:%i",
+                    mAddress.c_str(), mPort);
+
+        mState = CONNECTED;
+        return true;
+    }
+
     IPaddress ipAddress;
 
     if (SDLNet_ResolveHost(&ipAddress, mAddress.c_str(), mPort) == -1)
@@ -328,6 +619,9 @@ bool Network::realConnect()
     logger->log("Network::Started session with %s:%i",
                 ipToString(ipAddress.host), ipAddress.port);
 
+    if (mCapture)
+        mCapture->startConnection();
+
     mState = CONNECTED;
 
     return true;
@@ -335,6 +629,14 @@ bool Network::realConnect()
 
 void Network::receive()
 {
+    if (mReplay)
+    {
+        while (mState == CONNECTED)
+            replayReceive();
+
+        return;
+    }
+
     SDLNet_SocketSet set;
 
     if (!(set = SDLNet_AllocSocketSet(1)))
@@ -358,10 +660,32 @@ void Network::receive()
     SDLNet_FreeSocketSet(set);
 }
 
+void Network::waitForSpace()
+{
+    // Checking for room under the lock closes the window in which a read
+    // could signal before the wait has started
+    SDL_mutexP(mSpaceMutex);
+
+    if (!mInBuffer.getWritable())
+        SDL_CondWaitTimeout(mSpaceAvailable, mSpaceMutex, 500);
+
+    SDL_mutexV(mSpaceMutex);
+}
+
 void Network::realReceive(SDLNet_SocketSet &set)
 {
+    // Leave the data in the socket while the main thread is catching up
+    if (!mInBuffer.getWritable())
+    {
+        waitForSpace();
+        return;
+    }
+
     int numReady = SDLNet_CheckSockets(set, ((Uint32)500));
     int ret;
+    unsigned int length;
+    char *data;
+
     switch (numReady)
     {
         case -1:
@@ -371,9 +695,9 @@ void Network::realReceive(SDLNet_SocketSet &set)
             break;
 
         case 1:
-            // Receive data from the socket
-            mMutex.lock();
-            ret = SDLNet_TCP_Recv(mSocket, mInBuffer + mInSize, BUFFER_SIZE - mInSize);
+            // Receive data from the socket straight into the free space
+            data = mInBuffer.getWriteBlock(length);
+            ret = SDLNet_TCP_Recv(mSocket, data, length);
 
             if (!ret)
             {
@@ -388,23 +712,11 @@ void Network::realReceive(SDLNet_SocketSet &set)
             }
             else
             {
-                mInSize += ret;
-                if (mToSkip)
-                {
-                    if (mInSize >= mToSkip)
-                    {
-                        mInSize -= mToSkip;
-                        memmove(mInBuffer, mInBuffer + mToSkip, mInSize);
-                        mToSkip = 0;
-                    }
-                    else
-                    {
-                        mToSkip -= mInSize;
-                        mInSize = 0;
-                    }
-                }
+                if (mCapture)
+                    mCapture->write(data, ret);
+
+                mInBuffer.commit(ret);
             }
-            mMutex.unlock();
             break;
 
         default:
@@ -419,6 +731,111 @@ void Network::realReceive(SDLNet_SocketSet &set)
     }
 }
 
+void Network::replayReceive()
+{
+    // Fetch the next record once the current one has been delivered
+    if (mReplayOffset == mReplayData.size())
+    {
+        mReplayOffset = 0;
+
+        if (!mReplay->readRecord(mReplayTime, mReplayData))
+        {
+            // Like a server that has nothing more to say
+            mReplayData.clear();
+            SDL_Delay(100);
+            return;
+        }
+    }
+
+    const Uint32 elapsed = SDL_GetTicks() - mConnectTime;
+    if (mReplayPaced && elapsed < mReplayTime)
+    {
+        SDL_Delay(std::min(mReplayTime - elapsed, (Uint32) 100));
+        return;
+    }
+
+    unsigned int length;
+    char *data = mInBuffer.getWriteBlock(length);
+
+    if (!length)
+    {
+        waitForSpace();
+        return;
+    }
+
+    length = std::min(length, (unsigned int) mReplayData.size() -
+                              mReplayOffset);
+    memcpy(data, &mReplayData[mReplayOffset], length);
+    mInBuffer.commit(length);
+    mReplayOffset += length;
+}
+
+void Network::send()
+{
+    // Data may have been flushed before the connection was made
+    Uint32 timeout = 0;
+
+    while (mState == CONNECTED)
+    {
+        SDL_SemWaitTimeout(mSendSignal, timeout);
+        timeout = 500;
+
+        mMutex.lock();
+        if (!mSendBuffer.empty())
+        {
+            const Uint32 age = SDL_GetTicks() - mSendQueueTime;
+
+            // Like Nagle's algorithm, give small amounts of data a chance to
+            // be sent along with more, but never for longer than the delay
+            if (mSendBuffer.size() < SEND_COALESCE_SIZE && age < mSendDelay)
+                timeout = mSendDelay - age;
+            else
+                mSending.swap(mSendBuffer);
+        }
+        mMutex.unlock();
+
+        if (!mSending.empty())
+            realSend();
+    }
+
+    // On a disconnect, send what was still waiting in a single final attempt,
+    // so that a stalled connection can't hold up the disconnect any longer
+    if (mState == IDLE)
+    {
+        mMutex.lock();
+        mSending.swap(mSendBuffer);
+        mMutex.unlock();
+
+        if (!mSending.empty())
+            realSend();
+    }
+}
+
+void Network::realSend()
+{
+    // When replaying there is no one to send to
+    if (mReplay)
+    {
+        mBytesSent += mSending.size();
+        mSending.clear();
+        return;
+    }
+
+    const Uint32 start = SDL_GetTicks();
+    const int ret = SDLNet_TCP_Send(mSocket, &mSending[0], mSending.size());
+
+    if (SDL_GetTicks() - start >= SEND_STALL_TIME)
+        mSendStalls++;
+
+    if (ret < (int) mSending.size())
+        setError(strprintf("Error in SDLNet_TCP_Send(): %s", SDLNet_GetError()));
+
+    if (ret > 0)
+        mBytesSent += ret;
+
+    mSending.clear();
+}
+
 void Network::setError(const std::string &error)
 {
     logger->log("Network error: %s", error.c_str());
@@ -436,16 +853,13 @@ void Network::fatal(const std::string &error)
 {
     logger->error(strprintf("Fatal network error: %s", error.c_str()));
     mError = error;
-    skip(mInSize);
     disconnect();
+    skip(mInBuffer.getReadable());
     clearHandlers();
 }
 
-Uint16 Network::readWord(int pos)
+Uint16 Network::readWord(int pos) const
 {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    return SDL_Swap16((*(Uint16*)(mInBuffer+(pos))));
-#else
-    return (*(Uint16*)(mInBuffer+(pos)));
-#endif
+    // Little endian, and possibly wrapping around the end of the buffer
+    return mInBuffer.peek(pos) | (mInBuffer.peek(pos + 1) << 8);
 }
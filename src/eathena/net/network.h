@@ -24,12 +24,13 @@
 #ifndef NETWORK_
 #define NETWORK_
 
-#include <map>
 #include <SDL_net.h>
 #include <SDL_thread.h>
 #include <string>
+#include <vector>
 
 #include "../../core/utils/mutex.h"
+#include "../../core/utils/ringbuffer.h"
 
 /**
  * Protocol version, reported to the eAthena char and mapserver who can adjust
@@ -37,9 +38,26 @@
  */
 #define CLIENT_PROTOCOL_VERSION      1
 
+class CaptureReader;
+class CaptureWriter;
 class MessageHandler;
 class MessageIn;
 
+/**
+ * Statistics on the handling of one type of message.
+ */
+struct PacketStatistics
+{
+    PacketStatistics():
+        count(0), bytes(0), totalTime(0), maxTime(0)
+    {}
+
+    unsigned int count;     /**< Number of messages handled */
+    unsigned int bytes;     /**< Size of those messages */
+    Uint64 totalTime;       /**< Microseconds spent handling them */
+    unsigned int maxTime;   /**< Longest time spent on one message */
+};
+
 class Network
 {
     public:
@@ -53,6 +71,7 @@ class Network
         };
 
         friend int networkThread(void *data);
+        friend int sendThread(void *data);
         friend class MessageOut;
 
         Network();
@@ -69,26 +88,97 @@ class Network
 
         void clearHandlers();
 
+        /**
+         * Sets whether statistics are kept on the handling of each type of
+         * message. Keeping them makes dispatching slightly slower.
+         */
+        void setStatisticsEnabled(bool enabled);
+
+        bool isStatisticsEnabled() const { return mStatisticsEnabled; }
+
+        /**
+         * Returns the statistics on messages with the given id.
+         */
+        const PacketStatistics &getStatistics(Uint16 id) const;
+
+        /**
+         * Returns the ids of the message types handling took the most time
+         * for, the most expensive first.
+         */
+        std::vector<Uint16> getBusiestPackets(unsigned int count) const;
+
+        /**
+         * Writes the statistics of all handled message types to the log.
+         */
+        void logStatistics() const;
+
+        void resetStatistics();
+
         NetState getState() const { return mState; }
 
         const std::string& getError() const { return mError; }
 
         bool isConnected() const { return mState == CONNECTED; }
 
-        int getInSize() const { return mInSize; }
+        int getInSize() const { return mInBuffer.getReadable(); }
 
+        /**
+         * Skips the given number of received bytes. When they haven't all
+         * arrived yet, the rest is skipped as soon as they do.
+         */
         void skip(int len);
 
+        /**
+         * Returns whether a complete message has been received.
+         */
         bool messageReady();
 
+        /**
+         * Returns the next message, which should be checked to be complete
+         * using messageReady() first. The message refers to the receive
+         * buffer directly and remains valid until it is skipped.
+         */
         MessageIn getNextMessage();
 
         void dispatchMessages();
 
+        /**
+         * Hands the messages written since the last call over to the
+         * sending thread.
+         */
         void flush();
 
+        /**
+         * Returns the number of messages written.
+         */
+        unsigned int getPacketsQueued() const { return mPacketsQueued; }
+
+        /**
+         * Returns the number of bytes sent.
+         */
+        unsigned int getBytesSent() const { return mBytesSent; }
+
+        /**
+         * Returns the number of times sending blocked for a long time.
+         */
+        unsigned int getSendStalls() const { return mSendStalls; }
+
         void clearError();
 
+        /**
+         * Records the data received on all following connections to the
+         * given file.
+         */
+        bool startCapture(const std::string &path);
+
+        /**
+         * Makes all following connections replay the data recorded in the
+         * given file instead of connecting to a server. Data sent to the
+         * server is discarded. Unless paced, the data is delivered as fast
+         * as it is handled rather than at the recorded times.
+         */
+        bool startReplay(const std::string &path, bool paced = true);
+
         void interrupt() { mState = NET_ERROR; }
 
     private:
@@ -96,7 +186,19 @@ class Network
 
         void fatal(const std::string &error);
 
-        Uint16 readWord(int pos);
+        Uint16 readWord(int pos) const;
+
+        /**
+         * Returns the length of the message at the start of the receive
+         * buffer, or -1 when not enough data has arrived to tell.
+         */
+        int getMessageLength() const;
+
+        /**
+         * Waits until the main thread makes room in the full receive buffer,
+         * or until a timeout passes.
+         */
+        void waitForSpace();
 
         bool realConnect();
 
@@ -104,25 +206,82 @@ class Network
 
         void realReceive(SDLNet_SocketSet &set);
 
+        /**
+         * Feeds recorded data into the receive buffer, keeping to the
+         * recorded timing when paced.
+         */
+        void replayReceive();
+
+        /**
+         * Sends flushed data until the connection is closed, and what is
+         * left once more when it was closed by a disconnect. Runs in a
+         * thread of its own.
+         */
+        void send();
+
+        void realSend();
+
         TCPsocket mSocket;
 
         std::string mAddress;
         short mPort;
 
-        char *mInBuffer, *mOutBuffer;
-        unsigned int mInSize, mOutSize;
+        /**
+         * Received data. Filled by the worker thread and read by the main
+         * thread without locking.
+         */
+        RingBuffer mInBuffer;
+
+        /**
+         * Holds a copy of the current message when it wraps around the end
+         * of the receive buffer.
+         */
+        std::vector<char> mWrapBuffer;
+
+        std::vector<char> mOutBuffer;       /**< Messages being written */
+        std::vector<char> mSendBuffer;      /**< Flushed, guarded by mMutex */
+        std::vector<char> mSending;         /**< Being sent */
+        Uint32 mSendQueueTime;              /**< When mSendBuffer was filled */
+
+        /**
+         * How long flushed data may wait for more data to be sent along with
+         * it, in milliseconds.
+         */
+        Uint32 mSendDelay;
+
+        SDL_sem *mSendSignal;               /**< Signaled on flush */
+
+        unsigned int mPacketsQueued;
+        unsigned int mBytesSent;
+        unsigned int mSendStalls;
 
         unsigned int mToSkip;
 
+        CaptureWriter *mCapture;
+        CaptureReader *mReplay;
+        Uint32 mConnectTime;                /**< Ticks when connected */
+        std::vector<char> mReplayData;      /**< Current recorded data */
+        unsigned int mReplayOffset;         /**< Amount of it delivered */
+        Uint32 mReplayTime;                 /**< When it was received */
+        bool mReplayPaced;                  /**< Keep to the recorded times */
+        bool mReplayTrace;                  /**< Log each handled message */
+        Uint32 mReplayDigest;               /**< Of the handled messages */
+        unsigned int mMessagesDispatched;   /**< On this connection */
+
+        SDL_mutex *mSpaceMutex;             /**< Guards the wait below */
+        SDL_cond *mSpaceAvailable;          /**< Signaled when data is read */
+
         NetState mState;
         std::string mError;
 
         SDL_Thread *mWorkerThread;
         Mutex mMutex;
 
-        typedef std::map<Uint16, MessageHandler*> MessageHandlers;
-        typedef MessageHandlers::iterator MessageHandlerIterator;
-        MessageHandlers mMessageHandlers;
+        /** Handlers indexed by message id */
+        std::vector<MessageHandler*> mMessageHandlers;
+
+        bool mStatisticsEnabled;
+        std::vector<PacketStatistics> mStatistics;  /**< By message id */
 };
 
 extern Network *network;
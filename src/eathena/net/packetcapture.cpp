@@ -0,0 +1,191 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <SDL.h>
+#include <SDL_endian.h>
+
+#include <cstring>
+
+#include "packetcapture.h"
+
+#include "../../core/log.h"
+
+/**
+ * Identifies a capture file and its format version.
+ */
+static const char CAPTURE_MAGIC[8] = { 'A', 'E', 'C', 'A', 'P', 'T', 0, 1 };
+
+CaptureWriter::CaptureWriter():
+    mFile(NULL),
+    mConnectionStart(0)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    if (mFile)
+        fclose(mFile);
+}
+
+bool CaptureWriter::open(const std::string &path)
+{
+    mFile = fopen(path.c_str(), "wb");
+
+    if (!mFile)
+    {
+        logger->log("Could not open capture file %s", path.c_str());
+        return false;
+    }
+
+    fwrite(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC), 1, mFile);
+    logger->log("Capturing network traffic to %s", path.c_str());
+    return true;
+}
+
+void CaptureWriter::startConnection()
+{
+    mConnectionStart = SDL_GetTicks();
+    writeRecord(NULL, 0);
+}
+
+void CaptureWriter::write(const char *data, const Uint32 length)
+{
+    if (length > 0)
+        writeRecord(data, length);
+}
+
+void CaptureWriter::writeRecord(const char *data, const Uint32 length)
+{
+    if (!mFile)
+        return;
+
+    const Uint32 header[2] = {
+        SDL_SwapLE32(SDL_GetTicks() - mConnectionStart),
+        SDL_SwapLE32(length)
+    };
+
+    fwrite(header, sizeof(header), 1, mFile);
+    if (length > 0)
+        fwrite(data, length, 1, mFile);
+
+    // Keep the capture usable when the client crashes
+    fflush(mFile);
+}
+
+CaptureReader::CaptureReader():
+    mFile(NULL),
+    mConnectionEnded(true),
+    mAtMarker(false)
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+    if (mFile)
+        fclose(mFile);
+}
+
+bool CaptureReader::open(const std::string &path)
+{
+    mFile = fopen(path.c_str(), "rb");
+
+    if (!mFile)
+    {
+        logger->log("Could not open capture file %s", path.c_str());
+        return false;
+    }
+
+    char magic[sizeof(CAPTURE_MAGIC)];
+
+    if (fread(magic, sizeof(magic), 1, mFile) != 1 ||
+        memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0)
+    {
+        logger->log("%s is not a capture file", path.c_str());
+        fclose(mFile);
+        mFile = NULL;
+        return false;
+    }
+
+    logger->log("Replaying network traffic from %s", path.c_str());
+    return true;
+}
+
+bool CaptureReader::nextConnection()
+{
+    Uint32 time, length;
+    std::vector<char> data;
+
+    // Skip what remains of the current connection
+    while (!mConnectionEnded)
+        readRecord(time, data);
+
+    // Look for the record starting the next connection, unless it was
+    // already read while reading the previous one
+    if (!mAtMarker && (!readHeader(time, length) || length != 0))
+        return false;
+
+    mAtMarker = false;
+    mConnectionEnded = false;
+    return true;
+}
+
+bool CaptureReader::readRecord(Uint32 &time, std::vector<char> &data)
+{
+    if (mConnectionEnded)
+        return false;
+
+    Uint32 length;
+
+    if (!readHeader(time, length))
+    {
+        mConnectionEnded = true;
+        return false;
+    }
+
+    if (length == 0)
+    {
+        mConnectionEnded = true;
+        mAtMarker = true;
+        return false;
+    }
+
+    data.resize(length);
+    if (fread(&data[0], length, 1, mFile) != 1)
+    {
+        logger->log("Warning: capture file is truncated");
+        mConnectionEnded = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool CaptureReader::readHeader(Uint32 &time, Uint32 &length)
+{
+    Uint32 header[2];
+
+    if (!mFile || fread(header, sizeof(header), 1, mFile) != 1)
+        return false;
+
+    time = SDL_SwapLE32(header[0]);
+    length = SDL_SwapLE32(header[1]);
+    return true;
+}
@@ -0,0 +1,114 @@
+/*
+ *  Aethyra
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This file is part of Aethyra.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PACKETCAPTURE_H
+#define PACKETCAPTURE_H
+
+#include <SDL_types.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Records the data received from the server to a file, so that a session can
+ * be replayed later using CaptureReader.
+ *
+ * A capture starts with a header, followed by records consisting of the time
+ * in milliseconds since the start of the connection, the length of the data
+ * and the data itself, all numbers being 32 bit little endian. A record
+ * without data marks the start of a new connection.
+ */
+class CaptureWriter
+{
+    public:
+        CaptureWriter();
+
+        ~CaptureWriter();
+
+        /**
+         * Opens the given file for writing, replacing its contents.
+         */
+        bool open(const std::string &path);
+
+        /**
+         * Marks the start of a new connection.
+         */
+        void startConnection();
+
+        /**
+         * Records data received on the current connection.
+         */
+        void write(const char *data, const Uint32 length);
+
+    private:
+        void writeRecord(const char *data, const Uint32 length);
+
+        FILE *mFile;
+        Uint32 mConnectionStart;    /**< Ticks at the start of connection */
+};
+
+/**
+ * Reads back data recorded by CaptureWriter.
+ */
+class CaptureReader
+{
+    public:
+        CaptureReader();
+
+        ~CaptureReader();
+
+        /**
+         * Opens the given capture file.
+         */
+        bool open(const std::string &path);
+
+        /**
+         * Skips ahead to the data of the next connection.
+         *
+         * @return <code>true</code> if there is another connection,
+         *         <code>false</code> when the end of the capture was reached.
+         */
+        bool nextConnection();
+
+        /**
+         * Reads the next record of the current connection.
+         *
+         * @param time the time the data was received, in milliseconds since
+         *             the start of the connection.
+         * @param data the received data.
+         * @return <code>false</code> when there is no more data for the
+         *         current connection.
+         */
+        bool readRecord(Uint32 &time, std::vector<char> &data);
+
+    private:
+        /**
+         * Reads the header of the next record.
+         */
+        bool readHeader(Uint32 &time, Uint32 &length);
+
+        FILE *mFile;
+        bool mConnectionEnded;      /**< No more data for the connection */
+        bool mAtMarker;             /**< Start of next connection was read */
+};
+
+#endif
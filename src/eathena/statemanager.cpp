@@ -64,6 +64,7 @@
 #include "../core/configuration.h"
 #include "../core/log.h"
 #include "../core/resourcemanager.h"
+#include "../core/scheduler.h"
 
 #include "../core/map/sprite/localplayer.h"
 
@@ -192,6 +193,16 @@ StateManager::StateManager() :
     SDLNet_Init();
     network = new Network();
 
+    if (!options.capturePath.empty() &&
+        !network->startCapture(options.capturePath))
+        logger->log("Unable to capture network data to %s",
+                    options.capturePath.c_str());
+
+    if (!options.replayPath.empty() &&
+        !network->startReplay(options.replayPath, !options.fastReplay))
+        logger->log("Unable to replay network data from %s",
+                    options.replayPath.c_str());
+
     setState(START_STATE);
 }
 
@@ -454,6 +465,8 @@ void StateManager::setState(const State state)
 
 void StateManager::logic()
 {
+    Scheduler::beginFrame();
+
     if (game)
         game->logic();
 
@@ -38,6 +38,8 @@
 
 #include "../../bindings/guichan/sdl/sdlinput.h"
 
+#include "../../bindings/guichan/widgets/window.h"
+
 #include "../../core/log.h"
 #include "../../core/resourcemanager.h"
 
@@ -130,6 +132,12 @@ EmoteContainer::~EmoteContainer()
     destroy(mProtFocusListener);
 }
 
+void EmoteContainer::logic()
+{
+    if (isVisible())
+        Window::contentChanged(this);
+}
+
 void EmoteContainer::draw(gcn::Graphics *graphics)
 {
     const int columns = std::max(1, getWidth() / gridWidth);
@@ -58,6 +58,11 @@ class EmoteContainer : public gcn::Widget, gcn::KeyListener, gcn::MouseListener,
          */
         virtual ~EmoteContainer();
 
+        /**
+         * Redraws the window, since the emotes are animated.
+         */
+        void logic();
+
         /**
          * Draws the emotes.
          */
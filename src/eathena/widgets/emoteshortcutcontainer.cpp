@@ -29,6 +29,8 @@
 #include "../../bindings/guichan/graphics.h"
 #include "../../bindings/guichan/palette.h"
 
+#include "../../bindings/guichan/widgets/window.h"
+
 #include "../../bindings/sdl/keyboardconfig.h"
 
 #include "../../core/configlistener.h"
@@ -92,6 +94,11 @@ EmoteShortcutContainer::~EmoteShortcutContainer()
     }
 }
 
+void EmoteShortcutContainer::logic()
+{
+    Window::contentChanged(this);
+}
+
 void EmoteShortcutContainer::draw(gcn::Graphics *graphics)
 {
     Graphics *g = static_cast<Graphics*>(graphics);
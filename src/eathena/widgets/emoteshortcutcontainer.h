@@ -51,6 +51,11 @@ class EmoteShortcutContainer : public ShortcutContainer
          */
         virtual ~EmoteShortcutContainer();
 
+        /**
+         * Redraws the window, since the emotes are animated.
+         */
+        void logic();
+
         /**
          * Draws the items.
          */
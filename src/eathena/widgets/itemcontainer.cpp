@@ -40,6 +40,8 @@
 
 #include "../../bindings/guichan/sdl/sdlinput.h"
 
+#include "../../bindings/guichan/widgets/window.h"
+
 #include "../../core/configlistener.h"
 #include "../../core/configuration.h"
 #include "../../core/log.h"
@@ -86,6 +88,7 @@ ItemContainer::ItemContainer(Inventory *inventory,
     mInventory(inventory),
     mSelectedItemIndex(NO_ITEM),
     mLastSelectedItemId(NO_ITEM),
+    mItemsDrawn(0),
     mEquipSlotsFilter(NO_ITEM)
 {
     if (!actionEventId.empty())
@@ -174,6 +177,26 @@ void ItemContainer::logic()
         mMaxItems = i;
         recalculateHeight();
     }
+
+    // The inventory changes without any input on the container
+    unsigned int items = 0;
+
+    for (i = 0; i < mInventory->getSize(); i++)
+    {
+        const Item *item = mInventory->getItem(i);
+
+        if (item)
+            items = items * 31 + item->getId() * 7 + item->getQuantity() * 2 +
+                    item->isEquipped();
+        else
+            items = items * 31;
+    }
+
+    if (items != mItemsDrawn)
+    {
+        mItemsDrawn = items;
+        Window::contentChanged(this);
+    }
 }
 
 namespace
@@ -266,6 +266,7 @@ class ItemContainer : public gcn::Widget, gcn::KeyListener, gcn::MouseListener,
         int mLastSelectedItemId;  // last selected item ID. If we lose the item, find again by ID.
         int mMaxItems;
         int mOffset;
+        unsigned int mItemsDrawn; /**< Checksum of the items last drawn */
 
         static ItemPopup *mItemPopup;
         static PopupMenu *mPopupMenu;
@@ -33,6 +33,8 @@
 #include "../../bindings/guichan/gui.h"
 #include "../../bindings/guichan/palette.h"
 
+#include "../../bindings/guichan/widgets/window.h"
+
 #include "../../bindings/sdl/keyboardconfig.h"
 
 #include "../../core/configlistener.h"
@@ -69,7 +71,8 @@ class ItemShortcutContainerConfigListener : public ConfigListener
 };
 
 ItemShortcutContainer::ItemShortcutContainer():
-    ShortcutContainer(itemShortcut)
+    ShortcutContainer(itemShortcut),
+    mItemsDrawn(0)
 {
     if (mInstances == 0)
     {
@@ -97,6 +100,30 @@ ItemShortcutContainer::~ItemShortcutContainer()
     }
 }
 
+void ItemShortcutContainer::logic()
+{
+    // Item quantities change without any input on the shortcuts
+    unsigned int items = 0;
+
+    for (int i = 0; i < mShortcutHandler->getNumOfShortcuts(); i++)
+    {
+        const int itemId = mShortcutHandler->getShortcut(i);
+        const Item *item = itemId < 0 ? NULL :
+            player_node->getInventory()->findItem(itemId);
+
+        items = items * 31 + itemId;
+
+        if (item)
+            items += item->getQuantity() * 2 + item->isEquipped();
+    }
+
+    if (items != mItemsDrawn)
+    {
+        mItemsDrawn = items;
+        Window::contentChanged(this);
+    }
+}
+
 void ItemShortcutContainer::draw(gcn::Graphics *graphics)
 {
     Graphics *g = static_cast<Graphics*>(graphics);
@@ -50,6 +50,11 @@ class ItemShortcutContainer : public ShortcutContainer
          */
         virtual ~ItemShortcutContainer();
 
+        /**
+         * Redraws the window when the shortcut items changed.
+         */
+        void logic();
+
         /**
          * Draws the items.
          */
@@ -65,6 +70,8 @@ class ItemShortcutContainer : public ShortcutContainer
         static int mInstances;
 
         static PopupMenu *mPopupMenu;
+
+        unsigned int mItemsDrawn; /**< Checksum of the items last drawn */
 };
 
 #endif
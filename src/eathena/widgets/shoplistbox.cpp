@@ -29,6 +29,8 @@
 #include "../../bindings/guichan/graphics.h"
 #include "../../bindings/guichan/palette.h"
 
+#include "../../bindings/guichan/widgets/window.h"
+
 const int ITEM_ICON_SIZE = 32;
 
 ShopListBox::ShopListBox(gcn::ListModel *listModel):
@@ -51,6 +53,7 @@ ShopListBox::ShopListBox(gcn::ListModel *listModel, ShopListModel *shopListModel
 void ShopListBox::setPlayersMoney(int money)
 {
     mPlayerMoney = money;
+    Window::contentChanged(this);
 }
 
 void ShopListBox::draw(gcn::Graphics *gcnGraphics)
@@ -117,4 +120,5 @@ void ShopListBox::adjustSize()
 void ShopListBox::setPriceCheck(bool check)
 {
     mPriceCheck = check;
+    Window::contentChanged(this);
 }
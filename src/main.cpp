@@ -43,12 +43,16 @@ namespace
 static void printHelp()
 {
     std::cout << _("Options: ") << std::endl
+              << "  -c --capture\t\t: " << _("Record received network "
+                 "data to this file") << std::endl
               << "  -C --configfile\t: " << _("Configuration file to use")
               << std::endl
               << "  -d --data\t\t: " << _("Directory to load game data from")
               << std::endl
               << "  -D --default\t\t: " << _("Bypass the login process with "
                  "default settings") << std::endl
+              << "  -f --fast-replay\t: " << _("Replay as fast as possible "
+                 "instead of at the recorded pace") << std::endl
               << "  -h --help\t\t: " << _("Display this help") << std::endl
               << "  -H --updatehost\t: " << _("Use this update host")
               << std::endl
@@ -56,6 +60,8 @@ static void printHelp()
               << std::endl
               << "  -P --password\t\t: " << _("Login with this password")
               << std::endl
+              << "  -R --replay\t\t: " << _("Replay network data recorded "
+                 "with --capture instead of connecting") << std::endl
               << "  -u --skipupdate\t: " << _("Skip the update downloads")
               << std::endl
               << "  -U --username\t\t: " << _("Login with this username")
@@ -101,14 +107,17 @@ static void printVersion()
 
 static void parseOptions(int argc, char *argv[])
 {
-    const char *optstring = "hvud:U:P:Dp:C:H:O";
+    const char *optstring = "hvud:U:P:Dfp:c:C:H:OR:";
 
     const struct option long_options[] = {
+        { "capture",    required_argument, 0, 'c' },
         { "configfile", required_argument, 0, 'C' },
         { "data",       required_argument, 0, 'd' },
         { "default",    no_argument,       0, 'D' },
+        { "fast-replay", no_argument,      0, 'f' },
         { "playername", required_argument, 0, 'p' },
         { "password",   required_argument, 0, 'P' },
+        { "replay",     required_argument, 0, 'R' },
         { "help",       no_argument,       0, 'h' },
         { "updatehost", required_argument, 0, 'H' },
         { "skipupdate", no_argument,       0, 'u' },
@@ -128,6 +137,9 @@ static void parseOptions(int argc, char *argv[])
 
         switch (result)
         {
+            case 'c':
+                options.capturePath = optarg;
+                break;
             case 'C':
                 options.configPath = optarg;
                 break;
@@ -137,6 +149,9 @@ static void parseOptions(int argc, char *argv[])
             case 'D':
                 options.chooseDefault = true;
                 break;
+            case 'f':
+                options.fastReplay = true;
+                break;
             default: // Unknown option
             case 'h':
                 options.printHelp = true;
@@ -150,6 +165,9 @@ static void parseOptions(int argc, char *argv[])
             case 'P':
                 options.password = optarg;
                 break;
+            case 'R':
+                options.replayPath = optarg;
+                break;
             case 'u':
                 options.skipUpdate = true;
                 break;
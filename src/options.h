@@ -38,7 +38,8 @@ struct Options
         skipUpdate(false),
         chooseDefault(false),
         noOpenGL(false),
-        promptForGraphicsMode(false)
+        promptForGraphicsMode(false),
+        fastReplay(false)
     {};
 
     bool printHelp;
@@ -47,12 +48,15 @@ struct Options
     bool chooseDefault;
     bool noOpenGL;
     bool promptForGraphicsMode;
+    bool fastReplay;
     std::string username;
     std::string password;
     std::string playername;
     std::string configPath;
     std::string updateHost;
     std::string dataPath;
+    std::string capturePath;
+    std::string replayPath;
 };
 
 extern Options options;
@@ -0,0 +1,211 @@
+/*
+ *  AtlasTest
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "../../src/core/image/shelfpacker.h"
+
+/** Like the texture atlas, with a pixel left between images */
+const int PAGE_SIZE = 1024;
+const int PADDING = 1;
+
+const int ITERATIONS = 200000;
+const int LIVE_IMAGES = 300;
+
+struct Rect
+{
+    int page;
+    int x, y, width, height;
+};
+
+/**
+ * A small deterministic generator, so that every run churns the same way.
+ */
+unsigned int randomState = 12345;
+
+int random(const int min, const int max)
+{
+    randomState = randomState * 1103515245 + 12345;
+    return min + (randomState >> 16) % (max - min + 1);
+}
+
+/**
+ * The pages, handled the way TextureAtlas::add and TextureAtlas::remove do.
+ */
+std::vector<ShelfPacker*> pages;
+
+bool add(const int width, const int height, Rect &rect)
+{
+    rect.width = width + PADDING;
+    rect.height = height + PADDING;
+
+    for (unsigned int i = 0; i < pages.size(); i++)
+    {
+        if (pages[i] && pages[i]->allocate(rect.width, rect.height, rect.x,
+                                           rect.y))
+        {
+            rect.page = i;
+            return true;
+        }
+    }
+
+    ShelfPacker *page = new ShelfPacker(PAGE_SIZE);
+    if (!page->allocate(rect.width, rect.height, rect.x, rect.y))
+    {
+        delete page;
+        return false;
+    }
+
+    // Reuse the slot of a deleted page, so that page numbers stay small
+    rect.page = pages.size();
+    for (unsigned int i = 0; i < pages.size(); i++)
+    {
+        if (!pages[i])
+        {
+            rect.page = i;
+            break;
+        }
+    }
+
+    if (rect.page == (int) pages.size())
+        pages.push_back(page);
+    else
+        pages[rect.page] = page;
+
+    return true;
+}
+
+void remove(const Rect &rect)
+{
+    ShelfPacker *page = pages[rect.page];
+    page->release(rect.x, rect.y);
+
+    if (page->isEmpty())
+    {
+        delete page;
+        pages[rect.page] = NULL;
+    }
+}
+
+int countPages()
+{
+    int count = 0;
+    for (unsigned int i = 0; i < pages.size(); i++)
+    {
+        if (pages[i])
+            count++;
+    }
+    return count;
+}
+
+bool overlaps(const Rect &a, const Rect &b)
+{
+    return a.page == b.page &&
+           a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+int main()
+{
+    bool success = true;
+    std::deque<Rect> live;
+    int maxPages = 0;
+
+    // Strings of text rendered in a few font sizes, replaced oldest first
+    // like the entries of a text cache
+    for (int i = 0; i < ITERATIONS && success; i++)
+    {
+        if (live.size() == LIVE_IMAGES)
+        {
+            remove(live.front());
+            live.pop_front();
+        }
+
+        const int height = random(0, 3) * 2 + 12;
+        const int width = random(4, 250);
+
+        Rect rect;
+        if (!add(width, height, rect))
+        {
+            std::cerr<<"Image of "<<width<<"x"<<height<<" was not placed"
+                     <<std::endl;
+            success = false;
+            break;
+        }
+
+        if (rect.x < 0 || rect.y < 0 || rect.x + rect.width > PAGE_SIZE ||
+            rect.y + rect.height > PAGE_SIZE)
+        {
+            std::cerr<<"Image placed outside of its page at "<<rect.x<<","
+                     <<rect.y<<std::endl;
+            success = false;
+        }
+
+        for (std::deque<Rect>::iterator j = live.begin(); j != live.end();
+             ++j)
+        {
+            if (overlaps(rect, *j))
+            {
+                std::cerr<<"Image at "<<rect.x<<","<<rect.y
+                         <<" overlaps one at "<<j->x<<","<<j->y
+                         <<" on page "<<rect.page<<std::endl;
+                success = false;
+                break;
+            }
+        }
+
+        live.push_back(rect);
+
+        const int pageCount = countPages();
+        if (pageCount > maxPages)
+            maxPages = pageCount;
+    }
+
+    // The images in use cover at most about a third of a page, so a few
+    // pages leave plenty of room for rows that are still being drained
+    const int maxAllowed = 4;
+    std::cout<<"Most pages in use: "<<maxPages<<std::endl;
+
+    if (maxPages > maxAllowed)
+    {
+        std::cerr<<"Page count grew to "<<maxPages<<", expected at most "
+                 <<maxAllowed<<std::endl;
+        success = false;
+    }
+
+    while (!live.empty())
+    {
+        remove(live.front());
+        live.pop_front();
+    }
+
+    if (countPages() != 0)
+    {
+        std::cerr<<countPages()<<" pages left after freeing all images"
+                 <<std::endl;
+        success = false;
+    }
+
+    std::cout<<(success ? "All texture atlas checks passed" :
+                          "Texture atlas checks FAILED")<<std::endl;
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+/*
+ *  DyeBench
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <png.h>
+
+#include "../../src/core/log.h"
+
+#include "../../src/core/image/dye.h"
+
+/**
+ * Dye only needs the logger to report invalid dyes, so it is stubbed out
+ * here instead of pulling in the rest of the client.
+ */
+Logger *logger = NULL;
+
+Logger::Logger():
+    mLogToStandardOut(false),
+    mLogToChatWindow(false),
+    mMainThread(0),
+    mMutex(NULL)
+{
+}
+
+Logger::~Logger()
+{
+}
+
+void Logger::log(const char *log_text, ...)
+{
+    va_list ap;
+    va_start(ap, log_text);
+    vfprintf(stderr, log_text, ap);
+    va_end(ap);
+    fprintf(stderr, "\n");
+}
+
+const std::string DEFAULT_DYE = "R:#ff0000,ffff00;G:#00ff00,004020;"
+                                "Y:#ffff00,803000;B:#2040ff;M:#ff00ff,400040;"
+                                "C:#00ffff;W:#ffffff,303030,101010";
+
+struct Pixels
+{
+    std::string name;
+    std::vector<uint32_t> data;     /**< Stored as 0xRRGGBBAA */
+};
+
+/**
+ * The recoloring as the client did it before the lookup tables: the palette
+ * is interpolated again for every pixel.
+ */
+void updatePerPixel(const Dye &dye, uint32_t *pixels, const int count)
+{
+    for (uint32_t *end = pixels + count; pixels != end; ++pixels)
+    {
+        const uint32_t pixel = *pixels;
+
+        if (!(pixel & 0xff))
+            continue;
+
+        const int r = pixel >> 24;
+        const int g = (pixel >> 16) & 0xff;
+        const int b = (pixel >> 8) & 0xff;
+
+        const int cmax = std::max(r, std::max(g, b));
+        if (cmax == 0)
+            continue;
+
+        const int cmin = std::min(r, std::min(g, b));
+        const int intensity = r + g + b;
+
+        // not pure
+        if (cmin != cmax && (cmin != 0 || (intensity != cmax &&
+                                           intensity != 2 * cmax)))
+            continue;
+
+        const int i = (r != 0) | ((g != 0) << 1) | ((b != 0) << 2);
+
+        const DyePalette *palette = dye.getPalette(i - 1);
+        if (!palette)
+            continue;
+
+        *pixels = ((uint32_t) palette->getColor(cmax) << 8) | (pixel & 0xff);
+    }
+}
+
+void printUsage()
+{
+    std::cerr<<"Usage: dyebench [-r repeat] [-d dye] [imageFile...]"<<std::endl
+             <<"    -r number of times to recolor each image (default 20)"<<std::endl
+             <<"    -d the dye to apply, as in the client (default uses all seven palettes)"<<std::endl
+             <<std::endl
+             <<"Times the old per-pixel recoloring against the lookup tables and compares their results"<<std::endl
+             <<"See readme.txt for full documentation"<<std::endl;
+}
+
+double getTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Generates an image that looks like a sprite sheet to the dye: runs of
+ * pure colors of every palette and intensity, between transparent pixels
+ * and colors which are left alone.
+ */
+void generatePixels(Pixels &pixels)
+{
+    // Use a fixed seed, so that runs are comparable
+    srand(1);
+
+    pixels.name = "generated 512x512";
+    pixels.data.clear();
+
+    while (pixels.data.size() < 512 * 512)
+    {
+        const int kind = rand() % 10;
+        uint32_t color;
+
+        if (kind < 3)
+            color = (rand() & 0xffffff) << 8;
+        else if (kind < 8)
+        {
+            // Each channel is either off, at the full intensity or, for
+            // two channels, at half of it like the dye allows
+            const int intensity = rand() % 256;
+            const int channels = rand() % 7 + 1;
+            color = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                if (channels & (1 << c))
+                    color |= (uint32_t) intensity << (24 - c * 8);
+            }
+            color |= rand() % 4 ? 0xff : rand() % 256;
+        }
+        else
+            color = ((rand() & 0xffffff) << 8) | (rand() % 256);
+
+        for (int run = rand() % 16 + 1;
+             run > 0 && pixels.data.size() < 512 * 512; run--)
+        {
+            pixels.data.push_back(color);
+        }
+    }
+}
+
+/**
+ * Loads an image in the pixel layout that the client dyes, as done by
+ * Image::convertToRGBA.
+ */
+bool loadPixels(const std::string &filename, Pixels &pixels)
+{
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+
+    if (!png_image_begin_read_from_file(&image, filename.c_str()))
+    {
+        std::cerr<<"Could not load "<<filename<<": "<<image.message
+                 <<std::endl;
+        return false;
+    }
+
+    // Bytes in the order R, G, B, A, which are packed as 0xRRGGBBAA below
+    image.format = PNG_FORMAT_RGBA;
+    std::vector<png_byte> bytes(PNG_IMAGE_SIZE(image));
+
+    if (!png_image_finish_read(&image, NULL, &bytes[0], 0, NULL))
+    {
+        std::cerr<<"Could not load "<<filename<<": "<<image.message
+                 <<std::endl;
+        png_image_free(&image);
+        return false;
+    }
+
+    pixels.name = filename;
+    pixels.data.resize(image.width * image.height);
+
+    for (unsigned int i = 0; i < pixels.data.size(); i++)
+    {
+        const png_byte *p = &bytes[i * 4];
+        pixels.data[i] = ((uint32_t) p[0] << 24) | (p[1] << 16) |
+                         (p[2] << 8) | p[3];
+    }
+
+    return true;
+}
+
+/**
+ * Recolors the pixels both ways, reports the time taken and returns whether
+ * the results are the same.
+ */
+bool benchmark(const Pixels &pixels, const std::string &dyeString,
+               const int repeat)
+{
+    const Dye dye(dyeString);
+
+    const int count = pixels.data.size();
+    std::vector<uint32_t> oldResult, newResult;
+
+    double start = getTime();
+    for (int i = 0; i < repeat; i++)
+    {
+        oldResult = pixels.data;
+        updatePerPixel(dye, &oldResult[0], count);
+    }
+    const double oldTime = getTime() - start;
+
+    start = getTime();
+    for (int i = 0; i < repeat; i++)
+    {
+        newResult = pixels.data;
+        dye.update(&newResult[0], count);
+    }
+    const double newTime = getTime() - start;
+
+    int differences = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (oldResult[i] == newResult[i])
+            continue;
+
+        if (differences++ < 5)
+        {
+            fprintf(stderr, "Pixel %d: %08x dyed to %08x before, %08x now\n",
+                    i, pixels.data[i], oldResult[i], newResult[i]);
+        }
+    }
+
+    const double pixelCount = (double) count * repeat / 1000000.0;
+    printf("%s: %d pixels\n", pixels.name.c_str(), count);
+    printf("    per pixel:     %8.2f Mpixels/s\n", pixelCount / oldTime);
+    printf("    lookup tables: %8.2f Mpixels/s (%.1fx)\n",
+           pixelCount / newTime, oldTime / newTime);
+
+    if (differences)
+    {
+        printf("    FAILED: %d pixels differ\n", differences);
+        return false;
+    }
+
+    printf("    results match\n");
+    return true;
+}
+
+int main(int argc, char * argv[])
+{
+    int repeat = 20;
+    std::string dye = DEFAULT_DYE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:d:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                repeat = atoi(optarg);
+                break;
+            case 'd':
+                dye = optarg;
+                break;
+            default:
+                printUsage();
+                return 1;
+        }
+    }
+
+    if (repeat <= 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    Logger log;
+    logger = &log;
+
+    bool success = true;
+    Pixels pixels;
+
+    if (optind == argc)
+    {
+        generatePixels(pixels);
+        success = benchmark(pixels, dye, repeat);
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        if (!loadPixels(argv[i], pixels))
+        {
+            success = false;
+            continue;
+        }
+
+        if (pixels.data.empty())
+            continue;
+
+        if (!benchmark(pixels, dye, repeat))
+            success = false;
+    }
+
+    return success ? 0 : 1;
+}
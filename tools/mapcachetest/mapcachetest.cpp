@@ -0,0 +1,312 @@
+/*
+ *  MapCacheTest
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../../src/core/log.h"
+#include "../../src/core/resourcemanager.h"
+
+#include "../../src/core/map/mapcache.h"
+
+/**
+ * The map cache only needs the logger and the write directory, so those
+ * are stubbed out here instead of pulling in the rest of the client.
+ */
+Logger *logger = NULL;
+
+const std::string WRITE_DIR = "mapcachetest.tmp";
+const std::string MAP_FILE = "maps/test.tmx.gz";
+const std::string CACHE_FILE = WRITE_DIR + "/cache/maps/maps_test.tmx.gz.bin";
+const unsigned long CHECKSUM = 0x1234abcd;
+
+Logger::Logger():
+    mLogToStandardOut(false),
+    mLogToChatWindow(false)
+{
+}
+
+Logger::~Logger()
+{
+}
+
+void Logger::log(const char *log_text, ...)
+{
+    va_list ap;
+    va_start(ap, log_text);
+    vprintf(log_text, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+ResourceManager::ResourceManager()
+{
+}
+
+ResourceManager::~ResourceManager()
+{
+}
+
+ResourceManager *ResourceManager::getInstance()
+{
+    static ResourceManager instance;
+    return &instance;
+}
+
+std::string ResourceManager::getWriteDir() const
+{
+    return WRITE_DIR;
+}
+
+bool ResourceManager::mkdir(const std::string &path)
+{
+    std::string dir = WRITE_DIR;
+    std::string::size_type start = 1;
+
+    ::mkdir(dir.c_str(), 0755);
+
+    while (start < path.length())
+    {
+        std::string::size_type end = path.find('/', start);
+        if (end == std::string::npos)
+            end = path.length();
+
+        dir += "/" + path.substr(start, end - start);
+        ::mkdir(dir.c_str(), 0755);
+        start = end + 1;
+    }
+
+    return true;
+}
+
+MapData createMapData()
+{
+    MapData data;
+    data.width = 50;
+    data.height = 40;
+    data.tileWidth = 32;
+    data.tileHeight = 32;
+    data.properties.push_back(std::make_pair(std::string("name"),
+                                             std::string("Test")));
+
+    MapData::TilesetData tileset;
+    tileset.firstGid = 1;
+    tileset.image = "graphics/tiles/test.png";
+    tileset.tileWidth = 32;
+    tileset.tileHeight = 32;
+
+    MapData::AnimationData animation;
+    animation.gid = 5;
+    animation.frames.push_back(std::make_pair(3, 100));
+    animation.frames.push_back(std::make_pair(4, 200));
+    tileset.animations.push_back(animation);
+    data.tilesets.push_back(tileset);
+
+    MapData::LayerData layer;
+    layer.x = 0;
+    layer.y = 1;
+    layer.width = data.width;
+    layer.height = data.height;
+    layer.tileWidth = 32;
+    layer.tileHeight = 32;
+    layer.fringe = true;
+    layer.visible = true;
+    layer.collision = false;
+    for (int i = 0; i < layer.width * layer.height; i++)
+        layer.tiles.push_back(i * 7 - 3);
+    data.layers.push_back(layer);
+
+    layer.fringe = false;
+    layer.collision = true;
+    layer.tiles.clear();
+    for (int i = 0; i < layer.width * layer.height; i++)
+        layer.walkable.push_back(i % 3 == 0);
+    data.layers.push_back(layer);
+
+    MapData::ParticleData particle;
+    particle.file = "graphics/particles/test.particle.xml";
+    particle.x = 3;
+    particle.y = -4;
+    data.particles.push_back(particle);
+
+    data.warps.push_back("new_1-1");
+
+    return data;
+}
+
+bool equals(const MapData &a, const MapData &b)
+{
+    if (a.width != b.width || a.height != b.height ||
+        a.tileWidth != b.tileWidth || a.tileHeight != b.tileHeight ||
+        a.properties != b.properties || a.warps != b.warps ||
+        a.tilesets.size() != b.tilesets.size() ||
+        a.layers.size() != b.layers.size() ||
+        a.particles.size() != b.particles.size())
+        return false;
+
+    for (unsigned int i = 0; i < a.tilesets.size(); i++)
+    {
+        const MapData::TilesetData &ta = a.tilesets[i];
+        const MapData::TilesetData &tb = b.tilesets[i];
+
+        if (ta.firstGid != tb.firstGid || ta.image != tb.image ||
+            ta.tileWidth != tb.tileWidth || ta.tileHeight != tb.tileHeight ||
+            ta.animations.size() != tb.animations.size())
+            return false;
+
+        for (unsigned int j = 0; j < ta.animations.size(); j++)
+        {
+            if (ta.animations[j].gid != tb.animations[j].gid ||
+                ta.animations[j].frames != tb.animations[j].frames)
+                return false;
+        }
+    }
+
+    for (unsigned int i = 0; i < a.layers.size(); i++)
+    {
+        const MapData::LayerData &la = a.layers[i];
+        const MapData::LayerData &lb = b.layers[i];
+
+        if (la.x != lb.x || la.y != lb.y ||
+            la.width != lb.width || la.height != lb.height ||
+            la.tileWidth != lb.tileWidth || la.tileHeight != lb.tileHeight ||
+            la.fringe != lb.fringe || la.visible != lb.visible ||
+            la.collision != lb.collision || la.tiles != lb.tiles ||
+            la.walkable != lb.walkable)
+            return false;
+    }
+
+    for (unsigned int i = 0; i < a.particles.size(); i++)
+    {
+        if (a.particles[i].file != b.particles[i].file ||
+            a.particles[i].x != b.particles[i].x ||
+            a.particles[i].y != b.particles[i].y)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Checks that reading the cache fails and leaves the given data alone.
+ */
+bool expectFailure(const std::string &name)
+{
+    MapData data;
+    data.width = 7;
+    data.height = 9;
+    data.tileWidth = 0;
+    data.tileHeight = 0;
+    data.warps.push_back("untouched");
+
+    if (MapCache::read(MAP_FILE, CHECKSUM, data))
+    {
+        std::cerr<<name<<": damaged cache was accepted"<<std::endl;
+        return false;
+    }
+
+    if (data.width != 7 || data.height != 9 || data.warps.size() != 1 ||
+        !data.properties.empty() || !data.tilesets.empty() ||
+        !data.layers.empty() || !data.particles.empty())
+    {
+        std::cerr<<name<<": failed read changed the map data"<<std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main()
+{
+    const MapData original = createMapData();
+    bool success = true;
+
+    MapCache::write(MAP_FILE, CHECKSUM, original);
+
+    struct stat info;
+    if (stat(CACHE_FILE.c_str(), &info) != 0)
+    {
+        std::cerr<<"Cache file "<<CACHE_FILE<<" was not written"<<std::endl;
+        return -1;
+    }
+    const off_t size = info.st_size;
+
+    MapData read;
+    if (!MapCache::read(MAP_FILE, CHECKSUM, read) || !equals(original, read))
+    {
+        std::cerr<<"Reading the cache back gave different data"<<std::endl;
+        success = false;
+    }
+
+    MapData other;
+    if (MapCache::read(MAP_FILE, CHECKSUM + 1, other))
+    {
+        std::cerr<<"Cache of a different map file was accepted"<<std::endl;
+        success = false;
+    }
+
+    // Cut the file off at several points, including in the middle of the
+    // layers, which is where the reader used to give up halfway
+    const off_t cuts[] = { 4, 20, 100, size / 2, size - 40, size - 1 };
+    for (unsigned int i = 0; i < sizeof(cuts) / sizeof(cuts[0]); i++)
+    {
+        MapCache::write(MAP_FILE, CHECKSUM, original);
+
+        if (truncate(CACHE_FILE.c_str(), cuts[i]) != 0)
+        {
+            std::cerr<<"Could not truncate "<<CACHE_FILE<<std::endl;
+            return -1;
+        }
+
+        if (!expectFailure("Truncated cache"))
+            success = false;
+    }
+
+    MapCache::write(MAP_FILE, CHECKSUM, original);
+    FILE *file = fopen(CACHE_FILE.c_str(), "ab");
+    if (file)
+    {
+        fputs("garbage", file);
+        fclose(file);
+    }
+    if (!expectFailure("Cache with trailing data"))
+        success = false;
+
+    // A collision layer whose tile count overflows to nothing, so that it
+    // would be read as complete without any walkability data
+    MapData huge = original;
+    huge.layers[1].width = 65536;
+    huge.layers[1].height = 65536;
+    huge.layers[1].walkable.clear();
+    MapCache::write(MAP_FILE, CHECKSUM, huge);
+    if (!expectFailure("Cache with an oversized layer"))
+        success = false;
+
+    remove(CACHE_FILE.c_str());
+
+    std::cout<<(success ? "All map cache checks passed" :
+                          "Map cache checks FAILED")<<std::endl;
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+/*
+ *  PathBench
+ *  Copyright (C) 2010  Aethyra Development Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../tmxcopy/map.hpp"
+
+#include "../../src/core/map/pathfinder.h"
+
+struct Query
+{
+    int startX, startY;
+    int destX, destY;
+};
+
+void printUsage()
+{
+    std::cerr<<"Usage: pathbench [-n count] [-r repeat] [-m maxcost] [-w outfile] mapFile [queryFile]"<<std::endl
+             <<"    -n number of random queries to generate when no queryFile is given (default 1000)"<<std::endl
+             <<"    -r number of times to replay the queries (default 10)"<<std::endl
+             <<"    -m only search directly, up to this path cost (10 per straight step)"<<std::endl
+             <<"    -w write the queries to outfile, so that they can be replayed later"<<std::endl
+             <<std::endl
+             <<"Replays start/goal queries against the collision layer of a map and reports paths per second"<<std::endl
+             <<"See readme.txt for full documentation"<<std::endl;
+}
+
+double getTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Fills the path finder with the collision layer of the map. Mirrors
+ * MapReader in the client: empty tiles and the first tile of a tileset are
+ * walkable.
+ */
+bool loadCollision(Map *map, PathFinder &pathFinder)
+{
+    for (size_t l = 0; l < map->getNumberOfLayers(); l++)
+    {
+        Layer *layer = map->getLayer(l);
+        std::string name = layer->getName();
+        for (size_t i = 0; i < name.length(); i++)
+            name[i] = tolower(name[i]);
+
+        if (name.substr(0, 9) != "collision")
+            continue;
+
+        for (int y = 0; y < map->getHeight(); y++)
+        {
+            for (int x = 0; x < map->getWidth(); x++)
+            {
+                Tile &tile = layer->getTile(x, y, map->getWidth());
+                pathFinder.setWalk(x, y, tile.empty() || tile.index == 0);
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void generateQueries(const PathFinder &pathFinder, int count,
+                     std::vector<Query> &queries)
+{
+    const int w = pathFinder.getWidth();
+    const int h = pathFinder.getHeight();
+
+    // Use a fixed seed, so that runs are comparable
+    srand(1);
+
+    while (count > 0)
+    {
+        Query q;
+        q.startX = rand() % w;
+        q.startY = rand() % h;
+        q.destX = rand() % w;
+        q.destY = rand() % h;
+
+        if (!pathFinder.isWalkable(q.startX, q.startY) ||
+            !pathFinder.isWalkable(q.destX, q.destY))
+        {
+            continue;
+        }
+
+        queries.push_back(q);
+        count--;
+    }
+}
+
+bool readQueries(const std::string &filename, std::vector<Query> &queries)
+{
+    std::ifstream file(filename.c_str());
+    if (!file)
+    {
+        std::cerr<<"Could not open "<<filename<<std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        Query q;
+        if (sscanf(line.c_str(), "%d %d %d %d",
+                   &q.startX, &q.startY, &q.destX, &q.destY) == 4)
+        {
+            queries.push_back(q);
+        }
+    }
+
+    return true;
+}
+
+void writeQueries(const std::string &filename,
+                  const std::vector<Query> &queries)
+{
+    std::ofstream file(filename.c_str());
+    file<<"# startX startY destX destY"<<std::endl;
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        file<<queries[i].startX<<" "<<queries[i].startY<<" "
+            <<queries[i].destX<<" "<<queries[i].destY<<std::endl;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    int count = 1000;
+    int repeat = 10;
+    int maxCost = 0;
+    std::string outFile;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:m:w:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'r':
+                repeat = atoi(optarg);
+                break;
+            case 'm':
+                maxCost = atoi(optarg);
+                break;
+            case 'w':
+                outFile = optarg;
+                break;
+            case '?':
+                std::cerr<<"Unrecognized option"<<std::endl;
+                printUsage();
+                return -1;
+        }
+    }
+
+    if ((argc-optind) < 1 || (argc-optind) > 2 || count <= 0 || repeat <= 0)
+    {
+        printUsage();
+        return -1;
+    }
+
+    Map *map;
+    try
+    {
+        map = new Map(argv[optind]);
+    }
+    catch (int)
+    {
+        return -1;
+    }
+
+    PathFinder pathFinder(map->getWidth(), map->getHeight());
+    if (!loadCollision(map, pathFinder))
+    {
+        std::cerr<<"No collision layer found"<<std::endl;
+        delete map;
+        return -1;
+    }
+
+    const double buildStart = getTime();
+    pathFinder.buildHierarchy();
+    const double buildTime = getTime() - buildStart;
+
+    std::vector<Query> queries;
+    if ((argc-optind) == 2)
+    {
+        if (!readQueries(argv[optind+1], queries))
+        {
+            delete map;
+            return -1;
+        }
+    }
+    else
+        generateQueries(pathFinder, count, queries);
+
+    if (!outFile.empty())
+        writeQueries(outFile, queries);
+
+    Path path;
+    int found = 0;
+    long steps = 0;
+
+    const double start = getTime();
+    for (int r = 0; r < repeat; r++)
+    {
+        for (size_t i = 0; i < queries.size(); i++)
+        {
+            const Query &q = queries[i];
+            const bool result = (maxCost > 0)
+                ? pathFinder.findPath(q.startX, q.startY, q.destX, q.destY,
+                                      maxCost, path)
+                : pathFinder.findPath(q.startX, q.startY, q.destX, q.destY,
+                                      path);
+            if (result)
+            {
+                found++;
+                steps += path.size();
+            }
+        }
+    }
+    const double elapsed = getTime() - start;
+    const long total = (long) queries.size() * repeat;
+
+    std::cout<<"Map size:      "<<map->getWidth()<<"x"<<map->getHeight()<<std::endl
+             <<"Hierarchy:     "<<buildTime<<" s"<<std::endl
+             <<"Queries:       "<<queries.size()<<" x "<<repeat<<std::endl
+             <<"Paths found:   "<<found<<" ("<<(found ? steps / found : 0)<<" steps on average)"<<std::endl
+             <<"Elapsed:       "<<elapsed<<" s"<<std::endl
+             <<"Paths/second:  "<<(elapsed > 0 ? total / elapsed : 0)<<std::endl;
+
+    delete map;
+    return 0;
+}